@@ -0,0 +1,63 @@
+#include "core/bloom_filter.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace aegis::similarity {
+
+namespace {
+
+// Bits set per key within its word
+constexpr int BITS_PER_PATTERN = 5;
+
+/**
+ * SplitMix64 finalizer (window hashes of the legacy policy only use 30 bits).
+ */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Bit pattern of a key: BITS_PER_PATTERN bit positions taken from 6-bit
+ * slices of the upper hash bits (the low bits select the word).
+ */
+uint64_t pattern(const uint64_t mixed) {
+    uint64_t bits = 0;
+    for (int i = 0; i < BITS_PER_PATTERN; ++i) {
+        bits |= uint64_t{1} << ((mixed >> (34 + 6 * i)) & 63);
+    }
+    return bits;
+}
+
+}  // anonymous namespace
+
+BlockedBloomFilter::BlockedBloomFilter(const size_t expected_keys, const size_t bits_per_key)
+    : words_(std::bit_ceil(std::max<size_t>(expected_keys * bits_per_key / 64, 1)))
+    , mask_(words_.size() - 1)
+{
+    for (auto& word : words_) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool BlockedBloomFilter::insert(const uint64_t key) {
+    const uint64_t mixed = mix(key);
+    const uint64_t bits = pattern(mixed);
+    auto& word = words_[word_index(mixed)];
+    if ((word.load(std::memory_order_relaxed) & bits) == bits) {
+        return true;  // Fast path: no write to a shared cache line
+    }
+    return (word.fetch_or(bits, std::memory_order_relaxed) & bits) == bits;
+}
+
+bool BlockedBloomFilter::contains(const uint64_t key) const {
+    const uint64_t mixed = mix(key);
+    const uint64_t bits = pattern(mixed);
+    return (words_[word_index(mixed)].load(std::memory_order_relaxed) & bits) == bits;
+}
+
+}  // namespace aegis::similarity
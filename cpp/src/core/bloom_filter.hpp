@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * Register-blocked Bloom filter for 64-bit keys.
+ *
+ * All bits of a key live in a single 64-bit word, so a lookup or insert
+ * touches one cache line and one word. Inserting is an atomic fetch_or,
+ * which makes insert() a linearizable test-and-set: when several threads
+ * insert the same key, exactly one of them sees it as new. The price is a
+ * somewhat higher false-positive rate than a classic filter of equal size.
+ */
+class BlockedBloomFilter {
+public:
+    /**
+     * @param expected_keys Number of keys the filter is sized for
+     * @param bits_per_key Filter bits per expected key (rounded up so the
+     *        word count is a power of two)
+     */
+    explicit BlockedBloomFilter(size_t expected_keys, size_t bits_per_key = 16);
+
+    /**
+     * Insert a key. Safe to call concurrently.
+     *
+     * @return true if the key was (probably) already present
+     */
+    bool insert(uint64_t key);
+
+    /**
+     * Check whether a key was (probably) inserted. No false negatives.
+     */
+    [[nodiscard]] bool contains(uint64_t key) const;
+
+    /**
+     * Size of the bit array in bytes.
+     */
+    [[nodiscard]] size_t memory_bytes() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    [[nodiscard]] size_t word_index(uint64_t mixed) const { return mixed & mask_; }
+
+    std::vector<std::atomic<uint64_t>> words_;
+    size_t mask_;
+};
+
+}  // namespace aegis::similarity
@@ -11,9 +11,9 @@ CloneExtender::CloneExtender(const Config& config)
 }
 
 float CloneExtender::jaccard_similarity(
-    const std::vector<NormalizedToken>& tokens_a,
+    const TokenStore& tokens_a,
     const size_t start_a, const size_t count_a,
-    const std::vector<NormalizedToken>& tokens_b,
+    const TokenStore& tokens_b,
     const size_t start_b, const size_t count_b
 ) {
     if (count_a == 0 || count_b == 0) {
@@ -24,14 +24,16 @@ float CloneExtender::jaccard_similarity(
     std::unordered_multiset<uint32_t> set_a;
     std::unordered_multiset<uint32_t> set_b;
 
-    const size_t end_a = std::min(start_a + count_a, tokens_a.size());
-    const size_t end_b = std::min(start_b + count_b, tokens_b.size());
+    const auto hashes_a = tokens_a.normalized_hashes();
+    const auto hashes_b = tokens_b.normalized_hashes();
+    const size_t end_a = std::min(start_a + count_a, hashes_a.size());
+    const size_t end_b = std::min(start_b + count_b, hashes_b.size());
 
     for (size_t i = start_a; i < end_a; ++i) {
-        set_a.insert(tokens_a[i].normalized_hash);
+        set_a.insert(hashes_a[i]);
     }
     for (size_t i = start_b; i < end_b; ++i) {
-        set_b.insert(tokens_b[i].normalized_hash);
+        set_b.insert(hashes_b[i]);
     }
 
     // Calculate intersection size
@@ -58,9 +60,9 @@ float CloneExtender::jaccard_similarity(
 }
 
 float CloneExtender::alignment_similarity(
-    const std::vector<NormalizedToken>& tokens_a,
+    const TokenStore& tokens_a,
     const size_t start_a, const size_t count_a,
-    const std::vector<NormalizedToken>& tokens_b,
+    const TokenStore& tokens_b,
     const size_t start_b, const size_t count_b,
     const size_t max_gap
 ) {
@@ -68,15 +70,17 @@ float CloneExtender::alignment_similarity(
         return 0.0f;
     }
 
-    const size_t end_a = std::min(start_a + count_a, tokens_a.size());
-    const size_t end_b = std::min(start_b + count_b, tokens_b.size());
+    const auto hashes_a = tokens_a.normalized_hashes();
+    const auto hashes_b = tokens_b.normalized_hashes();
+    const size_t end_a = std::min(start_a + count_a, hashes_a.size());
+    const size_t end_b = std::min(start_b + count_b, hashes_b.size());
 
     size_t matches = 0;
     size_t pos_a = start_a;
     size_t pos_b = start_b;
 
     while (pos_a < end_a && pos_b < end_b) {
-        if (tokens_a[pos_a].normalized_hash == tokens_b[pos_b].normalized_hash) {
+        if (hashes_a[pos_a] == hashes_b[pos_b]) {
             ++matches;
             ++pos_a;
             ++pos_b;
@@ -86,7 +90,7 @@ float CloneExtender::alignment_similarity(
 
             // Look ahead in B
             for (size_t g = 1; g <= max_gap && pos_b + g < end_b; ++g) {
-                if (tokens_a[pos_a].normalized_hash == tokens_b[pos_b + g].normalized_hash) {
+                if (hashes_a[pos_a] == hashes_b[pos_b + g]) {
                     pos_b += g;
                     found = true;
                     break;
@@ -96,7 +100,7 @@ float CloneExtender::alignment_similarity(
             if (!found) {
                 // Look ahead in A
                 for (size_t g = 1; g <= max_gap && pos_a + g < end_a; ++g) {
-                    if (tokens_a[pos_a + g].normalized_hash == tokens_b[pos_b].normalized_hash) {
+                    if (hashes_a[pos_a + g] == hashes_b[pos_b]) {
                         pos_a += g;
                         found = true;
                         break;
@@ -116,13 +120,13 @@ float CloneExtender::alignment_similarity(
 }
 
 size_t CloneExtender::extend_forward(
-    const std::vector<NormalizedToken>& tokens_a, size_t pos_a,
-    const std::vector<NormalizedToken>& tokens_b, size_t pos_b
+    const std::span<const uint32_t> hashes_a, size_t pos_a,
+    const std::span<const uint32_t> hashes_b, size_t pos_b
 ) const {
     size_t extended = 0;
 
-    while (pos_a < tokens_a.size() && pos_b < tokens_b.size()) {
-        if (tokens_a[pos_a].normalized_hash == tokens_b[pos_b].normalized_hash) {
+    while (pos_a < hashes_a.size() && pos_b < hashes_b.size()) {
+        if (hashes_a[pos_a] == hashes_b[pos_b]) {
             ++extended;
             ++pos_a;
             ++pos_b;
@@ -131,11 +135,11 @@ size_t CloneExtender::extend_forward(
             bool resynced = false;
 
             // Look ahead in both sequences for a match
-            for (size_t la = 0; la <= config_.lookahead && pos_a + la < tokens_a.size(); ++la) {
-                for (size_t lb = 0; lb <= config_.lookahead && pos_b + lb < tokens_b.size(); ++lb) {
+            for (size_t la = 0; la <= config_.lookahead && pos_a + la < hashes_a.size(); ++la) {
+                for (size_t lb = 0; lb <= config_.lookahead && pos_b + lb < hashes_b.size(); ++lb) {
                     if (la == 0 && lb == 0) continue;
 
-                    if (tokens_a[pos_a + la].normalized_hash == tokens_b[pos_b + lb].normalized_hash) {
+                    if (hashes_a[pos_a + la] == hashes_b[pos_b + lb]) {
                         // Check if gap is acceptable
                         if (la <= config_.max_gap && lb <= config_.max_gap) {
                             pos_a += la;
@@ -157,8 +161,8 @@ size_t CloneExtender::extend_forward(
 }
 
 size_t CloneExtender::extend_backward(
-    const std::vector<NormalizedToken>& tokens_a, size_t pos_a,
-    const std::vector<NormalizedToken>& tokens_b, size_t pos_b
+    const std::span<const uint32_t> hashes_a, size_t pos_a,
+    const std::span<const uint32_t> hashes_b, size_t pos_b
 ) const {
     size_t extended = 0;
 
@@ -166,7 +170,7 @@ size_t CloneExtender::extend_backward(
         size_t check_a = pos_a - 1;
         size_t check_b = pos_b - 1;
 
-        if (tokens_a[check_a].normalized_hash == tokens_b[check_b].normalized_hash) {
+        if (hashes_a[check_a] == hashes_b[check_b]) {
             ++extended;
             --pos_a;
             --pos_b;
@@ -178,7 +182,7 @@ size_t CloneExtender::extend_backward(
                 for (size_t lb = 0; lb <= config_.lookahead && check_b >= lb; ++lb) {
                     if (la == 0 && lb == 0) continue;
 
-                    if (tokens_a[check_a - la].normalized_hash == tokens_b[check_b - lb].normalized_hash) {
+                    if (hashes_a[check_a - la] == hashes_b[check_b - lb]) {
                         if (la <= config_.max_gap && lb <= config_.max_gap) {
                             pos_a = check_a - la;
                             pos_b = check_b - lb;
@@ -214,12 +218,14 @@ ClonePair CloneExtender::extend(
     size_t end_b = start_b + pair.location_b.token_count;
 
     // Extend backward
-    size_t back_ext = extend_backward(tokens_a, start_a, tokens_b, start_b);
+    const auto hashes_a = tokens_a.normalized_hashes();
+    const auto hashes_b = tokens_b.normalized_hashes();
+    size_t back_ext = extend_backward(hashes_a, start_a, hashes_b, start_b);
     start_a -= back_ext;
     start_b -= back_ext;
 
     // Extend forward
-    const size_t fwd_ext = extend_forward(tokens_a, end_a, tokens_b, end_b);
+    const size_t fwd_ext = extend_forward(hashes_a, end_a, hashes_b, end_b);
     end_a += fwd_ext;
     end_b += fwd_ext;
 
@@ -243,31 +249,13 @@ ClonePair CloneExtender::extend(
     extended.location_b.token_count = static_cast<uint32_t>(end_b - start_b);
     extended.similarity = sim;
 
-    // Update line numbers
-    if (start_a < tokens_a.size()) {
-        extended.location_a.start_line = tokens_a[start_a].line;
-    }
-    if (end_a > 0 && end_a <= tokens_a.size()) {
-        extended.location_a.end_line = tokens_a[end_a - 1].line;
-    }
-    if (start_b < tokens_b.size()) {
-        extended.location_b.start_line = tokens_b[start_b].line;
-    }
-    if (end_b > 0 && end_b <= tokens_b.size()) {
-        extended.location_b.end_line = tokens_b[end_b - 1].line;
-    }
-
     // Determine a clone type
     if (sim >= 1.0f) {
         // Check if it's truly Type-1 or Type-2
-        bool all_match = true;
-        size_t count = std::min(end_a - start_a, end_b - start_b);
-        for (size_t i = 0; i < count; ++i) {
-            if (tokens_a[start_a + i].original_hash != tokens_b[start_b + i].original_hash) {
-                all_match = false;
-                break;
-            }
-        }
+        const size_t count = std::min(end_a - start_a, end_b - start_b);
+        const bool all_match = std::ranges::equal(
+            tokens_a.original_hashes().subspan(start_a, count),
+            tokens_b.original_hashes().subspan(start_b, count));
         extended.clone_type = all_match ? CloneType::TYPE_1 : CloneType::TYPE_2;
     } else {
         extended.clone_type = CloneType::TYPE_3;
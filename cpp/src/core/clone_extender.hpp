@@ -2,6 +2,7 @@
 
 #include "models/clone_types.hpp"
 #include "core/hash_index.hpp"
+#include <span>
 #include <vector>
 
 
@@ -76,9 +77,9 @@ public:
      * @return Similarity score 0.0 to 1.0
      */
     static float jaccard_similarity(
-        const std::vector<NormalizedToken>& tokens_a,
+        const TokenStore& tokens_a,
         size_t start_a, size_t count_a,
-        const std::vector<NormalizedToken>& tokens_b,
+        const TokenStore& tokens_b,
         size_t start_b, size_t count_b
     );
 
@@ -91,9 +92,9 @@ public:
      * @return Similarity score 0.0 to 1.0
      */
     static float alignment_similarity(
-        const std::vector<NormalizedToken>& tokens_a,
+        const TokenStore& tokens_a,
         size_t start_a, size_t count_a,
-        const std::vector<NormalizedToken>& tokens_b,
+        const TokenStore& tokens_b,
         size_t start_b, size_t count_b,
         size_t max_gap = 5
     );
@@ -117,14 +118,14 @@ private:
 
     // Extend forward from the current position
     [[nodiscard]] size_t extend_forward(
-        const std::vector<NormalizedToken>& tokens_a, size_t pos_a,
-        const std::vector<NormalizedToken>& tokens_b, size_t pos_b
+        std::span<const uint32_t> hashes_a, size_t pos_a,
+        std::span<const uint32_t> hashes_b, size_t pos_b
     ) const;
 
     // Extend backward from the current position
     [[nodiscard]] size_t extend_backward(
-        const std::vector<NormalizedToken>& tokens_a, size_t pos_a,
-        const std::vector<NormalizedToken>& tokens_b, size_t pos_b
+        std::span<const uint32_t> hashes_a, size_t pos_a,
+        std::span<const uint32_t> hashes_b, size_t pos_b
     ) const;
 };
 
@@ -0,0 +1,67 @@
+#include "core/count_min_sketch.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+namespace aegis::similarity {
+
+namespace {
+
+/**
+ * SplitMix64 finalizer; rows use different seeds of the same mixer.
+ */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+}  // anonymous namespace
+
+CountMinSketch::CountMinSketch(const size_t width, const size_t depth)
+    : width_(std::bit_ceil(std::max<size_t>(width, 1)))
+    , depth_(std::max<size_t>(depth, 1))
+    , counters_(width_ * depth_, 0)
+{
+}
+
+size_t CountMinSketch::slot(const uint64_t key, const size_t row) const {
+    const uint64_t seed = 0x9E3779B97F4A7C15ULL * (row + 1);
+    return row * width_ + (mix(key + seed) & (width_ - 1));
+}
+
+void CountMinSketch::add(const uint64_t key) {
+    for (size_t row = 0; row < depth_; ++row) {
+        auto& counter = counters_[slot(key, row)];
+        if (counter != std::numeric_limits<uint32_t>::max()) {
+            ++counter;
+        }
+    }
+    ++total_;
+}
+
+uint32_t CountMinSketch::estimate(const uint64_t key) const {
+    uint32_t result = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < depth_; ++row) {
+        result = std::min(result, counters_[slot(key, row)]);
+    }
+    return result;
+}
+
+void CountMinSketch::merge(const CountMinSketch& other) {
+    if (other.width_ != width_ || other.depth_ != depth_) {
+        throw std::invalid_argument("CountMinSketch dimensions differ");
+    }
+    for (size_t i = 0; i < counters_.size(); ++i) {
+        const uint64_t sum = static_cast<uint64_t>(counters_[i]) + other.counters_[i];
+        counters_[i] = static_cast<uint32_t>(
+            std::min<uint64_t>(sum, std::numeric_limits<uint32_t>::max()));
+    }
+    total_ += other.total_;
+}
+
+}  // namespace aegis::similarity
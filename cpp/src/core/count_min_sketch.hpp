@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * Count-min sketch for approximate frequency counting of 64-bit keys.
+ *
+ * Keeps depth rows of width counters; a key increments one counter per
+ * row and its estimate is the minimum over its counters. Estimates never
+ * undercount, and overcount by at most e * total / width with probability
+ * 1 - e^-depth. Memory is fixed regardless of the number of distinct keys.
+ */
+class CountMinSketch {
+public:
+    /**
+     * @param width Counters per row (rounded up to a power of two)
+     * @param depth Number of rows (independent hash functions)
+     */
+    explicit CountMinSketch(size_t width = 1 << 16, size_t depth = 4);
+
+    /**
+     * Count one occurrence of key.
+     */
+    void add(uint64_t key);
+
+    /**
+     * Estimated number of occurrences of key (never below the true count).
+     */
+    [[nodiscard]] uint32_t estimate(uint64_t key) const;
+
+    /**
+     * Add the counters of another sketch with the same dimensions.
+     *
+     * @throws std::invalid_argument if the dimensions differ
+     */
+    void merge(const CountMinSketch& other);
+
+    [[nodiscard]] size_t width() const { return width_; }
+    [[nodiscard]] size_t depth() const { return depth_; }
+
+    /**
+     * Total number of add() calls (including merged sketches).
+     */
+    [[nodiscard]] uint64_t total() const { return total_; }
+
+private:
+    [[nodiscard]] size_t slot(uint64_t key, size_t row) const;
+
+    size_t width_;
+    size_t depth_;
+    std::vector<uint32_t> counters_;  // depth_ rows of width_ counters
+    uint64_t total_ = 0;
+};
+
+}  // namespace aegis::similarity
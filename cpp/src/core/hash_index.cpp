@@ -1,15 +1,420 @@
 #include "core/hash_index.hpp"
+#include "core/bloom_filter.hpp"
+#include "core/count_min_sketch.hpp"
 #include "core/rolling_hash.hpp"
+#include "core/seed_chainer.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
 #include <ranges>
+#include <stdexcept>
+#include <type_traits>
 
 namespace aegis::similarity {
 
+namespace {
+
+// Index file layout (all integers in host byte order, checked on open):
+//   header | file table | hashes (u64) | offsets (u32) | locations
+// Every section starts on an INDEX_ALIGNMENT boundary so the CSR arrays
+// can be used directly from the mapping.
+constexpr std::array<char, 8> INDEX_MAGIC = {'A', 'E', 'G', 'I', 'S', 'I', 'D', 'X'};
+constexpr uint32_t INDEX_VERSION = 2;  // 2: locations hold token ranges only
+constexpr uint32_t INDEX_BYTE_ORDER = 0x01020304;
+constexpr uint64_t INDEX_ALIGNMENT = 64;
+
+struct IndexFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t location_size;      // sizeof(HashLocation) of the writer
+    uint64_t file_size;
+    uint64_t config_fingerprint;
+    uint64_t file_count;
+    uint64_t hash_count;
+    uint64_t location_count;
+    uint64_t file_table_offset;
+    uint64_t hashes_offset;
+    uint64_t offsets_offset;
+    uint64_t locations_offset;
+    uint64_t thinned_hashes;
+    uint64_t thinned_locations;
+    uint64_t dropped_singletons;
+};
+
+static_assert(std::is_trivially_copyable_v<IndexFileHeader>);
+static_assert(std::is_trivially_copyable_v<HashLocation>);
+static_assert(alignof(HashLocation) <= INDEX_ALIGNMENT);
+
+// Fixed part of a file table entry: content hash, mtime, size, path length
+constexpr size_t FILE_ENTRY_FIXED_SIZE = 3 * sizeof(uint64_t) + sizeof(uint32_t);
+
+uint64_t align_up(const uint64_t offset) {
+    return (offset + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+}
+
+/**
+ * Sequential writer that tracks the file offset for section alignment.
+ */
+class IndexWriter {
+public:
+    explicit IndexWriter(std::ofstream& out) : out_(out) {}
+
+    void write(const void* data, const size_t size) {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        offset_ += size;
+    }
+
+    template<typename T>
+    void write_value(const T& value) {
+        write(&value, sizeof(T));
+    }
+
+    void pad_to(const uint64_t target) {
+        static constexpr std::array<char, INDEX_ALIGNMENT> zeros{};
+        while (offset_ < target) {
+            write(zeros.data(), std::min<uint64_t>(target - offset_, zeros.size()));
+        }
+    }
+
+    [[nodiscard]] uint64_t offset() const { return offset_; }
+
+private:
+    std::ofstream& out_;
+    uint64_t offset_ = 0;
+};
+
+/**
+ * Sort key for the frozen build: hash plus the index of its record.
+ * Sorting 16-byte keys and gathering locations afterwards moves far less
+ * memory than sorting the 40-byte records themselves.
+ */
+struct SortKey {
+    uint64_t hash;
+    uint64_t record;
+};
+
+/**
+ * Stable LSD radix sort of keys by hash (8-bit digits).
+ * All digit histograms are built in a single pass, and passes where every
+ * key shares the same digit are skipped.
+ */
+void radix_sort_keys(std::span<SortKey> keys) {
+    constexpr size_t DIGITS = sizeof(uint64_t);
+    constexpr size_t RADIX = 256;
+
+    if (keys.size() < 2) {
+        return;
+    }
+
+    std::vector<std::array<size_t, RADIX>> counts(DIGITS);
+    for (auto& histogram : counts) {
+        histogram.fill(0);
+    }
+    for (const auto& key : keys) {
+        for (size_t d = 0; d < DIGITS; ++d) {
+            counts[d][(key.hash >> (d * 8)) & 0xFF]++;
+        }
+    }
+
+    std::vector<SortKey> scratch(keys.size());
+    SortKey* src = keys.data();
+    SortKey* dst = scratch.data();
+    for (size_t d = 0; d < DIGITS; ++d) {
+        auto& histogram = counts[d];
+        const uint8_t first_digit = (src[0].hash >> (d * 8)) & 0xFF;
+        if (histogram[first_digit] == keys.size()) {
+            continue;  // Every key has the same digit, nothing to reorder
+        }
+
+        size_t offset = 0;
+        for (auto& count : histogram) {
+            const size_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            dst[histogram[(src[i].hash >> (d * 8)) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != keys.data()) {
+        std::copy(src, src + keys.size(), keys.data());
+    }
+}
+
+// Parallel freeze splits records into 2^SHARD_BITS hash ranges
+constexpr size_t SHARD_BITS = 8;
+constexpr size_t PARALLEL_FREEZE_MIN_RECORDS = 1 << 16;
+
+/**
+ * Hashes that appear once produce no pairs. Stop hashes (likely trivial
+ * patterns like 'return', 'if', etc.) only produce pairs in SAMPLE mode.
+ */
+bool is_pair_source(
+    const std::span<const HashLocation> locations,
+    const StopHashPolicy& policy,
+    const size_t threshold
+) {
+    return locations.size() >= 2 &&
+           (locations.size() <= threshold || policy.mode == StopHashMode::SAMPLE);
+}
+
+/**
+ * Whether SAMPLE mode keeps one location of a stop hash seen count times.
+ * The draw is keyed by hash and position, so the in-memory build and the
+ * spilled merge keep the same locations.
+ */
+bool keeps_sampled_location(
+    const uint64_t hash,
+    const HashLocation& location,
+    const size_t count,
+    const size_t sample_size
+) {
+    const uint64_t key = hash ^ (static_cast<uint64_t>(location.file_id) << 32 | location.token_start);
+    return (key * 0x9E3779B97F4A7C15ULL >> 32) % count < sample_size;
+}
+
+/**
+ * Bounded pair buffer that hands full batches to a visitor, sorted by
+ * file pair.
+ */
+class PairBatch {
+public:
+    PairBatch(const ClonePairVisitor& visitor, const size_t capacity)
+        : visitor_(visitor)
+        , capacity_(std::max<size_t>(capacity, 1))
+    {
+        pairs_.reserve(std::min<size_t>(capacity_, 4096));
+    }
+
+    void push(const ClonePair& pair) {
+        pairs_.push_back(pair);
+        if (pairs_.size() >= capacity_) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (pairs_.empty()) {
+            return;
+        }
+        peak_ = std::max(peak_, pairs_.size());
+        emitted_ += pairs_.size();
+        std::ranges::sort(pairs_, {}, [](const ClonePair& pair) {
+            const auto a = pair.location_a.file_id;
+            const auto b = pair.location_b.file_id;
+            return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+        });
+        visitor_(pairs_);
+        pairs_.clear();
+    }
+
+    size_t emitted() const { return emitted_; }
+    size_t peak() const { return peak_; }
+
+private:
+    const ClonePairVisitor& visitor_;
+    size_t capacity_;
+    std::vector<ClonePair> pairs_;
+    size_t emitted_ = 0;
+    size_t peak_ = 0;
+};
+
+/**
+ * Emit all non-overlapping location pairs of one hash bucket. Stop hashes
+ * in SAMPLE mode pair up sample_size evenly spaced locations instead.
+ * With a file filter, only pairs touching a marked file are emitted.
+ */
+void emit_bucket_pairs(
+    const uint64_t hash,
+    const std::span<const HashLocation> locations,
+    const StopHashPolicy& policy,
+    const size_t threshold,
+    PairBatch& batch,
+    const std::vector<bool>* files = nullptr
+) {
+    const auto marked = [files](const HashLocation& loc) {
+        return loc.file_id < files->size() && (*files)[loc.file_id];
+    };
+
+    const size_t count = locations.size() > threshold
+        ? std::min(locations.size(), std::max<size_t>(policy.sample_size, 2))
+        : locations.size();
+    const auto location = [&](const size_t k) -> const HashLocation& {
+        return locations[k * locations.size() / count];
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            const auto& loc_a = location(i);
+            const auto& loc_b = location(j);
+
+            // Skip self-overlapping matches (same file, overlapping region)
+            if (loc_a.file_id == loc_b.file_id && loc_a.overlaps(loc_b)) {
+                continue;
+            }
+            if (files && !marked(loc_a) && !marked(loc_b)) {
+                continue;
+            }
+
+            ClonePair pair{};
+            pair.location_a = loc_a;
+            pair.location_b = loc_b;
+            pair.clone_type = CloneType::TYPE_1;  // Initial classification
+            pair.similarity = 1.0f;  // Exact match
+            pair.shared_hash = hash;
+
+            batch.push(pair);
+        }
+    }
+}
+
+/**
+ * Stop hash bucket as a clone class, locations sorted by file and position.
+ */
+CloneClass make_clone_class(const uint64_t hash, const std::span<const HashLocation> locations) {
+    CloneClass clone_class{};
+    clone_class.locations.assign(locations.begin(), locations.end());
+    std::ranges::sort(clone_class.locations, [](const HashLocation& a, const HashLocation& b) {
+        if (a.file_id != b.file_id) return a.file_id < b.file_id;
+        return a.token_start < b.token_start;
+    });
+    clone_class.clone_type = CloneType::TYPE_1;
+    clone_class.shared_hash = hash;
+    return clone_class;
+}
+
+/**
+ * Order of records in spilled runs: hash, then file and position.
+ */
+bool run_order(const HashRecord& a, const HashRecord& b) {
+    if (a.hash != b.hash) return a.hash < b.hash;
+    if (a.location.file_id != b.location.file_id) return a.location.file_id < b.location.file_id;
+    return a.location.token_start < b.location.token_start;
+}
+
+/**
+ * Read position in a sorted run, either a run file read through a
+ * bounded buffer or records already in memory.
+ */
+class RunCursor {
+public:
+    RunCursor(const std::filesystem::path& path, const size_t buffer_records)
+        : path_(path)
+        , in_(path, std::ios::binary)
+        , buffer_(buffer_records)
+    {
+        if (!in_) {
+            throw std::runtime_error("Cannot read spill run " + path.string());
+        }
+        refill();
+    }
+
+    explicit RunCursor(const std::span<const HashRecord> records)
+        : current_(records)
+    {}
+
+    [[nodiscard]] bool done() const { return pos_ == current_.size(); }
+    [[nodiscard]] const HashRecord& peek() const { return current_[pos_]; }
+
+    void advance() {
+        if (++pos_ == current_.size() && in_.is_open()) {
+            refill();
+        }
+    }
+
+private:
+    std::filesystem::path path_;
+    std::ifstream in_;
+    std::vector<HashRecord> buffer_;
+    std::span<const HashRecord> current_;
+    size_t pos_ = 0;
+
+    void refill() {
+        in_.read(reinterpret_cast<char*>(buffer_.data()),
+                 static_cast<std::streamsize>(buffer_.size() * sizeof(HashRecord)));
+        const auto bytes = static_cast<size_t>(in_.gcount());
+        if (in_.bad() || bytes % sizeof(HashRecord) != 0) {
+            throw std::runtime_error("Truncated spill run " + path_.string());
+        }
+        current_ = std::span<const HashRecord>(buffer_.data(), bytes / sizeof(HashRecord));
+        pos_ = 0;
+    }
+};
+
+/**
+ * K-way merge of sorted runs; records are passed to emit in run order.
+ */
+template<typename F>
+void merge_runs(std::vector<RunCursor>& cursors, F&& emit) {
+    const auto later = [&cursors](const size_t a, const size_t b) {
+        return run_order(cursors[b].peek(), cursors[a].peek());
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (!cursors[i].done()) {
+            heap.push(i);
+        }
+    }
+    while (!heap.empty()) {
+        const size_t i = heap.top();
+        heap.pop();
+        emit(cursors[i].peek());
+        cursors[i].advance();
+        if (!cursors[i].done()) {
+            heap.push(i);
+        }
+    }
+}
+
+/**
+ * Write records to a new run file.
+ */
+void write_run(const std::filesystem::path& path, const std::span<const HashRecord> records) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size_bytes()));
+    if (!out) {
+        throw std::runtime_error("Cannot write spill run " + path.string());
+    }
+}
+
+}  // anonymous namespace
+
 void HashIndex::clear() {
     index_.clear();
+    frozen_hashes_.clear();
+    frozen_offsets_.clear();
+    frozen_locations_.clear();
+    frozen_ = false;
+    csr_owner_.reset();
+    shared_hashes_ = {};
+    shared_offsets_ = {};
+    shared_locations_ = {};
+    mapped_ = false;
+    mutable_locations_ = 0;
+    thinned_hashes_ = 0;
+    thinned_locations_ = 0;
+    dropped_singletons_ = 0;
     file_paths_.clear();
     path_to_id_.clear();
+    removed_.clear();
+    file_locations_.clear();
+    file_locations_known_ = true;
+    dead_locations_ = 0;
+    free_file_ids_.clear();
+    pending_ = {};
 }
 
 uint32_t HashIndex::register_file(const std::string& path) {
@@ -18,8 +423,17 @@ uint32_t HashIndex::register_file(const std::string& path) {
         return it->second;
     }
 
-    const auto id = static_cast<uint32_t>(file_paths_.size());
-    file_paths_.push_back(path);
+    uint32_t id;
+    if (!free_file_ids_.empty()) {
+        // Compaction purged every location of this ID, so reuse is safe
+        id = free_file_ids_.back();
+        free_file_ids_.pop_back();
+        file_paths_[id] = path;
+        removed_[id] = 0;
+    } else {
+        id = static_cast<uint32_t>(file_paths_.size());
+        file_paths_.push_back(path);
+    }
     path_to_id_[path] = id;
     return id;
 }
@@ -33,234 +447,822 @@ const std::string& HashIndex::get_file_path(uint32_t file_id) const {
 }
 
 void HashIndex::add_hash(const uint64_t hash, const HashLocation& location) {
+    if (compaction_pending()) {
+        finish_compaction();
+    }
+    if (frozen_) {
+        thaw();
+    }
     index_[hash].push_back(location);
+    ++mutable_locations_;
+    if (file_locations_known_) {
+        if (location.file_id >= file_locations_.size()) {
+            file_locations_.resize(location.file_id + 1, 0);
+        }
+        ++file_locations_[location.file_id];
+    }
+    if (is_removed(location.file_id)) {
+        ++dead_locations_;
+    }
 }
 
-const std::vector<HashLocation>* HashIndex::get_locations(const uint64_t hash) const {
+std::vector<HashLocation> HashIndex::get_locations(const uint64_t hash) const {
+    std::vector<HashLocation> locations;
+    live_locations(stored_locations(hash), locations);
+    return locations;
+}
+
+size_t HashIndex::live_location_count(const uint64_t hash) const {
+    const auto stored = stored_locations(hash);
+    if (dead_locations_ == 0) {
+        return stored.size();
+    }
+    return static_cast<size_t>(std::ranges::count_if(stored, [this](const HashLocation& location) {
+        return is_live(location);
+    }));
+}
+
+std::span<const HashLocation> HashIndex::stored_locations(const uint64_t hash) const {
+    if (frozen_) {
+        const auto hashes = csr_hashes();
+        const auto offsets = csr_offsets();
+        const auto it = std::ranges::lower_bound(hashes, hash);
+        if (it == hashes.end() || *it != hash) {
+            return {};
+        }
+        const auto bucket = static_cast<size_t>(it - hashes.begin());
+        return csr_locations().subspan(offsets[bucket], offsets[bucket + 1] - offsets[bucket]);
+    }
+
     auto it = index_.find(hash);
     if (it == index_.end()) {
-        return nullptr;
+        return {};
     }
-    return &it->second;
+    return it->second;
 }
 
 size_t HashIndex::location_count() const {
-    size_t count = 0;
-    for (const auto& locations : index_ | std::views::values) {
-        count += locations.size();
-    }
-    return count;
+    const size_t stored = frozen_ ? csr_locations().size() : mutable_locations_;
+    return stored - dead_locations_;
 }
 
-std::vector<ClonePair> HashIndex::find_clone_pairs([[maybe_unused]] size_t min_matches) const {
-    std::vector<ClonePair> results;
-
-    // Limit to prevent combinatorial explosion (N locations = N*(N-1)/2 pairs)
-    // 500 locations = 124,750 pairs which is manageable
-    // 5000 locations = 12.5M pairs which causes OOM
+size_t HashIndex::remove_file_locations(const uint32_t file_id, const std::span<const uint64_t> hashes) {
+    if (compaction_pending()) {
+        finish_compaction();
+    }
+    if (frozen_) {
+        thaw();
+    }
 
-    for (const auto& [hash, locations] : index_) {
-        // Skip hashes that don't appear multiple times
-        if (locations.size() < 2) {
+    size_t removed = 0;
+    for (const uint64_t hash : hashes) {
+        const auto it = index_.find(hash);
+        if (it == index_.end()) {
             continue;
         }
+        removed += std::erase_if(it->second, [file_id](const HashLocation& loc) {
+            return loc.file_id == file_id;
+        });
+        if (it->second.empty()) {
+            index_.erase(it);
+        }
+    }
+    mutable_locations_ -= removed;
+    if (file_locations_known_ && file_id < file_locations_.size()) {
+        file_locations_[file_id] -= removed;
+        if (is_removed(file_id) && removed > 0) {
+            dead_locations_ -= removed;
+            if (file_locations_[file_id] == 0) {
+                free_file_ids_.push_back(file_id);
+            }
+        }
+    }
+    return removed;
+}
 
-        // Skip overly common hashes (likely trivial patterns like 'return', 'if', etc.)
-        // These cause O(N^2) explosion and aren't useful for clone detection
-        if (constexpr size_t MAX_LOCATIONS_PER_HASH = 500; locations.size() > MAX_LOCATIONS_PER_HASH) {
-            continue;
+void HashIndex::remove_file(const uint32_t file_id, ThreadPool* pool) {
+    if (file_id >= file_paths_.size() || is_removed(file_id)) {
+        return;
+    }
+
+    // Install a finished background compaction, but never wait for one
+    if (compaction_pending() &&
+        pending_.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        finish_compaction();
+    }
+    if (!file_locations_known_) {
+        count_file_locations();
+    }
+
+    removed_.resize(file_paths_.size(), 0);
+    removed_[file_id] = 1;
+    const size_t stored = file_id < file_locations_.size() ? file_locations_[file_id] : 0;
+    dead_locations_ += stored;
+    path_to_id_.erase(file_paths_[file_id]);
+    file_paths_[file_id].clear();
+    if (stored == 0) {
+        free_file_ids_.push_back(file_id);
+    }
+
+    if (!compaction_pending() && dead_locations_ > 0 &&
+        tombstone_ratio() >= compaction_threshold_) {
+        if (pool && frozen_) {
+            compact_async(*pool);
+        } else {
+            compact();
         }
+    }
+}
 
-        // Generate pairs from all combinations
-        for (size_t i = 0; i < locations.size(); ++i) {
-            for (size_t j = i + 1; j < locations.size(); ++j) {
-                const auto& loc_a = locations[i];
-                const auto& loc_b = locations[j];
+double HashIndex::tombstone_ratio() const {
+    const size_t stored = location_count() + dead_locations_;
+    return stored == 0 ? 0.0 : static_cast<double>(dead_locations_) / static_cast<double>(stored);
+}
 
-                // Skip self-overlapping matches (same file, overlapping region)
-                if (loc_a.file_id == loc_b.file_id && loc_a.overlaps(loc_b)) {
-                    continue;
-                }
+void HashIndex::compact() {
+    finish_compaction();
+    if (dead_locations_ == 0) {
+        return;
+    }
+
+    const auto purged = removed_;
+    if (frozen_) {
+        install_compacted(compact_arrays(csr_hashes(), csr_offsets(), csr_locations(), purged), purged);
+        return;
+    }
+    for (auto it = index_.begin(); it != index_.end();) {
+        std::erase_if(it->second, [this](const HashLocation& location) {
+            return !is_live(location);
+        });
+        it = it->second.empty() ? index_.erase(it) : std::next(it);
+    }
+    mutable_locations_ -= dead_locations_;
+    release_purged_files(purged);
+}
+
+void HashIndex::compact_async(ThreadPool& pool) {
+    if (compaction_pending() || dead_locations_ == 0) {
+        return;
+    }
+    if (!frozen_) {
+        compact();
+        return;
+    }
+
+    // Owned arrays move into a snapshot that keeps serving reads meanwhile
+    if (!csr_owner_) {
+        auto snapshot = std::make_shared<CsrArrays>();
+        snapshot->hashes = std::move(frozen_hashes_);
+        snapshot->offsets = std::move(frozen_offsets_);
+        snapshot->locations = std::move(frozen_locations_);
+        frozen_hashes_.clear();
+        frozen_offsets_.clear();
+        frozen_locations_.clear();
+        shared_hashes_ = snapshot->hashes;
+        shared_offsets_ = snapshot->offsets;
+        shared_locations_ = snapshot->locations;
+        csr_owner_ = std::move(snapshot);
+    }
 
-                ClonePair pair{};
-                pair.location_a = loc_a;
-                pair.location_b = loc_b;
-                pair.clone_type = CloneType::TYPE_1;  // Initial classification
-                pair.similarity = 1.0f;  // Exact match
-                pair.shared_hash = hash;
+    // The task holds its own reference to the storage and the tombstones
+    pending_.removed = removed_;
+    pending_.result = pool.submit([owner = csr_owner_,
+                                   hashes = shared_hashes_,
+                                   offsets = shared_offsets_,
+                                   locations = shared_locations_,
+                                   removed = pending_.removed] {
+        return compact_arrays(hashes, offsets, locations, removed);
+    });
+}
 
-                results.push_back(pair);
+void HashIndex::finish_compaction() {
+    if (!compaction_pending()) {
+        return;
+    }
+    auto arrays = pending_.result.get();
+    const auto purged = std::move(pending_.removed);
+    pending_ = {};
+    install_compacted(std::move(arrays), purged);
+}
+
+HashIndex::CsrArrays HashIndex::compact_arrays(
+    const std::span<const uint64_t> hashes,
+    const std::span<const uint32_t> offsets,
+    const std::span<const HashLocation> locations,
+    const std::vector<uint8_t>& removed
+) {
+    const auto is_purged = [&removed](const HashLocation& location) {
+        return location.file_id < removed.size() && removed[location.file_id] != 0;
+    };
+
+    CsrArrays arrays;
+    arrays.locations.reserve(static_cast<size_t>(
+        std::ranges::count_if(locations, [&](const HashLocation& l) { return !is_purged(l); })));
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const auto begin = static_cast<uint32_t>(arrays.locations.size());
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            if (!is_purged(locations[k])) {
+                arrays.locations.push_back(locations[k]);
             }
         }
+        if (arrays.locations.size() > begin) {
+            arrays.hashes.push_back(hashes[i]);
+            arrays.offsets.push_back(begin);
+        }
     }
-
-    return results;
+    arrays.offsets.push_back(static_cast<uint32_t>(arrays.locations.size()));
+    return arrays;
 }
 
-std::vector<ClonePair> HashIndex::find_clone_pairs_parallel(
-    ThreadPool& pool,
-    const size_t min_matches
-) const {
-    // Limit to prevent combinatorial explosion (same as sequential version)
-    // Collect all hashes with multiple locations into a vector for partitioning
-    // Filter out overly common hashes that would cause memory explosion
-    std::vector<std::pair<uint64_t, const std::vector<HashLocation>*>> work_items;
-    work_items.reserve(index_.size());
+void HashIndex::install_compacted(CsrArrays arrays, const std::vector<uint8_t>& purged) {
+    frozen_hashes_ = std::move(arrays.hashes);
+    frozen_offsets_ = std::move(arrays.offsets);
+    frozen_locations_ = std::move(arrays.locations);
+    frozen_ = true;
+    csr_owner_.reset();
+    shared_hashes_ = {};
+    shared_offsets_ = {};
+    shared_locations_ = {};
+    mapped_ = false;
+    release_purged_files(purged);
+}
 
-    for (const auto& [hash, locations] : index_) {
-        // Only include hashes with 2+ locations but not too many
-        if (constexpr size_t MAX_LOCATIONS_PER_HASH = 500; locations.size() >= 2 && locations.size() <= MAX_LOCATIONS_PER_HASH) {
-            work_items.emplace_back(hash, &locations);
+void HashIndex::release_purged_files(const std::vector<uint8_t>& purged) {
+    // Files removed after the snapshot keep their tombstoned locations
+    for (uint32_t file_id = 0; file_id < purged.size(); ++file_id) {
+        if (purged[file_id] == 0 || !is_removed(file_id) ||
+            file_id >= file_locations_.size() || file_locations_[file_id] == 0) {
+            continue;
         }
+        dead_locations_ -= file_locations_[file_id];
+        file_locations_[file_id] = 0;
+        free_file_ids_.push_back(file_id);
     }
+}
 
-    // For small workloads, use sequential processing
-    if (work_items.size() < 100 || pool.size() <= 1) {
-        return find_clone_pairs(min_matches);
+void HashIndex::count_file_locations() {
+    file_locations_.assign(file_paths_.size(), 0);
+    for_each_stored_bucket([this](uint64_t, std::span<const HashLocation> locations) {
+        for (const auto& location : locations) {
+            if (location.file_id >= file_locations_.size()) {
+                file_locations_.resize(location.file_id + 1, 0);
+            }
+            ++file_locations_[location.file_id];
+        }
+    });
+    dead_locations_ = 0;
+    for (uint32_t file_id = 0; file_id < file_locations_.size(); ++file_id) {
+        if (is_removed(file_id)) {
+            dead_locations_ += file_locations_[file_id];
+        }
     }
+    file_locations_known_ = true;
+}
+
+void HashIndex::freeze(std::vector<HashRecord> records) {
+    std::vector<std::vector<HashRecord>> record_groups;
+    record_groups.push_back(std::move(records));
+    build_frozen(std::move(record_groups), nullptr);
+}
+
+void HashIndex::freeze(std::vector<std::vector<HashRecord>> record_groups, ThreadPool& pool) {
+    build_frozen(std::move(record_groups), &pool);
+}
 
-    // Thread-local results to avoid contention
-    std::vector<std::vector<ClonePair>> thread_results(pool.size());
-    std::mutex results_mutex;
+void HashIndex::build_frozen(
+    std::vector<std::vector<HashRecord>> record_groups,
+    ThreadPool* pool
+) {
+    if (compaction_pending()) {
+        finish_compaction();
+    }
 
-    // Process work items in parallel
-    pool.parallel_for(0, work_items.size(), [&](size_t idx) {
-        const auto& [hash, locations_ptr] = work_items[idx];
-        const auto& locations = *locations_ptr;
+    // Fold any mutable entries (and a previous frozen layout) in as the first group
+    if (frozen_) {
+        thaw();
+    }
+    if (!index_.empty()) {
+        std::vector<HashRecord> existing;
+        existing.reserve(mutable_locations_);
+        for (const auto& [hash, locations] : index_) {
+            for (const auto& location : locations) {
+                existing.push_back({hash, location});
+            }
+        }
+        record_groups.insert(record_groups.begin(), std::move(existing));
+        index_.clear();
+        mutable_locations_ = 0;
+    }
 
-        std::vector<ClonePair> local_results;
+    size_t total = 0;
+    for (const auto& group : record_groups) {
+        total += group.size();
+    }
 
-        // Generate pairs from all combinations
-        for (size_t i = 0; i < locations.size(); ++i) {
-            for (size_t j = i + 1; j < locations.size(); ++j) {
-                const auto& loc_a = locations[i];
-                const auto& loc_b = locations[j];
+    frozen_hashes_.clear();
+    frozen_offsets_.clear();
+    frozen_locations_.clear();
+    frozen_ = true;
+    if (total == 0) {
+        frozen_offsets_.push_back(0);
+        count_file_locations();
+        return;
+    }
 
-                // Skip self-overlapping matches
-                if (loc_a.file_id == loc_b.file_id && loc_a.overlaps(loc_b)) {
-                    continue;
-                }
+    // Small inputs use a single shard and stay on the calling thread
+    const bool parallel = pool && pool->size() > 1 && total >= PARALLEL_FREEZE_MIN_RECORDS;
+    const size_t shard_bits = parallel ? SHARD_BITS : 0;
+    const size_t shard_count = size_t{1} << shard_bits;
+    const auto shard_of = [shard_bits](const uint64_t hash) -> size_t {
+        return shard_bits == 0 ? 0 : static_cast<size_t>(hash >> (64 - shard_bits));
+    };
+    const auto for_each_task = [pool, parallel](const size_t count, auto&& task) {
+        if (parallel) {
+            pool->parallel_for(0, count, task);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                task(i);
+            }
+        }
+    };
+
+    // Groups are split into contiguous blocks, each with its own shard histogram
+    const size_t group_count = record_groups.size();
+    const size_t block_count = parallel ? std::min(group_count, pool->size() * 4) : 1;
+    const auto block_begin = [group_count, block_count](const size_t block) {
+        return block * group_count / block_count;
+    };
+
+    std::vector<std::vector<size_t>> block_cursors(block_count, std::vector<size_t>(shard_count, 0));
+    for_each_task(block_count, [&](const size_t block) {
+        auto& histogram = block_cursors[block];
+        for (size_t g = block_begin(block); g < block_begin(block + 1); ++g) {
+            for (const auto& record : record_groups[g]) {
+                histogram[shard_of(record.hash)]++;
+            }
+        }
+    });
 
-                ClonePair pair{};
-                pair.location_a = loc_a;
-                pair.location_b = loc_b;
-                pair.clone_type = CloneType::TYPE_1;
-                pair.similarity = 1.0f;
-                pair.shared_hash = hash;
+    // Shard-major prefix sums: within a shard, earlier blocks come first, so
+    // the scatter preserves group order and the stable sort keeps it
+    std::vector<size_t> shard_begin(shard_count + 1, 0);
+    size_t offset = 0;
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        shard_begin[shard] = offset;
+        for (auto& cursors : block_cursors) {
+            const size_t count = cursors[shard];
+            cursors[shard] = offset;
+            offset += count;
+        }
+    }
+    shard_begin[shard_count] = offset;
+
+    // Record references pack (group, index) into the 64-bit key payload
+    std::vector<SortKey> keys(total);
+    for_each_task(block_count, [&](const size_t block) {
+        auto& cursors = block_cursors[block];
+        for (size_t g = block_begin(block); g < block_begin(block + 1); ++g) {
+            const auto& group = record_groups[g];
+            for (size_t i = 0; i < group.size(); ++i) {
+                keys[cursors[shard_of(group[i].hash)]++] = {
+                    group[i].hash, (static_cast<uint64_t>(g) << 32) | i
+                };
+            }
+        }
+    });
 
-                local_results.push_back(pair);
+    const auto shard_keys = [&keys, &shard_begin](const size_t shard) {
+        return std::span<SortKey>(keys).subspan(
+            shard_begin[shard], shard_begin[shard + 1] - shard_begin[shard]);
+    };
+
+    std::vector<size_t> shard_unique(shard_count + 1, 0);
+    for_each_task(shard_count, [&](const size_t shard) {
+        auto range = shard_keys(shard);
+        radix_sort_keys(range);
+        for (size_t k = 0; k < range.size(); ++k) {
+            if (k == 0 || range[k].hash != range[k - 1].hash) {
+                shard_unique[shard]++;
             }
         }
+    });
 
-        // Merge local results into a thread-specific bucket
-        if (!local_results.empty()) {
-            const size_t thread_idx = idx % pool.size();
-            std::lock_guard<std::mutex> lock(results_mutex);
-            auto& bucket = thread_results[thread_idx];
-            bucket.insert(bucket.end(), local_results.begin(), local_results.end());
+    size_t unique_total = 0;
+    for (size_t shard = 0; shard <= shard_count; ++shard) {
+        const size_t count = shard_unique[shard];
+        shard_unique[shard] = unique_total;
+        unique_total += count;
+    }
+
+    // Offsets are 32-bit: 4G locations would already need >100 GB of storage
+    frozen_hashes_.resize(unique_total);
+    frozen_offsets_.resize(unique_total + 1);
+    frozen_locations_.resize(total);
+    for_each_task(shard_count, [&](const size_t shard) {
+        const auto range = shard_keys(shard);
+        size_t bucket = shard_unique[shard];
+        for (size_t k = 0; k < range.size(); ++k) {
+            const size_t out = shard_begin[shard] + k;
+            if (k == 0 || range[k].hash != range[k - 1].hash) {
+                frozen_hashes_[bucket] = range[k].hash;
+                frozen_offsets_[bucket] = static_cast<uint32_t>(out);
+                ++bucket;
+            }
+            frozen_locations_[out] =
+                record_groups[range[k].record >> 32][range[k].record & 0xFFFFFFFF].location;
         }
     });
+    frozen_offsets_[unique_total] = static_cast<uint32_t>(total);
+    count_file_locations();
+}
+
+void HashIndex::thaw() {
+    for_each_stored_bucket([this](const uint64_t hash, std::span<const HashLocation> locations) {
+        index_[hash].assign(locations.begin(), locations.end());
+        mutable_locations_ += locations.size();
+    });
 
-    // Merge all thread results
-    size_t total_size = 0;
-    for (const auto& bucket : thread_results) {
-        total_size += bucket.size();
+    frozen_hashes_.clear();
+    frozen_hashes_.shrink_to_fit();
+    frozen_offsets_.clear();
+    frozen_offsets_.shrink_to_fit();
+    frozen_locations_.clear();
+    frozen_locations_.shrink_to_fit();
+    frozen_ = false;
+    csr_owner_.reset();
+    shared_hashes_ = {};
+    shared_offsets_ = {};
+    shared_locations_ = {};
+    mapped_ = false;
+}
+
+size_t HashIndex::memory_bytes() const {
+    if (csr_owner_) {
+        return shared_hashes_.size_bytes() + shared_offsets_.size_bytes() +
+               shared_locations_.size_bytes();
+    }
+    if (frozen_) {
+        return frozen_hashes_.capacity() * sizeof(uint64_t) +
+               frozen_offsets_.capacity() * sizeof(uint32_t) +
+               frozen_locations_.capacity() * sizeof(HashLocation);
     }
 
-    std::vector<ClonePair> results;
-    results.reserve(total_size);
+    // Approximate node-based map cost: one node (key, vector, next pointer,
+    // cached hash) per bucket entry plus the bucket array itself
+    using Node = std::pair<const uint64_t, std::vector<HashLocation>>;
+    size_t bytes = index_.bucket_count() * sizeof(void*);
+    for (const auto& locations : index_ | std::views::values) {
+        bytes += sizeof(Node) + 2 * sizeof(void*);
+        bytes += locations.capacity() * sizeof(HashLocation);
+    }
+    return bytes;
+}
 
-    for (auto& bucket : thread_results) {
-        results.insert(results.end(),
-                      std::make_move_iterator(bucket.begin()),
-                      std::make_move_iterator(bucket.end()));
+void HashIndex::save(const std::filesystem::path& path, const IndexFileInfo& info) const {
+    // Only the compacted CSR layout has a file representation
+    std::optional<HashIndex> frozen_copy;
+    const HashIndex* source = this;
+    if (!frozen_ || dead_locations_ > 0) {
+        frozen_copy.emplace(*this);
+        if (!frozen_) {
+            frozen_copy->freeze();
+        }
+        frozen_copy->compact();
+        source = &*frozen_copy;
     }
+    const auto hashes = source->csr_hashes();
+    const auto offsets = source->csr_offsets();
+    const auto locations = source->csr_locations();
 
-    return results;
+    uint64_t file_table_size = 0;
+    for (const auto& entry : info.files) {
+        file_table_size += FILE_ENTRY_FIXED_SIZE + entry.path.size();
+    }
+
+    IndexFileHeader header{};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.byte_order = INDEX_BYTE_ORDER;
+    header.header_size = sizeof(IndexFileHeader);
+    header.location_size = sizeof(HashLocation);
+    header.config_fingerprint = info.config_fingerprint;
+    header.file_count = info.files.size();
+    header.hash_count = hashes.size();
+    header.location_count = locations.size();
+    header.file_table_offset = align_up(sizeof(IndexFileHeader));
+    header.hashes_offset = align_up(header.file_table_offset + file_table_size);
+    header.offsets_offset = align_up(header.hashes_offset + hashes.size_bytes());
+    header.locations_offset = align_up(header.offsets_offset + offsets.size_bytes());
+    header.file_size = header.locations_offset + locations.size_bytes();
+    header.thinned_hashes = thinned_hashes_;
+    header.thinned_locations = thinned_locations_;
+    header.dropped_singletons = dropped_singletons_;
+
+    // Write under a temporary name so a crash never leaves a torn index
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot write index file " + temp_path.string());
+        }
+        IndexWriter writer(out);
+        writer.write_value(header);
+
+        writer.pad_to(header.file_table_offset);
+        for (const auto& entry : info.files) {
+            writer.write_value(entry.content_hash);
+            writer.write_value(entry.mtime);
+            writer.write_value(entry.size);
+            writer.write_value(static_cast<uint32_t>(entry.path.size()));
+            writer.write(entry.path.data(), entry.path.size());
+        }
+
+        writer.pad_to(header.hashes_offset);
+        writer.write(hashes.data(), hashes.size_bytes());
+        writer.pad_to(header.offsets_offset);
+        writer.write(offsets.data(), offsets.size_bytes());
+        writer.pad_to(header.locations_offset);
+        writer.write(locations.data(), locations.size_bytes());
+
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed writing index file " + temp_path.string());
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::filesystem::remove(temp_path, error);
+        throw std::runtime_error("Cannot replace index file " + path.string());
+    }
 }
 
-std::vector<ClonePair> HashIndex::merge_adjacent_clones(
-    std::vector<ClonePair> pairs,
-    size_t max_gap
-) {
-    if (pairs.empty()) {
-        return pairs;
+HashIndex HashIndex::open(const std::filesystem::path& path, IndexFileInfo* info) {
+    auto mapping = MappedFile::open(path);
+    const std::byte* data = mapping->data();
+    const uint64_t file_size = mapping->size();
+
+    const auto invalid = [&path](const std::string& reason) {
+        return std::runtime_error("Invalid index file " + path.string() + ": " + reason);
+    };
+
+    IndexFileHeader header{};
+    if (file_size < sizeof(IndexFileHeader)) {
+        throw invalid("truncated header");
+    }
+    std::memcpy(&header, data, sizeof(IndexFileHeader));
+    if (header.magic != INDEX_MAGIC) {
+        throw invalid("bad magic");
+    }
+    if (header.byte_order != INDEX_BYTE_ORDER) {
+        throw invalid("byte order mismatch");
+    }
+    if (header.version != INDEX_VERSION) {
+        throw invalid("unsupported version " + std::to_string(header.version));
+    }
+    if (header.header_size != sizeof(IndexFileHeader) ||
+        header.location_size != sizeof(HashLocation)) {
+        throw invalid("layout mismatch");
+    }
+    if (header.file_size != file_size) {
+        throw invalid("size mismatch");
+    }
+
+    // Each section must be aligned and lie inside the file
+    const auto check_section = [&](const uint64_t offset, const uint64_t count, const size_t element) {
+        if (offset % INDEX_ALIGNMENT != 0 || offset > file_size ||
+            count > (file_size - offset) / element) {
+            throw invalid("corrupt section table");
+        }
+    };
+    check_section(header.hashes_offset, header.hash_count, sizeof(uint64_t));
+    check_section(header.offsets_offset, header.hash_count + 1, sizeof(uint32_t));
+    check_section(header.locations_offset, header.location_count, sizeof(HashLocation));
+
+    HashIndex index;
+    IndexFileInfo file_info;
+    file_info.config_fingerprint = header.config_fingerprint;
+    file_info.files.reserve(std::min<uint64_t>(header.file_count, file_size / FILE_ENTRY_FIXED_SIZE));
+
+    uint64_t cursor = header.file_table_offset;
+    for (uint64_t i = 0; i < header.file_count; ++i) {
+        if (cursor > file_size || file_size - cursor < FILE_ENTRY_FIXED_SIZE) {
+            throw invalid("truncated file table");
+        }
+        IndexFileEntry entry;
+        uint32_t path_size = 0;
+        std::memcpy(&entry.content_hash, data + cursor, sizeof(uint64_t));
+        std::memcpy(&entry.mtime, data + cursor + 8, sizeof(int64_t));
+        std::memcpy(&entry.size, data + cursor + 16, sizeof(uint64_t));
+        std::memcpy(&path_size, data + cursor + 24, sizeof(uint32_t));
+        cursor += FILE_ENTRY_FIXED_SIZE;
+        if (file_size - cursor < path_size) {
+            throw invalid("truncated file table");
+        }
+        entry.path.assign(reinterpret_cast<const char*>(data + cursor), path_size);
+        cursor += path_size;
+
+        if (index.register_file(entry.path) != i) {
+            throw invalid("duplicate file path " + entry.path);
+        }
+        file_info.files.push_back(std::move(entry));
+    }
+    if (cursor > header.hashes_offset) {
+        throw invalid("file table overlaps hash section");
+    }
+
+    index.shared_hashes_ = {
+        reinterpret_cast<const uint64_t*>(data + header.hashes_offset), header.hash_count};
+    index.shared_offsets_ = {
+        reinterpret_cast<const uint32_t*>(data + header.offsets_offset), header.hash_count + 1};
+    index.shared_locations_ = {
+        reinterpret_cast<const HashLocation*>(data + header.locations_offset), header.location_count};
+    if (index.shared_offsets_.front() != 0 ||
+        index.shared_offsets_.back() != header.location_count) {
+        throw invalid("corrupt offsets section");
     }
 
-    // Sort pairs by file pair and location
-    std::ranges::sort(pairs, [](const ClonePair& a, const ClonePair& b) {
-        // First by file pair (normalized so smaller file_id is always first)
-        const auto a_file_min = std::min(a.location_a.file_id, a.location_b.file_id);
-        const auto a_file_max = std::max(a.location_a.file_id, a.location_b.file_id);
-        const auto b_file_min = std::min(b.location_a.file_id, b.location_b.file_id);
-        const auto b_file_max = std::max(b.location_a.file_id, b.location_b.file_id);
+    index.csr_owner_ = std::move(mapping);
+    index.mapped_ = true;
+    index.frozen_ = true;
+    index.file_locations_known_ = false;
+    index.thinned_hashes_ = header.thinned_hashes;
+    index.thinned_locations_ = header.thinned_locations;
+    index.dropped_singletons_ = header.dropped_singletons;
 
-        if (a_file_min != b_file_min) return a_file_min < b_file_min;
-        if (a_file_max != b_file_max) return a_file_max < b_file_max;
+    if (info) {
+        *info = std::move(file_info);
+    }
+    return index;
+}
+
+HashIndex::PairStreamStats HashIndex::visit_clone_pairs(
+    const ClonePairVisitor& visitor,
+    const size_t batch_size
+) const {
+    PairStreamStats stats;
+    PairBatch batch(visitor, batch_size);
+    const size_t threshold = stop_hash_threshold();
 
-        // Then by start position in first file
-        return a.location_a.token_start < b.location_a.token_start;
+    for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+        if (is_pair_source(locations, stop_policy_, threshold)) {
+            emit_bucket_pairs(hash, locations, stop_policy_, threshold, batch);
+        }
     });
+    batch.flush();
 
-    std::vector<ClonePair> merged;
-    ClonePair current = pairs[0];
+    stats.pairs = batch.emitted();
+    stats.peak_buffered = batch.peak();
+    return stats;
+}
 
-    for (size_t i = 1; i < pairs.size(); ++i) {
-        const auto& next = pairs[i];
+HashIndex::PairStreamStats HashIndex::visit_clone_pairs_of(
+    const std::span<const uint64_t> hashes,
+    const std::vector<bool>& files,
+    const ClonePairVisitor& visitor,
+    const size_t batch_size
+) const {
+    PairStreamStats stats;
+    PairBatch batch(visitor, batch_size);
+    const size_t threshold = stop_hash_threshold();
+
+    std::vector<HashLocation> live;
+    for (const uint64_t hash : hashes) {
+        auto locations = stored_locations(hash);
+        if (dead_locations_ > 0) {
+            live_locations(locations, live);
+            locations = live;
+        }
+        if (is_pair_source(locations, stop_policy_, threshold)) {
+            emit_bucket_pairs(hash, locations, stop_policy_, threshold, batch, &files);
+        }
+    }
+    batch.flush();
 
-        // Check if same file pair
-        bool same_files =
-            (current.location_a.file_id == next.location_a.file_id &&
-             current.location_b.file_id == next.location_b.file_id) ||
-            (current.location_a.file_id == next.location_b.file_id &&
-             current.location_b.file_id == next.location_a.file_id);
+    stats.pairs = batch.emitted();
+    stats.peak_buffered = batch.peak();
+    return stats;
+}
 
-        if (!same_files) {
-            merged.push_back(current);
-            current = next;
-            continue;
+HashIndex::PairStreamStats HashIndex::visit_clone_pairs_parallel(
+    ThreadPool& pool,
+    const ClonePairVisitor& visitor,
+    const size_t batch_size
+) const {
+    // Collect all hashes that produce pairs into a vector for partitioning.
+    // With tombstones the live count is only known after filtering, which
+    // the producers do with their own scratch buffers.
+    std::vector<std::pair<uint64_t, std::span<const HashLocation>>> work_items;
+    work_items.reserve(hash_count());
+    const size_t threshold = stop_hash_threshold();
+    const bool tombstones = dead_locations_ > 0;
+
+    for_each_stored_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+        if (tombstones ? locations.size() > 1 : is_pair_source(locations, stop_policy_, threshold)) {
+            work_items.emplace_back(hash, locations);
         }
+    });
 
-        // Normalize so we compare same-direction locations
-        HashLocation curr_a = current.location_a;
-        HashLocation curr_b = current.location_b;
-        HashLocation next_a = next.location_a;
-        HashLocation next_b = next.location_b;
+    // For small workloads, use sequential processing
+    if (work_items.size() < 100 || pool.size() <= 1) {
+        return visit_clone_pairs(visitor, batch_size);
+    }
 
-        if (current.location_a.file_id != next.location_a.file_id) {
-            std::swap(next_a, next_b);
+    // One producer per worker, each with its own bounded batch. The
+    // visitor is serialized so consumers need no synchronization.
+    std::mutex visitor_mutex;
+    const ClonePairVisitor locked_visitor = [&](std::span<const ClonePair> pairs) {
+        std::lock_guard<std::mutex> lock(visitor_mutex);
+        visitor(pairs);
+    };
+
+    const size_t producers = pool.size();
+    std::vector<PairStreamStats> producer_stats(producers);
+    pool.parallel_for(0, producers, [&](const size_t p) {
+        PairBatch batch(locked_visitor, batch_size);
+        std::vector<HashLocation> live;
+        for (size_t idx = p; idx < work_items.size(); idx += producers) {
+            const uint64_t hash = work_items[idx].first;
+            auto locations = work_items[idx].second;
+            if (tombstones) {
+                live_locations(locations, live);
+                if (!is_pair_source(live, stop_policy_, threshold)) {
+                    continue;
+                }
+                locations = live;
+            }
+            emit_bucket_pairs(hash, locations, stop_policy_, threshold, batch);
         }
+        batch.flush();
+        producer_stats[p].pairs = batch.emitted();
+        producer_stats[p].peak_buffered = batch.peak();
+    });
 
-        // Check if adjacent (with max_gap tolerance)
-        uint32_t curr_end_a = curr_a.token_start + curr_a.token_count;
-        uint32_t curr_end_b = curr_b.token_start + curr_b.token_count;
+    PairStreamStats stats;
+    for (const auto& producer : producer_stats) {
+        stats.pairs += producer.pairs;
+        stats.peak_buffered += producer.peak_buffered;
+    }
+    return stats;
+}
 
-        bool adjacent_a = next_a.token_start <= curr_end_a + max_gap &&
-                          next_a.token_start >= curr_a.token_start;
-        bool adjacent_b = next_b.token_start <= curr_end_b + max_gap &&
-                          next_b.token_start >= curr_b.token_start;
+size_t HashIndex::stop_hash_threshold() const {
+    return stop_policy_.threshold(location_count() + thinned_locations_ + dropped_singletons_);
+}
 
-        if (adjacent_a && adjacent_b) {
-            // Merge: extend current to include next
-            uint32_t new_end_a = std::max(curr_end_a,
-                next_a.token_start + next_a.token_count);
-            uint32_t new_end_b = std::max(curr_end_b,
-                next_b.token_start + next_b.token_count);
+void HashIndex::note_thinned_stop_hashes(const size_t hashes, const size_t locations) {
+    thinned_hashes_ += hashes;
+    thinned_locations_ += locations;
+}
 
-            current.location_a.token_count = new_end_a - current.location_a.token_start;
-            current.location_b.token_count = new_end_b - current.location_b.token_start;
+void HashIndex::note_dropped_singletons(const size_t locations) {
+    dropped_singletons_ += locations;
+}
 
-            // Update line ranges
-            current.location_a.end_line = std::max(curr_a.end_line, next_a.end_line);
-            current.location_b.end_line = std::max(curr_b.end_line, next_b.end_line);
-        } else {
-            merged.push_back(current);
-            current = next;
+std::vector<CloneClass> HashIndex::find_clone_classes() const {
+    std::vector<CloneClass> classes;
+    if (stop_policy_.mode != StopHashMode::CLONE_CLASS) {
+        return classes;
+    }
+
+    const size_t threshold = stop_hash_threshold();
+    for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+        if (locations.size() > threshold) {
+            classes.push_back(make_clone_class(hash, locations));
         }
+    });
+    return classes;
+}
+
+std::vector<ClonePair> HashIndex::find_clone_pairs() const {
+    std::vector<ClonePair> results;
+    visit_clone_pairs([&results](std::span<const ClonePair> pairs) {
+        results.insert(results.end(), pairs.begin(), pairs.end());
+    });
+    return results;
+}
+
+std::vector<ClonePair> HashIndex::find_clone_pairs_parallel(ThreadPool& pool) const {
+    if (pool.size() <= 1) {
+        return find_clone_pairs();
     }
 
-    merged.push_back(current);
-    return merged;
+    std::vector<ClonePair> results;
+    visit_clone_pairs_parallel(pool, [&results](std::span<const ClonePair> pairs) {
+        results.insert(results.end(), pairs.begin(), pairs.end());
+    });
+    return results;
+}
+
+std::vector<ClonePair> HashIndex::merge_adjacent_clones(
+    std::vector<ClonePair> pairs,
+    const size_t max_gap
+) {
+    SeedChainer::Config config;
+    config.max_gap = max_gap;
+    return SeedChainer(config).chain(std::move(pairs));
 }
 
 std::vector<ClonePair> HashIndex::filter_by_size(
@@ -282,12 +1284,27 @@ std::vector<ClonePair> HashIndex::filter_by_size(
 HashIndex::Stats HashIndex::get_stats() const {
     Stats stats{};
     stats.total_files = file_paths_.size();
-    stats.total_hashes = index_.size();
+    stats.total_hashes = hash_count();
     stats.total_locations = 0;
     stats.duplicate_hashes = 0;
     stats.max_locations_per_hash = 0;
-
-    for (const auto& locations : index_ | std::views::values) {
+    stats.memory_bytes = memory_bytes();
+    stats.frozen = frozen_;
+    stats.stop_hash_threshold = stop_hash_threshold();
+    stats.stop_hashes = thinned_hashes_;
+    stats.stop_hash_locations = thinned_locations_;
+    stats.thinned_locations = thinned_locations_;
+    stats.singletons_dropped = dropped_singletons_;
+
+    size_t singletons_kept = 0;
+    for_each_bucket([&stats, &singletons_kept](uint64_t, std::span<const HashLocation> locations) {
+        if (locations.size() == 1) {
+            singletons_kept++;
+        }
+        if (locations.size() > stats.stop_hash_threshold) {
+            stats.stop_hashes++;
+            stats.stop_hash_locations += locations.size();
+        }
         stats.total_locations += locations.size();
         if (locations.size() > 1) {
             stats.duplicate_hashes++;
@@ -296,7 +1313,15 @@ HashIndex::Stats HashIndex::get_stats() const {
             stats.max_locations_per_hash,
             locations.size()
         );
-    }
+    });
+
+    // Each dropped singleton would have cost a location plus a CSR entry
+    const size_t filtered = dropped_singletons_ + singletons_kept;
+    stats.singleton_false_positive_rate = dropped_singletons_ > 0
+        ? static_cast<double>(singletons_kept) / static_cast<double>(filtered)
+        : 0.0;
+    stats.singleton_bytes_saved = dropped_singletons_ *
+        (sizeof(HashLocation) + sizeof(uint64_t) + sizeof(uint32_t));
 
     return stats;
 }
@@ -319,64 +1344,463 @@ HashIndexBuilder::HashIndexBuilder(HashIndex& existing_index, size_t window_size
 {
 }
 
-void HashIndexBuilder::add_file(const TokenizedFile& file, bool use_normalized) {
-    if (file.tokens.empty()) {
+HashIndexBuilder::HashIndexBuilder(HashIndex& existing_index, const Config& config)
+    : window_size_(config.window_size)
+    , freeze_(config.freeze)
+    , winnow_window_(config.winnow_window)
+    , hash_function_(config.hash_function)
+    , external_index_(&existing_index)
+    , use_external_(true)
+    , stop_policy_(config.stop_hashes)
+    , drop_singletons_(config.drop_singletons)
+{
+    existing_index.set_stop_hash_policy(stop_policy_);
+}
+
+void HashIndexBuilder::finalize(ThreadPool* pool) {
+    if (!freeze_) {
         return;
     }
 
-    HashIndex& target_index = use_external_ ? *external_index_ : index_;
-    const uint32_t file_id = target_index.register_file(file.path);
+    size_t corpus_size = 0;
+    for (const auto& group : record_groups_) {
+        corpus_size += group.size();
+    }
+    if (drop_singletons_) {
+        eliminate_singletons(pool);
+    }
+    if (stop_policy_.mode != StopHashMode::CLONE_CLASS) {
+        thin_stop_hashes(pool, corpus_size);
+    }
 
-    // Extract hash values from tokens
-    std::vector<uint64_t> token_hashes;
-    token_hashes.reserve(file.tokens.size());
+    if (pool) {
+        target_index().freeze(std::move(record_groups_), *pool);
+    } else {
+        size_t total = 0;
+        for (const auto& group : record_groups_) {
+            total += group.size();
+        }
+        std::vector<HashRecord> records;
+        records.reserve(total);
+        for (const auto& group : record_groups_) {
+            records.insert(records.end(), group.begin(), group.end());
+        }
+        target_index().freeze(std::move(records));
+    }
+    record_groups_ = {};
+}
 
-    for (const auto& token : file.tokens) {
-        // Skip structural tokens that shouldn't participate in similarity
-        if (token.type == TokenType::NEWLINE ||
-            token.type == TokenType::INDENT ||
-            token.type == TokenType::DEDENT) {
-            continue;
+void HashIndexBuilder::eliminate_singletons(ThreadPool* pool) {
+    size_t total = 0;
+    for (const auto& group : record_groups_) {
+        total += group.size();
+    }
+    if (total == 0) {
+        return;
+    }
+
+    BlockedBloomFilter seen(total);
+    BlockedBloomFilter repeated(total);
+    const auto for_each_group = [&](auto&& body) {
+        if (pool && pool->size() > 1) {
+            pool->parallel_for(0, record_groups_.size(), body);
+        } else {
+            for (size_t g = 0; g < record_groups_.size(); ++g) {
+                body(g);
+            }
         }
+    };
 
-        uint64_t hash = use_normalized ? token.normalized_hash : token.original_hash;
-        token_hashes.push_back(hash);
+    // Pass 1: a hash inserted into seen a second time goes into repeated
+    for_each_group([&](const size_t g) {
+        for (const auto& record : record_groups_[g]) {
+            if (seen.insert(record.hash)) {
+                repeated.insert(record.hash);
+            }
+        }
+    });
+
+    // Pass 2: keep candidates only
+    std::vector<size_t> dropped(record_groups_.size(), 0);
+    for_each_group([&](const size_t g) {
+        dropped[g] = std::erase_if(record_groups_[g], [&repeated](const HashRecord& record) {
+            return !repeated.contains(record.hash);
+        });
+    });
+
+    size_t dropped_total = 0;
+    for (const size_t count : dropped) {
+        dropped_total += count;
     }
+    target_index().note_dropped_singletons(dropped_total);
+}
 
-    if (token_hashes.size() < window_size_) {
-        return;  // File too small
+void HashIndexBuilder::thin_stop_hashes(ThreadPool* pool, const size_t corpus_size) {
+    size_t total = 0;
+    for (const auto& group : record_groups_) {
+        total += group.size();
+    }
+    const size_t threshold = stop_policy_.threshold(corpus_size);
+    if (total <= threshold) {
+        return;  // No hash can exceed the threshold
+    }
+
+    // Size the sketch so its overcount (e * total / width) stays below a
+    // quarter of the threshold: mostly hashes with at least 3/4 of the
+    // threshold reach the exact count
+    constexpr double E = 2.718281828459045;
+    const auto width = static_cast<size_t>(std::clamp(
+        4.0 * E * static_cast<double>(total) / static_cast<double>(threshold), 1024.0, 1048576.0));
+
+    const size_t workers = pool ? std::max<size_t>(pool->size(), 1) : 1;
+    const auto for_each_worker = [&](auto&& body) {
+        if (pool && workers > 1) {
+            pool->parallel_for(0, workers, body);
+        } else {
+            body(0);
+        }
+    };
+
+    // Pass 1: per-worker sketches over strided groups, merged afterwards
+    std::vector<CountMinSketch> sketches(workers, CountMinSketch(width));
+    for_each_worker([&](const size_t w) {
+        for (size_t g = w; g < record_groups_.size(); g += workers) {
+            for (const auto& record : record_groups_[g]) {
+                sketches[w].add(record.hash);
+            }
+        }
+    });
+    for (size_t w = 1; w < workers; ++w) {
+        sketches[0].merge(sketches[w]);
+    }
+    const auto& sketch = sketches[0];
+
+    // Pass 2: count the sketch's candidates exactly. The sketch never
+    // undercounts, so every stop hash is a candidate; hashes it only
+    // overestimates through collisions are cleared here
+    std::vector<std::unordered_map<uint64_t, size_t>> candidates(workers);
+    for_each_worker([&](const size_t w) {
+        for (size_t g = w; g < record_groups_.size(); g += workers) {
+            for (const auto& record : record_groups_[g]) {
+                if (sketch.estimate(record.hash) > threshold) {
+                    candidates[w][record.hash]++;
+                }
+            }
+        }
+    });
+    std::unordered_map<uint64_t, size_t> stop_counts;
+    for (const auto& worker : candidates) {
+        for (const auto& [hash, count] : worker) {
+            stop_counts[hash] += count;
+        }
+    }
+    std::erase_if(stop_counts, [threshold](const auto& entry) { return entry.second <= threshold; });
+
+    // Pass 3: drop stop hash records, or keep a deterministic sample of
+    // about sample_size locations per stop hash
+    std::vector<std::unordered_map<uint64_t, size_t>> thinned(workers);
+    for_each_worker([&](const size_t w) {
+        if (stop_counts.empty()) {
+            return;
+        }
+        for (size_t g = w; g < record_groups_.size(); g += workers) {
+            std::erase_if(record_groups_[g], [&](const HashRecord& record) {
+                const auto stop = stop_counts.find(record.hash);
+                if (stop == stop_counts.end()) {
+                    return false;
+                }
+                const bool drop = stop_policy_.mode != StopHashMode::SAMPLE ||
+                    !keeps_sampled_location(record.hash, record.location, stop->second, stop_policy_.sample_size);
+                if (drop) {
+                    thinned[w][record.hash]++;
+                }
+                return drop;
+            });
+        }
+    });
+
+    std::unordered_map<uint64_t, size_t> all_thinned;
+    size_t thinned_locations = 0;
+    for (const auto& worker : thinned) {
+        for (const auto& [hash, count] : worker) {
+            all_thinned[hash] += count;
+            thinned_locations += count;
+        }
+    }
+    target_index().note_thinned_stop_hashes(all_thinned.size(), thinned_locations);
+}
+
+void HashIndexBuilder::add_file(const TokenizedFile& file, bool use_normalized) {
+    if (file.tokens.empty()) {
+        return;
+    }
+
+    const uint32_t file_id = target_index().register_file(file.path);
+    auto records = collect_records(file, file_id, use_normalized);
+
+    if (freeze_) {
+        record_groups_.push_back(std::move(records));
+    } else {
+        for (const auto& [hash, location] : records) {
+            target_index().add_hash(hash, location);
+        }
     }
+}
 
-    // Compute rolling hashes and add to index
-    auto window_hashes = HashSequence::compute_all(token_hashes, window_size_);
+void HashIndexBuilder::add_files(
+    const std::vector<TokenizedFile>& files,
+    ThreadPool& pool,
+    bool use_normalized,
+    const std::vector<bool>* selected
+) {
+    // Register sequentially so file IDs follow input order
+    std::vector<uint32_t> file_ids(files.size(), 0);
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!files[i].tokens.empty()) {
+            file_ids[i] = target_index().register_file(files[i].path);
+        }
+    }
+
+    std::vector<std::vector<HashRecord>> groups(files.size());
+    pool.parallel_for(0, files.size(), [&](const size_t i) {
+        if (!files[i].tokens.empty() && (!selected || (*selected)[i])) {
+            groups[i] = collect_records(files[i], file_ids[i], use_normalized);
+        }
+    });
 
-    // Map token index (excluding structural) back to the original token
-    std::vector<size_t> token_mapping;
-    for (size_t i = 0; i < file.tokens.size(); ++i) {
-        if (const auto& token = file.tokens[i]; token.type != TokenType::NEWLINE &&
-            token.type != TokenType::INDENT &&
-            token.type != TokenType::DEDENT) {
-            token_mapping.push_back(i);
+    for (auto& group : groups) {
+        if (freeze_) {
+            record_groups_.push_back(std::move(group));
+        } else {
+            for (const auto& [hash, location] : group) {
+                target_index().add_hash(hash, location);
+            }
         }
     }
+}
 
-    for (const auto& [pos, hash] : window_hashes) {
-        // Map position back to original token array
-        const size_t orig_start = token_mapping[pos];
-        const size_t orig_end = token_mapping[std::min(pos + window_size_ - 1,
-                                                  token_mapping.size() - 1)];
+std::vector<HashRecord> HashIndexBuilder::collect_records(
+    const TokenizedFile& file,
+    const uint32_t file_id,
+    const bool use_normalized
+) const {
+    std::vector<HashRecord> records;
 
+    // Index locations use positions in the significant sequence
+    const auto& tokens = file.tokens;
+    const auto token_hashes = tokens.significant_hashes(use_normalized);
+    if (token_hashes.size() < window_size_) {
+        return records;  // File too small
+    }
+
+    // Compute rolling hashes, keeping only winnowed fingerprints if enabled
+    const auto window_hashes = HashSequence::compute_all(token_hashes, window_size_, hash_function_);
+
+    const auto add_record = [&](const size_t pos, const uint64_t hash) {
         HashLocation loc{};
         loc.file_id = file_id;
-        loc.start_line = file.tokens[orig_start].line;
-        loc.end_line = file.tokens[orig_end].line;
-        loc.start_col = file.tokens[orig_start].column;
-        loc.end_col = file.tokens[orig_end].column + file.tokens[orig_end].length;
         loc.token_start = static_cast<uint32_t>(pos);
         loc.token_count = static_cast<uint32_t>(window_size_);
 
-        target_index.add_hash(hash, loc);
+        records.push_back({hash, loc});
+    };
+
+    if (winnow_window_ > 1) {
+        const auto fingerprints = HashSequence::winnow(window_hashes, winnow_window_);
+        records.reserve(fingerprints.size());
+        for (const auto& [pos, hash] : fingerprints) {
+            add_record(pos, hash);
+        }
+    } else {
+        records.reserve(window_hashes.size());
+        for (size_t pos = 0; pos < window_hashes.size(); ++pos) {
+            add_record(pos, window_hashes[pos]);
+        }
+    }
+
+    return records;
+}
+
+// =============================================================================
+// ExternalHashIndex
+// =============================================================================
+
+ExternalHashIndex::ExternalHashIndex(const Config& config)
+    : config_(config)
+{
+    config_.merge_fan_in = std::max<size_t>(config_.merge_fan_in, 2);
+    if (config_.spill_dir.empty()) {
+        config_.spill_dir = std::filesystem::temp_directory_path();
+    }
+    buffer_capacity_ = std::max<size_t>(config_.memory_budget_bytes / sizeof(HashRecord), 1);
+
+    // Indexes of this and other processes may share the spill directory
+    static std::atomic<uint64_t> instances{0};
+    run_prefix_ = "aegis_spill_" + std::to_string(std::random_device{}()) + "_" +
+                  std::to_string(instances++) + "_";
+}
+
+ExternalHashIndex::~ExternalHashIndex() {
+    for (const auto& run : runs_) {
+        std::error_code error;
+        std::filesystem::remove(run, error);
+    }
+}
+
+void ExternalHashIndex::add_records(std::span<const HashRecord> records) {
+    records_ += records.size();
+    while (!records.empty()) {
+        if (buffer_.size() == buffer_capacity_) {
+            spill();
+        }
+        const size_t take = std::min(records.size(), buffer_capacity_ - buffer_.size());
+        if (buffer_.capacity() < buffer_.size() + take) {
+            // Grow geometrically, but never past the budget
+            buffer_.reserve(std::min(buffer_capacity_,
+                                     std::max(buffer_.size() + take, 2 * buffer_.capacity())));
+        }
+        buffer_.insert(buffer_.end(), records.begin(), records.begin() + static_cast<std::ptrdiff_t>(take));
+        records = records.subspan(take);
+    }
+}
+
+std::filesystem::path ExternalHashIndex::next_run_path() {
+    return config_.spill_dir / (run_prefix_ + std::to_string(next_run_++) + ".run");
+}
+
+size_t ExternalHashIndex::read_buffer_records(const size_t runs) const {
+    return std::max<size_t>(config_.memory_budget_bytes / sizeof(HashRecord) / std::max<size_t>(runs, 1), 256);
+}
+
+void ExternalHashIndex::spill() {
+    if (buffer_.empty()) {
+        return;
+    }
+    std::ranges::sort(buffer_, run_order);
+    runs_.push_back(next_run_path());  // Registered first so it is cleaned up on failure
+    write_run(runs_.back(), buffer_);
+    stats_.runs++;
+    stats_.bytes += buffer_.size() * sizeof(HashRecord);
+    buffer_.clear();
+}
+
+void ExternalHashIndex::reduce_runs() {
+    const size_t fan_in = config_.merge_fan_in;
+    while (runs_.size() > fan_in) {
+        const size_t buffer_records = read_buffer_records(fan_in + 1);
+        std::vector<RunCursor> cursors;
+        cursors.reserve(fan_in);
+        for (size_t i = 0; i < fan_in; ++i) {
+            cursors.emplace_back(runs_[i], buffer_records);
+        }
+
+        runs_.push_back(next_run_path());
+        std::ofstream out(runs_.back(), std::ios::binary | std::ios::trunc);
+        std::vector<HashRecord> pending;
+        pending.reserve(buffer_records);
+        const auto flush = [&] {
+            out.write(reinterpret_cast<const char*>(pending.data()),
+                      static_cast<std::streamsize>(pending.size() * sizeof(HashRecord)));
+            stats_.bytes += pending.size() * sizeof(HashRecord);
+            pending.clear();
+        };
+        merge_runs(cursors, [&](const HashRecord& record) {
+            pending.push_back(record);
+            if (pending.size() == buffer_records) {
+                flush();
+            }
+        });
+        flush();
+        if (!out) {
+            throw std::runtime_error("Cannot write spill run " + runs_.back().string());
+        }
+        out.close();
+        cursors.clear();
+
+        for (size_t i = 0; i < fan_in; ++i) {
+            std::error_code error;
+            std::filesystem::remove(runs_[i], error);
+        }
+        runs_.erase(runs_.begin(), runs_.begin() + static_cast<std::ptrdiff_t>(fan_in));
+        stats_.runs++;
+        stats_.merge_passes++;
+    }
+}
+
+void ExternalHashIndex::for_each_bucket(
+    const std::function<void(uint64_t, std::span<const HashLocation>)>& visitor
+) {
+    // Once anything is on disk, the buffer goes too and the budget is
+    // spent on read buffers instead
+    if (!runs_.empty()) {
+        spill();
+        buffer_ = {};
+    } else {
+        std::ranges::sort(buffer_, run_order);
+    }
+    reduce_runs();
+
+    std::vector<RunCursor> cursors;
+    cursors.reserve(runs_.size() + 1);
+    const size_t buffer_records = read_buffer_records(runs_.size());
+    for (const auto& run : runs_) {
+        cursors.emplace_back(run, buffer_records);
+    }
+    if (!buffer_.empty()) {
+        cursors.emplace_back(std::span<const HashRecord>(buffer_));
+    }
+
+    std::vector<HashLocation> bucket;
+    uint64_t hash = 0;
+    merge_runs(cursors, [&](const HashRecord& record) {
+        if (!bucket.empty() && record.hash != hash) {
+            visitor(hash, bucket);
+            bucket.clear();
+        }
+        hash = record.hash;
+        bucket.push_back(record.location);
+    });
+    if (!bucket.empty()) {
+        visitor(hash, bucket);
     }
 }
 
+HashIndex::PairStreamStats ExternalHashIndex::visit_clone_pairs(
+    const ClonePairVisitor& visitor,
+    std::vector<CloneClass>* clone_classes,
+    const size_t batch_size
+) {
+    PairBatch batch(visitor, batch_size);
+    const size_t threshold = stop_hash_threshold();
+    const bool collect_classes = clone_classes && stop_policy_.mode == StopHashMode::CLONE_CLASS;
+
+    std::vector<HashLocation> sampled;
+    for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+        // SAMPLE keeps the locations the in-memory build keeps when it
+        // thins stop hashes, then pairs them the same way
+        auto pair_locations = locations;
+        if (stop_policy_.mode == StopHashMode::SAMPLE && locations.size() > threshold) {
+            sampled.clear();
+            for (const auto& location : locations) {
+                if (keeps_sampled_location(hash, location, locations.size(), stop_policy_.sample_size)) {
+                    sampled.push_back(location);
+                }
+            }
+            pair_locations = sampled;
+        }
+        if (is_pair_source(pair_locations, stop_policy_, threshold)) {
+            emit_bucket_pairs(hash, pair_locations, stop_policy_, threshold, batch);
+        }
+        if (collect_classes && locations.size() > threshold) {
+            clone_classes->push_back(make_clone_class(hash, locations));
+        }
+    });
+    batch.flush();
+
+    HashIndex::PairStreamStats stats;
+    stats.pairs = batch.emitted();
+    stats.peak_buffered = batch.peak();
+    return stats;
+}
+
 }  // namespace aegis::similarity
@@ -1,14 +1,93 @@
 #pragma once
 
 #include "models/clone_types.hpp"
+#include "utils/mapped_file.hpp"
 #include "utils/thread_pool.hpp"
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <span>
 #include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
 
 namespace aegis::similarity {
 
+/**
+ * A single (hash, location) record collected during a frozen index build.
+ */
+struct HashRecord {
+    uint64_t hash;
+    HashLocation location;
+};
+
+/**
+ * Policy for stop hashes: window hashes that occur so often that pairing
+ * every location would explode (N locations = N(N-1)/2 pairs).
+ *
+ * A hash is a stop hash when it has more locations than
+ * threshold(total_locations) = max(min_locations, fraction * total), so
+ * the cut scales with corpus size instead of being a fixed constant.
+ */
+struct StopHashPolicy {
+    // What to do with stop hashes
+    StopHashMode mode;
+
+    // Hashes with at most this many locations are never stop hashes
+    size_t min_locations;
+
+    // Stop hashes have more than this fraction of all indexed windows
+    double fraction;
+
+    // Locations paired per stop hash in SAMPLE mode
+    size_t sample_size;
+
+    StopHashPolicy()
+        : mode(StopHashMode::CLONE_CLASS)
+        , min_locations(500)
+        , fraction(0.001)
+        , sample_size(64)
+    {}
+
+    /**
+     * Location count above which a hash is a stop hash.
+     */
+    [[nodiscard]] size_t threshold(const size_t total_locations) const {
+        const auto relative = static_cast<size_t>(fraction * static_cast<double>(total_locations));
+        return std::max(min_locations, relative);
+    }
+};
+
+/**
+ * One entry of the file table of a saved index.
+ */
+struct IndexFileEntry {
+    std::string path;
+    uint64_t content_hash;  // FileUtils::content_hash of the source
+    int64_t mtime;          // Last write time in file clock ticks
+    uint64_t size;          // Source size in bytes
+};
+
+/**
+ * Metadata saved alongside the index sections.
+ */
+struct IndexFileInfo {
+    // Fingerprint of the settings the index was built with; a reader
+    // must not reuse an index built with a different fingerprint
+    uint64_t config_fingerprint = 0;
+
+    // Indexed files in file_id order
+    std::vector<IndexFileEntry> files;
+};
+
+/**
+ * Consumer of streamed clone pairs; receives one batch per call.
+ */
+using ClonePairVisitor = std::function<void(std::span<const ClonePair>)>;
+
 /**
  * Inverted index mapping rolling hashes to their source locations.
  *
@@ -16,9 +95,30 @@ namespace aegis::similarity {
  * 1. Storing all hash -> location mappings during analysis
  * 2. Finding potential clones by looking up duplicate hashes
  * 3. Merging adjacent clone pairs into larger regions
+ *
+ * Two storage layouts are supported:
+ * - Mutable: unordered_map of per-hash vectors, used by add_hash() for
+ *   small or incremental indexes.
+ * - Frozen: compressed-sparse-row (CSR) layout built by freeze(). Unique
+ *   hashes are kept sorted in one array, with an offsets array pointing
+ *   into a single contiguous location array. This avoids a node and a
+ *   heap vector per unique hash and is used for full analysis runs.
+ *
+ * A frozen index can be saved to a versioned binary file (header, file
+ * table, then the three CSR arrays as raw sections) and opened again via
+ * mmap: the CSR arrays are used in place, with no deserialization.
+ *
+ * Files are retracted with remove_file(), which tombstones the file ID
+ * instead of rewriting the arrays. Lookups and pair generation skip
+ * tombstoned locations; the arrays are compacted once tombstones make up
+ * a large enough share of them, so a long-lived index stays usable while
+ * files come and go.
  */
 class HashIndex {
 public:
+    // Default number of pairs per batch for the streaming visitors
+    static constexpr size_t DEFAULT_PAIR_BATCH = 1 << 16;
+
     /**
      * Clear all data from the index.
      */
@@ -27,18 +127,22 @@ public:
     /**
      * Register a file and get its ID.
      *
+     * IDs of removed files are reused once compaction has purged their
+     * locations, so a reused ID never picks up stale locations.
+     *
      * @param path The file path
      * @return The assigned file ID
      */
     uint32_t register_file(const std::string& path);
 
     /**
-     * Get the path for a file ID.
+     * Get the path for a file ID (empty for removed files).
      */
     const std::string& get_file_path(uint32_t file_id) const;
 
     /**
-     * Get the number of registered files.
+     * Get the number of file IDs in use, including removed files whose
+     * IDs have not been reused yet.
      */
     size_t file_count() const { return file_paths_.size(); }
 
@@ -51,30 +155,332 @@ public:
     void add_hash(uint64_t hash, const HashLocation& location);
 
     /**
-     * Get all locations for a specific hash.
+     * Get all live locations for a specific hash.
+     *
+     * Copies the bucket; hot paths use for_each_live_location() or
+     * live_location_count() instead.
+     *
+     * @return Locations of files that have not been removed (empty if the
+     *         hash is not indexed)
+     */
+    std::vector<HashLocation> get_locations(uint64_t hash) const;
+
+    /**
+     * Visit the live locations of a hash in place, without copying the
+     * bucket.
+     */
+    template<typename F>
+    void for_each_live_location(const uint64_t hash, F&& f) const {
+        for (const auto& location : stored_locations(hash)) {
+            if (dead_locations_ == 0 || is_live(location)) {
+                f(location);
+            }
+        }
+    }
+
+    /**
+     * Get the number of live locations for a hash (0 if not indexed).
+     */
+    size_t live_location_count(uint64_t hash) const;
+
+    /**
+     * Get the number of unique hashes in the index. Hashes whose
+     * locations are all tombstoned count until the next compaction.
+     */
+    size_t hash_count() const {
+        return frozen_ ? csr_hashes().size() : index_.size();
+    }
+
+    /**
+     * Convert the index to the frozen CSR layout.
+     *
+     * Any entries already added through add_hash() are merged with the
+     * given records. Records are radix-sorted by hash; locations sharing
+     * a hash keep their insertion order. Calling add_hash() on a frozen
+     * index converts it back to the mutable layout.
+     *
+     * @param records Additional (hash, location) records to index
+     */
+    void freeze(std::vector<HashRecord> records = {});
+
+    /**
+     * Convert the index to the frozen CSR layout using a thread pool.
+     *
+     * Records are scattered into hash-range shards (by the top bits of the
+     * hash) and each shard is sorted and laid out independently. Groups are
+     * visited in order, so the result is identical to calling freeze() with
+     * the concatenation of all groups.
+     *
+     * @param record_groups Records to index, typically one group per file
+     * @param pool Thread pool used for the shard passes
+     */
+    void freeze(std::vector<std::vector<HashRecord>> record_groups, ThreadPool& pool);
+
+    /**
+     * Check if the index uses the frozen CSR layout.
+     */
+    bool is_frozen() const { return frozen_; }
+
+    /**
+     * Check if the CSR arrays live in a memory-mapped index file.
+     */
+    bool is_mapped() const { return mapped_; }
+
+    /**
+     * Save the index to a binary index file.
+     *
+     * A mutable index is frozen and tombstoned locations are compacted
+     * away (on a copy) first. The file is written
+     * to a temporary name and renamed, so readers never see a partial file.
+     *
+     * @param path Destination file
+     * @param info File table and config fingerprint to store
+     * @throws std::runtime_error on I/O errors
      */
-    const std::vector<HashLocation>* get_locations(uint64_t hash) const;
+    void save(const std::filesystem::path& path, const IndexFileInfo& info) const;
 
     /**
-     * Get the number of unique hashes in the index.
+     * Open a saved index through mmap.
+     *
+     * File paths are registered in file table order, so file IDs match
+     * the saved index. The CSR arrays stay in the mapping; modifying the
+     * index (add_hash, freeze) copies them to memory first.
+     *
+     * @param path Index file
+     * @param info Receives the file table and config fingerprint (optional)
+     * @return The mapped, frozen index
+     * @throws std::runtime_error if the file is missing, truncated or has
+     *         an unsupported version or byte order
      */
-    size_t hash_count() const { return index_.size(); }
+    static HashIndex open(const std::filesystem::path& path, IndexFileInfo* info = nullptr);
 
     /**
-     * Get total number of locations stored.
+     * Estimate the memory footprint of the hash storage in bytes.
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * Get total number of live (not tombstoned) locations.
      */
     size_t location_count() const;
 
+    /**
+     * Remove all locations of a file from the given hash buckets.
+     *
+     * Used to drop a changed or deleted file without rebuilding. The
+     * caller passes the hashes the file was indexed under; buckets left
+     * empty are erased. A frozen index is thawed first.
+     *
+     * @param file_id File whose locations to remove
+     * @param hashes Hashes the file contributed
+     * @return Number of locations removed
+     */
+    size_t remove_file_locations(uint32_t file_id, std::span<const uint64_t> hashes);
+
+    /**
+     * Retract a file: tombstone its ID and unregister its path.
+     *
+     * Its locations stay in storage but are skipped by lookups and pair
+     * generation. When the tombstone ratio reaches the compaction
+     * threshold, a frozen index is compacted on the pool in the background
+     * (see compact_async()) and any other index in place.
+     *
+     * @param file_id File to remove (unknown or removed IDs are ignored)
+     * @param pool Thread pool for background compaction (optional)
+     */
+    void remove_file(uint32_t file_id, ThreadPool* pool = nullptr);
+
+    /**
+     * Check if a file ID is tombstoned.
+     */
+    bool is_removed(uint32_t file_id) const {
+        return file_id < removed_.size() && removed_[file_id] != 0;
+    }
+
+    /**
+     * Tombstoned locations still in storage, and their share of all
+     * stored locations.
+     */
+    size_t tombstoned_locations() const { return dead_locations_; }
+    double tombstone_ratio() const;
+
+    /**
+     * Tombstone ratio at which remove_file() compacts (default 0.25).
+     */
+    void set_compaction_threshold(double ratio) { compaction_threshold_ = ratio; }
+    double compaction_threshold() const { return compaction_threshold_; }
+
+    /**
+     * Drop all tombstoned locations now. A pending background compaction
+     * is finished first.
+     */
+    void compact();
+
+    /**
+     * Start compacting a frozen index on the pool.
+     *
+     * The CSR arrays move into a shared snapshot that keeps serving
+     * lookups while the compacted copy is built from it. The result is
+     * installed by finish_compaction(), which every mutating call runs
+     * first, or by remove_file() once it is ready. Files removed after
+     * the snapshot stay tombstoned. A mutable index is compacted in place.
+     */
+    void compact_async(ThreadPool& pool);
+
+    /**
+     * Check if a background compaction has been started and not installed.
+     */
+    bool compaction_pending() const { return pending_.result.valid(); }
+
+    /**
+     * Wait for a pending background compaction and install its result.
+     */
+    void finish_compaction();
+
+    /**
+     * Counters returned by the streaming clone pair visitors.
+     */
+    struct PairStreamStats {
+        size_t pairs = 0;          // Clone pairs handed to the visitor
+        size_t peak_buffered = 0;  // Most pairs buffered at once by producers
+    };
+
+    /**
+     * Stream all clone pairs to a visitor in bounded batches.
+     *
+     * Produces the same pairs as find_clone_pairs() without materializing
+     * them: pairs are buffered up to batch_size and each batch is sorted
+     * by file pair before it is handed over, so consumers that bucket per
+     * file pair see contiguous groups. The batch buffer is reused after
+     * the visitor returns.
+     *
+     * @param visitor Called with each batch of pairs
+     * @param batch_size Maximum number of pairs per batch
+     * @return Pair and buffer counters
+     */
+    PairStreamStats visit_clone_pairs(
+        const ClonePairVisitor& visitor,
+        size_t batch_size = DEFAULT_PAIR_BATCH
+    ) const;
+
+    /**
+     * Stream all clone pairs using parallel producers.
+     *
+     * Each worker fills its own batch buffer; batches are handed to the
+     * visitor one at a time (the visitor never runs concurrently), so at
+     * most pool.size() batches are alive at once.
+     *
+     * @param pool Thread pool to generate pairs on
+     * @param visitor Called with each batch of pairs
+     * @param batch_size Maximum number of pairs per batch
+     * @return Pair and buffer counters
+     */
+    PairStreamStats visit_clone_pairs_parallel(
+        ThreadPool& pool,
+        const ClonePairVisitor& visitor,
+        size_t batch_size = DEFAULT_PAIR_BATCH
+    ) const;
+
+    /**
+     * Visit every (hash, locations) bucket regardless of layout.
+     *
+     * Only live locations are passed; buckets without any are skipped.
+     * With tombstones present the span points into a scratch buffer that
+     * is only valid during the call.
+     */
+    template<typename F>
+    void for_each_bucket(F&& f) const {
+        if (dead_locations_ == 0) {
+            for_each_stored_bucket(f);
+            return;
+        }
+        std::vector<HashLocation> live;
+        for_each_stored_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+            live_locations(locations, live);
+            if (!live.empty()) {
+                f(hash, std::span<const HashLocation>(live));
+            }
+        });
+    }
+
+    /**
+     * Visit every stored bucket, tombstoned locations included.
+     */
+    template<typename F>
+    void for_each_stored_bucket(F&& f) const {
+        if (frozen_) {
+            const auto hashes = csr_hashes();
+            const auto offsets = csr_offsets();
+            const auto locations = csr_locations();
+            for (size_t i = 0; i < hashes.size(); ++i) {
+                f(hashes[i], locations.subspan(offsets[i], offsets[i + 1] - offsets[i]));
+            }
+        } else {
+            for (const auto& [hash, locations] : index_) {
+                f(hash, std::span<const HashLocation>(locations));
+            }
+        }
+    }
+
+    /**
+     * Stream the clone pairs of selected hashes that involve a marked file.
+     *
+     * Pairs between two unmarked files are skipped, so incremental
+     * analysis can re-pair only the files that changed. Stop hashes are
+     * handled as in visit_clone_pairs().
+     *
+     * @param hashes Hashes to visit (each should appear once)
+     * @param files files[file_id] is true for the files whose pairs are wanted
+     * @param visitor Called with each batch of pairs
+     * @param batch_size Maximum number of pairs per batch
+     * @return Pair and buffer counters
+     */
+    PairStreamStats visit_clone_pairs_of(
+        std::span<const uint64_t> hashes,
+        const std::vector<bool>& files,
+        const ClonePairVisitor& visitor,
+        size_t batch_size = DEFAULT_PAIR_BATCH
+    ) const;
+
+    /**
+     * Set how stop hashes are handled by pair generation.
+     */
+    void set_stop_hash_policy(const StopHashPolicy& policy) { stop_policy_ = policy; }
+    const StopHashPolicy& stop_hash_policy() const { return stop_policy_; }
+
+    /**
+     * Current stop hash threshold (see StopHashPolicy::threshold).
+     * Locations removed at build time still count towards the corpus size.
+     */
+    size_t stop_hash_threshold() const;
+
+    /**
+     * Record stop hashes whose locations the builder dropped or sampled
+     * before indexing, so they still show up in get_stats().
+     */
+    void note_thinned_stop_hashes(size_t hashes, size_t locations);
+
+    /**
+     * Record how many singleton windows the builder filtered out before
+     * indexing (see HashIndexBuilder::Config::drop_singletons).
+     */
+    void note_dropped_singletons(size_t locations);
+
+    /**
+     * Collect stop hashes as clone classes (one per hash, locations sorted
+     * by file and position). Only returns classes in CLONE_CLASS mode.
+     */
+    std::vector<CloneClass> find_clone_classes() const;
+
     /**
      * Find all clone pairs in the index.
      *
      * A clone pair is generated for each pair of locations that share
      * the same hash and don't overlap.
      *
-     * @param min_matches Minimum hash matches to consider (default 1)
      * @return Vector of clone pairs
      */
-    std::vector<ClonePair> find_clone_pairs(size_t min_matches = 1) const;
+    std::vector<ClonePair> find_clone_pairs() const;
 
     /**
      * Find all clone pairs in the index using parallel processing.
@@ -83,13 +489,9 @@ public:
      * on large codebases.
      *
      * @param pool Thread pool to use for parallel execution
-     * @param min_matches Minimum hash matches to consider (default 1)
      * @return Vector of clone pairs
      */
-    std::vector<ClonePair> find_clone_pairs_parallel(
-        ThreadPool& pool,
-        size_t min_matches = 1
-    ) const;
+    std::vector<ClonePair> find_clone_pairs_parallel(ThreadPool& pool) const;
 
     /**
      * Merge adjacent clone pairs into larger clone regions.
@@ -99,6 +501,8 @@ public:
      * - Their locations are adjacent or overlapping
      * - The gap between them is small enough
      *
+     * Convenience wrapper around SeedChainer (see seed_chainer.hpp).
+     *
      * @param pairs The clone pairs to merge
      * @param max_gap Maximum gap in tokens to allow merging
      * @return Merged clone pairs representing larger regions
@@ -129,26 +533,193 @@ public:
         size_t total_locations;
         size_t duplicate_hashes;  // Hashes appearing more than once
         size_t max_locations_per_hash;
+        size_t memory_bytes;      // Estimated bytes used by hash storage
+        bool frozen;              // Whether the CSR layout is in use
+        size_t stop_hash_threshold;  // Locations above which a hash is a stop hash
+        size_t stop_hashes;          // Stop hashes (indexed or thinned at build)
+        size_t stop_hash_locations;  // Their locations (indexed or thinned)
+        size_t thinned_locations;    // Locations dropped or sampled away at build
+        size_t singletons_dropped;   // Singleton windows filtered out at build
+        double singleton_false_positive_rate;  // Singletons that passed the filter
+        size_t singleton_bytes_saved;  // Index bytes not spent on dropped singletons
     };
 
     Stats get_stats() const;
 
 private:
-    // Hash -> list of locations
+    // Hash -> list of locations (mutable layout)
     std::unordered_map<uint64_t, std::vector<HashLocation>> index_;
+    size_t mutable_locations_ = 0;  // Locations in index_
+
+    // Frozen CSR layout: sorted unique hashes, offsets into locations.
+    // frozen_offsets_ has frozen_hashes_.size() + 1 entries.
+    std::vector<uint64_t> frozen_hashes_;
+    std::vector<uint32_t> frozen_offsets_;
+    std::vector<HashLocation> frozen_locations_;
+    bool frozen_ = false;
+
+    // Shared CSR storage: a mapped index file or the snapshot a background
+    // compaction reads from. When set, the CSR arrays are the shared_* views.
+    std::shared_ptr<const void> csr_owner_;
+    std::span<const uint64_t> shared_hashes_;
+    std::span<const uint32_t> shared_offsets_;
+    std::span<const HashLocation> shared_locations_;
+    bool mapped_ = false;
+
+    std::span<const uint64_t> csr_hashes() const {
+        return csr_owner_ ? shared_hashes_ : std::span<const uint64_t>(frozen_hashes_);
+    }
+    std::span<const uint32_t> csr_offsets() const {
+        return csr_owner_ ? shared_offsets_ : std::span<const uint32_t>(frozen_offsets_);
+    }
+    std::span<const HashLocation> csr_locations() const {
+        return csr_owner_ ? shared_locations_ : std::span<const HashLocation>(frozen_locations_);
+    }
+
+    // Tombstones: removed_[file_id] != 0 for removed files
+    std::vector<uint8_t> removed_;
+    std::vector<size_t> file_locations_;  // Stored locations per file ID
+    bool file_locations_known_ = true;    // False for an opened index until counted
+    size_t dead_locations_ = 0;           // Stored locations of removed files
+    std::vector<uint32_t> free_file_ids_;  // Removed IDs with no stored locations
+    double compaction_threshold_ = 0.25;
+
+    // Owned CSR arrays, moved around as a unit by compaction
+    struct CsrArrays {
+        std::vector<uint64_t> hashes;
+        std::vector<uint32_t> offsets;
+        std::vector<HashLocation> locations;
+    };
+
+    // Background compaction in flight. Copies of the index do not inherit
+    // it: the task owns its snapshot, so dropping the future is safe.
+    struct PendingCompaction {
+        std::future<CsrArrays> result;
+        std::vector<uint8_t> removed;  // Tombstones the compaction purges
+
+        PendingCompaction() = default;
+        PendingCompaction(const PendingCompaction&) {}
+        PendingCompaction(PendingCompaction&&) = default;
+        PendingCompaction& operator=(const PendingCompaction&) {
+            result = {};
+            removed.clear();
+            return *this;
+        }
+        PendingCompaction& operator=(PendingCompaction&&) = default;
+    };
+    PendingCompaction pending_;
+
+    bool is_live(const HashLocation& location) const {
+        return !is_removed(location.file_id);
+    }
+
+    /**
+     * Copy the live locations of a stored bucket into out.
+     */
+    void live_locations(std::span<const HashLocation> stored, std::vector<HashLocation>& out) const {
+        out.clear();
+        std::ranges::copy_if(stored, std::back_inserter(out), [this](const HashLocation& location) {
+            return is_live(location);
+        });
+    }
+
+    /**
+     * Stored locations of a hash, tombstoned ones included.
+     */
+    std::span<const HashLocation> stored_locations(uint64_t hash) const;
+
+    /**
+     * Count stored locations per file ID (lazily, for opened indexes).
+     */
+    void count_file_locations();
+
+    /**
+     * Build the compacted copy of CSR arrays without the removed files.
+     */
+    static CsrArrays compact_arrays(
+        std::span<const uint64_t> hashes,
+        std::span<const uint32_t> offsets,
+        std::span<const HashLocation> locations,
+        const std::vector<uint8_t>& removed
+    );
+
+    /**
+     * Install compacted CSR arrays and release the purged file IDs.
+     */
+    void install_compacted(CsrArrays arrays, const std::vector<uint8_t>& purged);
+
+    /**
+     * Release the file IDs whose locations a compaction purged.
+     */
+    void release_purged_files(const std::vector<uint8_t>& purged);
+
+    // Stop hash handling and build-time thinning counters
+    StopHashPolicy stop_policy_;
+    size_t thinned_hashes_ = 0;
+    size_t thinned_locations_ = 0;
+    size_t dropped_singletons_ = 0;
 
     // File ID -> file path
     std::vector<std::string> file_paths_;
 
     // File path -> file ID (for deduplication)
     std::unordered_map<std::string, uint32_t> path_to_id_;
+
+
+    /**
+     * Convert a frozen index back to the mutable layout.
+     */
+    void thaw();
+
+    /**
+     * Build the CSR layout from record groups (pool is optional).
+     */
+    void build_frozen(std::vector<std::vector<HashRecord>> record_groups, ThreadPool* pool);
 };
 
 /**
  * Helper class to build HashIndex from tokenized files.
+ *
+ * In freeze mode, add_file() only collects (hash, location) records into
+ * a flat array; finalize() then builds the frozen CSR layout in one pass.
  */
 class HashIndexBuilder {
 public:
+    /**
+     * Configuration for index building.
+     */
+    struct Config {
+        // Rolling hash window size (in tokens)
+        size_t window_size;
+
+        // Collect flat records and build the frozen CSR layout in finalize()
+        bool freeze;
+
+        // Winnowing run length in window hashes (0 or 1 = index every window)
+        size_t winnow_window;
+
+        // Rolling hash function for window hashes
+        HashFunction hash_function;
+
+        // Two-pass singleton elimination in freeze mode: stream all window
+        // hashes through a Bloom filter first and index only hashes seen
+        // at least twice. Windows that occur once can never form a pair.
+        bool drop_singletons;
+
+        // Stop hash policy, applied to the index. In freeze mode, DROP and
+        // SAMPLE also thin stop hashes found by a count-min sketch pass
+        // before the CSR build, so they never take index memory.
+        StopHashPolicy stop_hashes;
+
+        Config()
+            : window_size(10)
+            , freeze(false)
+            , winnow_window(0)
+            , hash_function(HashFunction::MERSENNE_61)
+            , drop_singletons(false)
+        {}
+    };
+
     /**
      * Construct a builder with the specified configuration.
      *
@@ -165,6 +736,14 @@ public:
      */
     HashIndexBuilder(HashIndex& existing_index, size_t window_size);
 
+    /**
+     * Construct a builder that uses an existing index with full configuration.
+     *
+     * @param existing_index Reference to existing index to build upon
+     * @param config Builder configuration
+     */
+    HashIndexBuilder(HashIndex& existing_index, const Config& config);
+
     /**
      * Add a tokenized file to the index.
      *
@@ -173,6 +752,48 @@ public:
      */
     void add_file(const TokenizedFile& file, bool use_normalized = true);
 
+    /**
+     * Add several tokenized files, hashing them in parallel.
+     *
+     * File IDs are registered up front in input order and records are
+     * merged in the same order, so the resulting index does not depend on
+     * scheduling. Window hashes are computed per file on the pool; in
+     * mutable mode they are then inserted sequentially.
+     *
+     * @param files The tokenized files
+     * @param pool Thread pool used for hashing
+     * @param use_normalized Use normalized hashes (for Type-2 detection)
+     * @param selected Only hash files[i] with selected[i] set (all if null);
+     *                 every file is still registered
+     */
+    void add_files(
+        const std::vector<TokenizedFile>& files,
+        ThreadPool& pool,
+        bool use_normalized = true,
+        const std::vector<bool>* selected = nullptr
+    );
+
+    /**
+     * Finish building. In freeze mode this builds the CSR layout from the
+     * collected records; otherwise it is a no-op.
+     *
+     * @param pool Optional thread pool for a sharded parallel build
+     */
+    void finalize(ThreadPool* pool = nullptr);
+
+    /**
+     * Compute the window records of one file without adding them.
+     *
+     * @param file The tokenized file
+     * @param file_id File ID to store in the locations
+     * @param use_normalized Use normalized hashes (for Type-2 detection)
+     */
+    std::vector<HashRecord> collect_records(
+        const TokenizedFile& file,
+        uint32_t file_id,
+        bool use_normalized
+    ) const;
+
     /**
      * Get the built index.
      */
@@ -181,9 +802,173 @@ public:
 
 private:
     size_t window_size_;
+    bool freeze_ = false;
+    size_t winnow_window_ = 0;
+    HashFunction hash_function_ = HashFunction::MERSENNE_61;
     HashIndex index_;               // Internal index (when not using external)
     HashIndex* external_index_ = nullptr;  // External index (when provided)
     bool use_external_ = false;
+    std::vector<std::vector<HashRecord>> record_groups_;  // Per-file records (freeze mode)
+    StopHashPolicy stop_policy_;
+    bool drop_singletons_ = false;
+
+    HashIndex& target_index() { return use_external_ ? *external_index_ : index_; }
+
+    /**
+     * Drop or sample stop hash records before freezing (DROP and SAMPLE
+     * modes). A count-min sketch over all records picks the candidates,
+     * which are then counted exactly.
+     */
+    void thin_stop_hashes(ThreadPool* pool, size_t corpus_size);
+
+    /**
+     * Remove records whose hash occurs only once (freeze mode). A first
+     * Bloom filter marks hashes seen once, a second those seen twice; the
+     * second pass keeps only records in the second filter. True duplicates
+     * are never dropped; singletons survive with the false-positive rate.
+     */
+    void eliminate_singletons(ThreadPool* pool);
+};
+
+/**
+ * Out-of-core hash index for corpora whose window records do not fit in
+ * memory.
+ *
+ * Records are buffered up to a memory budget. A full buffer is sorted by
+ * (hash, file_id, token_start) and spilled to a run file, so only the
+ * budget stays resident however large the corpus is. Buckets come from a
+ * k-way merge of the runs: each hash's locations arrive together, in file
+ * ID then position order, which is the order of a frozen HashIndex built
+ * from the same records when files are added in file ID order (as the
+ * builders do). With more runs than merge_fan_in, runs are first merged
+ * into longer runs.
+ *
+ * Pair generation matches HashIndex::visit_clone_pairs(). Stop hashes are
+ * judged on exact location counts, as the merge sees whole buckets; the
+ * threshold uses all added records, like a HashIndex that counts thinned
+ * and dropped windows. SAMPLE mode keeps the stop hash locations that
+ * HashIndexBuilder keeps when it thins them before freezing. Run files
+ * are removed with the index.
+ */
+class ExternalHashIndex {
+public:
+    /**
+     * Configuration for spilling and merging.
+     */
+    struct Config {
+        // Bytes of records buffered before a sorted run is spilled; also
+        // split between the read buffers of a merge
+        size_t memory_budget_bytes;
+
+        // Directory for run files (system temp directory if empty)
+        std::filesystem::path spill_dir;
+
+        // Most runs read at once by one merge
+        size_t merge_fan_in;
+
+        Config()
+            : memory_budget_bytes(256 << 20)
+            , merge_fan_in(64)
+        {}
+    };
+
+    /**
+     * Spill counters.
+     */
+    struct SpillStats {
+        size_t runs = 0;          // Run files written, merged runs included
+        size_t bytes = 0;         // Bytes written to run files
+        size_t merge_passes = 0;  // Merges of runs into longer runs
+    };
+
+    explicit ExternalHashIndex(const Config& config = Config());
+    ~ExternalHashIndex();
+
+    ExternalHashIndex(const ExternalHashIndex&) = delete;
+    ExternalHashIndex& operator=(const ExternalHashIndex&) = delete;
+
+    /**
+     * Add records, spilling a sorted run whenever the buffer is full.
+     *
+     * @throws std::runtime_error if a run file cannot be written
+     */
+    void add_records(std::span<const HashRecord> records);
+
+    /**
+     * Get the number of records added.
+     */
+    size_t location_count() const { return records_; }
+
+    const SpillStats& spill_stats() const { return stats_; }
+
+    /**
+     * Set how stop hashes are handled by pair generation.
+     */
+    void set_stop_hash_policy(const StopHashPolicy& policy) { stop_policy_ = policy; }
+    const StopHashPolicy& stop_hash_policy() const { return stop_policy_; }
+
+    /**
+     * Location count above which a hash is a stop hash.
+     */
+    size_t stop_hash_threshold() const { return stop_policy_.threshold(records_); }
+
+    /**
+     * Visit every (hash, locations) bucket in hash order.
+     *
+     * Once runs have been spilled, the buffered records are spilled as
+     * well, so the merge read buffers get the whole budget. The span is
+     * only valid during the call.
+     *
+     * @throws std::runtime_error if a run file cannot be read or written
+     */
+    void for_each_bucket(const std::function<void(uint64_t, std::span<const HashLocation>)>& visitor);
+
+    /**
+     * Stream all clone pairs to a visitor in bounded batches, in one merge.
+     *
+     * @param visitor Called with each batch of pairs (sorted by file pair)
+     * @param clone_classes Receives the stop hash clone classes in
+     *                      CLONE_CLASS mode, as HashIndex::find_clone_classes()
+     *                      (optional)
+     * @param batch_size Maximum number of pairs per batch
+     * @return Pair and buffer counters
+     */
+    HashIndex::PairStreamStats visit_clone_pairs(
+        const ClonePairVisitor& visitor,
+        std::vector<CloneClass>* clone_classes = nullptr,
+        size_t batch_size = HashIndex::DEFAULT_PAIR_BATCH
+    );
+
+private:
+    Config config_;
+    size_t buffer_capacity_;          // Records that fit in the budget
+    std::vector<HashRecord> buffer_;  // Records not yet spilled
+    std::vector<std::filesystem::path> runs_;
+    std::string run_prefix_;          // Unique per index
+    size_t next_run_ = 0;
+    size_t records_ = 0;
+    StopHashPolicy stop_policy_;
+    SpillStats stats_;
+
+    /**
+     * Sort the buffer and write it as a new run.
+     */
+    void spill();
+
+    /**
+     * Path for the next run file.
+     */
+    std::filesystem::path next_run_path();
+
+    /**
+     * Merge runs into longer runs until one merge can read them all.
+     */
+    void reduce_runs();
+
+    /**
+     * Read buffer size per run for a merge of the given number of runs.
+     */
+    size_t read_buffer_records(size_t runs) const;
 };
 
 }  // namespace aegis::similarity
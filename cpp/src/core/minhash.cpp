@@ -0,0 +1,164 @@
+#include "core/minhash.hpp"
+#include "core/hash_index.hpp"
+#include "core/rolling_hash.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace aegis::similarity {
+
+namespace {
+
+constexpr uint64_t EMPTY_BIN = std::numeric_limits<uint64_t>::max();
+
+/**
+ * SplitMix64 finalizer.
+ */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Map a 64-bit hash to [0, n) with its high bits (multiply-shift).
+ */
+size_t reduce(const uint64_t hash, const size_t n) {
+    return static_cast<size_t>(((hash >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+}  // anonymous namespace
+
+MinHashLSH::MinHashLSH(const Config& config)
+    : config_(config)
+{
+    config_.signature_size = std::max<size_t>(config_.signature_size, 1);
+    config_.bands = std::clamp<size_t>(config_.bands, 1, config_.signature_size);
+    rows_ = config_.signature_size / config_.bands;
+}
+
+std::vector<uint64_t> MinHashLSH::signature(const TokenizedFile& file) const {
+    const auto hashes = file.tokens.significant_hashes(config_.use_normalized);
+    if (config_.shingle_size == 0 || hashes.size() < config_.shingle_size) {
+        return {};
+    }
+    const auto shingles = HashSequence::compute_all(
+        hashes, config_.shingle_size, config_.hash_function);
+    return signature(shingles);
+}
+
+std::vector<uint64_t> MinHashLSH::signature(const std::span<const uint64_t> shingles) const {
+    if (shingles.empty()) {
+        return {};
+    }
+
+    // One permutation: each shingle is mixed once and kept as its bin's minimum
+    const size_t bins = config_.signature_size;
+    std::vector<uint64_t> filled(bins, EMPTY_BIN);
+    for (const uint64_t shingle : shingles) {
+        const uint64_t value = mix(shingle);
+        auto& bin = filled[reduce(value, bins)];
+        bin = std::min(bin, value);
+    }
+
+    // Empty bins probe a fixed per-bin sequence of bins until one is filled,
+    // so two files fill the same empty bin from the same source bin
+    std::vector<uint64_t> result = filled;
+    for (size_t i = 0; i < bins; ++i) {
+        if (filled[i] != EMPTY_BIN) {
+            continue;
+        }
+        for (uint64_t attempt = 1; ; ++attempt) {
+            const size_t source = reduce(mix(i * 0x9E3779B97F4A7C15ULL + attempt), bins);
+            if (filled[source] != EMPTY_BIN) {
+                result[i] = filled[source];
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+double MinHashLSH::estimate_similarity(
+    const std::span<const uint64_t> a,
+    const std::span<const uint64_t> b
+) {
+    if (a.empty() || a.size() != b.size()) {
+        return 0.0;
+    }
+    size_t equal = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        equal += a[i] == b[i] ? 1 : 0;
+    }
+    return static_cast<double>(equal) / static_cast<double>(a.size());
+}
+
+std::vector<MinHashLSH::FilePair> MinHashLSH::candidate_pairs(
+    const std::vector<std::vector<uint64_t>>& signatures,
+    ThreadPool* pool
+) const {
+    // Per band: sort (band key, file) and pair up the files of each run
+    std::vector<std::vector<uint64_t>> band_pairs(config_.bands);
+    const auto bucket_band = [&](const size_t band) {
+        std::vector<std::pair<uint64_t, uint32_t>> keys;
+        keys.reserve(signatures.size());
+        for (uint32_t file = 0; file < signatures.size(); ++file) {
+            const auto& signature = signatures[file];
+            if (signature.size() != config_.signature_size) {
+                continue;
+            }
+            uint64_t key = band;
+            for (size_t row = band * rows_; row < (band + 1) * rows_; ++row) {
+                key = mix(key ^ signature[row]);
+            }
+            keys.emplace_back(key, file);
+        }
+        std::ranges::sort(keys);
+
+        auto& pairs = band_pairs[band];
+        for (size_t begin = 0; begin < keys.size();) {
+            size_t end = begin + 1;
+            while (end < keys.size() && keys[end].first == keys[begin].first) {
+                ++end;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t j = i + 1; j < end; ++j) {
+                    pairs.push_back(static_cast<uint64_t>(keys[i].second) << 32 | keys[j].second);
+                }
+            }
+            begin = end;
+        }
+    };
+
+    if (pool && pool->size() > 1 && config_.bands > 1) {
+        pool->parallel_for(0, config_.bands, bucket_band);
+    } else {
+        for (size_t band = 0; band < config_.bands; ++band) {
+            bucket_band(band);
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    for (auto& pairs : band_pairs) {
+        keys.insert(keys.end(), pairs.begin(), pairs.end());
+        pairs = {};
+    }
+    std::ranges::sort(keys);
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // Banding only proposes pairs; the full signature decides
+    std::vector<FilePair> result;
+    for (const uint64_t key : keys) {
+        const auto file_a = static_cast<uint32_t>(key >> 32);
+        const auto file_b = static_cast<uint32_t>(key & 0xFFFFFFFF);
+        const double similarity = estimate_similarity(signatures[file_a], signatures[file_b]);
+        if (similarity >= config_.min_similarity) {
+            result.push_back({file_a, file_b, similarity});
+        }
+    }
+    return result;
+}
+
+}  // namespace aegis::similarity
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "models/clone_types.hpp"
+#include "utils/thread_pool.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * File-level near-duplicate search with MinHash signatures and LSH banding.
+ *
+ * A file is reduced to the set of its shingles (rolling hashes over
+ * shingle_size significant tokens, the same windows the hash index uses).
+ * Signatures use one-permutation hashing: every shingle is mixed once and
+ * lands in one of signature_size bins, which keep their minimum; empty
+ * bins borrow the value of a non-empty bin chosen by a per-bin probe
+ * sequence (optimal densification), so two signatures agree in a bin with
+ * probability equal to the Jaccard similarity of the shingle sets. Cost is
+ * O(shingles + signature_size) per file.
+ *
+ * Candidate pairs come from LSH banding: the signature is cut into bands
+ * of signature_size / bands rows and files whose rows agree on a whole
+ * band share a bucket. A pair with Jaccard similarity s becomes a
+ * candidate with probability 1 - (1 - s^rows)^bands, so more bands
+ * (fewer rows each) lower the similarity at which pairs are found.
+ * Candidates are then checked against min_similarity on the full
+ * signature.
+ */
+class MinHashLSH {
+public:
+    /**
+     * Configuration for signatures and banding.
+     */
+    struct Config {
+        // MinHash values per file
+        size_t signature_size;
+
+        // LSH bands; each covers signature_size / bands values
+        size_t bands;
+
+        // Shingle length in significant tokens
+        size_t shingle_size;
+
+        // Minimum estimated Jaccard similarity of a reported pair
+        double min_similarity;
+
+        // Shingle normalized hashes (Type-2) instead of original hashes
+        bool use_normalized;
+
+        // Rolling hash for the shingles
+        HashFunction hash_function;
+
+        Config()
+            : signature_size(128)
+            , bands(32)
+            , shingle_size(10)
+            , min_similarity(0.3)
+            , use_normalized(true)
+            , hash_function(HashFunction::MERSENNE_61)
+        {}
+    };
+
+    /**
+     * A candidate file pair (file_a < file_b) and its estimated similarity.
+     */
+    struct FilePair {
+        uint32_t file_a;
+        uint32_t file_b;
+        double similarity;
+    };
+
+    explicit MinHashLSH(const Config& config = Config());
+
+    /**
+     * MinHash signature of a file (empty if it has fewer significant
+     * tokens than shingle_size).
+     */
+    [[nodiscard]] std::vector<uint64_t> signature(const TokenizedFile& file) const;
+
+    /**
+     * Signature of an already computed set of shingle hashes.
+     */
+    [[nodiscard]] std::vector<uint64_t> signature(std::span<const uint64_t> shingles) const;
+
+    /**
+     * Fraction of positions where two signatures agree (0 if either is empty).
+     */
+    [[nodiscard]] static double estimate_similarity(
+        std::span<const uint64_t> a,
+        std::span<const uint64_t> b
+    );
+
+    /**
+     * Find file pairs that share an LSH bucket and reach min_similarity.
+     *
+     * @param signatures Signatures indexed by file ID (empty ones are skipped)
+     * @param pool Optional thread pool; bands are bucketed in parallel
+     * @return Candidate pairs sorted by (file_a, file_b)
+     */
+    [[nodiscard]] std::vector<FilePair> candidate_pairs(
+        const std::vector<std::vector<uint64_t>>& signatures,
+        ThreadPool* pool = nullptr
+    ) const;
+
+    [[nodiscard]] const Config& config() const { return config_; }
+
+private:
+    Config config_;
+    size_t rows_;  // Signature values per band
+};
+
+}  // namespace aegis::similarity
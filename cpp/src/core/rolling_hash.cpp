@@ -1,101 +1,432 @@
 #include "core/rolling_hash.hpp"
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
 
 namespace aegis::similarity {
 
-RollingHash::RollingHash(const size_t window_size)
+namespace {
+
+size_t ring_capacity(const size_t window_size) {
+    size_t capacity = 1;
+    while (capacity < window_size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+}  // anonymous namespace
+
+template<typename Policy>
+BasicRollingHash<Policy>::BasicRollingHash(const size_t window_size)
     : window_size_(window_size)
-    , base_power_(1)
+    , base_power_(power_mod(window_size > 0 ? window_size - 1 : 0))
+    , ring_(ring_capacity(window_size), 0)
+    , mask_(ring_.size() - 1)
 {
-    // Pre-calculate BASE^(window_size-1) mod MOD
-    for (size_t i = 1; i < window_size_; ++i) {
-        base_power_ = (base_power_ * BASE) % MOD;
-    }
 }
 
-void RollingHash::reset() {
+template<typename Policy>
+void BasicRollingHash<Policy>::reset() {
     hash_ = 0;
-    window_.clear();
+    pushed_ = 0;
 }
 
-std::optional<uint64_t> RollingHash::push(const uint64_t token_hash) {
-    // If window is already full, remove oldest token first
-    if (window_.size() >= window_size_) {
-        // Remove oldest token from hash
-        // hash = hash - old_token * BASE^(window_size-1)
-        uint64_t old_token = window_.front();
-        window_.pop_front();
-
-        // Subtract old token contribution (handle potential underflow)
-        uint64_t old_contribution = (old_token * base_power_) % MOD;
-        if (hash_ >= old_contribution) {
-            hash_ = hash_ - old_contribution;
-        } else {
-            hash_ = MOD - (old_contribution - hash_);
-        }
+template<typename Policy>
+std::optional<uint64_t> BasicRollingHash<Policy>::push(const uint64_t token_hash) {
+    // If window is already full, remove the oldest token contribution
+    // (it sits window_size slots behind the next write position)
+    if (pushed_ >= window_size_) {
+        const uint64_t old_token = ring_[(pushed_ - window_size_) & mask_];
+        hash_ = Policy::remove(hash_, old_token, base_power_);
     }
 
-    // Add new token to hash
-    // hash = hash * BASE + new_token
-    hash_ = (hash_ * BASE + token_hash) % MOD;
-    window_.push_back(token_hash);
+    // Add new token to hash: hash = hash * BASE + new_token
+    hash_ = Policy::append(hash_, token_hash);
+    ring_[pushed_ & mask_] = token_hash;
+    ++pushed_;
 
     // Return hash only if window is now full
-    if (window_.size() >= window_size_) {
+    if (pushed_ >= window_size_) {
         return hash_;
     }
 
     return std::nullopt;
 }
 
-uint64_t RollingHash::compute_hash(const std::vector<uint64_t>& token_hashes) {
+template<typename Policy>
+uint64_t BasicRollingHash<Policy>::compute_hash(const std::vector<uint64_t>& token_hashes) {
     if (token_hashes.empty()) {
         return 0;
     }
 
     uint64_t hash = 0;
     for (const uint64_t token_hash : token_hashes) {
-        hash = (hash * BASE + token_hash) % MOD;
+        hash = Policy::append(hash, token_hash);
     }
     return hash;
 }
 
-uint64_t RollingHash::power_mod(uint64_t exp) {
+template<typename Policy>
+uint64_t BasicRollingHash<Policy>::power_mod(uint64_t exp) {
     uint64_t result = 1;
     uint64_t base = BASE;
 
     while (exp > 0) {
         if (exp % 2 == 1) {
-            result = (result * base) % MOD;
+            result = Policy::mul(result, base);
         }
-        base = (base * base) % MOD;
+        base = Policy::mul(base, base);
         exp /= 2;
     }
 
     return result;
 }
 
-std::vector<std::pair<size_t, uint64_t>> HashSequence::compute_all(
-    const std::vector<uint64_t>& token_hashes,
-    const size_t window_size
+template class BasicRollingHash<Mod1e9HashPolicy>;
+template class BasicRollingHash<Mersenne61HashPolicy>;
+
+namespace {
+
+// Number of independent segments rolled in lockstep
+constexpr size_t LANES = 4;
+
+// Below this many windows per lane, segmenting is not worth the extra seeds
+constexpr size_t MIN_WINDOWS_PER_LANE = 64;
+
+/**
+ * Roll one chain from its seed window over [begin, end).
+ * out[begin] must already hold the seed hash.
+ */
+template<typename Policy, typename Token>
+void roll_scalar(
+    const Token* tokens, const size_t window_size, const uint64_t base_power,
+    uint64_t* out, const size_t begin, const size_t end
+) {
+    uint64_t hash = out[begin];
+    for (size_t pos = begin + 1; pos < end; ++pos) {
+        hash = Policy::remove(hash, tokens[pos - 1], base_power);
+        hash = Policy::append(hash, tokens[pos + window_size - 1]);
+        out[pos] = hash;
+    }
+}
+
+/**
+ * Roll LANES chains in lockstep; lane l covers [l * segment, (l + 1) * segment).
+ * The chains are independent, so the compiler can overlap their multiplies.
+ */
+template<typename Policy, typename Token>
+void roll_multi_lane(
+    const Token* tokens, const size_t window_size, const uint64_t base_power,
+    uint64_t* out, const size_t segment
+) {
+    uint64_t hash[LANES];
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        hash[lane] = out[lane * segment];
+    }
+    for (size_t step = 1; step < segment; ++step) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            const size_t pos = lane * segment + step;
+            hash[lane] = Policy::remove(hash[lane], tokens[pos - 1], base_power);
+            hash[lane] = Policy::append(hash[lane], tokens[pos + window_size - 1]);
+            out[pos] = hash[lane];
+        }
+    }
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AEGIS_HAS_AVX2_KERNEL 1
+
+/**
+ * (x & M) + (x >> 61) with one conditional subtraction; x < 2^63.
+ */
+__attribute__((target("avx2")))
+inline __m256i reduce61_avx2(const __m256i x) {
+    const __m256i mod = _mm256_set1_epi64x(static_cast<long long>(Mersenne61HashPolicy::MOD));
+    const __m256i r = _mm256_add_epi64(_mm256_and_si256(x, mod), _mm256_srli_epi64(x, 61));
+    const __m256i ge = _mm256_cmpgt_epi64(r, _mm256_sub_epi64(mod, _mm256_set1_epi64x(1)));
+    return _mm256_sub_epi64(r, _mm256_and_si256(ge, mod));
+}
+
+/**
+ * a * b mod 2^61 - 1 for a, b < 2^61 using 32x32->64 multiplies.
+ *
+ * With a = a1 * 2^32 + a0 and b = b1 * 2^32 + b0:
+ *   a * b = a1b1 * 2^64 + (a1b0 + a0b1) * 2^32 + a0b0
+ * and 2^64 = 8, 2^61 = 1 (mod 2^61 - 1). The middle term is split at
+ * bit 29 so its high part wraps around as mid >> 29.
+ */
+__attribute__((target("avx2")))
+inline __m256i mul61_avx2(const __m256i a, const __m256i b, const __m256i b_hi) {
+    const __m256i a_hi = _mm256_srli_epi64(a, 32);
+    const __m256i low = _mm256_mul_epu32(a, b);
+    const __m256i high = _mm256_mul_epu32(a_hi, b_hi);
+    const __m256i mid = _mm256_add_epi64(_mm256_mul_epu32(a_hi, b), _mm256_mul_epu32(a, b_hi));
+
+    const __m256i mod = _mm256_set1_epi64x(static_cast<long long>(Mersenne61HashPolicy::MOD));
+    const __m256i mask29 = _mm256_set1_epi64x((1LL << 29) - 1);
+
+    __m256i x = _mm256_slli_epi64(high, 3);
+    x = _mm256_add_epi64(x, _mm256_srli_epi64(mid, 29));
+    x = _mm256_add_epi64(x, _mm256_slli_epi64(_mm256_and_si256(mid, mask29), 32));
+    x = _mm256_add_epi64(x, _mm256_and_si256(low, mod));
+    x = _mm256_add_epi64(x, _mm256_srli_epi64(low, 61));
+    return reduce61_avx2(x);
+}
+
+/**
+ * Gather tokens[lane * segment + offset] for all lanes, reduced mod 2^61 - 1.
+ */
+template<typename Token>
+__attribute__((target("avx2")))
+inline __m256i load_lanes_avx2(const Token* tokens, const size_t segment, const size_t offset) {
+    using Policy = Mersenne61HashPolicy;
+    return _mm256_set_epi64x(
+        static_cast<long long>(Policy::reduce(tokens[3 * segment + offset])),
+        static_cast<long long>(Policy::reduce(tokens[2 * segment + offset])),
+        static_cast<long long>(Policy::reduce(tokens[segment + offset])),
+        static_cast<long long>(Policy::reduce(tokens[offset])));
+}
+
+/**
+ * AVX2 version of roll_multi_lane for the Mersenne-61 policy.
+ *
+ * Each step computes hash * B + t_new - t_old * B^w in one pass:
+ * removing then appending multiplies the outgoing term by B once more.
+ */
+template<typename Token>
+__attribute__((target("avx2")))
+void roll_mersenne61_avx2(
+    const Token* tokens, const size_t window_size,
+    uint64_t* out, const size_t segment
+) {
+    using Policy = Mersenne61HashPolicy;
+    static_assert(LANES == 4, "AVX2 kernel holds four 64-bit lanes");
+
+    const uint64_t base_power_w = BasicRollingHash<Policy>::power_mod(window_size);
+    const __m256i mod = _mm256_set1_epi64x(static_cast<long long>(Policy::MOD));
+    const __m256i base = _mm256_set1_epi64x(static_cast<long long>(Policy::BASE));
+    const __m256i base_hi = _mm256_srli_epi64(base, 32);
+    const __m256i drop = _mm256_set1_epi64x(static_cast<long long>(base_power_w));
+    const __m256i drop_hi = _mm256_srli_epi64(drop, 32);
+
+    __m256i hash = _mm256_set_epi64x(
+        static_cast<long long>(out[3 * segment]), static_cast<long long>(out[2 * segment]),
+        static_cast<long long>(out[segment]), static_cast<long long>(out[0]));
+
+    alignas(32) uint64_t lanes[LANES];
+    for (size_t step = 1; step < segment; ++step) {
+        const __m256i outgoing = load_lanes_avx2(tokens, segment, step - 1);
+        const __m256i incoming = load_lanes_avx2(tokens, segment, step + window_size - 1);
+
+        // Each term is < 2^61, so the sum stays below 2^63
+        __m256i x = mul61_avx2(hash, base, base_hi);
+        x = _mm256_add_epi64(x, incoming);
+        x = _mm256_add_epi64(x, _mm256_sub_epi64(mod, mul61_avx2(outgoing, drop, drop_hi)));
+        hash = reduce61_avx2(x);
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), hash);
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            out[lane * segment + step] = lanes[lane];
+        }
+    }
+}
+
+#endif
+
+template<typename Policy, typename Token>
+std::vector<uint64_t> compute_windows(
+    const std::span<const Token> token_hashes,
+    const size_t window_size,
+    HashKernel kernel
+) {
+    std::vector<uint64_t> result;
+
+    if (window_size == 0 || token_hashes.size() < window_size) {
+        return result;
+    }
+
+    const size_t window_count = token_hashes.size() - window_size + 1;
+    result.resize(window_count);
+
+    constexpr bool is_mersenne = std::is_same_v<Policy, Mersenne61HashPolicy>;
+    // The legacy policy is only exact for tokens below 2^32 (larger values
+    // overflow before reduction), so by default it keeps its single chain
+    if (kernel == HashKernel::AUTO) {
+        if constexpr (is_mersenne) {
+            kernel = HashSequence::avx2_supported() ? HashKernel::AVX2 : HashKernel::MULTI_LANE;
+        } else {
+            kernel = HashKernel::SCALAR;
+        }
+    }
+    if (kernel == HashKernel::AVX2 && !(is_mersenne && HashSequence::avx2_supported())) {
+        kernel = HashKernel::MULTI_LANE;
+    }
+
+    const size_t segment = window_count / LANES;
+    if (segment < MIN_WINDOWS_PER_LANE) {
+        kernel = HashKernel::SCALAR;
+    }
+
+    // Seed every chain with its first window hash
+    const size_t chains = kernel == HashKernel::SCALAR ? 1 : LANES;
+    for (size_t chain = 0; chain < chains; ++chain) {
+        const size_t seed = chain * segment;
+        uint64_t hash = 0;
+        for (size_t i = 0; i < window_size; ++i) {
+            hash = Policy::append(hash, token_hashes[seed + i]);
+        }
+        result[seed] = hash;
+    }
+
+    const uint64_t base_power = BasicRollingHash<Policy>::power_mod(window_size - 1);
+    const Token* tokens = token_hashes.data();
+
+    switch (kernel) {
+        case HashKernel::SCALAR:
+            roll_scalar<Policy>(tokens, window_size, base_power, result.data(), 0, window_count);
+            return result;
+        case HashKernel::AVX2:
+#ifdef AEGIS_HAS_AVX2_KERNEL
+            if constexpr (is_mersenne) {
+                roll_mersenne61_avx2(tokens, window_size, result.data(), segment);
+                break;
+            }
+#endif
+            [[fallthrough]];
+        case HashKernel::AUTO:
+        case HashKernel::MULTI_LANE:
+            roll_multi_lane<Policy>(tokens, window_size, base_power, result.data(), segment);
+            break;
+    }
+
+    // Windows past the last full segment continue the last chain
+    roll_scalar<Policy>(tokens, window_size, base_power, result.data(),
+                        LANES * segment - 1, window_count);
+    return result;
+}
+
+}  // anonymous namespace
+
+bool HashSequence::avx2_supported() {
+#ifdef AEGIS_HAS_AVX2_KERNEL
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+template<typename Policy>
+std::vector<uint64_t> HashSequence::compute_all(
+    const std::span<const uint64_t> token_hashes,
+    const size_t window_size,
+    const HashKernel kernel
+) {
+    return compute_windows<Policy>(token_hashes, window_size, kernel);
+}
+
+template<typename Policy>
+std::vector<uint64_t> HashSequence::compute_all(
+    const std::span<const uint32_t> token_hashes,
+    const size_t window_size,
+    const HashKernel kernel
+) {
+    return compute_windows<Policy>(token_hashes, window_size, kernel);
+}
+
+template std::vector<uint64_t> HashSequence::compute_all<Mod1e9HashPolicy>(
+    std::span<const uint64_t>, size_t, HashKernel);
+template std::vector<uint64_t> HashSequence::compute_all<Mersenne61HashPolicy>(
+    std::span<const uint64_t>, size_t, HashKernel);
+template std::vector<uint64_t> HashSequence::compute_all<Mod1e9HashPolicy>(
+    std::span<const uint32_t>, size_t, HashKernel);
+template std::vector<uint64_t> HashSequence::compute_all<Mersenne61HashPolicy>(
+    std::span<const uint32_t>, size_t, HashKernel);
+
+namespace {
+
+template<typename Token>
+std::vector<uint64_t> compute_with(
+    const std::span<const Token> token_hashes,
+    const size_t window_size,
+    const HashFunction function,
+    const HashKernel kernel
+) {
+    switch (function) {
+        case HashFunction::MOD_1E9_9:
+            return HashSequence::compute_all<Mod1e9HashPolicy>(token_hashes, window_size, kernel);
+        case HashFunction::MERSENNE_61:
+            return HashSequence::compute_all<Mersenne61HashPolicy>(token_hashes, window_size, kernel);
+    }
+    return HashSequence::compute_all<Mersenne61HashPolicy>(token_hashes, window_size, kernel);
+}
+
+}  // anonymous namespace
+
+std::vector<uint64_t> HashSequence::compute_all(
+    const std::span<const uint64_t> token_hashes,
+    const size_t window_size,
+    const HashFunction function,
+    const HashKernel kernel
+) {
+    return compute_with(token_hashes, window_size, function, kernel);
+}
+
+std::vector<uint64_t> HashSequence::compute_all(
+    const std::span<const uint32_t> token_hashes,
+    const size_t window_size,
+    const HashFunction function,
+    const HashKernel kernel
+) {
+    return compute_with(token_hashes, window_size, function, kernel);
+}
+
+std::vector<std::pair<size_t, uint64_t>> HashSequence::winnow(
+    const std::vector<uint64_t>& window_hashes,
+    const size_t winnow_window
 ) {
     std::vector<std::pair<size_t, uint64_t>> result;
 
-    if (token_hashes.size() < window_size) {
+    if (winnow_window <= 1) {
+        result.reserve(window_hashes.size());
+        for (size_t pos = 0; pos < window_hashes.size(); ++pos) {
+            result.emplace_back(pos, window_hashes[pos]);
+        }
+        return result;
+    }
+
+    if (window_hashes.empty()) {
         return result;
     }
 
-    // Pre-allocate for efficiency
-    result.reserve(token_hashes.size() - window_size + 1);
+    // Monotone queue of candidate positions with strictly increasing hashes;
+    // the front is the rightmost minimum of the current run
+    std::deque<size_t> candidates;
+    size_t last_selected = window_hashes.size();
 
-    RollingHash hasher(window_size);
+    for (size_t i = 0; i < window_hashes.size(); ++i) {
+        while (!candidates.empty() && window_hashes[candidates.back()] >= window_hashes[i]) {
+            candidates.pop_back();
+        }
+        candidates.push_back(i);
+
+        if (candidates.front() + winnow_window <= i) {
+            candidates.pop_front();
+        }
 
-    for (size_t i = 0; i < token_hashes.size(); ++i) {
-        if (auto hash = hasher.push(token_hashes[i]); hash.has_value()) {
-            // Position is the start of the window
-            size_t start_pos = i - window_size + 1;
-            result.emplace_back(start_pos, *hash);
+        if (i + 1 >= winnow_window && candidates.front() != last_selected) {
+            last_selected = candidates.front();
+            result.emplace_back(last_selected, window_hashes[last_selected]);
         }
     }
+
+    if (window_hashes.size() < winnow_window) {
+        result.emplace_back(candidates.front(), window_hashes[candidates.front()]);
+    }
+
     return result;
 }
 
@@ -1,12 +1,72 @@
 #pragma once
 
+#include "models/clone_types.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace aegis::similarity {
 
+/**
+ * Legacy hash policy: BASE = 31 modulo the 30-bit prime 1e9 + 9.
+ *
+ * Kept for compatibility; with millions of windows the 30-bit range
+ * produces real collisions.
+ */
+struct Mod1e9HashPolicy {
+    static constexpr uint64_t BASE = 31;
+    static constexpr uint64_t MOD = 1'000'000'009ULL;
+
+    static uint64_t mul(const uint64_t a, const uint64_t b) { return (a * b) % MOD; }
+
+    // hash * BASE + token (tokens are added unreduced, as before)
+    static uint64_t append(const uint64_t hash, const uint64_t token) {
+        return (hash * BASE + token) % MOD;
+    }
+
+    // hash - token * base_power
+    static uint64_t remove(const uint64_t hash, const uint64_t token, const uint64_t base_power) {
+        const uint64_t contribution = (token * base_power) % MOD;
+        return hash >= contribution ? hash - contribution : MOD - (contribution - hash);
+    }
+};
+
+/**
+ * Hash policy over the Mersenne prime 2^61 - 1.
+ *
+ * Products are reduced with one 64x64->128 multiply plus shift/add
+ * (x mod 2^61-1 = (x & M) + (x >> 61)), so no division is needed. The
+ * base is a fixed large constant: results must be stable across runs.
+ */
+struct Mersenne61HashPolicy {
+    static constexpr uint64_t MOD = (1ULL << 61) - 1;
+    static constexpr uint64_t BASE = 0x1E3B6D9F4A7C15ULL;
+
+    static uint64_t reduce(const uint64_t x) {
+        const uint64_t r = (x & MOD) + (x >> 61);
+        return r >= MOD ? r - MOD : r;
+    }
+
+    static uint64_t mul(const uint64_t a, const uint64_t b) {
+        __extension__ using uint128 = unsigned __int128;
+        const uint128 product = static_cast<uint128>(a) * b;
+        const uint64_t lo = static_cast<uint64_t>(product) & MOD;
+        const uint64_t hi = static_cast<uint64_t>(product >> 61);
+        return reduce(lo + hi);
+    }
+
+    static uint64_t append(const uint64_t hash, const uint64_t token) {
+        return reduce(mul(hash, BASE) + reduce(token));
+    }
+
+    static uint64_t remove(const uint64_t hash, const uint64_t token, const uint64_t base_power) {
+        return reduce(hash + MOD - mul(reduce(token), base_power));
+    }
+};
+
 /**
  * Rabin-Karp rolling hash implementation.
  *
@@ -19,22 +79,22 @@ namespace aegis::similarity {
  * When sliding the window:
  *   new_hash = ((old_hash - t[0] * BASE^(w-1)) * BASE + t[new]) mod MOD
  *
- * Constants chosen for low collision rate:
- *   BASE = 31 (small prime, good ASCII distribution)
- *   MOD = 1e9 + 9 (large prime)
+ * BASE, MOD and the modular arithmetic come from the Policy. The window
+ * is kept in a power-of-two ring buffer.
  */
-class RollingHash {
+template<typename Policy>
+class BasicRollingHash {
 public:
     // Hash constants
-    static constexpr uint64_t BASE = 31;
-    static constexpr uint64_t MOD = 1'000'000'009ULL;
+    static constexpr uint64_t BASE = Policy::BASE;
+    static constexpr uint64_t MOD = Policy::MOD;
 
     /**
      * Construct a rolling hash with the specified window size.
      *
      * @param window_size Number of tokens in the sliding window
      */
-    explicit RollingHash(size_t window_size);
+    explicit BasicRollingHash(size_t window_size);
 
     /**
      * Reset the rolling hash to the initial state.
@@ -58,12 +118,12 @@ public:
     /**
      * Get the number of tokens currently in the window.
      */
-    size_t current_size() const { return window_.size(); }
+    size_t current_size() const { return std::min(pushed_, window_size_); }
 
     /**
      * Check if the window is full.
      */
-    bool is_full() const { return window_.size() >= window_size_; }
+    bool is_full() const { return pushed_ >= window_size_; }
 
     /**
      * Compute hash for a sequence of token hashes (non-rolling).
@@ -84,25 +144,106 @@ private:
     size_t window_size_;
     uint64_t hash_ = 0;
     uint64_t base_power_;  // BASE^(window_size-1) mod MOD
-    std::deque<uint64_t> window_;
+    std::vector<uint64_t> ring_;  // Power-of-two capacity >= window_size
+    size_t mask_;
+    size_t pushed_ = 0;    // Tokens pushed since the last reset
+};
+
+// Legacy hash, kept as the default RollingHash for compatibility
+using RollingHash = BasicRollingHash<Mod1e9HashPolicy>;
+using RollingHash61 = BasicRollingHash<Mersenne61HashPolicy>;
+
+extern template class BasicRollingHash<Mod1e9HashPolicy>;
+extern template class BasicRollingHash<Mersenne61HashPolicy>;
+
+/**
+ * Kernel used by HashSequence::compute_all.
+ */
+enum class HashKernel {
+    AUTO,        // Best available kernel for the policy and CPU
+    SCALAR,      // One rolling chain over the whole sequence
+    MULTI_LANE,  // Independent segments interleaved in scalar registers
+    AVX2         // Independent segments in AVX2 lanes (Mersenne-61 only)
 };
 
 /**
  * Batch processor for computing all window hashes in a token sequence.
  * More efficient than calling push() repeatedly when you need all hashes.
+ *
+ * The sequence can be split into independent segments, each seeded with
+ * its own first window hash and rolled in lockstep. This breaks the
+ * serial dependency of a single rolling chain so segments run in
+ * parallel lanes. All kernels produce identical results (for the legacy
+ * policy, as long as token hashes fit in 32 bits).
  */
 class HashSequence {
 public:
     /**
      * Compute all window hashes for a token sequence.
      *
-     * @param token_hashes Vector of token hash values
+     * @tparam Policy Hash policy (defaults to the legacy hash)
+     * @param token_hashes Token hash values
      * @param window_size Size of the sliding window
-     * @return Vector of (position, hash) pairs
+     * @param kernel Kernel to use (unsupported kernels fall back)
+     * @return Window hashes indexed by start position
+     */
+    template<typename Policy = Mod1e9HashPolicy>
+    static std::vector<uint64_t> compute_all(
+        std::span<const uint64_t> token_hashes,
+        size_t window_size,
+        HashKernel kernel = HashKernel::AUTO
+    );
+
+    /**
+     * Compute all window hashes for 32-bit token hashes, such as the
+     * columns of a TokenStore, without widening them first.
+     */
+    template<typename Policy = Mod1e9HashPolicy>
+    static std::vector<uint64_t> compute_all(
+        std::span<const uint32_t> token_hashes,
+        size_t window_size,
+        HashKernel kernel = HashKernel::AUTO
+    );
+
+    /**
+     * Compute all window hashes with a hash function chosen at runtime.
+     */
+    static std::vector<uint64_t> compute_all(
+        std::span<const uint64_t> token_hashes,
+        size_t window_size,
+        HashFunction function,
+        HashKernel kernel = HashKernel::AUTO
+    );
+
+    static std::vector<uint64_t> compute_all(
+        std::span<const uint32_t> token_hashes,
+        size_t window_size,
+        HashFunction function,
+        HashKernel kernel = HashKernel::AUTO
+    );
+
+    /**
+     * Check whether the AVX2 kernel can run on this CPU.
+     */
+    static bool avx2_supported();
+
+    /**
+     * Select winnowing fingerprints from a sequence of window hashes.
+     *
+     * In every run of winnow_window consecutive window hashes the minimum
+     * is selected (the rightmost one on ties) and each selected position is
+     * emitted once. Selection only depends on the run itself, so with
+     * k-token windows any two sequences sharing winnow_window + k - 1
+     * consecutive tokens share at least one fingerprint. Inputs shorter
+     * than one run keep their overall minimum.
+     *
+     * @param window_hashes Window hashes indexed by position (compute_all())
+     * @param winnow_window Number of consecutive window hashes per run
+     * @return Selected (position, hash) pairs in position order
      */
-    static std::vector<std::pair<size_t, uint64_t>> compute_all(
-        const std::vector<uint64_t>& token_hashes,
-        size_t window_size
+    static std::vector<std::pair<size_t, uint64_t>> winnow(
+        const std::vector<uint64_t>& window_hashes,
+        size_t winnow_window
     );
 };
 
@@ -0,0 +1,317 @@
+#include "core/seed_chainer.hpp"
+#include <algorithm>
+#include <ranges>
+#include <unordered_map>
+
+namespace aegis::similarity {
+
+namespace {
+
+uint64_t file_pair_key(const ClonePair& pair) {
+    return static_cast<uint64_t>(pair.location_a.file_id) << 32 | pair.location_b.file_id;
+}
+
+int64_t diagonal(const ClonePair& pair) {
+    return static_cast<int64_t>(pair.location_b.token_start) -
+           static_cast<int64_t>(pair.location_a.token_start);
+}
+
+uint32_t end_a(const ClonePair& pair) {
+    return pair.location_a.token_start + pair.location_a.token_count;
+}
+
+uint32_t end_b(const ClonePair& pair) {
+    return pair.location_b.token_start + pair.location_b.token_count;
+}
+
+/**
+ * Put the lower file (or the earlier region within one file) first.
+ */
+void orient(ClonePair& pair) {
+    const auto& a = pair.location_a;
+    const auto& b = pair.location_b;
+    if (a.file_id > b.file_id || (a.file_id == b.file_id && a.token_start > b.token_start)) {
+        std::swap(pair.location_a, pair.location_b);
+    }
+}
+
+/**
+ * Order seed indices of one diagonal by token_start_a.
+ *
+ * Seeds of a clone cover nearly every start on their diagonal, so a
+ * counting sort over the start range is linear. Sparse diagonals (a few
+ * seeds far apart) fall back to a comparison sort of that small group.
+ */
+void order_by_start(std::vector<uint32_t>& group, const std::vector<ClonePair>& seeds) {
+    if (group.size() < 2) {
+        return;
+    }
+
+    uint32_t lo = seeds[group[0]].location_a.token_start;
+    uint32_t hi = lo;
+    for (const uint32_t idx : group) {
+        lo = std::min(lo, seeds[idx].location_a.token_start);
+        hi = std::max(hi, seeds[idx].location_a.token_start);
+    }
+
+    const size_t range = static_cast<size_t>(hi - lo) + 1;
+    if (range > 4 * group.size() + 64) {
+        std::ranges::sort(group, [&seeds](const uint32_t x, const uint32_t y) {
+            return seeds[x].location_a.token_start < seeds[y].location_a.token_start;
+        });
+        return;
+    }
+
+    std::vector<uint32_t> offsets(range + 1, 0);
+    for (const uint32_t idx : group) {
+        offsets[seeds[idx].location_a.token_start - lo + 1]++;
+    }
+    for (size_t i = 1; i <= range; ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    std::vector<uint32_t> sorted(group.size());
+    for (const uint32_t idx : group) {
+        sorted[offsets[seeds[idx].location_a.token_start - lo]++] = idx;
+    }
+    group = std::move(sorted);
+}
+
+/**
+ * Extend run to cover next (both already in the same orientation).
+ */
+void absorb(ClonePair& run, const ClonePair& next) {
+    if (end_a(next) > end_a(run)) {
+        run.location_a.token_count = end_a(next) - run.location_a.token_start;
+    }
+    if (end_b(next) > end_b(run)) {
+        run.location_b.token_count = end_b(next) - run.location_b.token_start;
+    }
+}
+
+/**
+ * Collapse seeds of one file pair to gapped runs along each diagonal.
+ */
+std::vector<ClonePair> chain_diagonals(const std::vector<ClonePair>& seeds, const size_t max_gap) {
+    std::unordered_map<int64_t, std::vector<uint32_t>> diagonals;
+    for (uint32_t i = 0; i < seeds.size(); ++i) {
+        diagonals[diagonal(seeds[i])].push_back(i);
+    }
+
+    std::vector<ClonePair> runs;
+    for (auto& group : diagonals | std::views::values) {
+        order_by_start(group, seeds);
+
+        ClonePair run = seeds[group[0]];
+        for (size_t i = 1; i < group.size(); ++i) {
+            const auto& next = seeds[group[i]];
+            if (next.location_a.token_start <= end_a(run) + max_gap) {
+                absorb(run, next);
+            } else {
+                runs.push_back(run);
+                run = next;
+            }
+        }
+        runs.push_back(run);
+    }
+    return runs;
+}
+
+/**
+ * Join diagonal runs of one file pair on nearby diagonals (indels shift
+ * the diagonal) and append the regions to out.
+ */
+void join_runs(std::vector<ClonePair> runs, const size_t max_gap, std::vector<ClonePair>& out) {
+    std::ranges::sort(runs, [](const ClonePair& x, const ClonePair& y) {
+        if (x.location_a.token_start != y.location_a.token_start) {
+            return x.location_a.token_start < y.location_a.token_start;
+        }
+        return x.location_b.token_start < y.location_b.token_start;
+    });
+
+    ClonePair current = runs[0];
+    for (size_t i = 1; i < runs.size(); ++i) {
+        const auto& next = runs[i];
+        const bool adjacent_a = next.location_a.token_start <= end_a(current) + max_gap;
+        const bool adjacent_b = next.location_b.token_start >= current.location_b.token_start &&
+                                next.location_b.token_start <= end_b(current) + max_gap;
+        if (adjacent_a && adjacent_b) {
+            absorb(current, next);
+        } else {
+            out.push_back(current);
+            current = next;
+        }
+    }
+    out.push_back(current);
+}
+
+/**
+ * Hash of a class's shape: its files and offsets relative to the first
+ * location.
+ */
+uint64_t class_shape(const CloneClass& clone_class) {
+    const auto& first = clone_class.locations[0];
+    uint64_t hash = clone_class.locations.size();
+    for (const auto& loc : clone_class.locations) {
+        const uint64_t offset = static_cast<uint64_t>(loc.token_start - first.token_start);
+        hash = (hash ^ (static_cast<uint64_t>(loc.file_id) << 32 | offset)) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool same_shape(const CloneClass& x, const CloneClass& y) {
+    if (x.locations.size() != y.locations.size()) {
+        return false;
+    }
+    const uint32_t base_x = x.locations[0].token_start;
+    const uint32_t base_y = y.locations[0].token_start;
+    for (size_t i = 0; i < x.locations.size(); ++i) {
+        if (x.locations[i].file_id != y.locations[i].file_id ||
+            x.locations[i].token_start - base_x != y.locations[i].token_start - base_y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // anonymous namespace
+
+SeedChainer::Stream::Stream(const Config& config)
+    : config_(config)
+    , compact_at_(config.compact_threshold)
+{
+}
+
+void SeedChainer::Stream::add(const std::span<const ClonePair> seeds) {
+    for (ClonePair seed : seeds) {
+        orient(seed);
+        auto& entry = by_file_pair_[file_pair_key(seed)];
+        if (entry.seeds.size() == entry.compacted_size) {
+            dirty_.push_back(file_pair_key(seed));
+        }
+        entry.seeds.push_back(seed);
+    }
+    held_ += seeds.size();
+    peak_size_ = std::max(peak_size_, held_);
+
+    if (held_ >= compact_at_) {
+        compact();
+    }
+}
+
+void SeedChainer::Stream::compact() {
+    for (const uint64_t key : dirty_) {
+        auto& entry = by_file_pair_[key];
+        held_ -= entry.seeds.size();
+        entry.seeds = chain_diagonals(entry.seeds, config_.max_gap);
+        entry.compacted_size = entry.seeds.size();
+        held_ += entry.seeds.size();
+    }
+    dirty_.clear();
+    compact_at_ = std::max(config_.compact_threshold, 2 * held_);
+}
+
+std::vector<ClonePair> SeedChainer::Stream::finish(ThreadPool* pool) {
+    std::vector<std::pair<uint64_t, std::vector<ClonePair>>> groups;
+    groups.reserve(by_file_pair_.size());
+    for (auto& [key, entry] : by_file_pair_) {
+        groups.emplace_back(key, std::move(entry.seeds));
+    }
+    by_file_pair_.clear();
+    dirty_.clear();
+    held_ = 0;
+    compact_at_ = config_.compact_threshold;
+    std::ranges::sort(groups, {}, &std::pair<uint64_t, std::vector<ClonePair>>::first);
+
+    std::vector<std::vector<ClonePair>> chained(groups.size());
+    const auto run_group = [&](const size_t i) {
+        auto runs = chain_diagonals(groups[i].second, config_.max_gap);
+        groups[i].second = {};
+        join_runs(std::move(runs), config_.max_gap, chained[i]);
+    };
+    if (pool != nullptr && pool->size() > 1 && groups.size() >= config_.parallel_threshold) {
+        pool->parallel_for(0, groups.size(), run_group);
+    } else {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            run_group(i);
+        }
+    }
+
+    size_t total = 0;
+    for (const auto& group : chained) {
+        total += group.size();
+    }
+    std::vector<ClonePair> merged;
+    merged.reserve(total);
+    for (auto& group : chained) {
+        merged.insert(merged.end(), group.begin(), group.end());
+    }
+    return merged;
+}
+
+SeedChainer::SeedChainer(const Config& config)
+    : config_(config)
+{
+}
+
+std::vector<CloneClass> SeedChainer::chain_classes(std::vector<CloneClass> classes) const {
+    std::unordered_map<uint64_t, std::vector<uint32_t>> shapes;
+    for (uint32_t i = 0; i < classes.size(); ++i) {
+        if (!classes[i].locations.empty()) {
+            shapes[class_shape(classes[i])].push_back(i);
+        }
+    }
+
+    std::vector<CloneClass> chained;
+    for (auto& group : shapes | std::views::values) {
+        std::ranges::sort(group, {}, [&classes](const uint32_t i) {
+            return classes[i].locations[0].token_start;
+        });
+
+        CloneClass run = std::move(classes[group[0]]);
+        for (size_t k = 1; k < group.size(); ++k) {
+            auto& next = classes[group[k]];
+            const auto& head = run.locations[0];
+            const bool adjacent = next.locations[0].token_start <=
+                                  head.token_start + head.token_count + config_.max_gap;
+            if (adjacent && same_shape(run, next)) {
+                for (size_t i = 0; i < run.locations.size(); ++i) {
+                    auto& loc = run.locations[i];
+                    const auto& other = next.locations[i];
+                    const uint32_t end = other.token_start + other.token_count;
+                    if (end > loc.token_start + loc.token_count) {
+                        loc.token_count = end - loc.token_start;
+                    }
+                }
+            } else {
+                chained.push_back(std::move(run));
+                run = std::move(next);
+            }
+        }
+        chained.push_back(std::move(run));
+    }
+
+    std::ranges::sort(chained, [](const CloneClass& x, const CloneClass& y) {
+        const auto& a = x.locations[0];
+        const auto& b = y.locations[0];
+        if (a.file_id != b.file_id) return a.file_id < b.file_id;
+        return a.token_start < b.token_start;
+    });
+    return chained;
+}
+
+std::vector<ClonePair> SeedChainer::chain(std::vector<ClonePair> seeds) const {
+    auto chain_stream = stream();
+    chain_stream.add(seeds);
+    seeds = {};
+    return chain_stream.finish();
+}
+
+std::vector<ClonePair> SeedChainer::chain(std::vector<ClonePair> seeds, ThreadPool& pool) const {
+    auto chain_stream = stream();
+    chain_stream.add(seeds);
+    seeds = {};
+    return chain_stream.finish(&pool);
+}
+
+}  // namespace aegis::similarity
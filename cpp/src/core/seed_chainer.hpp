@@ -0,0 +1,144 @@
+#pragma once
+
+#include "models/clone_types.hpp"
+#include "utils/thread_pool.hpp"
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * Chains raw window matches (seeds) into clone regions.
+ *
+ * Every window of an exact clone emits its own seed, so a 200-token
+ * clone arrives as ~190 overlapping pairs. Instead of sorting all seeds,
+ * the chainer buckets them by (file_a, file_b, diagonal) where
+ * diagonal = token_start_b - token_start_a, orders each diagonal with a
+ * counting sort over its (usually dense) start range and merges runs
+ * whose gap is at most max_gap in one linear pass.
+ *
+ * The resulting diagonal runs are far fewer than the seeds; runs of the
+ * same file pair whose starts are within max_gap on both sides are then
+ * joined, which bridges small insertions that shift the diagonal.
+ *
+ * Seeds are oriented so that file_a <= file_b (and token_start_a <=
+ * token_start_b within one file) before chaining.
+ */
+class SeedChainer {
+public:
+    /**
+     * Configuration for seed chaining.
+     */
+    struct Config {
+        // Maximum gap (in tokens) between chained seeds
+        size_t max_gap;
+
+        // Minimum number of file pairs before chaining on the thread pool
+        size_t parallel_threshold;
+
+        // Buffered seeds that trigger a diagonal compaction in a Stream
+        size_t compact_threshold;
+
+        Config()
+            : max_gap(5)
+            , parallel_threshold(8)
+            , compact_threshold(1 << 16)
+        {}
+    };
+
+    /**
+     * Incremental chainer for seeds that arrive in batches.
+     *
+     * Seeds are bucketed per file pair as they arrive. Whenever
+     * compact_threshold new seeds are buffered, the touched file pairs are
+     * collapsed to their diagonal runs, so memory stays proportional to
+     * the number of clone regions rather than the number of raw seeds.
+     * Merging on a diagonal is order independent, so the result equals
+     * chaining all seeds at once.
+     */
+    class Stream {
+    public:
+        explicit Stream(const Config& config);
+
+        /**
+         * Add a batch of seeds (copied; the span may be reused afterwards).
+         */
+        void add(std::span<const ClonePair> seeds);
+
+        /**
+         * Chain everything added so far. The stream is empty afterwards.
+         *
+         * @param pool Optional thread pool; each file pair is one task
+         * @return Chained clone pairs, grouped by file pair in ascending order
+         */
+        [[nodiscard]] std::vector<ClonePair> finish(ThreadPool* pool = nullptr);
+
+        /**
+         * Largest number of seeds and runs held at once.
+         */
+        [[nodiscard]] size_t peak_size() const { return peak_size_; }
+
+    private:
+        struct FilePairSeeds {
+            std::vector<ClonePair> seeds;
+            size_t compacted_size = 0;  // Size after the last compaction
+        };
+
+        void compact();
+
+        Config config_;
+        std::unordered_map<uint64_t, FilePairSeeds> by_file_pair_;
+        std::vector<uint64_t> dirty_;  // File pairs grown since compaction
+        size_t held_ = 0;
+        size_t compact_at_;
+        size_t peak_size_ = 0;
+    };
+
+    explicit SeedChainer(const Config& config = Config());
+
+    /**
+     * Chain seeds into clone regions.
+     *
+     * @param seeds Raw clone pairs, in any order
+     * @return Chained clone pairs, grouped by file pair in ascending order
+     */
+    [[nodiscard]] std::vector<ClonePair> chain(std::vector<ClonePair> seeds) const;
+
+    /**
+     * Chain seeds with each file pair processed as one task on the pool.
+     *
+     * Produces the same result as the sequential overload.
+     *
+     * @param seeds Raw clone pairs, in any order
+     * @param pool Thread pool to run per-file-pair chaining on
+     * @return Chained clone pairs, grouped by file pair in ascending order
+     */
+    [[nodiscard]] std::vector<ClonePair> chain(
+        std::vector<ClonePair> seeds,
+        ThreadPool& pool
+    ) const;
+
+    /**
+     * Chain window-sized clone classes into larger classes.
+     *
+     * Consecutive windows of a block repeated N times form N-location
+     * classes with the same shape (the same files and relative offsets),
+     * shifted by one token. Classes are bucketed by shape and runs along
+     * the shift are merged with the same max_gap rule as seeds.
+     *
+     * @param classes Clone classes with locations sorted by file and position
+     * @return Chained clone classes, ordered by first location
+     */
+    [[nodiscard]] std::vector<CloneClass> chain_classes(std::vector<CloneClass> classes) const;
+
+    /**
+     * Start an incremental chaining pass with this chainer's config.
+     */
+    [[nodiscard]] Stream stream() const { return Stream(config_); }
+
+private:
+    Config config_;
+};
+
+}  // namespace aegis::similarity
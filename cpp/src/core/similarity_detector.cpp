@@ -1,21 +1,128 @@
 #include "core/similarity_detector.hpp"
 #include "core/clone_extender.hpp"
+#include "core/minhash.hpp"
+#include "core/seed_chainer.hpp"
+#include "core/suffix_array.hpp"
 #include "utils/file_utils.hpp"
+#include "tokenizers/chunked_scan.hpp"
 #include "tokenizers/python_normalizer.hpp"
 #include <chrono>
 #include <algorithm>
-#include <mutex>
+#include <array>
+#include <bit>
+#include <limits>
+#include <ranges>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace aegis::similarity {
 
 // Default cache capacity (number of files)
 constexpr size_t DEFAULT_CACHE_CAPACITY = 1000;
 
+// Slots of the per-thread normalizer registry (UNKNOWN is the last language)
+constexpr size_t LANGUAGE_COUNT = static_cast<size_t>(Language::UNKNOWN) + 1;
+
+/**
+ * Resident state of analyze_incremental().
+ *
+ * Each file keeps a slot (its file ID in the location index) while it is
+ * resident. Reports use ranks instead: the position of the file in
+ * sorted path order, which is the file ID a full run assigns. The rank
+ * order of two paths never changes, so cached pairs and classes are
+ * stored with slot IDs but oriented and ordered by rank, and stay valid
+ * when other files are added or removed.
+ */
+struct SimilarityDetector::IncrementalState {
+    struct ResidentFile {
+        uint32_t slot = 0;
+        uint64_t content_hash = 0;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        TokenizedFile tokens;
+        MappedSource source;  // Always read, never mapped (outlives the scan)
+        std::vector<uint64_t> hashes;  // Unique window hashes it was indexed under
+    };
+
+    std::filesystem::path root;
+    std::map<std::filesystem::path, ResidentFile> files;  // Rank order
+    HashIndex locations;                                 // Mutable, by slot
+    size_t stop_threshold = 0;
+    std::unordered_set<uint64_t> stop_hashes;            // Buckets above stop_threshold
+
+    // Final clone pairs per file pair (key: slot_a << 32 | slot_b)
+    std::unordered_map<uint64_t, std::vector<ClonePair>> pairs;
+    std::vector<std::unordered_set<uint32_t>> partners;  // slot -> slots paired in the cache
+    std::vector<CloneClass> clone_classes;               // Slot IDs, rank order
+
+    /**
+     * Drop the cached pairs of every file pair involving slot.
+     */
+    void forget_pairs(const uint32_t slot) {
+        if (slot >= partners.size()) {
+            return;
+        }
+        for (const uint32_t other : std::exchange(partners[slot], {})) {
+            pairs.erase(static_cast<uint64_t>(slot) << 32 | other);
+            pairs.erase(static_cast<uint64_t>(other) << 32 | slot);
+            if (other != slot) {
+                partners[other].erase(slot);
+            }
+        }
+    }
+};
+
+namespace {
+
+int64_t file_mtime(const std::filesystem::path& path) {
+    std::error_code error;
+    const auto mtime = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count());
+}
+
+/**
+ * Replace file IDs through a slot/rank mapping.
+ */
+void remap_files(HashLocation& location, const std::vector<uint32_t>& mapping) {
+    location.file_id = mapping[location.file_id];
+}
+
+/**
+ * Whether a same-file pair shares a source line.
+ *
+ * The index only drops windows whose token ranges overlap; windows that
+ * touch the same line are not clones of each other either.
+ */
+bool shares_lines(const ClonePair& pair, const std::vector<TokenizedFile>& files) {
+    if (pair.location_a.file_id != pair.location_b.file_id || pair.location_a.file_id >= files.size()) {
+        return false;
+    }
+    const auto& tokens = files[pair.location_a.file_id].tokens;
+    const auto a = tokens.source_span(pair.location_a);
+    const auto b = tokens.source_span(pair.location_b);
+    return !(a.end_line < b.start_line || a.start_line > b.end_line);
+}
+
+}  // anonymous namespace
+
 SimilarityDetector::SimilarityDetector(DetectorConfig config)
     : config_(std::move(config))
 {
 }
 
+SimilarityDetector::~SimilarityDetector() = default;
+
+void SimilarityDetector::set_config(const DetectorConfig& config) {
+    config_ = config;
+    incremental_.reset();
+    query_index_.reset();
+}
+
+void SimilarityDetector::reset_incremental() {
+    incremental_.reset();
+}
+
 void SimilarityDetector::ensure_initialized() {
     if (!thread_pool_) {
         size_t num_threads = config_.num_threads;
@@ -46,25 +153,19 @@ LRUCache<std::string, TokenizedFile>::Stats SimilarityDetector::cache_stats() co
 }
 
 TokenNormalizer* SimilarityDetector::get_normalizer(const Language lang) {
-    std::lock_guard<std::mutex> lock(normalizer_mutex_);
-
-    auto it = normalizers_.find(lang);
-    if (it != normalizers_.end()) {
-        return it->second.get();
-    }
+    thread_local std::array<std::unique_ptr<TokenNormalizer>, LANGUAGE_COUNT> normalizers;
 
-    auto normalizer = create_normalizer(lang);
+    auto& normalizer = normalizers[static_cast<size_t>(lang)];
     if (!normalizer) {
-        return nullptr;
+        normalizer = create_normalizer(lang);
     }
-
-    auto* ptr = normalizer.get();
-    normalizers_[lang] = std::move(normalizer);
-    return ptr;
+    return normalizer.get();
 }
 
-std::optional<TokenizedFile> SimilarityDetector::tokenize_single_file(
-    const std::filesystem::path& file_path
+std::optional<SimilarityDetector::SourceFile> SimilarityDetector::tokenize_single_file(
+    const std::filesystem::path& file_path,
+    std::pmr::memory_resource* memory,
+    ThreadPool* pool
 ) {
     // Detect language
     const auto ext = FileUtils::get_extension(file_path);
@@ -75,16 +176,31 @@ std::optional<TokenizedFile> SimilarityDetector::tokenize_single_file(
         return std::nullopt;  // Unsupported language
     }
 
-    // Read file
-    const auto source = FileUtils::read_file(file_path);
+    // Map or read the file; the tokenizer works on the view
+    auto source = MappedSource::open(file_path);
     if (!source) {
         return std::nullopt;  // Read failed
     }
 
     // Tokenize
-    auto tokenized = normalizer->normalize(*source);
+    auto tokenized = pool ? normalizer->normalize(source->view(), memory, *pool)
+                          : normalizer->normalize(source->view(), memory);
     tokenized.path = file_path.string();
 
+    return SourceFile{std::move(tokenized), std::move(*source)};
+}
+
+std::optional<TokenizedFile> SimilarityDetector::tokenize_source(
+    const std::filesystem::path& file_path,
+    const std::string_view source
+) {
+    auto* normalizer = get_normalizer(detect_language(FileUtils::get_extension(file_path)));
+    if (!normalizer) {
+        return std::nullopt;  // Unsupported language
+    }
+
+    auto tokenized = normalizer->normalize(source);
+    tokenized.path = file_path.string();
     return tokenized;
 }
 
@@ -154,6 +270,388 @@ SimilarityReport SimilarityDetector::analyze(const std::vector<std::string>& fil
     return generate_report(clones, state, total_time);
 }
 
+HashIndex::Stats SimilarityDetector::write_index(
+    const std::filesystem::path& root,
+    const std::filesystem::path& index_path
+) {
+    ensure_initialized();
+
+    const auto files = FileUtils::find_files(
+        root,
+        config_.extensions,
+        config_.exclude_patterns
+    );
+
+    // Always rebuild: an existing file at index_path is replaced
+    AnalysisState state;
+    tokenize_files(files, state);
+    // The saved index is always built in memory. The settings are put
+    // back on scope exit, so a throwing build leaves config_ unchanged
+    {
+        struct RestoreConfig {
+            DetectorConfig& config;
+            std::string index_path;
+            size_t memory_budget_bytes;
+            ~RestoreConfig() {
+                config.index_path = std::move(index_path);
+                config.memory_budget_bytes = memory_budget_bytes;
+            }
+        } restore{config_, std::exchange(config_.index_path, std::string()),
+                  std::exchange(config_.memory_budget_bytes, 0)};
+        build_index(state);
+    }
+
+    state.index.save(index_path, index_file_info(state));
+    return state.index.get_stats();
+}
+
+SimilarityReport SimilarityDetector::analyze_incremental(const std::filesystem::path& root) {
+    // Exact reuse needs the unthinned, unfiltered index of the hash engine
+    if (config_.engine != DetectionEngine::HASH_INDEX ||
+        config_.stop_hash_mode != StopHashMode::CLONE_CLASS ||
+        config_.use_lsh_prefilter ||
+        config_.memory_budget_bytes > 0) {
+        incremental_.reset();
+        return analyze(root);
+    }
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    ensure_initialized();
+
+    const auto files = FileUtils::find_files(
+        root,
+        config_.extensions,
+        config_.exclude_patterns
+    );
+
+    if (files.empty()) {
+        incremental_.reset();
+        SimilarityReport empty_report;
+        empty_report.finalize(0, 0, 0);
+        return empty_report;
+    }
+
+    if (!incremental_ || incremental_->root != root) {
+        incremental_ = std::make_unique<IncrementalState>();
+        incremental_->root = root;
+    }
+
+    // A failed update leaves the resident state inconsistent; start over next time
+    try {
+        return update_incremental(files, start_time);
+    } catch (...) {
+        incremental_.reset();
+        throw;
+    }
+}
+
+SimilarityReport SimilarityDetector::update_incremental(
+    const std::vector<std::filesystem::path>& files,
+    const std::chrono::high_resolution_clock::time_point start_time
+) {
+    using Clock = std::chrono::high_resolution_clock;
+    const auto elapsed_ms = [](const Clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count();
+    };
+
+    auto& inc = *incremental_;
+    const bool cold = inc.files.empty();
+    AnalysisState state;
+    state.parallel_enabled = files.size() >= 4 && thread_pool_;
+    state.thread_count = state.parallel_enabled ? thread_pool_->size() : 1;
+
+    // --- Find changes: only files whose mtime or size moved are read ---
+    auto phase_start = Clock::now();
+    struct Candidate {
+        std::filesystem::path path;
+        int64_t mtime = 0;
+        std::optional<IncrementalState::ResidentFile> file;  // nullopt: unreadable
+        bool same_content = false;
+        size_t bytes_read = 0;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& path : files) {
+        const int64_t mtime = file_mtime(path);
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+        const auto it = inc.files.find(path);
+        if (it != inc.files.end() && !error && it->second.mtime == mtime && it->second.size == size) {
+            continue;
+        }
+        candidates.push_back({path, mtime, std::nullopt, false});
+    }
+
+    const auto load = [&](const size_t i) {
+        auto& candidate = candidates[i];
+        auto source = MappedSource::open(candidate.path, std::numeric_limits<size_t>::max());
+        if (!source) {
+            return;
+        }
+        candidate.bytes_read = source->size();
+        const uint64_t content_hash = FileUtils::content_hash(source->view());
+        const auto it = inc.files.find(candidate.path);
+        if (it != inc.files.end() && it->second.content_hash == content_hash) {
+            candidate.same_content = true;
+            return;
+        }
+        auto tokens = tokenize_source(candidate.path, source->view());
+        if (!tokens) {
+            return;
+        }
+        IncrementalState::ResidentFile file;
+        file.content_hash = content_hash;
+        file.mtime = candidate.mtime;
+        file.size = source->size();
+        file.tokens = std::move(*tokens);
+        file.source = std::move(*source);
+        candidate.file = std::move(file);
+    };
+    if (state.parallel_enabled && candidates.size() > 1) {
+        thread_pool_->parallel_for(0, candidates.size(), load);
+    } else {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            load(i);
+        }
+    }
+    for (const auto& candidate : candidates) {
+        state.files_read += candidate.bytes_read > 0 ? 1 : 0;
+        state.bytes_read += candidate.bytes_read;
+    }
+    state.tokenize_time_ms = elapsed_ms(phase_start);
+
+    // --- Update the location index ---
+    phase_start = Clock::now();
+    std::vector<uint64_t> touched;       // Hashes whose buckets changed
+    std::vector<uint64_t> added_hashes;  // Hashes of new file contents
+    std::vector<uint32_t> changed_slots;
+
+    const auto remove_file = [&](const std::map<std::filesystem::path, IncrementalState::ResidentFile>::iterator it) {
+        const auto& resident = it->second;
+        inc.locations.remove_file_locations(resident.slot, resident.hashes);
+        touched.insert(touched.end(), resident.hashes.begin(), resident.hashes.end());
+        inc.forget_pairs(resident.slot);
+        inc.files.erase(it);
+    };
+
+    // Deleted files (both lists are in path order)
+    {
+        auto found = files.begin();
+        for (auto it = inc.files.begin(); it != inc.files.end();) {
+            while (found != files.end() && *found < it->first) {
+                ++found;
+            }
+            if (found == files.end() || *found != it->first) {
+                remove_file(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    HashIndexBuilder::Config builder_config;
+    builder_config.window_size = config_.window_size;
+    builder_config.winnow_window = winnow_window();
+    builder_config.hash_function = config_.hash_function;
+    builder_config.stop_hashes.mode = config_.stop_hash_mode;
+    builder_config.stop_hashes.min_locations = config_.stop_hash_min_locations;
+    builder_config.stop_hashes.fraction = config_.stop_hash_fraction;
+    HashIndexBuilder builder(inc.locations, builder_config);
+
+    for (auto& candidate : candidates) {
+        const auto it = inc.files.find(candidate.path);
+        if (candidate.same_content) {
+            it->second.mtime = candidate.mtime;
+            continue;
+        }
+        if (it != inc.files.end()) {
+            remove_file(it);
+        }
+        if (!candidate.file) {
+            continue;  // Unreadable or unsupported now
+        }
+
+        auto& file = *candidate.file;
+        file.slot = inc.locations.register_file(candidate.path.string());
+        auto records = builder.collect_records(file.tokens, file.slot, config_.detect_type2);
+        for (const auto& [hash, location] : records) {
+            inc.locations.add_hash(hash, location);
+            file.hashes.push_back(hash);
+        }
+        std::ranges::sort(file.hashes);
+        file.hashes.erase(std::unique(file.hashes.begin(), file.hashes.end()), file.hashes.end());
+        touched.insert(touched.end(), file.hashes.begin(), file.hashes.end());
+        added_hashes.insert(added_hashes.end(), file.hashes.begin(), file.hashes.end());
+        changed_slots.push_back(file.slot);
+        inc.files.emplace(candidate.path, std::move(file));
+    }
+    std::ranges::sort(touched);
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    std::ranges::sort(added_hashes);
+    added_hashes.erase(std::unique(added_hashes.begin(), added_hashes.end()), added_hashes.end());
+
+    // Pairs between unchanged files only change if a stop hash status flips
+    const size_t threshold = inc.locations.stop_hash_threshold();
+    bool full = cold || threshold != inc.stop_threshold;
+    bool classes_dirty = full;
+    for (const uint64_t hash : touched) {
+        const bool was_stop = inc.stop_hashes.contains(hash);
+        const bool is_stop = inc.locations.live_location_count(hash) > threshold;
+        full = full || was_stop != is_stop;
+        classes_dirty = classes_dirty || was_stop || is_stop;
+    }
+    inc.stop_threshold = threshold;
+    if (full) {
+        inc.stop_hashes.clear();
+        inc.locations.for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+            if (locations.size() > threshold) {
+                inc.stop_hashes.insert(hash);
+            }
+        });
+    } else {
+        for (const uint64_t hash : touched) {
+            if (inc.locations.live_location_count(hash) > threshold) {
+                inc.stop_hashes.insert(hash);
+            } else {
+                inc.stop_hashes.erase(hash);
+            }
+        }
+    }
+
+    // --- Rank view: the state a full run over the same files would build ---
+    std::vector<uint32_t> slot_to_rank(inc.locations.file_count(), 0);
+    std::vector<uint32_t> rank_to_slot;
+    rank_to_slot.reserve(inc.files.size());
+    for (auto& [path, file] : inc.files) {
+        const auto rank = state.index.register_file(file.tokens.path);
+        slot_to_rank[file.slot] = rank;
+        rank_to_slot.push_back(file.slot);
+        state.sources[rank] = std::move(file.source);
+        state.line_counts[rank] = file.tokens.total_lines;
+        state.total_tokens += file.tokens.tokens.size();
+        state.tokenized_files.push_back(std::move(file.tokens));
+    }
+    inc.partners.resize(inc.locations.file_count());
+    state.hash_time_ms = elapsed_ms(phase_start);
+
+    // --- Re-pair changed file pairs, refined exactly as in a full run ---
+    phase_start = Clock::now();
+    if (full) {
+        inc.pairs.clear();
+        for (auto& partners : inc.partners) {
+            partners.clear();
+        }
+    }
+
+    auto chain_stream = SeedChainer(chain_config()).stream();
+    std::vector<ClonePair> ranked;
+    const auto consume = [&](std::span<const ClonePair> batch) {
+        ranked.clear();
+        for (auto pair : batch) {
+            remap_files(pair.location_a, slot_to_rank);
+            remap_files(pair.location_b, slot_to_rank);
+            if (!shares_lines(pair, state.tokenized_files)) {
+                ranked.push_back(pair);
+            }
+        }
+        chain_stream.add(ranked);
+    };
+    if (full) {
+        inc.locations.visit_clone_pairs(consume);
+    } else if (!changed_slots.empty()) {
+        std::vector<bool> changed(inc.locations.file_count(), false);
+        for (const uint32_t slot : changed_slots) {
+            changed[slot] = true;
+        }
+        inc.locations.visit_clone_pairs_of(added_hashes, changed, consume);
+    }
+
+    auto pairs = chain_stream.finish(state.parallel_enabled ? thread_pool_.get() : nullptr);
+    state.peak_pair_buffer = chain_stream.peak_size();
+    if (winnow_window() > 1) {
+        extend_exact_matches(pairs, state);
+    }
+    for (auto& pair : refine_pairs(std::move(pairs), state)) {
+        remap_files(pair.location_a, rank_to_slot);
+        remap_files(pair.location_b, rank_to_slot);
+        const uint32_t slot_a = pair.location_a.file_id;
+        const uint32_t slot_b = pair.location_b.file_id;
+        inc.pairs[static_cast<uint64_t>(slot_a) << 32 | slot_b].push_back(pair);
+        inc.partners[slot_a].insert(slot_b);
+        inc.partners[slot_b].insert(slot_a);
+    }
+
+    if (classes_dirty) {
+        std::vector<CloneClass> classes;
+        classes.reserve(inc.stop_hashes.size());
+        for (const uint64_t hash : inc.stop_hashes) {
+            const auto locations = inc.locations.get_locations(hash);
+            CloneClass clone_class{};
+            clone_class.locations.assign(locations.begin(), locations.end());
+            for (auto& location : clone_class.locations) {
+                remap_files(location, slot_to_rank);
+            }
+            std::ranges::sort(clone_class.locations, [](const HashLocation& a, const HashLocation& b) {
+                if (a.file_id != b.file_id) return a.file_id < b.file_id;
+                return a.token_start < b.token_start;
+            });
+            clone_class.clone_type = CloneType::TYPE_1;
+            clone_class.shared_hash = hash;
+            classes.push_back(std::move(clone_class));
+        }
+        inc.clone_classes = refine_clone_classes(std::move(classes), state);
+        for (auto& clone_class : inc.clone_classes) {
+            for (auto& location : clone_class.locations) {
+                remap_files(location, rank_to_slot);
+            }
+        }
+    }
+
+    // --- Assemble in full-run order: file pairs by rank, then by size ---
+    std::vector<std::pair<uint64_t, const std::vector<ClonePair>*>> groups;
+    groups.reserve(inc.pairs.size());
+    size_t pair_total = 0;
+    for (const auto& [key, group] : inc.pairs) {
+        const uint64_t rank_key = static_cast<uint64_t>(slot_to_rank[key >> 32]) << 32 |
+                                  slot_to_rank[key & 0xFFFFFFFFULL];
+        groups.emplace_back(rank_key, &group);
+        pair_total += group.size();
+    }
+    std::ranges::sort(groups, {}, &std::pair<uint64_t, const std::vector<ClonePair>*>::first);
+
+    std::vector<ClonePair> clones;
+    clones.reserve(pair_total);
+    for (const auto& group : groups | std::views::values) {
+        for (ClonePair pair : *group) {
+            remap_files(pair.location_a, slot_to_rank);
+            remap_files(pair.location_b, slot_to_rank);
+            clones.push_back(pair);
+        }
+    }
+    std::ranges::sort(clones, [](const auto& a, const auto& b) {
+        return a.token_count() > b.token_count();
+    });
+
+    state.clone_classes = inc.clone_classes;
+    for (auto& clone_class : state.clone_classes) {
+        for (auto& location : clone_class.locations) {
+            remap_files(location, slot_to_rank);
+        }
+    }
+    state.match_time_ms = elapsed_ms(phase_start);
+
+    auto report = generate_report(clones, state, elapsed_ms(start_time));
+    report.performance.index_bytes = inc.locations.memory_bytes();
+
+    // Hand the file contents back to the resident state
+    uint32_t rank = 0;
+    for (auto& file : inc.files | std::views::values) {
+        file.source = std::move(state.sources[rank]);
+        file.tokens = std::move(state.tokenized_files[rank]);
+        ++rank;
+    }
+    return report;
+}
+
 SimilarityReport SimilarityDetector::compare(
     const std::filesystem::path& file1,
     const std::filesystem::path& file2
@@ -161,6 +659,138 @@ SimilarityReport SimilarityDetector::compare(
     return analyze({file1.string(), file2.string()});
 }
 
+SnippetQueryResult SimilarityDetector::query(const std::string_view code, const Language language) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    auto* normalizer = get_normalizer(language);
+    if (!normalizer) {
+        throw std::runtime_error(std::string("Unsupported query language: ") + language_to_string(language));
+    }
+    const HashIndex& index = query_target();
+
+    // The snippet gets a file ID no indexed file can have
+    constexpr uint32_t QUERY_FILE_ID = std::numeric_limits<uint32_t>::max();
+    const auto snippet = normalizer->normalize(code);
+
+    HashIndex scratch;
+    HashIndexBuilder::Config builder_config;
+    builder_config.window_size = config_.window_size;
+    builder_config.winnow_window = winnow_window();
+    builder_config.hash_function = config_.hash_function;
+    const HashIndexBuilder builder(scratch, builder_config);
+    const auto records = builder.collect_records(snippet, QUERY_FILE_ID, config_.detect_type2);
+
+    SnippetQueryResult result;
+    result.query_tokens = snippet.tokens.significant_size();
+
+    // One seed per (snippet window, indexed location) hit
+    const size_t threshold = index.stop_hash_threshold();
+    std::vector<ClonePair> seeds;
+    for (const auto& [hash, query_location] : records) {
+        if (index.live_location_count(hash) > threshold) {
+            result.stop_hashes++;
+            continue;
+        }
+        index.for_each_live_location(hash, [&](const HashLocation& location) {
+            ClonePair seed{};
+            seed.location_a = location;
+            seed.location_b = query_location;
+            seed.clone_type = CloneType::TYPE_1;
+            seed.similarity = 1.0f;
+            seed.shared_hash = hash;
+            seeds.push_back(seed);
+        });
+    }
+    result.window_hits = seeds.size();
+
+    // Locations only hold token ranges. Lines come from the resident
+    // tokens, or for a saved index from the matched files tokenized again
+    std::unordered_map<uint32_t, TokenizedFile> reloaded;
+    const auto span_in_index = [&](const HashLocation& location) {
+        const auto& path = index.get_file_path(location.file_id);
+        if (incremental_ && &index == &incremental_->locations) {
+            const auto it = incremental_->files.find(path);
+            return it != incremental_->files.end() ? it->second.tokens.tokens.source_span(location)
+                                                   : SourceSpan{};
+        }
+        auto [it, inserted] = reloaded.try_emplace(location.file_id);
+        if (inserted) {
+            if (auto file = tokenize_single_file(path, std::pmr::get_default_resource())) {
+                it->second = std::move(file->tokens);
+            }
+        }
+        return it->second.tokens.source_span(location);
+    };
+
+    // Indexed IDs sort before the snippet ID, so location_b stays the snippet side
+    const size_t min_tokens = std::min(config_.min_clone_tokens, result.query_tokens);
+    for (const auto& region : SeedChainer(chain_config()).chain(std::move(seeds))) {
+        const auto& found = region.location_a;
+        const auto& in_snippet = region.location_b;
+        if (found.token_count < min_tokens) {
+            continue;
+        }
+
+        const auto span = span_in_index(found);
+        const auto query_span = snippet.tokens.source_span(in_snippet);
+
+        SnippetMatch match;
+        match.file = index.get_file_path(found.file_id);
+        match.start_line = span.start_line;
+        match.end_line = span.end_line;
+        match.start_col = span.start_col;
+        match.end_col = span.end_col;
+        match.query_start_line = query_span.start_line;
+        match.query_end_line = query_span.end_line;
+        match.tokens = found.token_count;
+        match.coverage = result.query_tokens > 0
+            ? std::min(1.0f, static_cast<float>(in_snippet.token_count) / static_cast<float>(result.query_tokens))
+            : 0.0f;
+        result.matches.push_back(std::move(match));
+    }
+
+    std::ranges::sort(result.matches, [](const SnippetMatch& a, const SnippetMatch& b) {
+        if (a.tokens != b.tokens) {
+            return a.tokens > b.tokens;
+        }
+        if (a.file != b.file) {
+            return a.file < b.file;
+        }
+        return a.start_line < b.start_line;
+    });
+
+    result.query_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start
+    ).count();
+    return result;
+}
+
+const HashIndex& SimilarityDetector::query_target() {
+    if (incremental_ && !incremental_->files.empty()) {
+        return incremental_->locations;
+    }
+    if (query_index_) {
+        return *query_index_;
+    }
+    if (config_.index_path.empty()) {
+        throw std::runtime_error("No resident index: run analyze_incremental() or set index_path");
+    }
+
+    IndexFileInfo info;
+    auto index = std::make_unique<HashIndex>(HashIndex::open(config_.index_path, &info));
+    if (info.config_fingerprint != index_fingerprint()) {
+        throw std::runtime_error("Index was built with different settings: " + config_.index_path);
+    }
+
+    StopHashPolicy policy;
+    policy.mode = config_.stop_hash_mode;
+    policy.min_locations = config_.stop_hash_min_locations;
+    policy.fraction = config_.stop_hash_fraction;
+    index->set_stop_hash_policy(policy);
+    query_index_ = std::move(index);
+    return *query_index_;
+}
+
 void SimilarityDetector::tokenize_files(
     const std::vector<std::filesystem::path>& files,
     AnalysisState& state
@@ -172,46 +802,54 @@ void SimilarityDetector::tokenize_files(
     state.parallel_enabled = use_parallel;
     state.thread_count = use_parallel ? thread_pool_->size() : 1;
 
+    // Each file is read once; its source is kept for snippets and hashing
+    const auto add_file = [&state](SourceFile& file) {
+        const uint32_t file_id = state.index.register_file(file.tokens.path);
+        state.count_source(file.source);
+        state.sources[file_id] = std::move(file.source);
+        state.line_counts[file_id] = file.tokens.total_lines;
+        state.tokenized_files.push_back(std::move(file.tokens));
+    };
+
     // For small file sets, use sequential processing
     if (!use_parallel) {
+        // A few large files can still be split over the pool
+        auto* memory = state.arena.resource();
         for (const auto& file_path : files) {
-            auto tokenized = tokenize_single_file(file_path);
-            if (!tokenized) continue;
-
-            // Register file and store data
-            auto source = FileUtils::read_file(file_path);
-            if (!source) continue;
-
-            uint32_t file_id = state.index.register_file(tokenized->path);
-            state.sources[file_id] = std::move(*source);
-            state.line_counts[file_id] = tokenized->total_lines;
-            state.tokenized_files.push_back(std::move(*tokenized));
+            if (auto file = tokenize_single_file(file_path, memory, thread_pool_.get())) {
+                add_file(*file);
+            }
         }
     } else {
-        // Parallel tokenization for larger file sets
-        std::mutex state_mutex;
-        std::vector<std::pair<TokenizedFile, std::string>> results;
-        results.reserve(files.size());
+        // Parallel tokenization for larger file sets. Results keep input
+        // order so file IDs do not depend on scheduling.
+        std::vector<std::optional<SourceFile>> results(files.size());
 
+        // Files large enough to split are left for after the others: their
+        // pieces run on the pool, which a worker must not wait on
+        std::vector<char> large(files.size(), 0);
         thread_pool_->parallel_for(0, files.size(), [&](size_t i) {
-            const auto& file_path = files[i];
-
-            auto tokenized = tokenize_single_file(file_path);
-            if (!tokenized) return;
-
-            auto source = FileUtils::read_file(file_path);
-            if (!source) return;
-
-            std::lock_guard<std::mutex> lock(state_mutex);
-            results.emplace_back(std::move(*tokenized), std::move(*source));
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(files[i], ec);
+            if (!ec && size >= ChunkedScan::MIN_SOURCE_BYTES) {
+                large[i] = 1;
+                return;
+            }
+            results[i] = tokenize_single_file(files[i], state.arena.resource());
         });
 
+        auto* memory = state.arena.resource();
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (large[i]) {
+                results[i] = tokenize_single_file(files[i], memory, thread_pool_.get());
+            }
+        }
+
         // Register all files (sequential to maintain consistent IDs)
-        for (auto& [tokenized, source] : results) {
-            uint32_t file_id = state.index.register_file(tokenized.path);
-            state.sources[file_id] = std::move(source);
-            state.line_counts[file_id] = tokenized.total_lines;
-            state.tokenized_files.push_back(std::move(tokenized));
+        for (auto& result : results) {
+            if (result) {
+                add_file(*result);
+            }
         }
     }
 
@@ -229,38 +867,320 @@ void SimilarityDetector::tokenize_files(
 
 void SimilarityDetector::build_index(AnalysisState& state) const
 {
+    // The suffix array engine builds its own structure in find_clones()
+    if (config_.engine == DetectionEngine::SUFFIX_ARRAY) {
+        state.index.freeze();
+        return;
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
 
+    // Candidate file pairs are needed even when the index is loaded
+    std::vector<bool> selected;
+    if (config_.use_lsh_prefilter) {
+        selected = select_candidate_files(state);
+    }
+
+    if (!config_.index_path.empty() && load_saved_index(state)) {
+        state.index_loaded = true;
+        state.hash_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        ).count();
+        return;
+    }
+
     // Use existing state.index to preserve file_id mappings from tokenize_files
     // This ensures line_counts keys match file_paths indices
-    HashIndexBuilder builder(state.index, config_.window_size);
+    HashIndexBuilder::Config builder_config;
+    builder_config.window_size = config_.window_size;
+    builder_config.freeze = true;  // Full runs use the compact CSR layout
+    builder_config.winnow_window = winnow_window();
+    builder_config.hash_function = config_.hash_function;
+    builder_config.stop_hashes.mode = config_.stop_hash_mode;
+    builder_config.stop_hashes.min_locations = config_.stop_hash_min_locations;
+    builder_config.stop_hashes.fraction = config_.stop_hash_fraction;
+    builder_config.drop_singletons = config_.drop_singleton_hashes;
+    HashIndexBuilder builder(state.index, builder_config);
+
+    // Under a memory budget the records are spilled and never indexed
+    if (config_.memory_budget_bytes > 0) {
+        build_external_index(state, builder, selected);
+        state.hash_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start
+        ).count();
+        return;
+    }
 
-    for (const auto& file : state.tokenized_files) {
-        builder.add_file(file, config_.detect_type2);
+    // Hash files on the pool and build the CSR layout by hash-range shards
+    if (state.parallel_enabled && thread_pool_) {
+        builder.add_files(state.tokenized_files, *thread_pool_, config_.detect_type2,
+                          selected.empty() ? nullptr : &selected);
+        builder.finalize(thread_pool_.get());
+    } else {
+        for (size_t i = 0; i < state.tokenized_files.size(); ++i) {
+            if (selected.empty() || selected[i]) {
+                builder.add_file(state.tokenized_files[i], config_.detect_type2);
+            }
+        }
+        builder.finalize();
     }
 
     // Note: builder uses state.index directly, no need to move
 
+    // A failed save only costs the next run a rebuild; it is reported
+    if (!config_.index_path.empty()) {
+        try {
+            state.index.save(config_.index_path, index_file_info(state));
+        } catch (const std::exception& e) {
+            state.index_save_error = e.what();
+        }
+    }
+
     auto end = std::chrono::high_resolution_clock::now();
     state.hash_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         end - start
     ).count();
 }
 
+void SimilarityDetector::build_external_index(
+    AnalysisState& state,
+    const HashIndexBuilder& builder,
+    const std::vector<bool>& selected
+) const {
+    ExternalHashIndex::Config external_config;
+    external_config.memory_budget_bytes = config_.memory_budget_bytes;
+    external_config.spill_dir = config_.spill_dir;
+    auto external = std::make_unique<ExternalHashIndex>(external_config);
+    external->set_stop_hash_policy(state.index.stop_hash_policy());
+
+    const auto& files = state.tokenized_files;
+    std::vector<uint32_t> file_ids(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        file_ids[i] = state.index.register_file(files[i].path);
+    }
+
+    // Files are hashed a chunk at a time and added in file ID order, so
+    // only one chunk of records is alive besides the spill buffer
+    ThreadPool* pool = state.parallel_enabled ? thread_pool_.get() : nullptr;
+    const size_t chunk = pool ? pool->size() * 4 : 1;
+    std::vector<std::vector<HashRecord>> groups(chunk);
+    for (size_t begin = 0; begin < files.size(); begin += chunk) {
+        const size_t end = std::min(begin + chunk, files.size());
+        const auto collect = [&](const size_t i) {
+            if (selected.empty() || selected[i]) {
+                groups[i - begin] = builder.collect_records(files[i], file_ids[i], config_.detect_type2);
+            }
+        };
+        if (pool) {
+            pool->parallel_for(begin, end, collect);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                collect(i);
+            }
+        }
+        for (size_t i = begin; i < end; ++i) {
+            external->add_records(groups[i - begin]);
+            groups[i - begin] = {};
+        }
+    }
+
+    state.index.freeze();  // File table only
+    state.external_index = std::move(external);
+}
+
+uint64_t SimilarityDetector::index_fingerprint() const {
+    std::ostringstream settings;
+    settings << "window=" << config_.window_size
+             << ";hash=" << static_cast<int>(config_.hash_function)
+             << ";type2=" << config_.detect_type2
+             << ";winnow=" << winnow_window()
+             << ";stop=" << stop_hash_mode_to_string(config_.stop_hash_mode)
+             << ";stop_min=" << config_.stop_hash_min_locations
+             << ";stop_fraction=" << std::bit_cast<uint64_t>(config_.stop_hash_fraction)
+             << ";singletons=" << config_.drop_singleton_hashes;
+    if (config_.use_lsh_prefilter) {
+        settings << ";lsh=" << config_.minhash_signature_size
+                 << "/" << config_.lsh_bands
+                 << "/" << std::bit_cast<uint64_t>(config_.lsh_min_similarity);
+    }
+    return FileUtils::content_hash(settings.str());
+}
+
+std::vector<bool> SimilarityDetector::select_candidate_files(AnalysisState& state) const {
+    MinHashLSH::Config lsh_config;
+    lsh_config.signature_size = config_.minhash_signature_size;
+    lsh_config.bands = config_.lsh_bands;
+    lsh_config.shingle_size = config_.window_size;
+    lsh_config.min_similarity = config_.lsh_min_similarity;
+    lsh_config.use_normalized = config_.detect_type2;
+    lsh_config.hash_function = config_.hash_function;
+    const MinHashLSH lsh(lsh_config);
+
+    const auto& files = state.tokenized_files;
+    std::vector<std::vector<uint64_t>> signatures(files.size());
+    ThreadPool* pool = state.parallel_enabled ? thread_pool_.get() : nullptr;
+    if (pool) {
+        pool->parallel_for(0, files.size(), [&](const size_t i) {
+            signatures[i] = lsh.signature(files[i]);
+        });
+    } else {
+        for (size_t i = 0; i < files.size(); ++i) {
+            signatures[i] = lsh.signature(files[i]);
+        }
+    }
+
+    std::vector<bool> selected(files.size(), false);
+    state.prefiltered = true;
+    state.candidate_pairs.clear();
+    for (const auto& pair : lsh.candidate_pairs(signatures, pool)) {
+        state.candidate_pairs.insert(static_cast<uint64_t>(pair.file_a) << 32 | pair.file_b);
+        selected[pair.file_a] = true;
+        selected[pair.file_b] = true;
+    }
+    return selected;
+}
+
+IndexFileInfo SimilarityDetector::index_file_info(const AnalysisState& state) const {
+    IndexFileInfo info;
+    info.config_fingerprint = index_fingerprint();
+    info.files.reserve(state.index.file_count());
+    for (uint32_t file_id = 0; file_id < state.index.file_count(); ++file_id) {
+        const auto& path = state.index.get_file_path(file_id);
+        const auto source = state.sources.find(file_id);
+
+        IndexFileEntry entry;
+        entry.path = path;
+        entry.content_hash = source != state.sources.end()
+            ? FileUtils::content_hash(source->second.view()) : 0;
+        entry.size = source != state.sources.end() ? source->second.size() : 0;
+        std::error_code error;
+        const auto mtime = std::filesystem::last_write_time(path, error);
+        entry.mtime = error ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count());
+        info.files.push_back(std::move(entry));
+    }
+    return info;
+}
+
+bool SimilarityDetector::load_saved_index(AnalysisState& state) const {
+    std::error_code error;
+    if (!std::filesystem::exists(config_.index_path, error)) {
+        return false;
+    }
+
+    IndexFileInfo info;
+    HashIndex saved;
+    try {
+        saved = HashIndex::open(config_.index_path, &info);
+    } catch (const std::exception&) {
+        return false;  // Unreadable or incompatible: rebuild
+    }
+
+    if (info.config_fingerprint != index_fingerprint() ||
+        info.files.size() != state.index.file_count()) {
+        return false;
+    }
+    for (uint32_t file_id = 0; file_id < info.files.size(); ++file_id) {
+        const auto& entry = info.files[file_id];
+        const auto source = state.sources.find(file_id);
+        if (entry.path != state.index.get_file_path(file_id) ||
+            source == state.sources.end() ||
+            entry.size != source->second.size() ||
+            entry.content_hash != FileUtils::content_hash(source->second.view())) {
+            return false;
+        }
+    }
+
+    StopHashPolicy policy;
+    policy.mode = config_.stop_hash_mode;
+    policy.min_locations = config_.stop_hash_min_locations;
+    policy.fraction = config_.stop_hash_fraction;
+    saved.set_stop_hash_policy(policy);
+    state.index = std::move(saved);
+    return true;
+}
+
 std::vector<ClonePair> SimilarityDetector::find_clones(AnalysisState& state) {
     const auto start = std::chrono::high_resolution_clock::now();
 
-    // Find raw clone pairs - use a parallel version for larger workloads
+    // Find clone regions. The hash engine streams raw pairs straight into
+    // the seed chainer in bounded batches instead of materializing them.
     std::vector<ClonePair> pairs;
-    if (state.parallel_enabled && thread_pool_) {
-        pairs = state.index.find_clone_pairs_parallel(*thread_pool_);
+    if (config_.engine == DetectionEngine::SUFFIX_ARRAY) {
+        // Maximal repeats are already merged and at least min_clone_tokens long
+        SuffixArrayCloneFinder::Config sa_config;
+        sa_config.min_tokens = config_.min_clone_tokens;
+        sa_config.use_normalized = config_.detect_type2;
+        pairs = SuffixArrayCloneFinder(sa_config).find_clone_pairs(state.tokenized_files);
     } else {
-        pairs = state.index.find_clone_pairs();
+        auto chain_stream = SeedChainer(chain_config()).stream();
+
+        // Same-file pairs must not share a line. With the LSH prefilter,
+        // only candidate file pairs (and clones within a file) are chained
+        std::vector<ClonePair> candidates;
+        const auto consume = [&](std::span<const ClonePair> batch) {
+            candidates.clear();
+            for (const auto& pair : batch) {
+                const auto [low, high] = std::minmax(pair.location_a.file_id, pair.location_b.file_id);
+                const bool keep = low == high
+                    ? !shares_lines(pair, state.tokenized_files)
+                    : !state.prefiltered || state.candidate_pairs.contains(static_cast<uint64_t>(low) << 32 | high);
+                if (keep) {
+                    candidates.push_back(pair);
+                }
+            }
+            chain_stream.add(candidates);
+        };
+        const bool parallel = state.parallel_enabled && thread_pool_;
+        std::vector<CloneClass> stop_classes;
+        HashIndex::PairStreamStats stream_stats;
+        if (state.external_index) {
+            // One merge of the spilled runs yields pairs and stop hash classes
+            stream_stats = state.external_index->visit_clone_pairs(consume, &stop_classes);
+        } else {
+            stream_stats = parallel
+                ? state.index.visit_clone_pairs_parallel(*thread_pool_, consume)
+                : state.index.visit_clone_pairs(consume);
+            stop_classes = state.index.find_clone_classes();
+        }
+
+        pairs = chain_stream.finish(parallel ? thread_pool_.get() : nullptr);
+        state.peak_pair_buffer = stream_stats.peak_buffered + chain_stream.peak_size();
+
+        if (winnow_window() > 1) {
+            extend_exact_matches(pairs, state);
+        }
+
+        // Stop hashes become clone classes instead of N^2 pairs
+        state.clone_classes = refine_clone_classes(std::move(stop_classes), state);
     }
 
-    // Merge adjacent pairs
-    pairs = HashIndex::merge_adjacent_clones(pairs, 5);
+    pairs = refine_pairs(std::move(pairs), state);
+
+    // Sort by size (largest first)
+    std::ranges::sort(pairs, [](const auto& a, const auto& b) {
+        return a.token_count() > b.token_count();
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    state.match_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        end - start
+    ).count();
+
+    return pairs;
+}
 
+SeedChainer::Config SimilarityDetector::chain_config() const {
+    // Consecutive fingerprints of a winnowed match start at most
+    // winnow_window tokens apart, so the merge gap must cover that
+    SeedChainer::Config chain_config;
+    chain_config.max_gap = std::max<size_t>(5, winnow_window());
+    return chain_config;
+}
+
+std::vector<ClonePair> SimilarityDetector::refine_pairs(
+    std::vector<ClonePair> pairs,
+    const AnalysisState& state
+) const {
     // Filter by minimum size
     pairs = HashIndex::filter_by_size(pairs, config_.min_clone_tokens);
 
@@ -280,18 +1200,88 @@ std::vector<ClonePair> SimilarityDetector::find_clones(AnalysisState& state) {
         CloneExtender extender(ext_config);
         pairs = extender.extend_all(pairs, state.tokenized_files, state.index);
     }
+    return pairs;
+}
 
-    // Sort by size (largest first)
-    std::ranges::sort(pairs, [](const auto& a, const auto& b) {
-        return a.token_count() > b.token_count();
-    });
+std::vector<CloneClass> SimilarityDetector::refine_clone_classes(
+    std::vector<CloneClass> classes,
+    const AnalysisState& state
+) const {
+    std::vector<CloneClass> refined;
+    for (auto& clone_class : SeedChainer(chain_config()).chain_classes(std::move(classes))) {
+        if (clone_class.token_count() < config_.min_clone_tokens) {
+            continue;
+        }
+        ClonePair representative{};
+        representative.location_a = clone_class.locations[0];
+        representative.location_b = clone_class.locations[1];
+        clone_class.clone_type = classify_clone(representative, state);
+        refined.push_back(std::move(clone_class));
+    }
+    return refined;
+}
 
-    const auto end = std::chrono::high_resolution_clock::now();
-    state.match_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        end - start
-    ).count();
+size_t SimilarityDetector::winnow_window() const {
+    if (!config_.use_winnowing) {
+        return 0;
+    }
+    if (config_.winnow_window > 0) {
+        return config_.winnow_window;
+    }
+    if (config_.min_clone_tokens <= config_.window_size) {
+        return 1;
+    }
+    return config_.min_clone_tokens - config_.window_size + 1;
+}
 
-    return pairs;
+void SimilarityDetector::extend_exact_matches(
+    std::vector<ClonePair>& pairs,
+    const AnalysisState& state
+) const {
+    const auto& files = state.tokenized_files;
+
+    for (auto& pair : pairs) {
+        if (pair.location_a.file_id >= files.size() || pair.location_b.file_id >= files.size()) {
+            continue;
+        }
+
+        // Index locations are positions in the significant sequences
+        const auto& tokens_a = files[pair.location_a.file_id].tokens;
+        const auto& tokens_b = files[pair.location_b.file_id].tokens;
+        const auto hashes_a = tokens_a.significant_hashes(config_.detect_type2);
+        const auto hashes_b = tokens_b.significant_hashes(config_.detect_type2);
+        size_t start_a = pair.location_a.token_start;
+        size_t start_b = pair.location_b.token_start;
+        size_t end_a = std::min<size_t>(start_a + pair.location_a.token_count, hashes_a.size());
+        size_t end_b = std::min<size_t>(start_b + pair.location_b.token_count, hashes_b.size());
+        if (start_a >= end_a || start_b >= end_b) {
+            continue;
+        }
+
+        // Regions in the same file must not grow into each other
+        const bool same_file = pair.location_a.file_id == pair.location_b.file_id;
+        const auto disjoint = [same_file](size_t sa, size_t ea, size_t sb, size_t eb) {
+            return !same_file || ea <= sb || eb <= sa;
+        };
+
+        while (start_a > 0 && start_b > 0 &&
+               hashes_a[start_a - 1] == hashes_b[start_b - 1] &&
+               disjoint(start_a - 1, end_a, start_b - 1, end_b)) {
+            --start_a;
+            --start_b;
+        }
+        while (end_a < hashes_a.size() && end_b < hashes_b.size() &&
+               hashes_a[end_a] == hashes_b[end_b] &&
+               disjoint(start_a, end_a + 1, start_b, end_b + 1)) {
+            ++end_a;
+            ++end_b;
+        }
+
+        pair.location_a.token_start = static_cast<uint32_t>(start_a);
+        pair.location_a.token_count = static_cast<uint32_t>(end_a - start_a);
+        pair.location_b.token_start = static_cast<uint32_t>(start_b);
+        pair.location_b.token_count = static_cast<uint32_t>(end_b - start_b);
+    }
 }
 
 SimilarityReport SimilarityDetector::generate_report(
@@ -307,9 +1297,16 @@ SimilarityReport SimilarityDetector::generate_report(
         file_paths.push_back(state.index.get_file_path(static_cast<uint32_t>(i)));
     }
 
-    // Add clones to the report
+    // Add clones to the report; snippets are cut from the mapped sources
+    std::map<uint32_t, std::string_view> sources;
+    for (const auto& [file_id, source] : state.sources) {
+        sources.emplace(file_id, source.view());
+    }
     for (const auto& pair : clones) {
-        report.add_clone(pair, file_paths, state.sources);
+        report.add_clone(pair, file_paths, state.tokenized_files, sources);
+    }
+    for (const auto& clone_class : state.clone_classes) {
+        report.add_clone_class(clone_class, file_paths, state.tokenized_files, sources);
     }
 
     // Calculate metrics by language
@@ -327,6 +1324,13 @@ SimilarityReport SimilarityDetector::generate_report(
                 report.metrics.by_language[lang_name]++;
             }
         }
+        for (const auto& clone_class : state.clone_classes) {
+            if (std::ranges::any_of(clone_class.locations, [&](const HashLocation& loc) {
+                    return state.index.get_file_path(loc.file_id) == file.path;
+                })) {
+                report.metrics.by_language[lang_name]++;
+            }
+        }
     }
 
     // Calculate hotspots
@@ -352,6 +1356,22 @@ SimilarityReport SimilarityDetector::generate_report(
         state.thread_count,
         state.parallel_enabled
     );
+    report.performance.index_bytes = state.index.memory_bytes();
+    report.performance.peak_pair_buffer = state.peak_pair_buffer;
+    report.performance.index_loaded = state.index_loaded;
+    report.performance.index_save_error = state.index_save_error;
+    report.performance.lsh_candidate_pairs = state.candidate_pairs.size();
+    report.performance.files_read = state.files_read;
+    report.performance.bytes_read = state.bytes_read;
+    report.performance.bytes_mapped = state.bytes_mapped;
+    const auto arena = state.arena.stats();
+    report.performance.arena_allocations = arena.allocations;
+    report.performance.arena_heap_allocations = arena.heap_allocations;
+    report.performance.arena_high_water_bytes = arena.high_water_bytes;
+    if (state.external_index) {
+        report.performance.spilled_runs = state.external_index->spill_stats().runs;
+        report.performance.spilled_bytes = state.external_index->spill_stats().bytes;
+    }
 
     return report;
 }
@@ -387,15 +1407,15 @@ CloneType SimilarityDetector::classify_clone(
         return CloneType::TYPE_1;  // Can't determine, default to Type-1
     }
 
-    // Get token ranges
+    // Get token ranges (positions in the significant sequence)
     const size_t start_a = pair.location_a.token_start;
     const size_t count_a = pair.location_a.token_count;
     const size_t start_b = pair.location_b.token_start;
     const size_t count_b = pair.location_b.token_count;
 
     // Bounds check
-    if (start_a + count_a > file_a->tokens.size() ||
-        start_b + count_b > file_b->tokens.size()) {
+    if (start_a + count_a > file_a->tokens.significant_size() ||
+        start_b + count_b > file_b->tokens.significant_size()) {
         return CloneType::TYPE_1;
     }
 
@@ -405,26 +1425,12 @@ CloneType SimilarityDetector::classify_clone(
     }
 
     // Compare ALL tokens (not just normalizable ones)
-    // Type-1 requires ALL original hashes to match
-    bool all_original_match = true;
-
-    for (size_t i = 0; i < count_a; ++i) {
-        const auto& tok_a = file_a->tokens[start_a + i];
-
-        // Check if original hashes differ
-        if (const auto& tok_b = file_b->tokens[start_b + i]; tok_a.original_hash != tok_b.original_hash) {
-            all_original_match = false;
-            // This is a normalizable token difference (potential Type-2)
-            // We already know normalized hashes match, so this must be
-            // a renamed identifier, string, number, or type
-            if (tok_a.type == TokenType::IDENTIFIER ||
-                tok_a.type == TokenType::STRING_LITERAL ||
-                tok_a.type == TokenType::NUMBER_LITERAL ||
-                tok_a.type == TokenType::TYPE) {
-                // Type-2 clone confirmed - different originals but same normalized
-            }
-        }
-    }
+    // Type-1 requires ALL original hashes to match; normalized hashes
+    // already matched, so any difference is a renamed identifier,
+    // string, number, or type
+    const bool all_original_match = std::ranges::equal(
+        file_a->tokens.significant_hashes(false).subspan(start_a, count_a),
+        file_b->tokens.significant_hashes(false).subspan(start_b, count_b));
 
     // Type-1: All original hashes match exactly
     // Type-2: Some normalizable tokens differ (but normalized matched, hence clone detected)
@@ -3,14 +3,20 @@
 #include "models/clone_types.hpp"
 #include "models/report.hpp"
 #include "core/hash_index.hpp"
+#include "core/seed_chainer.hpp"
 #include "tokenizers/token_normalizer.hpp"
+#include "utils/analysis_arena.hpp"
 #include "utils/thread_pool.hpp"
 #include "utils/lru_cache.hpp"
+#include "utils/mapped_source.hpp"
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <vector>
 #include <map>
 #include <optional>
+#include <unordered_set>
+#include <string_view>
 
 namespace aegis::similarity {
 
@@ -31,6 +37,8 @@ public:
      */
     explicit SimilarityDetector(DetectorConfig config = {});
 
+    ~SimilarityDetector();
+
     /**
      * Analyze a project directory for code clones.
      *
@@ -47,6 +55,33 @@ public:
      */
     SimilarityReport analyze(const std::vector<std::string>& files);
 
+    /**
+     * Analyze a project directory, reusing the previous incremental run.
+     *
+     * The first call analyzes everything and keeps the tokenized files,
+     * a mutable hash index and the clone pairs of every file pair
+     * resident. Later calls on the same root only re-read files whose
+     * mtime or size changed, re-tokenize and re-hash those whose content
+     * hash changed, drop the locations of changed and deleted files, and
+     * re-pair only file pairs involving a changed file. The report
+     * matches analyze(root) exactly (apart from timings and memory).
+     *
+     * A full re-pair from the resident index is done when the stop hash
+     * threshold moves or a hash crosses it. The suffix array engine,
+     * the DROP/SAMPLE stop hash modes (which thin the index
+     * approximately at build time), the LSH prefilter and a memory
+     * budget fall back to analyze(root).
+     *
+     * @param root Root directory to analyze
+     * @return Complete similarity report
+     */
+    SimilarityReport analyze_incremental(const std::filesystem::path& root);
+
+    /**
+     * Discard the resident state of analyze_incremental().
+     */
+    void reset_incremental();
+
     /**
      * Compare two specific files for similarity.
      *
@@ -59,15 +94,53 @@ public:
         const std::filesystem::path& file2
     );
 
+    /**
+     * Find the indexed regions that match a code fragment.
+     *
+     * The fragment is normalized like a source file, hashed with the
+     * configured window (and winnowing), and each window is looked up in
+     * the resident index. Hits are chained with the seed chainer into
+     * matching regions, ranked by matched length. No pairs are formed
+     * between indexed files, so the cost depends on the fragment and its
+     * hits rather than on the corpus. Stop hash windows are skipped.
+     *
+     * The resident index is the one kept by analyze_incremental(), or
+     * else the saved index at index_path, which is mapped on the first
+     * query and kept open. Regions shorter than min_clone_tokens are
+     * dropped unless the fragment itself is shorter.
+     *
+     * @param code Source fragment
+     * @param language Language of the fragment
+     * @return Ranked matches with per-query counters
+     * @throws std::runtime_error if the language is unsupported, there is
+     *         no resident index, or the saved index was built with other
+     *         settings
+     */
+    SnippetQueryResult query(std::string_view code, Language language);
+
+    /**
+     * Build the hash index for a project and save it to an index file.
+     *
+     * @param root Root directory to index
+     * @param index_path Destination index file
+     * @return Statistics of the saved index
+     * @throws std::runtime_error if the file cannot be written
+     */
+    HashIndex::Stats write_index(
+        const std::filesystem::path& root,
+        const std::filesystem::path& index_path
+    );
+
     /**
      * Get the current configuration.
      */
     const DetectorConfig& config() const { return config_; }
 
     /**
-     * Update configuration.
+     * Update configuration. Discards any incremental state and the
+     * saved index kept open for queries.
      */
-    void set_config(const DetectorConfig& config) { config_ = config; }
+    void set_config(const DetectorConfig& config);
 
     /**
      * Clear the token cache.
@@ -88,17 +161,23 @@ private:
     // Cache for tokenized files
     std::unique_ptr<LRUCache<std::string, TokenizedFile>> token_cache_;
 
-    // Cached normalizers by language
-    std::map<Language, std::unique_ptr<TokenNormalizer>> normalizers_;
+    // Resident state of analyze_incremental() (defined in the .cpp)
+    struct IncrementalState;
+    std::unique_ptr<IncrementalState> incremental_;
 
-    // Mutex for thread-safe normalizer access
-    mutable std::mutex normalizer_mutex_;
+    // Saved index mapped by query() when there is no incremental state
+    std::unique_ptr<HashIndex> query_index_;
 
     // Internal analysis state
     struct AnalysisState {
+        // Token storage of the analyzed files; declared first so it is
+        // released after everything that points into it
+        AnalysisArena arena;
+
         HashIndex index;
         std::vector<TokenizedFile> tokenized_files;
-        std::map<uint32_t, std::string> sources;  // file_id -> source code
+        std::vector<CloneClass> clone_classes;    // Chained stop hash classes
+        std::map<uint32_t, MappedSource> sources;  // file_id -> source code
         std::map<uint32_t, size_t> line_counts;   // file_id -> line count
 
         int64_t tokenize_time_ms = 0;
@@ -109,12 +188,45 @@ private:
         size_t total_tokens = 0;         // Total tokens processed
         size_t thread_count = 0;         // Number of threads used
         bool parallel_enabled = false;   // Whether parallel processing was used
+        size_t peak_pair_buffer = 0;     // Most clone pairs buffered at once
+        bool index_loaded = false;       // Index was mapped from index_path
+        std::string index_save_error;    // Why saving to index_path failed
+
+        // LSH prefilter: candidate file pairs (key: file_a << 32 | file_b)
+        bool prefiltered = false;
+        std::unordered_set<uint64_t> candidate_pairs;
+        // Spilled index records when a memory budget is set (index then
+        // only holds the file table)
+        std::unique_ptr<ExternalHashIndex> external_index;
+
+        // Source I/O: every file is loaded once per analysis
+        size_t files_read = 0;
+        size_t bytes_read = 0;    // Copied into memory
+        size_t bytes_mapped = 0;  // Mapped in place
+
+        void count_source(const MappedSource& source) {
+            ++files_read;
+            (source.is_mapped() ? bytes_mapped : bytes_read) += source.size();
+        }
     };
 
     /**
-     * Get or create normalizer for a language.
+     * A tokenized file and the source it was tokenized from.
+     */
+    struct SourceFile {
+        TokenizedFile tokens;
+        MappedSource source;
+    };
+
+    /**
+     * Get or create the calling thread's normalizer for a language.
+     *
+     * Each thread owns one instance per language, so files tokenized
+     * concurrently never share a normalizer and the lookup takes no lock.
+     * The keyword tables the instances classify with are static and
+     * read-only.
      */
-    TokenNormalizer* get_normalizer(Language lang);
+    static TokenNormalizer* get_normalizer(Language lang);
 
     /**
      * Initialize thread pool and cache if needed.
@@ -130,10 +242,24 @@ private:
     );
 
     /**
-     * Tokenize a single file (thread-safe).
+     * Load and tokenize a single file (thread-safe). The source is
+     * returned with the tokens, so the file is only read once.
+     *
+     * @param memory Resource the token columns are allocated from
+     * @param pool Pool to split a large file over (only from outside it)
+     */
+    std::optional<SourceFile> tokenize_single_file(
+        const std::filesystem::path& file_path,
+        std::pmr::memory_resource* memory,
+        ThreadPool* pool = nullptr
+    );
+
+    /**
+     * Tokenize already loaded source code (thread-safe).
      */
-    std::optional<TokenizedFile> tokenize_single_file(
-        const std::filesystem::path& file_path
+    std::optional<TokenizedFile> tokenize_source(
+        const std::filesystem::path& file_path,
+        std::string_view source
     );
 
     /**
@@ -141,11 +267,97 @@ private:
      */
     void build_index(AnalysisState& state) const;
 
+    /**
+     * Phase 2 under a memory budget: hash files in bounded chunks into
+     * an ExternalHashIndex that spills sorted runs to disk.
+     */
+    void build_external_index(
+        AnalysisState& state,
+        const HashIndexBuilder& builder,
+        const std::vector<bool>& selected
+    ) const;
+
+    /**
+     * LSH prefilter: compute MinHash signatures, record the candidate file
+     * pairs in state and return which files belong to any of them.
+     */
+    std::vector<bool> select_candidate_files(AnalysisState& state) const;
+
+    /**
+     * Fingerprint of the settings that shape the hash index.
+     */
+    uint64_t index_fingerprint() const;
+
+    /**
+     * File table for saving the index of the analyzed files.
+     */
+    IndexFileInfo index_file_info(const AnalysisState& state) const;
+
+    /**
+     * Replace state.index with the saved index at config_.index_path if it
+     * was built with the same settings from the same file contents.
+     *
+     * @return true if the saved index was loaded
+     */
+    bool load_saved_index(AnalysisState& state) const;
+
+    /**
+     * Index probed by query(): the incremental index, or the saved index
+     * at index_path (opened once).
+     */
+    const HashIndex& query_target();
+
     /**
      * Phase 3: Find and filter clone pairs.
      */
     std::vector<ClonePair> find_clones(AnalysisState& state);
 
+    /**
+     * Seed chaining settings for the hash index engine.
+     */
+    SeedChainer::Config chain_config() const;
+
+    /**
+     * Size filter, classification and Type-3 extension of chained pairs.
+     * Works pair by pair, so any subsequence can be refined on its own.
+     */
+    std::vector<ClonePair> refine_pairs(
+        std::vector<ClonePair> pairs,
+        const AnalysisState& state
+    ) const;
+
+    /**
+     * Chain, size-filter and classify raw stop hash clone classes.
+     */
+    std::vector<CloneClass> refine_clone_classes(
+        std::vector<CloneClass> classes,
+        const AnalysisState& state
+    ) const;
+
+    /**
+     * One analyze_incremental() update over the discovered files.
+     */
+    SimilarityReport update_incremental(
+        const std::vector<std::filesystem::path>& files,
+        std::chrono::high_resolution_clock::time_point start_time
+    );
+
+    /**
+     * Winnowing run length in effect (0 when winnowing is disabled).
+     */
+    size_t winnow_window() const;
+
+    /**
+     * Grow merged fingerprint matches to the full exact match.
+     *
+     * Winnowed seeds only cover part of a clone, so each pair is extended
+     * backward and forward while the indexed token hashes keep matching.
+     */
+    void extend_exact_matches(
+        std::vector<ClonePair>& pairs,
+        const AnalysisState& state
+    ) const;
+
     /**
      * Phase 4: Generate report from clone pairs.
      */
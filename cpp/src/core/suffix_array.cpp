@@ -0,0 +1,312 @@
+#include "core/suffix_array.hpp"
+#include "core/hash_index.hpp"
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+namespace aegis::similarity {
+
+namespace {
+
+constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Compute bucket heads (end = false) or tails (end = true) per symbol.
+ */
+void get_buckets(
+    const uint32_t* text, const size_t n, std::vector<uint32_t>& buckets, const bool end
+) {
+    std::ranges::fill(buckets, 0);
+    for (size_t i = 0; i < n; ++i) {
+        buckets[text[i]]++;
+    }
+    uint32_t sum = 0;
+    for (auto& bucket : buckets) {
+        const uint32_t count = bucket;
+        sum += count;
+        bucket = end ? sum : sum - count;
+    }
+}
+
+bool is_lms(const std::vector<bool>& s_type, const size_t i) {
+    return i > 0 && s_type[i] && !s_type[i - 1];
+}
+
+void induce_l(
+    const uint32_t* text, uint32_t* sa, const size_t n,
+    const std::vector<bool>& s_type, std::vector<uint32_t>& buckets
+) {
+    get_buckets(text, n, buckets, false);
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t j = sa[i];
+        if (j != EMPTY && j > 0 && !s_type[j - 1]) {
+            sa[buckets[text[j - 1]]++] = j - 1;
+        }
+    }
+}
+
+void induce_s(
+    const uint32_t* text, uint32_t* sa, const size_t n,
+    const std::vector<bool>& s_type, std::vector<uint32_t>& buckets
+) {
+    get_buckets(text, n, buckets, true);
+    for (size_t i = n; i-- > 0;) {
+        const uint32_t j = sa[i];
+        if (j != EMPTY && j > 0 && s_type[j - 1]) {
+            sa[--buckets[text[j - 1]]] = j - 1;
+        }
+    }
+}
+
+/**
+ * SA-IS (Nong, Zhang and Chan): sort LMS substrings by induced sorting,
+ * name them, recurse on the reduced string if names are not unique, then
+ * induce the full suffix array from the sorted LMS suffixes.
+ */
+void sais(const uint32_t* text, uint32_t* sa, const size_t n, const size_t alphabet_size) {
+    // Classify suffixes: S-type if smaller than the next suffix
+    std::vector<bool> s_type(n, false);
+    s_type[n - 1] = true;
+    for (size_t i = n - 1; i-- > 0;) {
+        s_type[i] = text[i] < text[i + 1] || (text[i] == text[i + 1] && s_type[i + 1]);
+    }
+
+    std::vector<uint32_t> buckets(alphabet_size);
+
+    // Stage 1: sort LMS substrings
+    std::fill(sa, sa + n, EMPTY);
+    get_buckets(text, n, buckets, true);
+    for (size_t i = 1; i < n; ++i) {
+        if (is_lms(s_type, i)) {
+            sa[--buckets[text[i]]] = static_cast<uint32_t>(i);
+        }
+    }
+    induce_l(text, sa, n, s_type, buckets);
+    induce_s(text, sa, n, s_type, buckets);
+
+    // Compact the sorted LMS positions into the front of sa
+    size_t lms_count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (is_lms(s_type, sa[i])) {
+            sa[lms_count++] = sa[i];
+        }
+    }
+
+    // Name LMS substrings; equal substrings get equal names
+    std::fill(sa + lms_count, sa + n, EMPTY);
+    uint32_t name = 0;
+    uint32_t previous = EMPTY;
+    for (size_t i = 0; i < lms_count; ++i) {
+        const uint32_t pos = sa[i];
+        bool differs = false;
+        for (size_t d = 0; ; ++d) {
+            if (previous == EMPTY ||
+                text[pos + d] != text[previous + d] ||
+                s_type[pos + d] != s_type[previous + d]) {
+                differs = true;
+                break;
+            }
+            if (d > 0 && (is_lms(s_type, pos + d) || is_lms(s_type, previous + d))) {
+                break;
+            }
+        }
+        if (differs) {
+            ++name;
+            previous = pos;
+        }
+        sa[lms_count + pos / 2] = name - 1;
+    }
+    for (size_t i = n, j = n; i-- > lms_count;) {
+        if (sa[i] != EMPTY) {
+            sa[--j] = sa[i];
+        }
+    }
+
+    // Stage 2: sort the reduced string (recursively if names repeat)
+    uint32_t* reduced = sa + n - lms_count;
+    if (name < lms_count) {
+        sais(reduced, sa, lms_count, name);
+    } else {
+        for (size_t i = 0; i < lms_count; ++i) {
+            sa[reduced[i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Stage 3: induce the full suffix array from the sorted LMS suffixes
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        if (is_lms(s_type, i)) {
+            reduced[j++] = static_cast<uint32_t>(i);
+        }
+    }
+    for (size_t i = 0; i < lms_count; ++i) {
+        sa[i] = reduced[sa[i]];
+    }
+    std::fill(sa + lms_count, sa + n, EMPTY);
+    get_buckets(text, n, buckets, true);
+    for (size_t i = lms_count; i-- > 0;) {
+        const uint32_t j = sa[i];
+        sa[i] = EMPTY;
+        sa[--buckets[text[j]]] = j;
+    }
+    induce_l(text, sa, n, s_type, buckets);
+    induce_s(text, sa, n, s_type, buckets);
+}
+
+}  // anonymous namespace
+
+std::vector<uint32_t> build_suffix_array(
+    const std::vector<uint32_t>& text,
+    const uint32_t alphabet_size
+) {
+    std::vector<uint32_t> sa(text.size());
+    if (text.size() == 1) {
+        sa[0] = 0;
+    } else if (!text.empty()) {
+        sais(text.data(), sa.data(), text.size(), alphabet_size);
+    }
+    return sa;
+}
+
+std::vector<uint32_t> build_lcp_array(
+    const std::vector<uint32_t>& text,
+    const std::vector<uint32_t>& suffix_array
+) {
+    const size_t n = text.size();
+    std::vector<uint32_t> rank(n);
+    for (size_t i = 0; i < n; ++i) {
+        rank[suffix_array[i]] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<uint32_t> lcp(n, 0);
+    size_t h = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        const size_t j = suffix_array[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+            ++h;
+        }
+        lcp[rank[i]] = static_cast<uint32_t>(h);
+        if (h > 0) {
+            --h;
+        }
+    }
+    return lcp;
+}
+
+SuffixArrayCloneFinder::SuffixArrayCloneFinder(const Config& config)
+    : config_(config)
+{
+}
+
+std::vector<ClonePair> SuffixArrayCloneFinder::find_clone_pairs(
+    const std::vector<TokenizedFile>& files
+) const {
+    std::vector<ClonePair> results;
+
+    std::vector<std::span<const uint32_t>> sequences;
+    sequences.reserve(files.size());
+    size_t token_total = 0;
+    for (const auto& file : files) {
+        sequences.push_back(file.tokens.significant_hashes(config_.use_normalized));
+        token_total += sequences.back().size();
+    }
+
+    // One symbol per token, one separator per file and the final sentinel
+    const size_t text_size = token_total + files.size() + 1;
+    if (text_size >= EMPTY) {
+        throw std::length_error("Token stream too large for the suffix array engine");
+    }
+
+    // Rank-compress token hashes to 1..K; 0 is the sentinel
+    std::vector<uint32_t> alphabet;
+    alphabet.reserve(token_total);
+    for (const auto& sequence : sequences) {
+        alphabet.insert(alphabet.end(), sequence.begin(), sequence.end());
+    }
+    std::ranges::sort(alphabet);
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+    const auto token_symbols = static_cast<uint32_t>(alphabet.size());
+
+    std::vector<uint32_t> text;
+    text.reserve(text_size);
+    std::vector<uint32_t> file_starts;
+    file_starts.reserve(files.size());
+    for (size_t f = 0; f < sequences.size(); ++f) {
+        file_starts.push_back(static_cast<uint32_t>(text.size()));
+        for (const uint32_t hash : sequences[f]) {
+            const auto rank = std::ranges::lower_bound(alphabet, hash) - alphabet.begin();
+            text.push_back(static_cast<uint32_t>(rank) + 1);
+        }
+        // Unique separator: no common prefix can run across a file end
+        text.push_back(token_symbols + 1 + static_cast<uint32_t>(f));
+    }
+    text.push_back(0);
+    alphabet = {};
+
+    const auto alphabet_size = static_cast<uint32_t>(token_symbols + files.size() + 1);
+    const auto suffix_array = build_suffix_array(text, alphabet_size);
+    const auto lcp = build_lcp_array(text, suffix_array);
+
+    const auto locate = [&file_starts](const uint32_t pos) {
+        const auto it = std::ranges::upper_bound(file_starts, pos);
+        const auto file = static_cast<uint32_t>(it - file_starts.begin() - 1);
+        return std::pair<uint32_t, uint32_t>{file, pos - file_starts[file]};
+    };
+
+    const auto make_location = [](const uint32_t file_id, const uint32_t start, const uint32_t count) {
+        HashLocation loc{};
+        loc.file_id = file_id;
+        loc.token_start = start;
+        loc.token_count = count;
+        return loc;
+    };
+
+    for (size_t i = 1; i < suffix_array.size(); ++i) {
+        uint32_t length = lcp[i];
+        if (length < config_.min_tokens) {
+            continue;
+        }
+
+        uint32_t pos_a = suffix_array[i - 1];
+        uint32_t pos_b = suffix_array[i];
+
+        // Not left-maximal: the pair one token earlier covers this repeat
+        if (pos_a > 0 && pos_b > 0 && text[pos_a - 1] == text[pos_b - 1]) {
+            continue;
+        }
+
+        if (pos_a > pos_b) {
+            std::swap(pos_a, pos_b);
+        }
+        const auto [file_a, start_a] = locate(pos_a);
+        auto [file_b, start_b] = locate(pos_b);
+
+        // Overlapping occurrences: the region [start_a, start_b + length) is
+        // periodic with period start_b - start_a, so split it into two
+        // disjoint copies whose length is a multiple of the period
+        if (file_a == file_b && start_a + length > start_b) {
+            const uint32_t period = start_b - start_a;
+            length = (length + period) / 2 / period * period;
+            if (length < config_.min_tokens) {
+                continue;
+            }
+            start_b = start_a + length;
+        }
+
+        ClonePair pair{};
+        pair.location_a = make_location(file_a, start_a, length);
+        pair.location_b = make_location(file_b, start_b, length);
+        pair.clone_type = CloneType::TYPE_1;  // Initial classification
+        pair.similarity = 1.0f;                // Exact match
+        pair.shared_hash = 0;                  // No window hash involved
+        results.push_back(pair);
+    }
+
+    return results;
+}
+
+}  // namespace aegis::similarity
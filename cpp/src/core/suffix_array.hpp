@@ -0,0 +1,86 @@
+#pragma once
+
+#include "models/clone_types.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * Build the suffix array of an integer text with SA-IS (linear time).
+ *
+ * The text must end with a unique sentinel 0 that is smaller than every
+ * other symbol, and all symbols must be below alphabet_size.
+ *
+ * @param text Symbols in [0, alphabet_size), terminated by 0
+ * @param alphabet_size Number of distinct symbol values
+ * @return Start positions of the suffixes in lexicographic order
+ */
+std::vector<uint32_t> build_suffix_array(
+    const std::vector<uint32_t>& text,
+    uint32_t alphabet_size
+);
+
+/**
+ * Build the LCP array with Kasai's algorithm (linear time).
+ *
+ * @param text The text the suffix array was built from
+ * @param suffix_array Suffix array of text
+ * @return lcp[i] = longest common prefix of suffixes sa[i - 1] and sa[i]
+ *         (lcp[0] = 0)
+ */
+std::vector<uint32_t> build_lcp_array(
+    const std::vector<uint32_t>& text,
+    const std::vector<uint32_t>& suffix_array
+);
+
+/**
+ * Exact clone engine based on a generalized suffix array.
+ *
+ * All files' significant token streams are rank-compressed and joined
+ * with a unique separator per file, so no common prefix crosses a file
+ * boundary. Clones are read off the suffix and LCP arrays: every pair of
+ * lexicographically adjacent suffixes whose LCP is at least min_tokens
+ * and that cannot be extended to the left is one maximal exact repeat.
+ *
+ * A region repeated k times yields k - 1 chained pairs instead of the
+ * k(k-1)/2 pairs of the hash index, so highly repetitive code needs no
+ * per-hash location cap. Pairs use the same token coordinates as the
+ * hash index (structural tokens removed), and file IDs are positions in
+ * the input file vector.
+ */
+class SuffixArrayCloneFinder {
+public:
+    /**
+     * Configuration for the suffix array engine.
+     */
+    struct Config {
+        // Minimum length of a reported repeat (in tokens)
+        size_t min_tokens;
+
+        // Compare normalized hashes (Type-2) instead of original hashes
+        bool use_normalized;
+
+        Config()
+            : min_tokens(30)
+            , use_normalized(true)
+        {}
+    };
+
+    explicit SuffixArrayCloneFinder(const Config& config = Config());
+
+    /**
+     * Find maximal exact repeats across and within the given files.
+     *
+     * @param files Tokenized files; file_id i refers to files[i]
+     * @return Clone pairs, one per maximal repeat between SA neighbours
+     */
+    [[nodiscard]] std::vector<ClonePair> find_clone_pairs(
+        const std::vector<TokenizedFile>& files
+    ) const;
+
+private:
+    Config config_;
+};
+
+}  // namespace aegis::similarity
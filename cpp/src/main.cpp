@@ -36,6 +36,26 @@ void print_usage(const char* program) {
               << "  --threshold <f>      Similarity threshold 0.0-1.0 (default: 0.7)\n"
               << "  --type3              Enable Type-3 detection (clones with gaps)\n"
               << "  --max-gap <n>        Maximum gap for Type-3 detection (default: 5)\n"
+              << "  --engine <name>      Exact clone engine: hash or suffix-array\n"
+              << "                       (default: hash)\n"
+              << "  --winnow             Index winnowed fingerprints only (smaller index)\n"
+              << "  --winnow-window <n>  Winnowing window in hashes (default: derived from\n"
+              << "                       --min-tokens and --window)\n"
+              << "  --stop-hashes <mode> Frequent windows: class, sample or drop\n"
+              << "                       (default: class)\n"
+              << "  --stop-hash-min <n>  Locations before a window is a stop hash\n"
+              << "                       (default: 500, scaled up on large corpora)\n"
+              << "  --index <path>       Saved hash index; reused when it matches the files\n"
+              << "                       and settings, otherwise rebuilt and written\n"
+              << "  --lsh                Only match files with a near-duplicate partner\n"
+              << "                       (MinHash/LSH prefilter for very large trees)\n"
+              << "  --minhash-size <n>   MinHash values per file (default: 128)\n"
+              << "  --lsh-bands <n>      LSH bands; more bands find less similar files\n"
+              << "                       (default: 32)\n"
+              << "  --memory-budget <n>  Bytes of index records kept in memory; beyond\n"
+              << "                       that sorted runs are spilled to disk (default: 0,\n"
+              << "                       no limit)\n"
+              << "  --spill-dir <path>   Directory for spilled runs (default: system temp)\n"
               << "  --compare <f1> <f2>  Compare two specific files\n"
               << "  --socket <path>      Run as server on Unix socket\n"
               << "  --pretty             Pretty-print JSON output\n"
@@ -58,6 +78,17 @@ struct CliArgs {
     float similarity_threshold = 0.7f;
     bool detect_type3 = false;
     size_t max_gap_tokens = 5;
+    std::string engine = "hash";
+    bool use_winnowing = false;
+    size_t winnow_window = 0;
+    std::string stop_hash_mode = "class";
+    size_t stop_hash_min_locations = 500;
+    std::string index_path;
+    bool use_lsh_prefilter = false;
+    size_t minhash_signature_size = 128;
+    size_t lsh_bands = 32;
+    size_t memory_budget_bytes = 0;
+    std::string spill_dir;
     bool pretty_print = false;
     std::string compare_file1;
     std::string compare_file2;
@@ -163,6 +194,17 @@ void validate_required_args(CliArgs& args) {
     if (args.root.empty() && args.compare_file1.empty() && args.socket_path.empty()) {
         args.has_error = true;
         args.error_message = "Either --root, --compare, or --socket is required";
+        return;
+    }
+    if (!detection_engine_from_string(args.engine)) {
+        args.has_error = true;
+        args.error_message = "Unknown engine: " + args.engine + " (expected hash or suffix-array)";
+        return;
+    }
+    if (!stop_hash_mode_from_string(args.stop_hash_mode)) {
+        args.has_error = true;
+        args.error_message = "Unknown stop hash mode: " + args.stop_hash_mode +
+                             " (expected class, sample or drop)";
     }
 }
 
@@ -215,6 +257,17 @@ CliArgs parse_args(int argc, char* argv[]) {
         if (try_parse_float_arg(arg, "--threshold", i, argc, argv, args.similarity_threshold)) continue;
         if (try_parse_flag(arg, "--type3", args.detect_type3)) continue;
         if (try_parse_size_arg(arg, "--max-gap", i, argc, argv, args.max_gap_tokens)) continue;
+        if (try_parse_string_arg(arg, "--engine", i, argc, argv, args.engine)) continue;
+        if (try_parse_flag(arg, "--winnow", args.use_winnowing)) continue;
+        if (try_parse_size_arg(arg, "--winnow-window", i, argc, argv, args.winnow_window)) continue;
+        if (try_parse_string_arg(arg, "--stop-hashes", i, argc, argv, args.stop_hash_mode)) continue;
+        if (try_parse_size_arg(arg, "--stop-hash-min", i, argc, argv, args.stop_hash_min_locations)) continue;
+        if (try_parse_string_arg(arg, "--index", i, argc, argv, args.index_path)) continue;
+        if (try_parse_flag(arg, "--lsh", args.use_lsh_prefilter)) continue;
+        if (try_parse_size_arg(arg, "--minhash-size", i, argc, argv, args.minhash_signature_size)) continue;
+        if (try_parse_size_arg(arg, "--lsh-bands", i, argc, argv, args.lsh_bands)) continue;
+        if (try_parse_size_arg(arg, "--memory-budget", i, argc, argv, args.memory_budget_bytes)) continue;
+        if (try_parse_string_arg(arg, "--spill-dir", i, argc, argv, args.spill_dir)) continue;
         if (try_parse_compare(arg, i, argc, argv, args)) continue;
         if (try_parse_string_arg(arg, "--socket", i, argc, argv, args.socket_path)) continue;
         if (try_parse_flag(arg, "--pretty", args.pretty_print)) continue;
@@ -282,6 +335,17 @@ int main(int argc, char* argv[]) {
     config.similarity_threshold = args.similarity_threshold;
     config.detect_type3 = args.detect_type3;
     config.max_gap_tokens = args.max_gap_tokens;
+    config.engine = *detection_engine_from_string(args.engine);
+    config.use_winnowing = args.use_winnowing;
+    config.winnow_window = args.winnow_window;
+    config.stop_hash_mode = *stop_hash_mode_from_string(args.stop_hash_mode);
+    config.stop_hash_min_locations = args.stop_hash_min_locations;
+    config.index_path = args.index_path;
+    config.use_lsh_prefilter = args.use_lsh_prefilter;
+    config.minhash_signature_size = args.minhash_signature_size;
+    config.lsh_bands = args.lsh_bands;
+    config.memory_budget_bytes = args.memory_budget_bytes;
+    config.spill_dir = args.spill_dir;
     config.extensions = args.extensions;
     config.exclude_patterns = args.exclude_patterns;
 
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 #include <optional>
@@ -76,23 +81,37 @@ struct NormalizedToken {
 
 /**
  * A location in the source code where a hash was found.
+ *
+ * Only the token range is stored: the index holds one location per
+ * window, so lines and columns are looked up in the file's tokens when a
+ * report needs them (TokenStore::source_span).
  */
 struct HashLocation {
     uint32_t file_id;      // Index into a file list
-    uint32_t start_line;
-    uint32_t end_line;
-    uint16_t start_col;
-    uint16_t end_col;
-    uint32_t token_start;  // Start index in token array
+    uint32_t token_start;  // Start index in the significant token sequence
     uint32_t token_count;  // Number of tokens in this region
 
-    // Check if this location overlaps with another
+    [[nodiscard]] uint32_t token_end() const { return token_start + token_count; }
+
+    // Check if this location shares tokens with another
     [[nodiscard]] bool overlaps(const HashLocation& other) const {
         if (file_id != other.file_id) return false;
-        return !(end_line < other.start_line || start_line > other.end_line);
+        return token_start < other.token_end() && other.token_start < token_end();
     }
 };
 
+static_assert(sizeof(HashLocation) == 12);
+
+/**
+ * Lines and columns covered by a token range.
+ */
+struct SourceSpan {
+    uint32_t start_line = 0;
+    uint32_t end_line = 0;
+    uint16_t start_col = 0;
+    uint16_t end_col = 0;  // Column just past the last token
+};
+
 /**
  * Clone type classification.
  */
@@ -125,12 +144,26 @@ struct ClonePair {
     [[nodiscard]] uint32_t token_count() const {
         return std::min(location_a.token_count, location_b.token_count);
     }
+};
+
+/**
+ * A group of locations that all contain the same code (a clone class).
+ *
+ * Used for code repeated too often to report pairwise: N copies are one
+ * record instead of N(N-1)/2 pairs.
+ */
+struct CloneClass {
+    std::vector<HashLocation> locations;  // Sorted by file_id, token_start
+    CloneType clone_type;
+    uint64_t shared_hash;                 // First window hash of the class
 
-    // Line count of the cloned region
-    [[nodiscard]] uint32_t line_count() const {
-        const auto a_lines = location_a.end_line - location_a.start_line + 1;
-        const auto b_lines = location_b.end_line - location_b.start_line + 1;
-        return std::min(a_lines, b_lines);
+    // Token count of the cloned region
+    [[nodiscard]] uint32_t token_count() const {
+        uint32_t count = locations.empty() ? 0 : locations[0].token_count;
+        for (const auto& loc : locations) {
+            count = std::min(count, loc.token_count);
+        }
+        return count;
     }
 };
 
@@ -145,6 +178,67 @@ struct DuplicationHotspot {
     uint32_t total_lines;      // Total lines in file
 };
 
+/**
+ * Rolling hash function used for window hashes.
+ */
+enum class HashFunction {
+    MOD_1E9_9,    // Legacy 30-bit Rabin-Karp hash (BASE 31, MOD 1e9 + 9)
+    MERSENNE_61   // 61-bit hash modulo the Mersenne prime 2^61 - 1
+};
+
+/**
+ * Engine used to find exact (Type-1/Type-2) clone seeds.
+ */
+enum class DetectionEngine {
+    HASH_INDEX,    // Fixed-window rolling hashes in an inverted index
+    SUFFIX_ARRAY   // Maximal repeats from a generalized suffix array
+};
+
+inline const char* detection_engine_to_string(const DetectionEngine engine) {
+    switch (engine) {
+        case DetectionEngine::HASH_INDEX:   return "hash";
+        case DetectionEngine::SUFFIX_ARRAY: return "suffix-array";
+    }
+    return "hash";
+}
+
+/**
+ * Parse an engine name ("hash" or "suffix-array").
+ */
+inline std::optional<DetectionEngine> detection_engine_from_string(const std::string& name) {
+    if (name == "hash") return DetectionEngine::HASH_INDEX;
+    if (name == "suffix-array") return DetectionEngine::SUFFIX_ARRAY;
+    return std::nullopt;
+}
+
+/**
+ * What to do with stop hashes (windows that occur too often to pair up).
+ */
+enum class StopHashMode {
+    DROP,         // Ignore them (no pairs)
+    CLONE_CLASS,  // Report each as one clone class instead of N^2 pairs
+    SAMPLE        // Pair up a bounded sample of their locations
+};
+
+inline const char* stop_hash_mode_to_string(const StopHashMode mode) {
+    switch (mode) {
+        case StopHashMode::DROP:        return "drop";
+        case StopHashMode::CLONE_CLASS: return "class";
+        case StopHashMode::SAMPLE:      return "sample";
+    }
+    return "class";
+}
+
+/**
+ * Parse a stop hash mode name ("drop", "class" or "sample").
+ */
+inline std::optional<StopHashMode> stop_hash_mode_from_string(const std::string& name) {
+    if (name == "drop") return StopHashMode::DROP;
+    if (name == "class") return StopHashMode::CLONE_CLASS;
+    if (name == "sample") return StopHashMode::SAMPLE;
+    return std::nullopt;
+}
+
 /**
  * Configuration for the similarity detector.
  */
@@ -167,6 +261,57 @@ struct DetectorConfig {
     // Maximum gap allowed for Type-3 extension
     size_t max_gap_tokens = 5;
 
+    // Exact clone engine. The suffix array engine reports maximal repeats
+    // directly and has no per-hash location cap; window_size, hash and
+    // winnowing settings only apply to the hash index engine.
+    DetectionEngine engine = DetectionEngine::HASH_INDEX;
+
+    // Rolling hash used for window hashes. The 61-bit hash makes
+    // collisions (bogus seeds) negligible even on very large indexes.
+    HashFunction hash_function = HashFunction::MERSENNE_61;
+
+    // Index winnowed fingerprints instead of every window hash. Any clone
+    // of at least winnow_window + window_size - 1 tokens is still found.
+    bool use_winnowing = false;
+
+    // Winnowing run length in window hashes. 0 derives it from the other
+    // settings (min_clone_tokens - window_size + 1), which guarantees that
+    // every clone of min_clone_tokens or more shares a fingerprint.
+    size_t winnow_window = 0;
+
+    // Handling of window hashes with more locations than the stop
+    // threshold: max(stop_hash_min_locations, stop_hash_fraction * windows)
+    StopHashMode stop_hash_mode = StopHashMode::CLONE_CLASS;
+    size_t stop_hash_min_locations = 500;
+    double stop_hash_fraction = 0.001;
+
+    // Filter out windows that occur only once before building the index
+    // (Bloom filter pre-pass). They cannot form clone pairs.
+    bool drop_singleton_hashes = true;
+
+    // File-level prefilter for very large trees: MinHash signatures over
+    // each file's shingles and LSH banding pick candidate file pairs, and
+    // only files in a candidate pair are indexed and matched in detail.
+    // Finds near-duplicate files; clones between files that share little
+    // code overall are missed. Hash index engine only.
+    bool use_lsh_prefilter = false;
+    size_t minhash_signature_size = 128;
+    size_t lsh_bands = 32;
+    double lsh_min_similarity = 0.3;  // Minimum estimated Jaccard similarity
+
+    // Saved hash index file (empty = none). A matching index (same files,
+    // contents and index settings) is mapped instead of rebuilt; otherwise
+    // the index is rebuilt and written here.
+    std::string index_path;
+
+    // Memory budget in bytes for the window records of the hash index
+    // (0 = build it in memory). Over budget, sorted runs are spilled to
+    // spill_dir (system temp directory if empty) and merged to generate
+    // pairs; the report is the same. The index is then not written to
+    // index_path, and incremental runs fall back to full runs.
+    size_t memory_budget_bytes = 0;
+    std::string spill_dir;
+
     // Number of threads (0 = auto-detect)
     size_t num_threads = 0;
 
@@ -189,12 +334,225 @@ struct DetectorConfig {
     };
 };
 
+/**
+ * The tokens of one file, stored column by column.
+ *
+ * Hashing and extension only read one or two fields per token, so each
+ * field lives in its own array and those loops touch just the bytes they
+ * need. The store also keeps the significant sequence (the tokens that
+ * are not NEWLINE, INDENT or DEDENT) that window hashes and index
+ * locations are built on. Only the Python normalizer emits structural
+ * tokens; until the first one arrives the significant sequence is the
+ * full one and costs nothing extra.
+ *
+ * Element access and iteration return tokens by value. The columns can
+ * live in a caller's memory resource (an analysis arena); copies always
+ * use the default resource.
+ */
+class TokenStore {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = NormalizedToken;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = NormalizedToken;
+
+        const_iterator() = default;
+        const_iterator(const TokenStore* store, const size_t index) : store_(store), index_(index) {}
+
+        NormalizedToken operator*() const { return (*store_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { const auto it = *this; ++index_; return it; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+
+    private:
+        const TokenStore* store_ = nullptr;
+        size_t index_ = 0;
+    };
+
+    TokenStore() = default;
+
+    explicit TokenStore(std::pmr::memory_resource* memory)
+        : types_(memory)
+        , original_hashes_(memory)
+        , normalized_hashes_(memory)
+        , lines_(memory)
+        , columns_(memory)
+        , lengths_(memory)
+        , significant_original_(memory)
+        , significant_normalized_(memory)
+        , significant_index_(memory)
+    {}
+
+    /**
+     * Check whether a token type is left out of the significant sequence.
+     */
+    static constexpr bool is_structural(const TokenType type) {
+        return type == TokenType::NEWLINE || type == TokenType::INDENT || type == TokenType::DEDENT;
+    }
+
+    void push_back(const NormalizedToken& token) {
+        if (is_structural(token.type)) {
+            if (!filtered_) {
+                start_filtering();
+            }
+        } else if (filtered_) {
+            significant_original_.push_back(token.original_hash);
+            significant_normalized_.push_back(token.normalized_hash);
+            significant_index_.push_back(static_cast<uint32_t>(types_.size()));
+        }
+        types_.push_back(token.type);
+        original_hashes_.push_back(token.original_hash);
+        normalized_hashes_.push_back(token.normalized_hash);
+        lines_.push_back(token.line);
+        columns_.push_back(token.column);
+        lengths_.push_back(token.length);
+    }
+
+    /**
+     * Append all tokens of another store.
+     */
+    void append(const TokenStore& other) {
+        if (other.filtered_ && !filtered_) {
+            start_filtering();
+        }
+        if (filtered_) {
+            const auto offset = static_cast<uint32_t>(types_.size());
+            for (size_t i = 0; i < other.significant_size(); ++i) {
+                significant_index_.push_back(offset + static_cast<uint32_t>(other.token_index(i)));
+            }
+            const auto original = other.significant_hashes(false);
+            const auto normalized = other.significant_hashes(true);
+            significant_original_.insert(significant_original_.end(), original.begin(), original.end());
+            significant_normalized_.insert(significant_normalized_.end(), normalized.begin(), normalized.end());
+        }
+        types_.insert(types_.end(), other.types_.begin(), other.types_.end());
+        original_hashes_.insert(original_hashes_.end(), other.original_hashes_.begin(), other.original_hashes_.end());
+        normalized_hashes_.insert(normalized_hashes_.end(), other.normalized_hashes_.begin(), other.normalized_hashes_.end());
+        lines_.insert(lines_.end(), other.lines_.begin(), other.lines_.end());
+        columns_.insert(columns_.end(), other.columns_.begin(), other.columns_.end());
+        lengths_.insert(lengths_.end(), other.lengths_.begin(), other.lengths_.end());
+    }
+
+    void reserve(const size_t count) {
+        types_.reserve(count);
+        original_hashes_.reserve(count);
+        normalized_hashes_.reserve(count);
+        lines_.reserve(count);
+        columns_.reserve(count);
+        lengths_.reserve(count);
+    }
+
+    void clear() {
+        types_.clear();
+        original_hashes_.clear();
+        normalized_hashes_.clear();
+        lines_.clear();
+        columns_.clear();
+        lengths_.clear();
+        filtered_ = false;
+        significant_original_.clear();
+        significant_normalized_.clear();
+        significant_index_.clear();
+    }
+
+    [[nodiscard]] size_t size() const { return types_.size(); }
+    [[nodiscard]] bool empty() const { return types_.empty(); }
+
+    [[nodiscard]] NormalizedToken operator[](const size_t i) const {
+        return {types_[i], original_hashes_[i], normalized_hashes_[i], lines_[i], columns_[i], lengths_[i]};
+    }
+    [[nodiscard]] NormalizedToken back() const { return (*this)[size() - 1]; }
+
+    [[nodiscard]] const_iterator begin() const { return {this, 0}; }
+    [[nodiscard]] const_iterator end() const { return {this, size()}; }
+
+    // Columns, indexed like the tokens
+    [[nodiscard]] std::span<const TokenType> types() const { return types_; }
+    [[nodiscard]] std::span<const uint32_t> original_hashes() const { return original_hashes_; }
+    [[nodiscard]] std::span<const uint32_t> normalized_hashes() const { return normalized_hashes_; }
+    [[nodiscard]] std::span<const uint32_t> lines() const { return lines_; }
+    [[nodiscard]] std::span<const uint16_t> columns() const { return columns_; }
+    [[nodiscard]] std::span<const uint16_t> lengths() const { return lengths_; }
+
+    /**
+     * Hashes of the significant tokens, in order.
+     *
+     * @param normalized Normalized hashes (Type-2) instead of original ones
+     */
+    [[nodiscard]] std::span<const uint32_t> significant_hashes(const bool normalized) const {
+        if (!filtered_) {
+            return normalized ? normalized_hashes() : original_hashes();
+        }
+        return normalized ? significant_normalized_ : significant_original_;
+    }
+
+    [[nodiscard]] size_t significant_size() const {
+        return filtered_ ? significant_index_.size() : size();
+    }
+
+    /**
+     * Index of a significant token among all tokens.
+     */
+    [[nodiscard]] size_t token_index(const size_t significant_pos) const {
+        return filtered_ ? significant_index_[significant_pos] : significant_pos;
+    }
+
+    /**
+     * Lines and columns covered by a location in this file.
+     *
+     * Locations index the significant sequence; a range running past the
+     * end is cut at the last token.
+     */
+    [[nodiscard]] SourceSpan source_span(const HashLocation& location) const {
+        const size_t end = std::min<size_t>(location.token_end(), significant_size());
+        if (location.token_start >= end) {
+            return {};
+        }
+        const size_t first = token_index(location.token_start);
+        const size_t last = token_index(end - 1);
+        return {
+            lines_[first],
+            lines_[last],
+            columns_[first],
+            static_cast<uint16_t>(columns_[last] + lengths_[last])
+        };
+    }
+
+private:
+    std::pmr::vector<TokenType> types_;
+    std::pmr::vector<uint32_t> original_hashes_;
+    std::pmr::vector<uint32_t> normalized_hashes_;
+    std::pmr::vector<uint32_t> lines_;
+    std::pmr::vector<uint16_t> columns_;
+    std::pmr::vector<uint16_t> lengths_;
+
+    // Significant sequence, only kept once a structural token was pushed
+    bool filtered_ = false;
+    std::pmr::vector<uint32_t> significant_original_;
+    std::pmr::vector<uint32_t> significant_normalized_;
+    std::pmr::vector<uint32_t> significant_index_;
+
+    // Every token so far is significant: copy them over and start filtering
+    void start_filtering() {
+        filtered_ = true;
+        significant_original_ = original_hashes_;
+        significant_normalized_ = normalized_hashes_;
+        significant_index_.resize(types_.size());
+        for (size_t i = 0; i < types_.size(); ++i) {
+            significant_index_[i] = static_cast<uint32_t>(i);
+        }
+    }
+};
+
 /**
  * Result of tokenizing a single file.
  */
 struct TokenizedFile {
     std::string path;
-    std::vector<NormalizedToken> tokens;
+    TokenStore tokens;
     uint32_t total_lines = 0;
     uint32_t code_lines = 0;
     uint32_t blank_lines = 0;
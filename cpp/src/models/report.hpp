@@ -3,6 +3,7 @@
 #include "models/clone_types.hpp"
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <map>
@@ -172,16 +173,45 @@ struct PerformanceMetrics {
     size_t files_per_second = 0;       // Files processed per second
     size_t thread_count = 0;           // Number of threads used
     bool parallel_enabled = false;     // Whether parallel processing was used
+    size_t index_bytes = 0;            // Memory footprint of the hash index
+    size_t peak_pair_buffer = 0;       // Most raw clone pairs alive at once
+    bool index_loaded = false;         // Whether a saved index was reused
+    std::string index_save_error;      // Why saving the index failed (empty if saved)
+    size_t lsh_candidate_pairs = 0;    // File pairs passed by the LSH prefilter
+    size_t spilled_runs = 0;           // Sorted index runs spilled to disk
+    size_t spilled_bytes = 0;          // Bytes written to spilled runs
+    size_t files_read = 0;             // Source files loaded
+    size_t bytes_read = 0;             // Source bytes copied into memory
+    size_t bytes_mapped = 0;           // Source bytes mapped in place
+    size_t arena_allocations = 0;      // Allocations served by the analysis arena
+    size_t arena_heap_allocations = 0; // Heap blocks the arena took
+    size_t arena_high_water_bytes = 0; // Most heap bytes the arena held
 
     nlohmann::json to_json() const {
-        return {
+        nlohmann::json j = {
             {"loc_per_second", loc_per_second},
             {"total_tokens", total_tokens},
             {"tokens_per_second", tokens_per_second},
             {"files_per_second", files_per_second},
             {"thread_count", thread_count},
-            {"parallel_enabled", parallel_enabled}
+            {"parallel_enabled", parallel_enabled},
+            {"index_bytes", index_bytes},
+            {"peak_pair_buffer", peak_pair_buffer},
+            {"index_loaded", index_loaded},
+            {"lsh_candidate_pairs", lsh_candidate_pairs},
+            {"spilled_runs", spilled_runs},
+            {"spilled_bytes", spilled_bytes},
+            {"files_read", files_read},
+            {"bytes_read", bytes_read},
+            {"bytes_mapped", bytes_mapped},
+            {"arena_allocations", arena_allocations},
+            {"arena_heap_allocations", arena_heap_allocations},
+            {"arena_high_water_bytes", arena_high_water_bytes}
         };
+        if (!index_save_error.empty()) {
+            j["index_save_error"] = index_save_error;
+        }
+        return j;
     }
 };
 
@@ -200,6 +230,59 @@ struct ReportMetrics {
     }
 };
 
+/**
+ * One indexed region matching part of a queried snippet.
+ */
+struct SnippetMatch {
+    std::string file;
+    uint32_t start_line = 0;
+    uint32_t end_line = 0;
+    uint32_t start_col = 0;
+    uint32_t end_col = 0;
+    uint32_t query_start_line = 0;  // Matched lines within the snippet
+    uint32_t query_end_line = 0;
+    uint32_t tokens = 0;            // Matched length in significant tokens
+    float coverage = 0.0f;          // Share of the snippet's tokens matched
+
+    nlohmann::json to_json() const {
+        return {
+            {"file", sanitize_utf8(file)},
+            {"start_line", start_line},
+            {"end_line", end_line},
+            {"start_col", start_col},
+            {"end_col", end_col},
+            {"query_start_line", query_start_line},
+            {"query_end_line", query_end_line},
+            {"tokens", tokens},
+            {"coverage", coverage}
+        };
+    }
+};
+
+/**
+ * Result of a snippet query, matches ranked best first.
+ */
+struct SnippetQueryResult {
+    std::vector<SnippetMatch> matches;
+    size_t query_tokens = 0;   // Significant tokens in the snippet
+    size_t window_hits = 0;    // Indexed locations hit by snippet windows
+    size_t stop_hashes = 0;    // Snippet windows skipped as stop hashes
+    int64_t query_time_us = 0;
+
+    nlohmann::json to_json() const {
+        nlohmann::json j;
+        j["matches"] = nlohmann::json::array();
+        for (const auto& match : matches) {
+            j["matches"].push_back(match.to_json());
+        }
+        j["query_tokens"] = query_tokens;
+        j["window_hits"] = window_hits;
+        j["stop_hashes"] = stop_hashes;
+        j["query_time_us"] = query_time_us;
+        return j;
+    }
+};
+
 /**
  * Complete similarity analysis report.
  *
@@ -260,45 +343,22 @@ public:
      *
      * @param pair The clone pair
      * @param file_paths Map of file_id to file path
+     * @param files Tokens by file_id (resolve locations to lines)
      * @param sources Map of file_id to source code (for snippet extraction)
      */
     void add_clone(
         const ClonePair& pair,
         const std::vector<std::string>& file_paths,
-        const std::map<uint32_t, std::string>& sources = {}
+        const std::vector<TokenizedFile>& files,
+        const std::map<uint32_t, std::string_view>& sources = {}
     ) {
         CloneEntry entry;
         entry.id = "clone_" + std::to_string(clones.size() + 1);
         entry.type = clone_type_to_string(pair.clone_type);
         entry.similarity = pair.similarity;
 
-        // Location A
-        CloneLocationInfo loc_a;
-        loc_a.file = pair.location_a.file_id < file_paths.size()
-            ? file_paths[pair.location_a.file_id]
-            : "unknown";
-        loc_a.start_line = pair.location_a.start_line;
-        loc_a.end_line = pair.location_a.end_line;
-        loc_a.snippet_preview = extract_snippet(
-            pair.location_a.file_id,
-            pair.location_a.start_line,
-            sources
-        );
-        entry.locations.push_back(loc_a);
-
-        // Location B
-        CloneLocationInfo loc_b;
-        loc_b.file = pair.location_b.file_id < file_paths.size()
-            ? file_paths[pair.location_b.file_id]
-            : "unknown";
-        loc_b.start_line = pair.location_b.start_line;
-        loc_b.end_line = pair.location_b.end_line;
-        loc_b.snippet_preview = extract_snippet(
-            pair.location_b.file_id,
-            pair.location_b.start_line,
-            sources
-        );
-        entry.locations.push_back(loc_b);
+        entry.locations.push_back(location_info(pair.location_a, file_paths, files, sources));
+        entry.locations.push_back(location_info(pair.location_b, file_paths, files, sources));
 
         // Generate recommendation
         entry.recommendation = generate_recommendation(pair);
@@ -309,6 +369,32 @@ public:
         metrics.by_type[entry.type]++;
     }
 
+    /**
+     * Add a clone class (one code region repeated at every location).
+     */
+    void add_clone_class(
+        const CloneClass& clone_class,
+        const std::vector<std::string>& file_paths,
+        const std::vector<TokenizedFile>& files,
+        const std::map<uint32_t, std::string_view>& sources = {}
+    ) {
+        CloneEntry entry;
+        entry.id = "clone_" + std::to_string(clones.size() + 1);
+        entry.type = clone_type_to_string(clone_class.clone_type);
+        entry.similarity = 1.0f;
+
+        for (const auto& location : clone_class.locations) {
+            entry.locations.push_back(location_info(location, file_paths, files, sources));
+        }
+
+        ClonePair representative{};
+        representative.clone_type = clone_class.clone_type;
+        entry.recommendation = generate_recommendation(representative);
+
+        clones.push_back(entry);
+        metrics.by_type[entry.type]++;
+    }
+
     /**
      * Calculate hotspots from clone data.
      *
@@ -440,10 +526,32 @@ public:
     }
 
 private:
+    /**
+     * Resolve a location to its file, lines and snippet.
+     */
+    CloneLocationInfo location_info(
+        const HashLocation& location,
+        const std::vector<std::string>& file_paths,
+        const std::vector<TokenizedFile>& files,
+        const std::map<uint32_t, std::string_view>& sources
+    ) {
+        CloneLocationInfo info;
+        info.file = location.file_id < file_paths.size()
+            ? file_paths[location.file_id]
+            : "unknown";
+        const auto span = location.file_id < files.size()
+            ? files[location.file_id].tokens.source_span(location)
+            : SourceSpan{};
+        info.start_line = span.start_line;
+        info.end_line = span.end_line;
+        info.snippet_preview = extract_snippet(location.file_id, span.start_line, sources);
+        return info;
+    }
+
     std::string extract_snippet(
         uint32_t file_id,
         uint32_t start_line,
-        const std::map<uint32_t, std::string>& sources
+        const std::map<uint32_t, std::string_view>& sources
     ) {
         auto it = sources.find(file_id);
         if (it == sources.end()) {
@@ -458,10 +566,10 @@ private:
         uint32_t line_num = 1;
         while (pos < source.size()) {
             size_t end = source.find('\n', pos);
-            if (end == std::string::npos) end = source.size();
+            if (end == std::string_view::npos) end = source.size();
 
             if (line_num >= start_line && line_num < start_line + 3) {
-                std::string line = source.substr(pos, end - pos);
+                std::string line(source.substr(pos, end - pos));
                 // Truncate long lines
                 if (line.size() > 60) {
                     line = line.substr(0, 57) + "...";
@@ -7,6 +7,7 @@
 #include <cstring>
 #include <iostream>
 #include <filesystem>
+#include <mutex>
 
 namespace aegis::server {
 
@@ -197,8 +198,17 @@ void UDSServer::cleanup() {
 std::unique_ptr<UDSServer> create_aegis_server(const UDSServer::Config& config) {
     auto server = std::make_unique<UDSServer>(config);
 
+    // Detector kept alive between incremental 'analyze' calls, keyed by
+    // the request parameters so a different root or config starts over
+    struct ResidentDetector {
+        std::mutex mutex;
+        std::string key;
+        std::unique_ptr<SimilarityDetector> detector;
+    };
+    auto resident = std::make_shared<ResidentDetector>();
+
     // Register 'analyze' method
-    server->register_method("analyze", [](const json& params) -> json {
+    server->register_method("analyze", [resident](const json& params) -> json {
         std::string root = params.value("root", "");
         if (root.empty()) {
             throw std::runtime_error("Missing 'root' parameter");
@@ -224,6 +234,37 @@ std::unique_ptr<UDSServer> create_aegis_server(const UDSServer::Config& config)
         cfg.similarity_threshold = params.value("min_similarity", 0.7f);
         cfg.num_threads = params.value("threads", 4);
         cfg.detect_type3 = params.value("type3", false);
+        const auto engine = detection_engine_from_string(params.value("engine", std::string("hash")));
+        if (!engine) {
+            throw std::runtime_error("Unknown 'engine' parameter");
+        }
+        cfg.engine = *engine;
+        cfg.use_winnowing = params.value("winnow", false);
+        cfg.winnow_window = params.value("winnow_window", 0);
+        const auto stop_hashes = stop_hash_mode_from_string(params.value("stop_hashes", std::string("class")));
+        if (!stop_hashes) {
+            throw std::runtime_error("Unknown 'stop_hashes' parameter");
+        }
+        cfg.stop_hash_mode = *stop_hashes;
+        cfg.stop_hash_min_locations = params.value("stop_hash_min", 500);
+        cfg.index_path = params.value("index", std::string());
+        cfg.use_lsh_prefilter = params.value("lsh", false);
+        cfg.minhash_signature_size = params.value("minhash_size", 128);
+        cfg.lsh_bands = params.value("lsh_bands", 32);
+        cfg.lsh_min_similarity = params.value("lsh_min_similarity", 0.3);
+        cfg.memory_budget_bytes = params.value("memory_budget_bytes", size_t{0});
+        cfg.spill_dir = params.value("spill_dir", std::string());
+
+        // Incremental runs reuse the previous state and only redo changed files
+        if (params.value("incremental", false)) {
+            std::lock_guard<std::mutex> lock(resident->mutex);
+            const auto key = params.dump();
+            if (!resident->detector || resident->key != key) {
+                resident->detector = std::make_unique<SimilarityDetector>(cfg);
+                resident->key = key;
+            }
+            return resident->detector->analyze_incremental(root).to_json();
+        }
 
         // Run analysis
         SimilarityDetector detector(cfg);
@@ -233,6 +274,139 @@ std::unique_ptr<UDSServer> create_aegis_server(const UDSServer::Config& config)
         return report.to_json();
     });
 
+    // Register 'save_index' method
+    server->register_method("save_index", [](const json& params) -> json {
+        std::string root = params.value("root", "");
+        std::string path = params.value("path", "");
+        if (root.empty() || path.empty()) {
+            throw std::runtime_error("Missing 'root' or 'path' parameter");
+        }
+
+        std::vector<std::string> extensions;
+        if (params.contains("extensions")) {
+            for (const auto& ext : params["extensions"]) {
+                extensions.push_back(ext.get<std::string>());
+            }
+        }
+        if (extensions.empty()) {
+            extensions = {".py"};
+        }
+
+        // Settings that shape the index; analyze must use the same ones
+        DetectorConfig cfg;
+        cfg.extensions = extensions;
+        cfg.window_size = params.value("window_size", 10);
+        cfg.min_clone_tokens = params.value("min_tokens", 30);
+        cfg.num_threads = params.value("threads", 4);
+        cfg.use_winnowing = params.value("winnow", false);
+        cfg.winnow_window = params.value("winnow_window", 0);
+        const auto stop_hashes = stop_hash_mode_from_string(params.value("stop_hashes", std::string("class")));
+        if (!stop_hashes) {
+            throw std::runtime_error("Unknown 'stop_hashes' parameter");
+        }
+        cfg.stop_hash_mode = *stop_hashes;
+        cfg.stop_hash_min_locations = params.value("stop_hash_min", 500);
+
+        SimilarityDetector detector(cfg);
+        const auto stats = detector.write_index(root, path);
+
+        return {
+            {"path", path},
+            {"files", stats.total_files},
+            {"hashes", stats.total_hashes},
+            {"locations", stats.total_locations}
+        };
+    });
+
+    // Detector holding a mapped saved index for 'query_snippet', keyed by
+    // the index path and settings
+    auto query_resident = std::make_shared<ResidentDetector>();
+
+    // Register 'query_snippet' method
+    server->register_method("query_snippet", [resident, query_resident](const json& params) -> json {
+        const std::string code = params.value("code", "");
+        if (code.empty()) {
+            throw std::runtime_error("Missing 'code' parameter");
+        }
+        const auto language = language_from_string(params.value("language", std::string("python")));
+        if (!language) {
+            throw std::runtime_error("Unknown 'language' parameter");
+        }
+        const size_t max_results = params.value("max_results", 50);
+
+        SnippetQueryResult result;
+        const std::string index_path = params.value("index", "");
+        if (index_path.empty()) {
+            // Probe the index kept by the last incremental 'analyze'
+            std::lock_guard<std::mutex> lock(resident->mutex);
+            if (!resident->detector) {
+                throw std::runtime_error("No resident index: run 'analyze' with 'incremental' or pass 'index'");
+            }
+            result = resident->detector->query(code, *language);
+        } else {
+            // Settings must match the ones the index was saved with
+            DetectorConfig cfg;
+            cfg.index_path = index_path;
+            cfg.window_size = params.value("window_size", 10);
+            cfg.min_clone_tokens = params.value("min_tokens", 30);
+            cfg.use_winnowing = params.value("winnow", false);
+            cfg.winnow_window = params.value("winnow_window", 0);
+            const auto stop_hashes = stop_hash_mode_from_string(params.value("stop_hashes", std::string("class")));
+            if (!stop_hashes) {
+                throw std::runtime_error("Unknown 'stop_hashes' parameter");
+            }
+            cfg.stop_hash_mode = *stop_hashes;
+            cfg.stop_hash_min_locations = params.value("stop_hash_min", 500);
+
+            auto key_params = params;
+            for (const auto* name : {"code", "language", "max_results"}) {
+                key_params.erase(name);
+            }
+            std::lock_guard<std::mutex> lock(query_resident->mutex);
+            const auto key = key_params.dump();
+            if (!query_resident->detector || query_resident->key != key) {
+                query_resident->detector = std::make_unique<SimilarityDetector>(cfg);
+                query_resident->key = key;
+            }
+            result = query_resident->detector->query(code, *language);
+        }
+
+        if (result.matches.size() > max_results) {
+            result.matches.resize(max_results);
+        }
+        return result.to_json();
+    });
+
+    // Register 'load_index' method
+    server->register_method("load_index", [](const json& params) -> json {
+        std::string path = params.value("path", "");
+        if (path.empty()) {
+            throw std::runtime_error("Missing 'path' parameter");
+        }
+
+        IndexFileInfo info;
+        const auto index = HashIndex::open(path, &info);
+
+        json files = json::array();
+        for (const auto& entry : info.files) {
+            files.push_back({
+                {"path", entry.path},
+                {"content_hash", entry.content_hash},
+                {"mtime", entry.mtime},
+                {"size", entry.size}
+            });
+        }
+
+        return {
+            {"path", path},
+            {"config_fingerprint", info.config_fingerprint},
+            {"files", files},
+            {"hashes", index.hash_count()},
+            {"locations", index.location_count()},
+            {"mapped_bytes", index.memory_bytes()}
+        };
+    });
+
     // Register the 'file_tree' method
     server->register_method("file_tree", [](const json& params) -> json {
         std::string root = params.value("root", "");
@@ -287,6 +461,19 @@ std::unique_ptr<UDSServer> create_aegis_server(const UDSServer::Config& config)
         cfg.similarity_threshold = params.value("min_similarity", 0.7f);
         cfg.detect_type3 = params.value("type3", false);
         cfg.max_gap_tokens = params.value("max_gap", 5);
+        const auto engine = detection_engine_from_string(params.value("engine", std::string("hash")));
+        if (!engine) {
+            throw std::runtime_error("Unknown 'engine' parameter");
+        }
+        cfg.engine = *engine;
+        cfg.use_winnowing = params.value("winnow", false);
+        cfg.winnow_window = params.value("winnow_window", 0);
+        const auto stop_hashes = stop_hash_mode_from_string(params.value("stop_hashes", std::string("class")));
+        if (!stop_hashes) {
+            throw std::runtime_error("Unknown 'stop_hashes' parameter");
+        }
+        cfg.stop_hash_mode = *stop_hashes;
+        cfg.stop_hash_min_locations = params.value("stop_hash_min", 500);
 
         // Run comparison
         SimilarityDetector detector(cfg);
@@ -37,6 +37,9 @@ struct ServerConfig {
  *
  * Supported methods:
  * - analyze: Run similarity analysis on a directory
+ * - save_index: Build and save the hash index of a directory
+ * - query_snippet: Find clones of a code snippet in a resident or saved index
+ * - load_index: Map a saved index and describe its contents
  * - file_tree: Get file tree for a directory
  * - shutdown: Gracefully stop the server
  */
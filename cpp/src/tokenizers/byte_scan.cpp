@@ -0,0 +1,225 @@
+#include "tokenizers/byte_scan.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define AEGIS_HAS_SIMD_SCAN 1
+#endif
+
+namespace aegis::similarity {
+
+namespace {
+
+bool in_set(const char c, const std::string_view bytes) {
+    for (const char b : bytes) {
+        if (c == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// First position in [pos, size) whose membership in bytes equals InSet
+template<bool InSet>
+size_t scan_scalar(const char* data, size_t pos, const size_t size, const std::string_view bytes) {
+    while (pos < size && in_set(data[pos], bytes) != InSet) {
+        ++pos;
+    }
+    return pos;
+}
+
+ByteScan::Newlines count_newlines_scalar(const char* data, size_t pos, const size_t end) {
+    ByteScan::Newlines newlines;
+    for (; pos < end; ++pos) {
+        if (data[pos] == '\n') {
+            ++newlines.count;
+            newlines.last = pos;
+        }
+    }
+    return newlines;
+}
+
+#ifdef AEGIS_HAS_SIMD_SCAN
+
+template<bool InSet>
+size_t scan_sse2(const char* data, size_t pos, const size_t size, const std::string_view bytes) {
+    __m128i needles[ByteScan::MAX_BYTES];
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        needles[i] = _mm_set1_epi8(bytes[i]);
+    }
+
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hits = _mm_cmpeq_epi8(chunk, needles[0]);
+        for (size_t i = 1; i < bytes.size(); ++i) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, needles[i]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if constexpr (!InSet) {
+            mask ^= 0xFFFF;
+        }
+        if (mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    return scan_scalar<InSet>(data, pos, size, bytes);
+}
+
+ByteScan::Newlines count_newlines_sse2(const char* data, size_t pos, const size_t end) {
+    ByteScan::Newlines newlines;
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= end; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) {
+            newlines.count += static_cast<size_t>(std::popcount(mask));
+            newlines.last = pos + 31 - static_cast<size_t>(std::countl_zero(mask));
+        }
+    }
+    const auto tail = count_newlines_scalar(data, pos, end);
+    if (tail.count > 0) {
+        newlines.count += tail.count;
+        newlines.last = tail.last;
+    }
+    return newlines;
+}
+
+template<bool InSet>
+__attribute__((target("avx2")))
+size_t scan_avx2(const char* data, size_t pos, const size_t size, const std::string_view bytes) {
+    __m256i needles[ByteScan::MAX_BYTES];
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        needles[i] = _mm256_set1_epi8(bytes[i]);
+    }
+
+    for (; pos + 32 <= size; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i hits = _mm256_cmpeq_epi8(chunk, needles[0]);
+        for (size_t i = 1; i < bytes.size(); ++i) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, needles[i]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if constexpr (!InSet) {
+            mask = ~mask;
+        }
+        if (mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    return scan_sse2<InSet>(data, pos, size, bytes);
+}
+
+__attribute__((target("avx2")))
+ByteScan::Newlines count_newlines_avx2(const char* data, size_t pos, const size_t end) {
+    ByteScan::Newlines newlines;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; pos + 32 <= end; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) {
+            newlines.count += static_cast<size_t>(std::popcount(mask));
+            newlines.last = pos + 31 - static_cast<size_t>(std::countl_zero(mask));
+        }
+    }
+    const auto tail = count_newlines_sse2(data, pos, end);
+    if (tail.count > 0) {
+        newlines.count += tail.count;
+        newlines.last = tail.last;
+    }
+    return newlines;
+}
+
+#endif
+
+ScanKernel resolve(const ScanKernel kernel) {
+#ifdef AEGIS_HAS_SIMD_SCAN
+    if (kernel == ScanKernel::AUTO) {
+        return ByteScan::avx2_supported() ? ScanKernel::AVX2 : ScanKernel::SSE2;
+    }
+    if (kernel == ScanKernel::AVX2 && !ByteScan::avx2_supported()) {
+        return ScanKernel::SSE2;
+    }
+    return kernel;
+#else
+    (void)kernel;
+    return ScanKernel::SCALAR;
+#endif
+}
+
+template<bool InSet>
+size_t scan(const std::string_view text, const size_t pos, const std::string_view bytes, const ScanKernel kernel) {
+    if (pos >= text.size()) {
+        return text.size();
+    }
+    if (bytes.empty()) {
+        return InSet ? text.size() : pos;
+    }
+    const std::string_view set = bytes.substr(0, ByteScan::MAX_BYTES);
+
+    switch (resolve(kernel)) {
+#ifdef AEGIS_HAS_SIMD_SCAN
+        case ScanKernel::AVX2:
+            return scan_avx2<InSet>(text.data(), pos, text.size(), set);
+        case ScanKernel::SSE2:
+            return scan_sse2<InSet>(text.data(), pos, text.size(), set);
+#endif
+        default:
+            return scan_scalar<InSet>(text.data(), pos, text.size(), set);
+    }
+}
+
+}  // anonymous namespace
+
+size_t ByteScan::find_any_of(
+    const std::string_view text,
+    const size_t pos,
+    const std::string_view bytes,
+    const ScanKernel kernel
+) {
+    return scan<true>(text, pos, bytes, kernel);
+}
+
+size_t ByteScan::skip_all_of(
+    const std::string_view text,
+    const size_t pos,
+    const std::string_view bytes,
+    const ScanKernel kernel
+) {
+    return scan<false>(text, pos, bytes, kernel);
+}
+
+ByteScan::Newlines ByteScan::count_newlines(
+    const std::string_view text,
+    const size_t begin,
+    size_t end,
+    const ScanKernel kernel
+) {
+    end = std::min(end, text.size());
+    if (begin >= end) {
+        return {};
+    }
+
+    switch (resolve(kernel)) {
+#ifdef AEGIS_HAS_SIMD_SCAN
+        case ScanKernel::AVX2:
+            return count_newlines_avx2(text.data(), begin, end);
+        case ScanKernel::SSE2:
+            return count_newlines_sse2(text.data(), begin, end);
+#endif
+        default:
+            return count_newlines_scalar(text.data(), begin, end);
+    }
+}
+
+bool ByteScan::avx2_supported() {
+#ifdef AEGIS_HAS_SIMD_SCAN
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+}  // namespace aegis::similarity
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace aegis::similarity {
+
+/**
+ * Kernel used by the ByteScan functions.
+ */
+enum class ScanKernel {
+    AUTO,    // Best available kernel for the CPU
+    SCALAR,  // One byte at a time
+    SSE2,    // 16 bytes per step (x86-64 only)
+    AVX2     // 32 bytes per step (x86-64 with AVX2 only)
+};
+
+/**
+ * Vectorized byte scanning for the tokenizers' skip loops.
+ *
+ * Comments, docstrings, string literals and blank runs are skipped by
+ * searching for the next byte that ends them (a newline, a quote, a
+ * backslash, ...) 16 or 32 bytes at a time instead of stepping through
+ * TokenizerState::advance(). Kernels that the CPU or build lacks fall back
+ * to the scalar one; all kernels return the same results.
+ */
+class ByteScan {
+public:
+    // Most bytes a search set may hold
+    static constexpr size_t MAX_BYTES = 8;
+
+    /**
+     * Find the first byte at or after pos that is one of bytes.
+     *
+     * @param bytes Search set, 1 to MAX_BYTES bytes
+     * @return Its position, or text.size() if there is none
+     */
+    static size_t find_any_of(
+        std::string_view text,
+        size_t pos,
+        std::string_view bytes,
+        ScanKernel kernel = ScanKernel::AUTO
+    );
+
+    /**
+     * Find the first byte at or after pos that is not one of bytes.
+     *
+     * @param bytes Bytes to skip, 1 to MAX_BYTES bytes
+     * @return Its position, or text.size() if there is none
+     */
+    static size_t skip_all_of(
+        std::string_view text,
+        size_t pos,
+        std::string_view bytes,
+        ScanKernel kernel = ScanKernel::AUTO
+    );
+
+    /**
+     * Newlines in a range of text.
+     */
+    struct Newlines {
+        size_t count = 0;
+        size_t last = 0;  // Position of the last one (valid if count > 0)
+    };
+
+    /**
+     * Count the newlines in [begin, end).
+     */
+    static Newlines count_newlines(
+        std::string_view text,
+        size_t begin,
+        size_t end,
+        ScanKernel kernel = ScanKernel::AUTO
+    );
+
+    /**
+     * Check whether the AVX2 kernel can run on this CPU.
+     */
+    static bool avx2_supported();
+};
+
+}  // namespace aegis::similarity
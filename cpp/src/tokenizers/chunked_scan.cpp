@@ -0,0 +1,32 @@
+#include "tokenizers/chunked_scan.hpp"
+#include "tokenizers/byte_scan.hpp"
+#include <algorithm>
+
+namespace aegis::similarity {
+
+std::vector<ChunkedScan::Piece> ChunkedScan::split(const std::string_view source, const size_t max_pieces) {
+    const size_t count = source.size() < MIN_SOURCE_BYTES ? 1 :
+        std::clamp<size_t>(source.size() / MIN_PIECE_BYTES, 1, std::max<size_t>(max_pieces, 1));
+
+    std::vector<Piece> pieces;
+    pieces.reserve(count);
+    pieces.push_back({0, source.size(), 1});
+
+    for (size_t i = 1; i < count; ++i) {
+        // Cut after the first newline past the even split point
+        const size_t target = source.size() / count * i;
+        auto& last = pieces.back();
+        const size_t newline = ByteScan::find_any_of(source, std::max(target, last.begin), "\n");
+        if (newline + 1 >= source.size()) {
+            break;
+        }
+
+        const size_t begin = newline + 1;
+        const auto newlines = ByteScan::count_newlines(source, last.begin, begin);
+        last.end = begin;
+        pieces.push_back({begin, source.size(), last.line + static_cast<uint32_t>(newlines.count)});
+    }
+    return pieces;
+}
+
+}  // namespace aegis::similarity
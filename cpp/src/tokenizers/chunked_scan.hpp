@@ -0,0 +1,126 @@
+#pragma once
+
+#include "models/clone_types.hpp"
+#include "utils/thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string_view>
+#include <vector>
+
+namespace aegis::similarity {
+
+/**
+ * Tokenizes a large source in pieces on a thread pool.
+ *
+ * The source is cut after newlines into one piece per worker, and each
+ * piece is scanned from the state the tokenizer has at the start of a
+ * line. That guess is wrong where a cut falls inside a comment, string or
+ * directive spanning lines, so the pieces are stitched in order: a piece
+ * is kept only if the scan before it stopped exactly at its start in that
+ * state. Otherwise the scan carries on over the piece sequentially and
+ * its speculative tokens are dropped. Either way the result is the one a
+ * single scan gives.
+ */
+class ChunkedScan {
+public:
+    // Smaller sources are scanned in one go
+    static constexpr size_t MIN_SOURCE_BYTES = 4 * 1024 * 1024;
+    // Smallest piece worth a task
+    static constexpr size_t MIN_PIECE_BYTES = 1024 * 1024;
+
+    /**
+     * A range of the source that starts at the beginning of a line.
+     */
+    struct Piece {
+        size_t begin = 0;
+        size_t end = 0;
+        uint32_t line = 1;  // Line number at begin
+    };
+
+    /**
+     * Cut a source into at most max_pieces pieces of similar size.
+     * Sources below MIN_SOURCE_BYTES stay in one piece.
+     */
+    static std::vector<Piece> split(std::string_view source, size_t max_pieces);
+
+    /**
+     * Scan a source, in pieces when it is large enough.
+     *
+     * Must not be called from a pool worker: it waits for the pieces.
+     *
+     * State needs a static line_start(source, pos, line) giving the
+     * state after a newline, and an operator== comparing positions and
+     * scanning context. Metrics needs the line counters and current line
+     * flags of the normalizers' LineMetrics. scan(state, metrics, result,
+     * end) runs the tokenizer loop until state.pos >= end.
+     */
+    template<typename State, typename Metrics, typename Scan>
+    static void run(
+        std::string_view source,
+        ThreadPool& pool,
+        State& state,
+        Metrics& metrics,
+        TokenizedFile& result,
+        Scan&& scan
+    ) {
+        const auto pieces = split(source, pool.size() + 1);
+        if (pieces.size() < 2) {
+            scan(state, metrics, result, source.size());
+            return;
+        }
+
+        // Pieces after the first are scanned on the pool, into default
+        // memory since the caller's resource may not be thread-safe
+        struct Speculation {
+            State state;
+            Metrics metrics;
+            TokenizedFile tokens;
+        };
+        std::vector<Speculation> speculations(pieces.size());
+        std::vector<std::future<void>> futures;
+        futures.reserve(pieces.size() - 1);
+        for (size_t i = 1; i < pieces.size(); ++i) {
+            futures.push_back(pool.submit([&, i]() {
+                auto& speculation = speculations[i];
+                speculation.state = State::line_start(source, pieces[i].begin, pieces[i].line);
+                scan(speculation.state, speculation.metrics, speculation.tokens, pieces[i].end);
+            }));
+        }
+
+        scan(state, metrics, result, pieces[0].end);
+        for (auto& future : futures) {
+            future.get();
+        }
+
+        for (size_t i = 1; i < pieces.size(); ++i) {
+            auto& speculation = speculations[i];
+            if (state == State::line_start(source, pieces[i].begin, pieces[i].line)) {
+                join(metrics, speculation.metrics);
+                result.tokens.append(speculation.tokens.tokens);
+                state = speculation.state;
+            } else if (state.pos < pieces[i].end) {
+                scan(state, metrics, result, pieces[i].end);
+            }
+        }
+    }
+
+private:
+    // Continue metrics with those of the next piece, closing the current line
+    template<typename Metrics>
+    static void join(Metrics& metrics, const Metrics& next) {
+        if (metrics.current_line > 0) {
+            if (metrics.line_has_code) metrics.code_lines++;
+            else if (metrics.line_has_comment) metrics.comment_lines++;
+            else metrics.blank_lines++;
+        }
+        metrics.code_lines += next.code_lines;
+        metrics.comment_lines += next.comment_lines;
+        metrics.blank_lines += next.blank_lines;
+        metrics.current_line = next.current_line;
+        metrics.line_has_code = next.line_has_code;
+        metrics.line_has_comment = next.line_has_comment;
+    }
+};
+
+}  // namespace aegis::similarity
@@ -1,12 +1,16 @@
 #include "tokenizers/cpp_normalizer.hpp"
+#include "tokenizers/chunked_scan.hpp"
+#include "tokenizers/keyword_table.hpp"
 #include <cctype>
 #include <algorithm>
 
 namespace aegis::similarity {
 
-CppNormalizer::CppNormalizer() {
+namespace {
+
+constexpr KeywordTable IDENTIFIER_WORDS{
     // C/C++ keywords
-    keywords_ = {
+    TaggedWords{TokenType::KEYWORD, std::to_array<std::string_view>({
         // Control flow
         "break", "case", "continue", "default", "do", "else", "for", "goto",
         "if", "return", "switch", "while",
@@ -22,18 +26,16 @@ CppNormalizer::CppNormalizer() {
         "private", "protected", "public", "reinterpret_cast", "static_cast",
         "template", "this", "throw", "true", "try", "typeid", "typename",
         "using", "virtual", "wchar_t", "xor", "xor_eq"
-    };
-
+    })},
     // C++11/14/17/20 keywords
-    modern_keywords_ = {
+    TaggedWords{TokenType::KEYWORD, std::to_array<std::string_view>({
         "alignas", "alignof", "char8_t", "char16_t", "char32_t", "concept",
         "consteval", "constexpr", "constinit", "co_await", "co_return",
         "co_yield", "decltype", "final", "noexcept", "nullptr", "override",
         "requires", "static_assert", "thread_local"
-    };
-
+    })},
     // Built-in types
-    builtin_types_ = {
+    TaggedWords{TokenType::TYPE, std::to_array<std::string_view>({
         "int8_t", "int16_t", "int32_t", "int64_t",
         "uint8_t", "uint16_t", "uint32_t", "uint64_t",
         "size_t", "ptrdiff_t", "intptr_t", "uintptr_t",
@@ -47,55 +49,74 @@ CppNormalizer::CppNormalizer() {
         "function", "bind", "reference_wrapper",
         "thread", "mutex", "condition_variable", "future", "promise",
         "atomic", "atomic_flag"
-    };
+    })},
+};
 
-    // Preprocessor directives
-    preprocessor_ = {
-        "include", "define", "undef", "ifdef", "ifndef", "if", "else",
-        "elif", "endif", "error", "warning", "pragma", "line"
-    };
-}
+}  // namespace
 
-TokenizedFile CppNormalizer::normalize(std::string_view source) {
-    TokenizedFile result;
+TokenizedFile CppNormalizer::normalize(std::string_view source, std::pmr::memory_resource* memory) {
+    TokenizedFile result{.path = {}, .tokens = TokenStore(memory)};
     result.path = "";
 
     TokenizerState state;
     state.source = source;
 
-    size_t code_lines = 0;
-    size_t blank_lines = 0;
-    size_t comment_lines = 0;
-    uint32_t current_line = 0;
-    bool line_has_code = false;
-    bool line_has_comment = false;
+    LineMetrics metrics{};
+    scan(state, metrics, result, source.size());
 
-    while (!state.eof()) {
-        handle_line_metrics(state, current_line, code_lines, comment_lines, blank_lines, 
-                          line_has_code, line_has_comment);
+    finalize_metrics(state, metrics, source, result);
+    return result;
+}
+
+TokenizedFile CppNormalizer::normalize(std::string_view source, std::pmr::memory_resource* memory, ThreadPool& pool) {
+    TokenizedFile result{.path = {}, .tokens = TokenStore(memory)};
+
+    TokenizerState state;
+    state.source = source;
+
+    LineMetrics metrics{};
+    ChunkedScan::run(source, pool, state, metrics, result,
+        [this](TokenizerState& s, LineMetrics& m, TokenizedFile& r, const size_t end) {
+            scan(s, m, r, end);
+        });
+
+    finalize_metrics(state, metrics, source, result);
+    return result;
+}
+
+void CppNormalizer::scan(TokenizerState& state, LineMetrics& metrics, TokenizedFile& result, const size_t end) {
+    while (state.pos < end) {
+        handle_line_metrics(state, metrics);
 
         if (skip_whitespace_and_newline(state)) continue;
 
-        if (process_preprocessor(state, line_has_code, result)) continue;
-        
-        if (process_comment(state, line_has_comment)) continue;
+        if (process_preprocessor(state, metrics.line_has_code, result)) continue;
+
+        if (process_comment(state, metrics.line_has_comment)) continue;
 
-        if (process_string_literal(state, result, line_has_code)) continue;
+        if (process_string_literal(state, result, metrics.line_has_code)) continue;
 
-        if (process_number(state, result, line_has_code)) continue;
+        if (process_number(state, result, metrics.line_has_code)) continue;
 
-        if (process_identifier(state, result, line_has_code)) continue;
+        if (process_identifier(state, result, metrics.line_has_code)) continue;
 
-        if (process_operator(state, result, line_has_code)) continue;
+        if (process_operator(state, result, metrics.line_has_code)) continue;
 
         // Unknown - skip
         state.advance();
     }
+}
 
+void CppNormalizer::finalize_metrics(const TokenizerState& state, const LineMetrics& metrics,
+                                     std::string_view source, TokenizedFile& result) {
     // Handle final line
-    if (current_line > 0) {
-        if (line_has_code) code_lines++;
-        else if (line_has_comment) comment_lines++;
+    uint32_t code_lines = metrics.code_lines;
+    uint32_t comment_lines = metrics.comment_lines;
+    uint32_t blank_lines = metrics.blank_lines;
+
+    if (metrics.current_line > 0) {
+        if (metrics.line_has_code) code_lines++;
+        else if (metrics.line_has_comment) comment_lines++;
         else blank_lines++;
     }
 
@@ -104,8 +125,6 @@ TokenizedFile CppNormalizer::normalize(std::string_view source) {
     result.code_lines = code_lines;
     result.blank_lines = blank_lines;
     result.comment_lines = comment_lines;
-
-    return result;
 }
 
 NormalizedToken CppNormalizer::parse_string(TokenizerState& state) {
@@ -130,6 +149,13 @@ NormalizedToken CppNormalizer::parse_string(TokenizerState& state) {
 
     std::string value;
     while (!state.eof()) {
+        const size_t run_end = ByteScan::find_any_of(state.source, state.pos, "\"\\\n");
+        value.append(state.source.substr(state.pos, run_end - state.pos));
+        state.advance_to(run_end);
+        if (state.eof()) {
+            break;
+        }
+
         char c = state.peek();
 
         if (c == '"') {
@@ -185,6 +211,13 @@ NormalizedToken CppNormalizer::parse_raw_string(TokenizerState& state) {
 
     std::string value;
     while (!state.eof()) {
+        const size_t run_end = ByteScan::find_any_of(state.source, state.pos, ")");
+        value.append(state.source.substr(state.pos, run_end - state.pos));
+        state.advance_to(run_end);
+        if (state.eof()) {
+            break;
+        }
+
         // Check for end marker
         bool found_end = true;
         for (size_t i = 0; i < end_marker.size() && found_end; i++) {
@@ -301,30 +334,22 @@ NormalizedToken CppNormalizer::parse_identifier_or_keyword(TokenizerState& state
     tok.line = state.line;
     tok.column = state.column;
 
-    std::string value;
     const size_t start_pos = state.pos;
 
     while (!state.eof() && is_identifier_char(state.peek())) {
-        value += state.advance();
+        state.advance();
     }
 
-    tok.length = static_cast<uint16_t>(state.pos - start_pos);
+    const std::string_view value = state.source.substr(start_pos, state.pos - start_pos);
+    tok.length = static_cast<uint16_t>(value.size());
     tok.original_hash = hash_string(value);
+    tok.type = IDENTIFIER_WORDS.classify(value);
 
-    // Check if it's a keyword
-    if (keywords_.contains(value) || modern_keywords_.contains(value)) {
-        tok.type = TokenType::KEYWORD;
+    if (tok.type == TokenType::KEYWORD) {
         tok.normalized_hash = tok.original_hash;
-    }
-    // Check if it's a built-in type
-    else if (builtin_types_.contains(value)) {
-        tok.type = TokenType::TYPE;
-        tok.normalized_hash = hash_placeholder(TokenType::TYPE);
-    }
-    // Regular identifier
-    else {
-        tok.type = TokenType::IDENTIFIER;
-        tok.normalized_hash = hash_placeholder(TokenType::IDENTIFIER);
+    } else {
+        // Built-in types and regular identifiers
+        tok.normalized_hash = hash_placeholder(tok.type);
     }
 
     return tok;
@@ -421,6 +446,11 @@ void CppNormalizer::skip_preprocessor(TokenizerState& state) {
 
     // Skip rest of line (handling line continuations with backslash)
     while (!state.eof()) {
+        state.advance_to(ByteScan::find_any_of(state.source, state.pos, "\n\\"));
+        if (state.eof()) {
+            return;
+        }
+
         char c = state.peek();
 
         if (c == '\n') {
@@ -443,23 +473,21 @@ void CppNormalizer::skip_preprocessor(TokenizerState& state) {
 }
 
 void CppNormalizer::skip_single_line_comment(TokenizerState& state) {
-    while (!state.eof() && state.peek() != '\n') {
-        state.advance();
-    }
+    state.advance_to(ByteScan::find_any_of(state.source, state.pos, "\n"));
 }
 
 void CppNormalizer::skip_multi_line_comment(TokenizerState& state) {
     state.advance();  // Skip /
     state.advance();  // Skip *
 
-    while (!state.eof()) {
-        if (state.peek() == '*' && state.peek_next() == '/') {
-            state.advance();
-            state.advance();
-            break;
-        }
-        state.advance();
+    // Find the '/' of "*/": doc comments are full of '*' but rarely contain '/'
+    const size_t content_start = state.pos;
+    size_t slash = ByteScan::find_any_of(state.source, content_start, "/");
+    while (slash < state.source.size() &&
+           (slash == content_start || state.source[slash - 1] != '*')) {
+        slash = ByteScan::find_any_of(state.source, slash + 1, "/");
     }
+    state.advance_to(std::min(slash + 1, state.source.size()));
 }
 
 bool CppNormalizer::is_identifier_start(char c) {
@@ -499,18 +527,16 @@ bool CppNormalizer::is_operator_char(char c) {
 // Helper implementations
 namespace aegis::similarity {
 
-void CppNormalizer::handle_line_metrics(TokenizerState& state, uint32_t& current_line,
-                         size_t& code_lines, size_t& comment_lines, size_t& blank_lines,
-                         bool& line_has_code, bool& line_has_comment) const {
-    if (state.line != current_line) {
-        if (current_line > 0) {
-            if (line_has_code) code_lines++;
-            else if (line_has_comment) comment_lines++;
-            else blank_lines++;
+void CppNormalizer::handle_line_metrics(const TokenizerState& state, LineMetrics& metrics) {
+    if (state.line != metrics.current_line) {
+        if (metrics.current_line > 0) {
+            if (metrics.line_has_code) metrics.code_lines++;
+            else if (metrics.line_has_comment) metrics.comment_lines++;
+            else metrics.blank_lines++;
         }
-        current_line = state.line;
-        line_has_code = false;
-        line_has_comment = false;
+        metrics.current_line = state.line;
+        metrics.line_has_code = false;
+        metrics.line_has_comment = false;
     }
 }
 
@@ -519,7 +545,11 @@ bool CppNormalizer::skip_whitespace_and_newline(TokenizerState& state) {
     
     // Whitespace
     if (c == ' ' || c == '\t' || c == '\r') {
+        // Most runs are a single blank; scan only longer ones (indentation)
         state.advance();
+        if (state.peek() == ' ' || state.peek() == '\t' || state.peek() == '\r') {
+            state.advance_to(ByteScan::skip_all_of(state.source, state.pos, " \t\r"));
+        }
         return true;
     }
 
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "tokenizers/token_normalizer.hpp"
-#include <unordered_set>
+#include "tokenizers/byte_scan.hpp"
 
 namespace aegis::similarity {
 
@@ -27,9 +27,9 @@ namespace aegis::similarity {
  */
 class CppNormalizer : public TokenNormalizer {
 public:
-    CppNormalizer();
-
-    TokenizedFile normalize(std::string_view source) override;
+    using TokenNormalizer::normalize;
+    TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory) override;
+    TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory, ThreadPool& pool) override;
 
     std::string_view language_name() const override {
         return "C++";
@@ -40,18 +40,6 @@ public:
     }
 
 private:
-    // C/C++ keywords
-    std::unordered_set<std::string> keywords_;
-
-    // C++11/14/17/20 keywords
-    std::unordered_set<std::string> modern_keywords_;
-
-    // Built-in types
-    std::unordered_set<std::string> builtin_types_;
-
-    // Preprocessor directives
-    std::unordered_set<std::string> preprocessor_;
-
     /**
      * Internal tokenization state.
      */
@@ -62,6 +50,16 @@ private:
         uint16_t column = 1;
         bool at_line_start = true;
 
+        // State after the newline that ends the line before pos
+        static TokenizerState line_start(std::string_view source, size_t pos, uint32_t line) {
+            return {source, pos, line, 1, true};
+        }
+        // Same place in the same source
+        bool operator==(const TokenizerState& other) const {
+            return pos == other.pos && line == other.line && column == other.column &&
+                   at_line_start == other.at_line_start;
+        }
+
         bool eof() const { return pos >= source.size(); }
         char peek() const { return eof() ? '\0' : source[pos]; }
         char peek_next() const {
@@ -85,6 +83,28 @@ private:
             }
             return c;
         }
+        // Same as calling advance() up to target, without visiting each byte
+        void advance_to(size_t target) {
+            const auto newlines = ByteScan::count_newlines(source, pos, target);
+            if (newlines.count > 0) {
+                line += static_cast<uint32_t>(newlines.count);
+                column = static_cast<uint16_t>(target - newlines.last);
+            } else {
+                column = static_cast<uint16_t>(column + (target - pos));
+            }
+            // Only the bytes after the last newline decide at_line_start
+            const size_t line_begin = newlines.count > 0 ? newlines.last + 1 : pos;
+            if (newlines.count > 0) {
+                at_line_start = true;
+            }
+            for (size_t i = target; i > line_begin; --i) {
+                if (source[i - 1] != ' ' && source[i - 1] != '\t') {
+                    at_line_start = false;
+                    break;
+                }
+            }
+            pos = target;
+        }
     };
 
     // Token parsing methods
@@ -98,11 +118,26 @@ private:
     static void skip_single_line_comment(TokenizerState& state);
     static void skip_multi_line_comment(TokenizerState& state);
 
+    /**
+     * Line metrics tracking for code analysis.
+     */
+    struct LineMetrics {
+        uint32_t code_lines = 0;
+        uint32_t blank_lines = 0;
+        uint32_t comment_lines = 0;
+        uint32_t current_line = 0;
+        bool line_has_code = false;
+        bool line_has_comment = false;
+    };
+
+    // Tokenize until state.pos reaches end
+    void scan(TokenizerState& state, LineMetrics& metrics, TokenizedFile& result, size_t end);
+    static void finalize_metrics(const TokenizerState& state, const LineMetrics& metrics,
+                                 std::string_view source, TokenizedFile& result);
+
     // Refactoring Helpers
-    void handle_line_metrics(TokenizerState& state, uint32_t& current_line,
-                             size_t& code_lines, size_t& comment_lines, size_t& blank_lines,
-                             bool& line_has_code, bool& line_has_comment) const;
-                             
+    static void handle_line_metrics(const TokenizerState& state, LineMetrics& metrics);
+
     bool skip_whitespace_and_newline(TokenizerState& state);
     
     bool process_preprocessor(TokenizerState& state, bool& line_has_code, TokenizedFile& result);
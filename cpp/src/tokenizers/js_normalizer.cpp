@@ -1,12 +1,16 @@
 #include "tokenizers/js_normalizer.hpp"
+#include "tokenizers/chunked_scan.hpp"
+#include "tokenizers/keyword_table.hpp"
 #include <cctype>
 #include <algorithm>
 
 namespace aegis::similarity {
 
-JavaScriptNormalizer::JavaScriptNormalizer() {
+namespace {
+
+constexpr KeywordTable IDENTIFIER_WORDS{
     // JavaScript/ES6+ keywords
-    keywords_ = {
+    TaggedWords{TokenType::KEYWORD, std::to_array<std::string_view>({
         // Control flow
         "break", "case", "catch", "continue", "debugger", "default", "do",
         "else", "finally", "for", "if", "return", "switch", "throw", "try",
@@ -26,40 +30,26 @@ JavaScriptNormalizer::JavaScriptNormalizer() {
         // Reserved
         "enum", "implements", "interface", "package", "private", "protected",
         "public"
-    };
-
+    })},
     // TypeScript-specific keywords
-    ts_keywords_ = {
+    TaggedWords{TokenType::KEYWORD, std::to_array<std::string_view>({
         "abstract", "any", "asserts", "bigint", "boolean", "declare",
         "infer", "is", "keyof", "module", "namespace", "never",
         "number", "object", "readonly", "require", "string", "symbol",
         "type", "unique", "unknown"
-    };
-
+    })},
     // Built-in types
-    builtin_types_ = {
+    TaggedWords{TokenType::TYPE, std::to_array<std::string_view>({
         "Array", "Boolean", "Date", "Error", "Function", "JSON", "Map",
         "Math", "Number", "Object", "Promise", "RegExp", "Set", "String",
         "Symbol", "WeakMap", "WeakSet", "BigInt", "ArrayBuffer",
         "DataView", "Float32Array", "Float64Array", "Int8Array",
         "Int16Array", "Int32Array", "Uint8Array", "Uint16Array",
         "Uint32Array", "Uint8ClampedArray"
-    };
-
-    // Operators
-    operators_ = {
-        "+", "-", "*", "/", "%", "**",
-        "=", "+=", "-=", "*=", "/=", "%=", "**=",
-        "==", "!=", "===", "!==", "<", ">", "<=", ">=",
-        "&&", "||", "!", "??", "?.", "?:",
-        "&", "|", "^", "~", "<<", ">>", ">>>",
-        "&=", "|=", "^=", "<<=", ">>=", ">>>=",
-        "&&=", "||=", "?", "?=",  // Split to avoid trigraph warning
-        "++", "--",
-        "(", ")", "[", "]", "{", "}",
-        ",", ";", ":", ".", "...", "=>", "?"
-    };
-}
+    })},
+};
+
+}  // namespace
 
 // -----------------------------------------------------------------------------
 // Normalize helpers (reduce cyclomatic complexity of normalize)
@@ -84,7 +74,11 @@ void JavaScriptNormalizer::update_line_metrics(TokenizerState& state, LineMetric
 
 bool JavaScriptNormalizer::skip_whitespace(TokenizerState& state, char c) {
     if (c == ' ' || c == '\t' || c == '\r') {
+        // Most runs are a single blank; scan only longer ones (indentation)
         state.advance();
+        if (state.peek() == ' ' || state.peek() == '\t' || state.peek() == '\r') {
+            state.advance_to(ByteScan::skip_all_of(state.source, state.pos, " \t\r"));
+        }
         return true;
     }
     return false;
@@ -187,16 +181,38 @@ void JavaScriptNormalizer::finalize_metrics(const TokenizerState& state, const L
 // Main normalize (refactored to use helpers)
 // -----------------------------------------------------------------------------
 
-TokenizedFile JavaScriptNormalizer::normalize(std::string_view source) {
-    TokenizedFile result;
+TokenizedFile JavaScriptNormalizer::normalize(std::string_view source, std::pmr::memory_resource* memory) {
+    TokenizedFile result{.path = {}, .tokens = TokenStore(memory)};
     result.path = "";
 
     TokenizerState state;
     state.source = source;
 
     LineMetrics metrics{};
+    scan(state, metrics, result, source.size());
 
-    while (!state.eof()) {
+    finalize_metrics(state, metrics, source, result);
+    return result;
+}
+
+TokenizedFile JavaScriptNormalizer::normalize(std::string_view source, std::pmr::memory_resource* memory, ThreadPool& pool) {
+    TokenizedFile result{.path = {}, .tokens = TokenStore(memory)};
+
+    TokenizerState state;
+    state.source = source;
+
+    LineMetrics metrics{};
+    ChunkedScan::run(source, pool, state, metrics, result,
+        [this](TokenizerState& s, LineMetrics& m, TokenizedFile& r, const size_t end) {
+            scan(s, m, r, end);
+        });
+
+    finalize_metrics(state, metrics, source, result);
+    return result;
+}
+
+void JavaScriptNormalizer::scan(TokenizerState& state, LineMetrics& metrics, TokenizedFile& result, const size_t end) {
+    while (state.pos < end) {
         update_line_metrics(state, metrics);
         char c = state.peek();
 
@@ -215,9 +231,6 @@ TokenizedFile JavaScriptNormalizer::normalize(std::string_view source) {
         // Unknown - skip
         state.advance();
     }
-
-    finalize_metrics(state, metrics, source, result);
-    return result;
 }
 
 NormalizedToken JavaScriptNormalizer::parse_string(TokenizerState& state) {
@@ -229,8 +242,17 @@ NormalizedToken JavaScriptNormalizer::parse_string(TokenizerState& state) {
     const char quote = state.advance();
     std::string value;
     const size_t start_pos = state.pos;
+    const char stop_bytes[] = {quote, '\\', '\n'};
+    const std::string_view stops(stop_bytes, sizeof(stop_bytes));
 
     while (!state.eof()) {
+        const size_t run_end = ByteScan::find_any_of(state.source, state.pos, stops);
+        value.append(state.source.substr(state.pos, run_end - state.pos));
+        state.advance_to(run_end);
+        if (state.eof()) {
+            break;
+        }
+
         char c = state.peek();
 
         if (c == quote) {
@@ -275,6 +297,13 @@ NormalizedToken JavaScriptNormalizer::parse_template_literal(TokenizerState& sta
     int brace_depth = 0;
 
     while (!state.eof()) {
+        const size_t run_end = ByteScan::find_any_of(state.source, state.pos, "`${}\\");
+        value.append(state.source.substr(state.pos, run_end - state.pos));
+        state.advance_to(run_end);
+        if (state.eof()) {
+            break;
+        }
+
         const char c = state.peek();
 
         if (c == '`' && brace_depth == 0) {
@@ -454,30 +483,22 @@ NormalizedToken JavaScriptNormalizer::parse_identifier_or_keyword(TokenizerState
     tok.line = state.line;
     tok.column = state.column;
 
-    std::string value;
     const size_t start_pos = state.pos;
 
     while (!state.eof() && is_identifier_char(state.peek())) {
-        value += state.advance();
+        state.advance();
     }
 
-    tok.length = static_cast<uint16_t>(state.pos - start_pos);
+    const std::string_view value = state.source.substr(start_pos, state.pos - start_pos);
+    tok.length = static_cast<uint16_t>(value.size());
     tok.original_hash = hash_string(value);
+    tok.type = IDENTIFIER_WORDS.classify(value);
 
-    // Check if it's a keyword
-    if (keywords_.contains(value) || ts_keywords_.contains(value)) {
-        tok.type = TokenType::KEYWORD;
+    if (tok.type == TokenType::KEYWORD) {
         tok.normalized_hash = tok.original_hash;
-    }
-    // Check if it's a built-in type
-    else if (builtin_types_.contains(value)) {
-        tok.type = TokenType::TYPE;
-        tok.normalized_hash = hash_placeholder(TokenType::TYPE);
-    }
-    // Regular identifier
-    else {
-        tok.type = TokenType::IDENTIFIER;
-        tok.normalized_hash = hash_placeholder(TokenType::IDENTIFIER);
+    } else {
+        // Built-in types and regular identifiers
+        tok.normalized_hash = hash_placeholder(tok.type);
     }
 
     return tok;
@@ -568,23 +589,21 @@ NormalizedToken JavaScriptNormalizer::parse_regex(TokenizerState& state) const
 }
 
 void JavaScriptNormalizer::skip_single_line_comment(TokenizerState& state) {
-    while (!state.eof() && state.peek() != '\n') {
-        state.advance();
-    }
+    state.advance_to(ByteScan::find_any_of(state.source, state.pos, "\n"));
 }
 
 void JavaScriptNormalizer::skip_multi_line_comment(TokenizerState& state) {
     state.advance();  // Skip /
     state.advance();  // Skip *
 
-    while (!state.eof()) {
-        if (state.peek() == '*' && state.peek_next() == '/') {
-            state.advance();
-            state.advance();
-            break;
-        }
-        state.advance();
+    // Find the '/' of "*/": doc comments are full of '*' but rarely contain '/'
+    const size_t content_start = state.pos;
+    size_t slash = ByteScan::find_any_of(state.source, content_start, "/");
+    while (slash < state.source.size() &&
+           (slash == content_start || state.source[slash - 1] != '*')) {
+        slash = ByteScan::find_any_of(state.source, slash + 1, "/");
     }
+    state.advance_to(std::min(slash + 1, state.source.size()));
 }
 
 bool JavaScriptNormalizer::is_identifier_start(char c)
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "tokenizers/token_normalizer.hpp"
-#include <unordered_set>
+#include "tokenizers/byte_scan.hpp"
 
 namespace aegis::similarity {
 
@@ -27,9 +27,9 @@ namespace aegis::similarity {
  */
 class JavaScriptNormalizer : public TokenNormalizer {
 public:
-    JavaScriptNormalizer();
-
-    TokenizedFile normalize(std::string_view source) override;
+    using TokenNormalizer::normalize;
+    TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory) override;
+    TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory, ThreadPool& pool) override;
 
     std::string_view language_name() const override {
         return "JavaScript";
@@ -40,18 +40,6 @@ public:
     }
 
 private:
-    // JavaScript/ES6+ keywords
-    std::unordered_set<std::string> keywords_;
-
-    // TypeScript-specific keywords
-    std::unordered_set<std::string> ts_keywords_;
-
-    // Built-in types (for TypeScript)
-    std::unordered_set<std::string> builtin_types_;
-
-    // Operators and punctuation
-    std::unordered_set<std::string> operators_;
-
     /**
      * Internal tokenization state.
      */
@@ -64,6 +52,16 @@ private:
         // Track if we might expect a regex (after certain tokens)
         bool may_be_regex = true;
 
+        // State after the newline that ends the line before pos
+        static TokenizerState line_start(std::string_view source, size_t pos, uint32_t line) {
+            return {source, pos, line, 1, true};
+        }
+        // Same place in the same source, with the same regex expectation
+        bool operator==(const TokenizerState& other) const {
+            return pos == other.pos && line == other.line && column == other.column &&
+                   may_be_regex == other.may_be_regex;
+        }
+
         bool eof() const { return pos >= source.size(); }
         char peek() const { return eof() ? '\0' : source[pos]; }
         char peek_next() const {
@@ -83,6 +81,17 @@ private:
             }
             return c;
         }
+        // Same as calling advance() up to target, without visiting each byte
+        void advance_to(size_t target) {
+            const auto newlines = ByteScan::count_newlines(source, pos, target);
+            if (newlines.count > 0) {
+                line += static_cast<uint32_t>(newlines.count);
+                column = static_cast<uint16_t>(target - newlines.last);
+            } else {
+                column = static_cast<uint16_t>(column + (target - pos));
+            }
+            pos = target;
+        }
     };
 
     // Token parsing methods
@@ -130,6 +139,9 @@ private:
         bool line_has_comment = false;
     };
 
+    // Tokenize until state.pos reaches end
+    void scan(TokenizerState& state, LineMetrics& metrics, TokenizedFile& result, size_t end);
+
     // Normalize helpers (reduce cyclomatic complexity of normalize)
     static void update_line_metrics(TokenizerState& state, LineMetrics& metrics);
     static bool skip_whitespace(TokenizerState& state, char c);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "models/clone_types.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace aegis::similarity {
+
+/**
+ * A word list whose words all get one token type.
+ */
+template<size_t N>
+struct TaggedWords {
+    TokenType type;
+    std::array<std::string_view, N> words;
+};
+
+/**
+ * Perfect hash table from keywords and builtin type names to their token
+ * type, built at compile time.
+ *
+ * The constructor searches for a hash seed that puts every word in its
+ * own slot (a table of 16 slots per word needs a handful of tries), so a
+ * lookup is a length check, one hash of the word, one slot read and one
+ * string compare, without allocating. Words listed more than once keep
+ * the type of their first list.
+ */
+template<size_t N>
+class KeywordTable {
+public:
+    template<size_t... Sizes>
+    consteval explicit KeywordTable(const TaggedWords<Sizes>&... lists) {
+        static_assert((Sizes + ...) == N, "word count must match the table size");
+        size_t count = 0;
+        (append(lists, count), ...);
+
+        for (seed_ = 1; !place_words(); ++seed_) {
+            if (seed_ > MAX_SEED) {
+                throw "no collision-free seed for the keyword table";
+            }
+        }
+    }
+
+    /**
+     * Classify an identifier-like word.
+     *
+     * @return The word's type if it is listed, IDENTIFIER otherwise
+     */
+    [[nodiscard]] constexpr TokenType classify(std::string_view word) const {
+        if (word.size() < min_length_ || word.size() > max_length_) {
+            return TokenType::IDENTIFIER;
+        }
+        const uint8_t slot = slots_[hash(word, seed_) & (SLOTS - 1)];
+        if (slot != 0 && words_[slot - 1] == word) {
+            return types_[slot - 1];
+        }
+        return TokenType::IDENTIFIER;
+    }
+
+private:
+    static_assert(N > 0 && N < 255, "slots hold word index + 1 in a byte");
+
+    static constexpr size_t SLOTS = std::bit_ceil(N) * 16;
+    static constexpr uint64_t MAX_SEED = 1 << 16;
+
+    std::array<std::string_view, N> words_{};
+    std::array<TokenType, N> types_{};
+    std::array<uint8_t, SLOTS> slots_{};  // 0 = empty, otherwise word index + 1
+    uint64_t seed_ = 0;
+    size_t min_length_ = SIZE_MAX;
+    size_t max_length_ = 0;
+
+    static constexpr uint64_t hash(std::string_view word, uint64_t seed) {
+        uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+        for (const char c : word) {
+            h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+        }
+        return h ^ (h >> 29);
+    }
+
+    template<size_t K>
+    consteval void append(const TaggedWords<K>& list, size_t& count) {
+        for (const auto word : list.words) {
+            words_[count] = word;
+            types_[count] = list.type;
+            min_length_ = std::min(min_length_, word.size());
+            max_length_ = std::max(max_length_, word.size());
+            ++count;
+        }
+    }
+
+    // Fill the slots with the current seed; false on a collision
+    consteval bool place_words() {
+        slots_.fill(0);
+        for (size_t i = 0; i < N; ++i) {
+            auto& slot = slots_[hash(words_[i], seed_) & (SLOTS - 1)];
+            if (slot == 0) {
+                slot = static_cast<uint8_t>(i + 1);
+            } else if (words_[slot - 1] != words_[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template<size_t... Sizes>
+KeywordTable(const TaggedWords<Sizes>&...) -> KeywordTable<(Sizes + ...)>;
+
+}  // namespace aegis::similarity
@@ -1,44 +1,36 @@
 #include "tokenizers/python_normalizer.hpp"
 #include "tokenizers/js_normalizer.hpp"
 #include "tokenizers/cpp_normalizer.hpp"
+#include "tokenizers/keyword_table.hpp"
 #include <cctype>
 #include <algorithm>
 
 namespace aegis::similarity {
 
-PythonNormalizer::PythonNormalizer() {
+namespace {
+
+constexpr KeywordTable IDENTIFIER_WORDS{
     // Python 3 keywords
-    keywords_ = {
+    TaggedWords{TokenType::KEYWORD, std::to_array<std::string_view>({
         "False", "None", "True", "and", "as", "assert", "async", "await",
         "break", "class", "continue", "def", "del", "elif", "else", "except",
         "finally", "for", "from", "global", "if", "import", "in", "is",
         "lambda", "nonlocal", "not", "or", "pass", "raise", "return", "try",
         "while", "with", "yield"
-    };
-
+    })},
     // Built-in types (normalized differently for better Type-2 detection)
-    builtin_types_ = {
+    TaggedWords{TokenType::TYPE, std::to_array<std::string_view>({
         "int", "float", "str", "bool", "list", "dict", "set", "tuple",
         "bytes", "bytearray", "complex", "frozenset", "object", "type",
         "range", "slice", "memoryview", "property", "classmethod",
         "staticmethod", "super"
-    };
-
-    // Operators and punctuation
-    operators_ = {
-        "+", "-", "*", "/", "//", "%", "**", "@",
-        "==", "!=", "<", ">", "<=", ">=",
-        "&", "|", "^", "~", "<<", ">>",
-        "=", "+=", "-=", "*=", "/=", "//=", "%=", "**=", "@=",
-        "&=", "|=", "^=", "<<=", ">>=",
-        "(", ")", "[", "]", "{", "}",
-        ",", ":", ";", ".", "->", "...",
-        "\\",  // Line continuation
-    };
-}
-
-TokenizedFile PythonNormalizer::normalize(std::string_view source) {
-    TokenizedFile result;
+    })},
+};
+
+}  // namespace
+
+TokenizedFile PythonNormalizer::normalize(std::string_view source, std::pmr::memory_resource* memory) {
+    TokenizedFile result{.path = {}, .tokens = TokenStore(memory)};
     result.path = "";  // Will be set by caller
 
     TokenizerState state;
@@ -112,7 +104,19 @@ NormalizedToken PythonNormalizer::parse_string(TokenizerState& state) {
     std::string value;
     size_t start_pos = state.pos;
 
+    // Bytes that can end a run of plain string contents (newlines only
+    // matter in single-quoted strings)
+    const char stop_bytes[] = {quote, '\\', '\n'};
+    const std::string_view stops(stop_bytes, triple ? 2 : 3);
+
     while (!state.eof()) {
+        const size_t run_end = ByteScan::find_any_of(state.source, state.pos, stops);
+        value.append(state.source.substr(state.pos, run_end - state.pos));
+        state.advance_to(run_end);
+        if (state.eof()) {
+            break;
+        }
+
         char c = state.peek();
 
         if (triple) {
@@ -288,30 +292,22 @@ NormalizedToken PythonNormalizer::parse_identifier_or_keyword(TokenizerState& st
     tok.line = state.line;
     tok.column = state.column;
 
-    std::string value;
     size_t start_pos = state.pos;
 
     while (!state.eof() && is_identifier_char(state.peek())) {
-        value += state.advance();
+        state.advance();
     }
 
-    tok.length = static_cast<uint16_t>(state.pos - start_pos);
+    const std::string_view value = state.source.substr(start_pos, state.pos - start_pos);
+    tok.length = static_cast<uint16_t>(value.size());
     tok.original_hash = hash_string(value);
+    tok.type = IDENTIFIER_WORDS.classify(value);
 
-    // Check if it's a keyword
-    if (keywords_.count(value)) {
-        tok.type = TokenType::KEYWORD;
+    if (tok.type == TokenType::KEYWORD) {
         tok.normalized_hash = tok.original_hash;  // Keywords keep their hash
-    }
-    // Check if it's a built-in type
-    else if (builtin_types_.count(value)) {
-        tok.type = TokenType::TYPE;
-        tok.normalized_hash = hash_placeholder(TokenType::TYPE);
-    }
-    // Regular identifier
-    else {
-        tok.type = TokenType::IDENTIFIER;
-        tok.normalized_hash = hash_placeholder(TokenType::IDENTIFIER);
+    } else {
+        // Built-in types and regular identifiers
+        tok.normalized_hash = hash_placeholder(tok.type);
     }
 
     return tok;
@@ -387,9 +383,7 @@ NormalizedToken PythonNormalizer::parse_operator(TokenizerState& state) {
 }
 
 void PythonNormalizer::skip_comment(TokenizerState& state) {
-    while (!state.eof() && state.peek() != '\n') {
-        state.advance();
-    }
+    state.advance_to(ByteScan::find_any_of(state.source, state.pos, "\n"));
 }
 
 void PythonNormalizer::skip_docstring(TokenizerState& state, char quote) {
@@ -399,7 +393,15 @@ void PythonNormalizer::skip_docstring(TokenizerState& state, char quote) {
     state.advance();  // Third quote
 
     // Skip until we find the closing triple quotes
+    const char stop_bytes[] = {quote, '\\'};
+    const std::string_view stops(stop_bytes, sizeof(stop_bytes));
+
     while (!state.eof()) {
+        state.advance_to(ByteScan::find_any_of(state.source, state.pos, stops));
+        if (state.eof()) {
+            return;
+        }
+
         char c = state.peek();
 
         // Check for closing triple quotes
@@ -427,7 +429,7 @@ void PythonNormalizer::skip_docstring(TokenizerState& state, char quote) {
     }
 }
 
-bool PythonNormalizer::is_docstring_context(const std::vector<NormalizedToken>& tokens) const {
+bool PythonNormalizer::is_docstring_context(const TokenStore& tokens) const {
     // A docstring appears in these contexts:
     // 1. At the very start of a file (module docstring)
     // 2. Immediately after 'def name(...):' (function docstring)
@@ -439,15 +441,16 @@ bool PythonNormalizer::is_docstring_context(const std::vector<NormalizedToken>&
     }
 
     // Look backwards through tokens, skipping NEWLINE and INDENT
-    for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
-        if (it->type == TokenType::NEWLINE || it->type == TokenType::INDENT) {
+    const auto types = tokens.types();
+    for (size_t i = types.size(); i-- > 0;) {
+        if (types[i] == TokenType::NEWLINE || types[i] == TokenType::INDENT) {
             continue;
         }
 
         // If we find a colon, this could be after def/class
-        if (it->type == TokenType::PUNCTUATION) {
+        if (types[i] == TokenType::PUNCTUATION) {
             // Check if the original hash matches ':'
-            if (it->original_hash == hash_string(":")) {
+            if (tokens.original_hashes()[i] == hash_string(":")) {
                 return true;  // After a colon = docstring context
             }
         }
@@ -482,6 +485,11 @@ bool PythonNormalizer::is_import_statement(const TokenizerState& state) const {
 void PythonNormalizer::skip_to_end_of_line(TokenizerState& state) {
     // Skip everything until newline (handles multi-line imports with backslash)
     while (!state.eof()) {
+        state.advance_to(ByteScan::find_any_of(state.source, state.pos, "\n\\("));
+        if (state.eof()) {
+            return;
+        }
+
         char c = state.peek();
 
         if (c == '\n') {
@@ -505,6 +513,10 @@ void PythonNormalizer::skip_to_end_of_line(TokenizerState& state) {
             // Skip until closing paren
             int depth = 1;
             while (!state.eof() && depth > 0) {
+                state.advance_to(ByteScan::find_any_of(state.source, state.pos, "()"));
+                if (state.eof()) {
+                    break;
+                }
                 char inner = state.peek();
                 if (inner == '(') depth++;
                 else if (inner == ')') depth--;
@@ -575,7 +587,11 @@ void PythonNormalizer::update_line_metrics(TokenizerState& state, LineMetrics& m
 
 bool PythonNormalizer::skip_whitespace(TokenizerState& state, char c) {
     if (c == ' ' || c == '\t') {
+        // Most runs are a single blank; scan only longer ones
         state.advance();
+        if (state.peek() == ' ' || state.peek() == '\t') {
+            state.advance_to(ByteScan::skip_all_of(state.source, state.pos, " \t"));
+        }
         return true;
     }
     return false;
@@ -692,15 +708,16 @@ bool PythonNormalizer::process_operator(TokenizerState& state, char c, Tokenized
 }
 
 void PythonNormalizer::process_indentation(TokenizerState& state, TokenizedFile& result) {
+    const size_t indent_end = ByteScan::skip_all_of(state.source, state.pos, " \t");
     size_t indent = 0;
-    while (!state.eof() && (state.peek() == ' ' || state.peek() == '\t')) {
-        if (state.peek() == '\t') {
+    for (size_t i = state.pos; i < indent_end; ++i) {
+        if (state.source[i] == '\t') {
             indent += 8 - (indent % 8);  // Tab stops at 8
         } else {
             indent++;
         }
-        state.advance();
     }
+    state.advance_to(indent_end);
 
     // Don't emit indent tokens for blank lines or comment-only lines
     if (!state.eof() && state.peek() != '\n' && state.peek() != '#') {
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "tokenizers/token_normalizer.hpp"
-#include <unordered_set>
+#include "tokenizers/byte_scan.hpp"
 #include <regex>
 
 namespace aegis::similarity {
@@ -25,9 +25,8 @@ namespace aegis::similarity {
  */
 class PythonNormalizer : public TokenNormalizer {
 public:
-    PythonNormalizer();
-
-    TokenizedFile normalize(std::string_view source) override;
+    using TokenNormalizer::normalize;
+    TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory) override;
 
     std::string_view language_name() const override {
         return "Python";
@@ -38,15 +37,6 @@ public:
     }
 
 private:
-    // Python keywords
-    std::unordered_set<std::string> keywords_;
-
-    // Python built-in types (treated specially for Type-2 detection)
-    std::unordered_set<std::string> builtin_types_;
-
-    // Operators and punctuation that should be preserved
-    std::unordered_set<std::string> operators_;
-
     /**
      * Line metrics tracking for code analysis.
      */
@@ -89,6 +79,18 @@ private:
             }
             return c;
         }
+        // Same as calling advance() up to target, without visiting each byte
+        void advance_to(size_t target) {
+            const auto newlines = ByteScan::count_newlines(source, pos, target);
+            if (newlines.count > 0) {
+                line += static_cast<uint32_t>(newlines.count);
+                column = static_cast<uint16_t>(target - newlines.last);
+                at_line_start = true;
+            } else {
+                column = static_cast<uint16_t>(column + (target - pos));
+            }
+            pos = target;
+        }
         void skip_whitespace_on_line() {
             while (!eof() && (peek() == ' ' || peek() == '\t')) {
                 advance();
@@ -120,7 +122,7 @@ private:
     void parse_decimal_part(TokenizerState& state, std::string& value);
     void parse_exponent_part(TokenizerState& state, std::string& value);
     void skip_complex_suffix(TokenizerState& state, std::string& value);
-    bool is_docstring_context(const std::vector<NormalizedToken>& tokens) const;
+    bool is_docstring_context(const TokenStore& tokens) const;
     bool is_import_statement(const TokenizerState& state) const;
     void skip_to_end_of_line(TokenizerState& state);
 
@@ -2,12 +2,16 @@
 
 #include "models/clone_types.hpp"
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <functional>
 
 namespace aegis::similarity {
 
+class ThreadPool;
+
 /**
  * Abstract base class for language-specific tokenizers.
  *
@@ -28,9 +32,26 @@ public:
      * Tokenize and normalize source code.
      *
      * @param source The source code to tokenize
+     * @param memory Resource the token columns are allocated from
      * @return TokenizedFile containing normalized tokens and metadata
      */
-    virtual TokenizedFile normalize(std::string_view source) = 0;
+    virtual TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory) = 0;
+
+    TokenizedFile normalize(const std::string_view source) {
+        return normalize(source, std::pmr::get_default_resource());
+    }
+
+    /**
+     * Tokenize and normalize source code, spreading a large source over a
+     * thread pool where the language supports it. The result is the same
+     * as normalize(source, memory).
+     *
+     * Must not be called from one of the pool's workers.
+     */
+    virtual TokenizedFile normalize(std::string_view source, std::pmr::memory_resource* memory, ThreadPool& pool) {
+        (void)pool;
+        return normalize(source, memory);
+    }
 
     /**
      * Get the language name for this normalizer.
@@ -131,6 +152,23 @@ inline const char* language_to_string(Language lang) {
     return "Unknown";
 }
 
+/**
+ * Parse a language name ("python", "javascript", "typescript", "cpp",
+ * "c") or a file extension such as ".py".
+ */
+inline std::optional<Language> language_from_string(std::string_view name) {
+    if (name.starts_with('.')) {
+        const auto language = detect_language(name);
+        return language != Language::UNKNOWN ? std::optional(language) : std::nullopt;
+    }
+    if (name == "python" || name == "py") return Language::PYTHON;
+    if (name == "javascript" || name == "js") return Language::JAVASCRIPT;
+    if (name == "typescript" || name == "ts") return Language::TYPESCRIPT;
+    if (name == "cpp" || name == "c++") return Language::CPP;
+    if (name == "c") return Language::C;
+    return std::nullopt;
+}
+
 /**
  * Factory function to create appropriate normalizer for a language.
  * Returns nullptr if language is not supported.
@@ -0,0 +1,91 @@
+#include "utils/analysis_arena.hpp"
+#include <algorithm>
+
+namespace aegis::similarity {
+
+namespace {
+
+// First heap block of a sub-arena; later blocks grow geometrically
+constexpr size_t INITIAL_BLOCK_BYTES = 64 * 1024;
+
+// Larger requests bypass the pools and are not reused until release
+constexpr size_t LARGEST_POOLED_BYTES = 1024 * 1024;
+
+// Small pool chunks keep size classes a file never reuses from holding
+// much memory
+constexpr size_t MAX_BLOCKS_PER_CHUNK = 8;
+
+}  // anonymous namespace
+
+// =============================================================================
+// HeapResource
+// =============================================================================
+
+void* AnalysisArena::HeapResource::do_allocate(const size_t bytes, const size_t alignment) {
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    blocks.fetch_add(1, std::memory_order_relaxed);
+    const size_t held = this->bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = high_water.load(std::memory_order_relaxed);
+    while (held > peak && !high_water.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {
+    }
+    return p;
+}
+
+void AnalysisArena::HeapResource::do_deallocate(void* p, const size_t bytes, const size_t alignment) {
+    this->bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool AnalysisArena::HeapResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// =============================================================================
+// SubArena
+// =============================================================================
+
+AnalysisArena::SubArena::SubArena(std::pmr::memory_resource* heap)
+    : buffer_(INITIAL_BLOCK_BYTES, heap)
+    , pool_(std::pmr::pool_options{MAX_BLOCKS_PER_CHUNK, LARGEST_POOLED_BYTES}, &buffer_)
+{
+}
+
+void* AnalysisArena::SubArena::do_allocate(const size_t bytes, const size_t alignment) {
+    ++allocations;
+    return pool_.allocate(bytes, alignment);
+}
+
+void AnalysisArena::SubArena::do_deallocate(void* p, const size_t bytes, const size_t alignment) {
+    pool_.deallocate(p, bytes, alignment);
+}
+
+bool AnalysisArena::SubArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// =============================================================================
+// AnalysisArena
+// =============================================================================
+
+std::pmr::memory_resource* AnalysisArena::resource() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& sub_arena = sub_arenas_[std::this_thread::get_id()];
+    if (!sub_arena) {
+        sub_arena = std::make_unique<SubArena>(&heap_);
+    }
+    return sub_arena.get();
+}
+
+AnalysisArena::Stats AnalysisArena::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    for (const auto& [thread, sub_arena] : sub_arenas_) {
+        stats.allocations += sub_arena->allocations;
+    }
+    stats.heap_allocations = heap_.blocks.load(std::memory_order_relaxed);
+    stats.high_water_bytes = heap_.high_water.load(std::memory_order_relaxed);
+    stats.sub_arenas = sub_arenas_.size();
+    return stats;
+}
+
+}  // namespace aegis::similarity
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace aegis::similarity {
+
+/**
+ * Memory for the data of one analysis, released in one shot.
+ *
+ * Every thread that allocates gets its own sub-arena: a pool (so vectors
+ * that grow reuse the blocks they outgrow) over a monotonic buffer that
+ * takes geometrically larger blocks from the heap. A sub-arena is only
+ * used by its thread while the analysis runs, so allocation takes no
+ * lock. Deallocation returns blocks to the pool, and the heap only gets
+ * them back when the arena is destroyed.
+ *
+ * Containers allocated here must not outlive the arena. Copies of
+ * std::pmr containers use the default resource, so copying data out of
+ * the analysis is safe; moving it out is not.
+ */
+class AnalysisArena {
+public:
+    /**
+     * Allocation counters.
+     */
+    struct Stats {
+        size_t allocations = 0;       // Allocations served by the sub-arenas
+        size_t heap_allocations = 0;  // Blocks taken from the heap
+        size_t high_water_bytes = 0;  // Most heap bytes held at once
+        size_t sub_arenas = 0;        // Threads that allocated
+    };
+
+    AnalysisArena() = default;
+
+    AnalysisArena(const AnalysisArena&) = delete;
+    AnalysisArena& operator=(const AnalysisArena&) = delete;
+
+    /**
+     * The calling thread's sub-arena (created on first use).
+     */
+    std::pmr::memory_resource* resource();
+
+    /**
+     * Counters so far; call when no thread is allocating.
+     */
+    [[nodiscard]] Stats stats() const;
+
+private:
+    // Heap blocks for the monotonic buffers, counted across threads
+    class HeapResource final : public std::pmr::memory_resource {
+    public:
+        std::atomic<size_t> blocks{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<size_t> high_water{0};
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    class SubArena final : public std::pmr::memory_resource {
+    public:
+        explicit SubArena(std::pmr::memory_resource* heap);
+
+        size_t allocations = 0;
+
+    private:
+        std::pmr::monotonic_buffer_resource buffer_;
+        std::pmr::unsynchronized_pool_resource pool_;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    // Declared before the sub-arenas, which return their blocks to it
+    HeapResource heap_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::thread::id, std::unique_ptr<SubArena>> sub_arenas_;
+};
+
+}  // namespace aegis::similarity
@@ -1,23 +1,55 @@
 #include "utils/file_utils.hpp"
 #include <algorithm>
+#include <cstring>
 #include <regex>
 
 namespace aegis::similarity {
 
 std::optional<std::string> FileUtils::read_file(const std::filesystem::path& path) {
-    std::ifstream file(path, std::ios::binary);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file) {
         return std::nullopt;
     }
 
-    std::ostringstream ss;
-    ss << file.rdbuf();
+    // Read straight into a string of the file's size (no stream copy)
+    const auto end = file.tellg();
+    if (end < 0) {
+        return std::nullopt;
+    }
+    std::string contents(static_cast<size_t>(end), '\0');
+    file.seekg(0);
+    file.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+    contents.resize(static_cast<size_t>(file.gcount()));
 
-    if (file.fail() && !file.eof()) {
+    if (file.bad()) {
         return std::nullopt;
     }
+    return contents;
+}
 
-    return ss.str();
+uint64_t FileUtils::content_hash(const std::string_view content) {
+    constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+    const auto mix = [](uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x;
+    };
+
+    // Eight bytes per step; the tail is zero-padded and the length mixed in
+    uint64_t hash = content.size() * MULTIPLIER;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= content.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, content.data() + i, sizeof(word));
+        hash = (hash ^ mix(word)) * MULTIPLIER;
+    }
+    if (i < content.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, content.data() + i, content.size() - i);
+        hash = (hash ^ mix(word)) * MULTIPLIER;
+    }
+    return mix(hash);
 }
 
 std::string FileUtils::get_extension(const std::filesystem::path& path) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -23,6 +24,14 @@ public:
      */
     static std::optional<std::string> read_file(const std::filesystem::path& path);
 
+    /**
+     * Fast 64-bit content hash used to detect changed files.
+     *
+     * Not cryptographic; only meant to tell whether a file still has the
+     * contents it was indexed with.
+     */
+    static uint64_t content_hash(std::string_view content);
+
     /**
      * Get file extension (including dot).
      */
@@ -0,0 +1,50 @@
+#include "utils/mapped_file.hpp"
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace aegis::similarity {
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path.string());
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + path.string());
+    }
+
+    const auto size = static_cast<size_t>(info.st_size);
+    const std::byte* data = nullptr;
+    if (size > 0) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + path.string());
+        }
+        data = static_cast<const std::byte*>(mapped);
+    }
+    ::close(fd);  // The mapping stays valid without the descriptor
+
+    return std::shared_ptr<const MappedFile>(new MappedFile(data, size));
+}
+
+MappedFile::MappedFile(const std::byte* data, const size_t size)
+    : data_(data)
+    , size_(size)
+{
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+}  // namespace aegis::similarity
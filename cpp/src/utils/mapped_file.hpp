@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace aegis::similarity {
+
+/**
+ * Read-only memory mapping of a whole file (POSIX mmap).
+ *
+ * Pages are loaded on demand by the OS and shared with the page cache, so
+ * opening even a large file is cheap. Shared ownership lets several
+ * objects keep views into the mapping alive.
+ */
+class MappedFile {
+public:
+    /**
+     * Map a file read-only.
+     *
+     * @param path File to map
+     * @return The mapping
+     * @throws std::runtime_error if the file cannot be opened or mapped
+     */
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path);
+
+    ~MappedFile();
+
+    // Non-copyable, non-movable (views point into the mapping)
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    [[nodiscard]] const std::byte* data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+    MappedFile(const std::byte* data, size_t size);
+
+    const std::byte* data_;
+    size_t size_;
+};
+
+}  // namespace aegis::similarity
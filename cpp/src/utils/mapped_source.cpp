@@ -0,0 +1,42 @@
+#include "utils/mapped_source.hpp"
+#include "utils/file_utils.hpp"
+
+namespace aegis::similarity {
+
+std::optional<MappedSource> MappedSource::open(
+    const std::filesystem::path& path,
+    const size_t mmap_min_bytes
+) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+
+    MappedSource source;
+    if (size >= mmap_min_bytes && size > 0) {
+        try {
+            source.mapping_ = MappedFile::open(path);
+            source.view_ = std::string_view(
+                reinterpret_cast<const char*>(source.mapping_->data()), source.mapping_->size());
+            return source;
+        } catch (const std::exception&) {
+            // Not mappable (e.g. a pipe or special file): read it instead
+        }
+    }
+
+    auto contents = FileUtils::read_file(path);
+    if (!contents) {
+        return std::nullopt;
+    }
+    return from_string(std::move(*contents));
+}
+
+MappedSource MappedSource::from_string(std::string contents) {
+    MappedSource source;
+    source.owned_ = std::make_shared<const std::string>(std::move(contents));
+    source.view_ = *source.owned_;
+    return source;
+}
+
+}  // namespace aegis::similarity
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "utils/mapped_file.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace aegis::similarity {
+
+/**
+ * Read-only contents of a source file, handed out as a string_view.
+ *
+ * Files of at least mmap_min_bytes are memory-mapped, so the tokenizers
+ * and snippet extraction read the page cache directly instead of a heap
+ * copy. Smaller files are read into one owned buffer, where a mapping
+ * would cost more in syscalls and page-table entries than the copy.
+ * Copies share the contents.
+ */
+class MappedSource {
+public:
+    // Default size from which open() maps instead of reading
+    static constexpr size_t MMAP_MIN_BYTES = 16 * 1024;
+
+    MappedSource() = default;
+
+    /**
+     * Load a file, mapping it if it has at least mmap_min_bytes.
+     *
+     * A mapped file that is truncated while still in use faults on access,
+     * so contents kept across scans should be loaded with
+     * mmap_min_bytes = SIZE_MAX (always read).
+     *
+     * @param path File to load
+     * @param mmap_min_bytes Smallest file size that is mapped
+     * @return The contents, or nullopt if the file cannot be read
+     */
+    static std::optional<MappedSource> open(
+        const std::filesystem::path& path,
+        size_t mmap_min_bytes = MMAP_MIN_BYTES
+    );
+
+    /**
+     * Wrap contents already in memory.
+     */
+    static MappedSource from_string(std::string contents);
+
+    [[nodiscard]] std::string_view view() const { return view_; }
+    [[nodiscard]] size_t size() const { return view_.size(); }
+    [[nodiscard]] bool empty() const { return view_.empty(); }
+
+    /**
+     * Check if the contents are a file mapping rather than a heap buffer.
+     */
+    [[nodiscard]] bool is_mapped() const { return mapping_ != nullptr; }
+
+private:
+    std::shared_ptr<const MappedFile> mapping_;
+    std::shared_ptr<const std::string> owned_;
+    std::string_view view_;
+};
+
+}  // namespace aegis::similarity
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "tokenizers/cpp_normalizer.hpp"
+#include "utils/thread_pool.hpp"
+#include <algorithm>
 
 using namespace aegis::similarity;
 
@@ -260,6 +262,24 @@ TEST_F(CppNormalizerTest, ConditionalCompilation) {
     EXPECT_FALSE(result.tokens.empty());
 }
 
+TEST_F(CppNormalizerTest, DirectiveAfterMultiLineComment) {
+    const std::string padding(80, '*');
+    auto result = normalizer.normalize(
+        "/* Comment " + padding + "\n"
+        "   spanning lines " + padding + " */\n"
+        "  #define LIMIT \\\n"
+        "      100\n"
+        "/* same line */ int x = LIMIT;\n"
+    );
+
+    // The directive and its continuation line are skipped
+    ASSERT_FALSE(result.tokens.empty());
+    EXPECT_EQ(result.tokens[0].type, TokenType::KEYWORD);
+    EXPECT_EQ(result.tokens[0].line, 5);
+    EXPECT_EQ(result.tokens[0].column, 17);
+    EXPECT_EQ(result.total_lines, 5);
+}
+
 // =============================================================================
 // Comments
 // =============================================================================
@@ -420,3 +440,56 @@ constexpr auto sum(const std::vector<T>& values) -> T {
     }
     EXPECT_GE(keyword_count, 5);  // template, constexpr, auto, const, for, return
 }
+
+// =============================================================================
+// Split Tokenization
+// =============================================================================
+
+TEST_F(CppNormalizerTest, LargeSourceSplitMatchesSequential) {
+    const std::string code =
+        "#define CHECK(x) \\\n"
+        "    do { if (!(x)) abort(); } while (0)\n"
+        "static int scale(const std::vector<int>& values, size_t limit) {\n"
+        "    // Sum the values up to limit\n"
+        "    int total = 0x1F; /* start */ const char* name = \"sum\\n\";\n"
+        "    for (size_t i = 0; i < limit; ++i) total += values[i] * 2.5e3;\n"
+        "    return total;\n"
+        "}\n\n";
+    const auto append_code = [&](std::string& source, const size_t bytes) {
+        while (source.size() < bytes) {
+            source += code;
+        }
+    };
+
+    // Five pieces cut near 1.2, 2.4, 3.6 and 4.8 MB: the first two cuts
+    // fall inside a comment, the third inside a raw string
+    std::string source;
+    append_code(source, 1 << 20);
+    source += "/*\n";
+    while (source.size() < (13 << 20) / 5) {
+        source += " * int not_code = 1;\n";
+    }
+    source += " */\n";
+    append_code(source, (17 << 20) / 5);
+    source += "const char* text = R\"x(\n";
+    while (source.size() < 4 << 20) {
+        source += "int not_code = \"1\";\n";
+    }
+    source += ")x\";\n";
+    append_code(source, 6 << 20);
+
+    ThreadPool pool(4);
+    const auto sequential = normalizer.normalize(source);
+    const auto split = normalizer.normalize(source, std::pmr::get_default_resource(), pool);
+
+    EXPECT_TRUE(std::ranges::equal(split.tokens.types(), sequential.tokens.types()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.original_hashes(), sequential.tokens.original_hashes()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.normalized_hashes(), sequential.tokens.normalized_hashes()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.lines(), sequential.tokens.lines()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.columns(), sequential.tokens.columns()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.lengths(), sequential.tokens.lengths()));
+    EXPECT_EQ(split.total_lines, sequential.total_lines);
+    EXPECT_EQ(split.code_lines, sequential.code_lines);
+    EXPECT_EQ(split.comment_lines, sequential.comment_lines);
+    EXPECT_EQ(split.blank_lines, sequential.blank_lines);
+}
@@ -2,9 +2,15 @@
 #include "core/similarity_detector.hpp"
 #include "tokenizers/python_normalizer.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/mapped_source.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <set>
 
 using namespace aegis::similarity;
 
@@ -157,6 +163,353 @@ TEST_F(SimilarityDetectorTest, DetectsType2Clones) {
     EXPECT_TRUE(found_type2) << "Should detect Type-2 clones with renamed identifiers";
 }
 
+TEST_F(SimilarityDetectorTest, ExactCloneAfterExtraLinesIsType1) {
+    const auto root = std::filesystem::temp_directory_path() / "aegis_classify_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    // Same function; b.py has statements (and structural tokens) before it
+    const std::string function =
+        "def process(items, limit):\n"
+        "    total = 0\n"
+        "    for item in items:\n"
+        "        if item.value > limit:\n"
+        "            total += item.value * 2\n"
+        "        else:\n"
+        "            total -= item.weight\n"
+        "    return total\n";
+    std::ofstream(root / "a.py") << function;
+    std::ofstream(root / "b.py") << "import os\nimport sys\n\nLIMIT = 10\n\n\n" << function;
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 20;
+    config.extensions = {".py"};
+
+    auto report = SimilarityDetector(config).analyze(root);
+    std::filesystem::remove_all(root);
+
+    ASSERT_FALSE(report.clones.empty());
+    for (const auto& clone : report.clones) {
+        EXPECT_EQ(clone.type, "Type-1");
+    }
+}
+
+TEST_F(SimilarityDetectorTest, SavedIndexIsReusedWhileFilesAreUnchanged) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_saved_index_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    std::filesystem::copy_file(fixtures_dir / "clone_type1_a.py", root / "a.py");
+    std::filesystem::copy_file(fixtures_dir / "clone_type1_b.py", root / "b.py");
+    const auto index_path = root / "project.aidx";
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 10;
+    config.index_path = index_path.string();
+
+    SimilarityDetector detector(config);
+    const auto built = detector.analyze(root);
+    EXPECT_FALSE(built.performance.index_loaded);
+    EXPECT_TRUE(built.performance.index_save_error.empty());
+    ASSERT_TRUE(std::filesystem::exists(index_path));
+
+    const auto reused = detector.analyze(root);
+    EXPECT_TRUE(reused.performance.index_loaded);
+    EXPECT_GT(built.summary.clone_pairs_found, 0);
+    EXPECT_EQ(reused.summary.clone_pairs_found, built.summary.clone_pairs_found);
+    ASSERT_EQ(reused.clones.size(), built.clones.size());
+    for (size_t i = 0; i < built.clones.size(); ++i) {
+        EXPECT_EQ(reused.clones[i].to_json(), built.clones[i].to_json());
+    }
+
+    // Different index settings or changed contents force a rebuild
+    auto other_config = config;
+    other_config.window_size = 6;
+    EXPECT_FALSE(SimilarityDetector(other_config).analyze(root).performance.index_loaded);
+
+    std::ofstream(root / "b.py", std::ios::app) << "\n# edited\n";
+    EXPECT_FALSE(detector.analyze(root).performance.index_loaded);
+    EXPECT_TRUE(detector.analyze(root).performance.index_loaded);
+
+    // A failed save is reported, not thrown
+    auto unwritable_config = config;
+    unwritable_config.index_path = (root / "missing_dir" / "project.aidx").string();
+    const auto unsaved = SimilarityDetector(unwritable_config).analyze(root);
+    EXPECT_FALSE(unsaved.performance.index_save_error.empty());
+    EXPECT_TRUE(unsaved.to_json()["performance"].contains("index_save_error"));
+    EXPECT_FALSE(built.to_json()["performance"].contains("index_save_error"));
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_F(SimilarityDetectorTest, IncrementalAnalysisMatchesFullRun) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_incremental_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "pkg");
+    for (const auto* name : {"clone_type1_a.py", "clone_type1_b.py", "clone_type2_a.py",
+                             "clone_type2_b.py", "clone_type3_a.py", "no_clones.py"}) {
+        std::filesystem::copy_file(fixtures_dir / name, root / "pkg" / name);
+    }
+
+    // Timing and memory fields legitimately differ between runs
+    const auto comparable = [](const SimilarityReport& report) {
+        auto json = report.to_json();
+        json.erase("timing");
+        json.erase("performance");
+        json["summary"].erase("analysis_time_ms");
+        return json;
+    };
+
+    // Default stop hashes, and a tiny threshold that turns many windows
+    // into classes (or samples)
+    const std::vector<std::pair<size_t, StopHashMode>> cases = {
+        {500, StopHashMode::CLONE_CLASS},
+        {3, StopHashMode::CLONE_CLASS},
+        {3, StopHashMode::SAMPLE},
+    };
+    for (const auto& [stop_hash_min, stop_hash_mode] : cases) {
+        SCOPED_TRACE("stop_hash_min=" + std::to_string(stop_hash_min) +
+                     " mode=" + stop_hash_mode_to_string(stop_hash_mode));
+        DetectorConfig config;
+        config.window_size = 5;
+        config.min_clone_tokens = 10;
+        config.num_threads = 2;
+        config.stop_hash_min_locations = stop_hash_min;
+        config.stop_hash_mode = stop_hash_mode;
+
+        SimilarityDetector incremental(config);
+        const auto expect_full_run_result = [&] {
+            const auto updated = incremental.analyze_incremental(root);
+            const auto full = SimilarityDetector(config).analyze(root);
+            EXPECT_GT(full.summary.clone_pairs_found, 0);
+            EXPECT_EQ(comparable(updated), comparable(full));
+        };
+
+        expect_full_run_result();
+        expect_full_run_result();  // Nothing changed
+
+        // Edited file: gains a copy of another file's code
+        {
+            std::ifstream extra(fixtures_dir / "clone_type3_b.py");
+            std::ofstream out(root / "pkg" / "no_clones.py", std::ios::app);
+            out << "\n" << extra.rdbuf();
+        }
+        expect_full_run_result();
+
+        // New file sorting between existing ones, and a new directory
+        std::filesystem::copy_file(fixtures_dir / "clone_type1_a.py", root / "pkg" / "clone_type1_ab.py");
+        std::filesystem::create_directories(root / "a");
+        std::filesystem::copy_file(fixtures_dir / "clone_type2_b.py", root / "a" / "first.py");
+        expect_full_run_result();
+
+        // Deleted files
+        std::filesystem::remove(root / "pkg" / "clone_type1_b.py");
+        std::filesystem::remove(root / "a" / "first.py");
+        expect_full_run_result();
+
+        // Restore the tree for the next configuration
+        std::filesystem::remove(root / "pkg" / "clone_type1_ab.py");
+        std::filesystem::copy_file(fixtures_dir / "clone_type1_b.py", root / "pkg" / "clone_type1_b.py");
+        std::filesystem::copy_file(fixtures_dir / "no_clones.py", root / "pkg" / "no_clones.py",
+                                   std::filesystem::copy_options::overwrite_existing);
+        expect_full_run_result();
+    }
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_F(SimilarityDetectorTest, QueryFindsSnippetInResidentIndex) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_query_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    for (const auto* name : {"clone_type2_a.py", "clone_type2_b.py", "no_clones.py"}) {
+        std::filesystem::copy_file(fixtures_dir / name, root / name);
+    }
+    const auto index_path = root / "project.aidx";
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 10;
+
+    // filter_items from the fixtures with every name changed
+    const std::string snippet =
+        "def keep_large(rows, limit):\n"
+        "    kept = []\n"
+        "    for row in rows:\n"
+        "        if row.value > limit:\n"
+        "            kept.append(row)\n"
+        "    return kept\n";
+
+    SimilarityDetector detector(config);
+    EXPECT_THROW(detector.query(snippet, Language::PYTHON), std::runtime_error);
+
+    detector.analyze_incremental(root);
+    const auto result = detector.query(snippet, Language::PYTHON);
+    EXPECT_GT(result.query_tokens, 0);
+    EXPECT_GT(result.window_hits, 0);
+    ASSERT_GE(result.matches.size(), 2);
+    std::set<std::string> files;
+    for (const auto& match : result.matches) {
+        files.insert(std::filesystem::path(match.file).filename().string());
+        EXPECT_GE(match.tokens, config.min_clone_tokens);
+        EXPECT_GT(match.coverage, 0.0f);
+        EXPECT_LE(match.coverage, 1.0f);
+        EXPECT_EQ(match.query_start_line, 1);
+        EXPECT_GT(match.start_line, 0);
+        EXPECT_GE(match.end_line, match.start_line);
+    }
+    EXPECT_EQ(files, (std::set<std::string>{"clone_type2_a.py", "clone_type2_b.py"}));
+    EXPECT_GE(result.matches.front().tokens, result.matches.back().tokens);
+
+    // Unrelated code finds nothing
+    EXPECT_TRUE(detector.query("x = compute(1, 2)\nprint(x)\n", Language::PYTHON).matches.empty());
+
+    // The same matches come from a saved index mapped on first query
+    SimilarityDetector(config).write_index(root, index_path);
+    auto saved_config = config;
+    saved_config.index_path = index_path.string();
+    SimilarityDetector from_file(saved_config);
+    const auto saved = from_file.query(snippet, Language::PYTHON);
+    ASSERT_EQ(saved.matches.size(), result.matches.size());
+    for (size_t i = 0; i < saved.matches.size(); ++i) {
+        EXPECT_EQ(saved.matches[i].to_json(), result.matches[i].to_json());
+    }
+
+    // Writing builds in memory but leaves the detector's settings as they were
+    auto budget_config = saved_config;
+    budget_config.memory_budget_bytes = 1 << 20;
+    SimilarityDetector writer(budget_config);
+    writer.write_index(root, index_path);
+    EXPECT_EQ(writer.config().index_path, budget_config.index_path);
+    EXPECT_EQ(writer.config().memory_budget_bytes, budget_config.memory_budget_bytes);
+
+    auto other_config = saved_config;
+    other_config.window_size = 6;
+    EXPECT_THROW(SimilarityDetector(other_config).query(snippet, Language::PYTHON), std::runtime_error);
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_F(SimilarityDetectorTest, LshPrefilterKeepsNearDuplicateFiles) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_lsh_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    for (const auto* name : {"clone_type1_a.py", "clone_type1_b.py", "no_clones.py"}) {
+        std::filesystem::copy_file(fixtures_dir / name, root / name);
+    }
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 10;
+    const auto full = SimilarityDetector(config).analyze(root);
+
+    config.use_lsh_prefilter = true;
+    const auto filtered = SimilarityDetector(config).analyze(root);
+    EXPECT_GE(filtered.performance.lsh_candidate_pairs, 1);
+
+    // Clones between the near-duplicate files survive; the small shared
+    // fragments with the unrelated file are skipped
+    const auto involves_unrelated = [](const CloneEntry& clone) {
+        return std::ranges::any_of(clone.locations, [](const CloneLocationInfo& location) {
+            return std::filesystem::path(location.file).filename() == "no_clones.py";
+        });
+    };
+    std::vector<nlohmann::json> expected;
+    for (const auto& clone : full.clones) {
+        if (!involves_unrelated(clone)) {
+            expected.push_back(clone.to_json()["locations"]);
+        }
+    }
+    std::vector<nlohmann::json> actual;
+    for (const auto& clone : filtered.clones) {
+        EXPECT_FALSE(involves_unrelated(clone));
+        actual.push_back(clone.to_json()["locations"]);
+    }
+    ASSERT_FALSE(actual.empty());
+    EXPECT_EQ(actual, expected);
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_F(SimilarityDetectorTest, MemoryBudgetSpillsAndMatchesInMemoryRun) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_budget_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "src");
+    std::filesystem::create_directories(root / "spill");
+    for (const auto* name : {"clone_type1_a.py", "clone_type1_b.py", "clone_type2_a.py",
+                             "clone_type2_b.py", "clone_type3_a.py", "clone_type3_b.py",
+                             "no_clones.py"}) {
+        std::filesystem::copy_file(fixtures_dir / name, root / "src" / name);
+    }
+    {
+        // One statement 80 times: stop hash buckets larger than the sample
+        std::ofstream out(root / "src" / "repeated.py");
+        for (int i = 0; i < 80; ++i) {
+            out << "total = scale(total, factor) + offset\n";
+        }
+    }
+
+    const auto comparable = [](const SimilarityReport& report) {
+        auto json = report.to_json();
+        json.erase("timing");
+        json.erase("performance");
+        json["summary"].erase("analysis_time_ms");
+        return json;
+    };
+
+    // Default stop hashes, and a tiny threshold that turns many windows
+    // into classes (or samples)
+    const std::vector<std::pair<size_t, StopHashMode>> cases = {
+        {500, StopHashMode::CLONE_CLASS},
+        {3, StopHashMode::CLONE_CLASS},
+        {3, StopHashMode::SAMPLE},
+    };
+    for (const auto& [stop_hash_min, stop_hash_mode] : cases) {
+        SCOPED_TRACE("stop_hash_min=" + std::to_string(stop_hash_min) +
+                     " mode=" + stop_hash_mode_to_string(stop_hash_mode));
+        DetectorConfig config;
+        config.window_size = 5;
+        config.min_clone_tokens = 10;
+        config.num_threads = 2;
+        config.stop_hash_min_locations = stop_hash_min;
+        config.stop_hash_mode = stop_hash_mode;
+        const auto in_memory = SimilarityDetector(config).analyze(root / "src");
+        EXPECT_EQ(in_memory.performance.spilled_runs, 0);
+
+        config.memory_budget_bytes = 128 * sizeof(HashRecord);
+        config.spill_dir = (root / "spill").string();
+        const auto budgeted = SimilarityDetector(config).analyze(root / "src");
+        EXPECT_GT(budgeted.performance.spilled_runs, 1);
+        EXPECT_GT(budgeted.performance.spilled_bytes, 0);
+        EXPECT_GT(budgeted.summary.clone_pairs_found, 0);
+        EXPECT_EQ(comparable(budgeted), comparable(in_memory));
+        EXPECT_TRUE(std::filesystem::is_empty(root / "spill"));
+    }
+
+    std::filesystem::remove_all(root);
+}
+
 TEST_F(SimilarityDetectorTest, NoFalsePositivesOnUniqueFiles) {
     if (!has_fixtures()) {
         GTEST_SKIP() << "Fixtures directory not found";
@@ -528,3 +881,388 @@ TEST_F(SimilarityDetectorTest, Type3ExtendsClonesWithGaps) {
     EXPECT_EQ(report_with.summary.files_analyzed, 2);
 }
 
+// =============================================================================
+// Winnowing Tests
+// =============================================================================
+
+TEST_F(SimilarityDetectorTest, WinnowingFindsSameClonesWithSmallerIndex) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    auto file1 = fixtures_dir / "clone_type1_a.py";
+    auto file2 = fixtures_dir / "clone_type1_b.py";
+
+    if (!std::filesystem::exists(file1) || !std::filesystem::exists(file2)) {
+        GTEST_SKIP() << "Test fixtures not found";
+    }
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 20;
+    config.extensions = {".py"};
+
+    DetectorConfig winnow_config = config;
+    winnow_config.use_winnowing = true;  // Derived window: 20 - 5 + 1 = 16
+
+    SimilarityDetector full_detector(config);
+    SimilarityDetector winnow_detector(winnow_config);
+
+    auto full_report = full_detector.compare(file1, file2);
+    auto winnow_report = winnow_detector.compare(file1, file2);
+
+    ASSERT_FALSE(full_report.clones.empty());
+    EXPECT_FALSE(winnow_report.clones.empty());
+    EXPECT_LT(winnow_report.performance.index_bytes, full_report.performance.index_bytes);
+    EXPECT_GT(full_report.performance.peak_pair_buffer, 0);
+    EXPECT_EQ(full_report.performance.to_json().count("peak_pair_buffer"), 1);
+
+    // Every clone found by the full index is covered by a winnowed clone
+    for (const auto& full_clone : full_report.clones) {
+        bool covered = false;
+        for (const auto& clone : winnow_report.clones) {
+            bool all_inside = true;
+            for (const auto& full_loc : full_clone.locations) {
+                bool inside = false;
+                for (const auto& loc : clone.locations) {
+                    if (loc.file == full_loc.file &&
+                        loc.start_line <= full_loc.start_line &&
+                        loc.end_line >= full_loc.end_line) {
+                        inside = true;
+                    }
+                }
+                all_inside = all_inside && inside;
+            }
+            covered = covered || all_inside;
+        }
+        EXPECT_TRUE(covered) << full_clone.locations[0].file << ":" << full_clone.locations[0].start_line;
+    }
+}
+
+// =============================================================================
+// Suffix Array Engine Tests
+// =============================================================================
+
+TEST_F(SimilarityDetectorTest, SuffixArrayEngineFindsType1Clones) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    auto file1 = fixtures_dir / "clone_type1_a.py";
+    auto file2 = fixtures_dir / "clone_type1_b.py";
+
+    if (!std::filesystem::exists(file1) || !std::filesystem::exists(file2)) {
+        GTEST_SKIP() << "Test fixtures not found";
+    }
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 20;
+    config.extensions = {".py"};
+
+    DetectorConfig sa_config = config;
+    sa_config.engine = DetectionEngine::SUFFIX_ARRAY;
+
+    auto hash_report = SimilarityDetector(config).compare(file1, file2);
+    auto sa_report = SimilarityDetector(sa_config).compare(file1, file2);
+
+    ASSERT_FALSE(hash_report.clones.empty());
+    ASSERT_FALSE(sa_report.clones.empty());
+
+    // Every hash-engine clone lies inside a suffix-array clone
+    for (const auto& hash_clone : hash_report.clones) {
+        bool covered = false;
+        for (const auto& clone : sa_report.clones) {
+            bool all_inside = true;
+            for (const auto& hash_loc : hash_clone.locations) {
+                bool inside = false;
+                for (const auto& loc : clone.locations) {
+                    if (loc.file == hash_loc.file &&
+                        loc.start_line <= hash_loc.start_line &&
+                        loc.end_line >= hash_loc.end_line) {
+                        inside = true;
+                    }
+                }
+                all_inside = all_inside && inside;
+            }
+            covered = covered || all_inside;
+        }
+        EXPECT_TRUE(covered) << hash_clone.locations[0].file << ":" << hash_clone.locations[0].start_line;
+    }
+}
+
+TEST_F(SimilarityDetectorTest, EngineNamesRoundTrip) {
+    EXPECT_EQ(detection_engine_from_string("hash"), DetectionEngine::HASH_INDEX);
+    EXPECT_EQ(detection_engine_from_string("suffix-array"), DetectionEngine::SUFFIX_ARRAY);
+    EXPECT_FALSE(detection_engine_from_string("bogus").has_value());
+    EXPECT_STREQ(detection_engine_to_string(DetectionEngine::SUFFIX_ARRAY), "suffix-array");
+}
+
+// =============================================================================
+// Stop Hash Tests
+// =============================================================================
+
+TEST_F(SimilarityDetectorTest, RepeatedBlockIsReportedAsOneCloneClass) {
+    const auto dir = std::filesystem::temp_directory_path() / "aegis_stop_hash_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // The same function in 8 files, each with a unique prefix
+    for (int f = 0; f < 8; ++f) {
+        std::ofstream out(dir / ("copy" + std::to_string(f) + ".py"));
+        out << "unique_" << f << " = " << f << "\n\n"
+            << "def process(items, limit):\n"
+            << "    total = 0\n"
+            << "    for item in items:\n"
+            << "        if item.value > limit:\n"
+            << "            total += item.value * 2\n"
+            << "        else:\n"
+            << "            total -= item.weight\n"
+            << "    return total\n";
+    }
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 20;
+    config.stop_hash_min_locations = 4;
+    config.num_threads = 1;
+
+    auto report = SimilarityDetector(config).analyze(dir);
+    std::filesystem::remove_all(dir);
+
+    // One class with all 8 copies instead of 28 pairwise clones
+    size_t class_entries = 0;
+    for (const auto& clone : report.clones) {
+        if (clone.locations.size() == 8) {
+            ++class_entries;
+        }
+    }
+    EXPECT_EQ(class_entries, 1);
+    EXPECT_LT(report.clones.size(), 28);
+}
+
+// =============================================================================
+// Source Loading Tests
+// =============================================================================
+
+TEST(MappedSourceTest, MapsLargeFilesAndReadsSmallOnes) {
+    const auto dir = std::filesystem::temp_directory_path() / "aegis_mapped_source_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::string small = "x = 1\r\ny = 2\n";
+    small.push_back('\0');
+    std::string large;
+    while (large.size() < 4 * MappedSource::MMAP_MIN_BYTES) {
+        large += "def f_" + std::to_string(large.size()) + "(a):\n    return a\n";
+    }
+    for (const auto& [name, contents] : {std::pair{"small.py", &small}, std::pair{"large.py", &large}}) {
+        std::ofstream(dir / name, std::ios::binary) << *contents;
+    }
+    std::ofstream(dir / "empty.py").close();
+
+    const auto small_source = MappedSource::open(dir / "small.py");
+    ASSERT_TRUE(small_source);
+    EXPECT_FALSE(small_source->is_mapped());
+    EXPECT_EQ(small_source->view(), small);
+    EXPECT_EQ(FileUtils::read_file(dir / "small.py"), small);
+
+    const auto large_source = MappedSource::open(dir / "large.py");
+    ASSERT_TRUE(large_source);
+    EXPECT_TRUE(large_source->is_mapped());
+    EXPECT_EQ(large_source->view(), large);
+
+    // Copies share the mapping
+    const MappedSource copy = *large_source;
+    EXPECT_EQ(copy.view().data(), large_source->view().data());
+
+    const auto read_source = MappedSource::open(dir / "large.py", std::numeric_limits<size_t>::max());
+    ASSERT_TRUE(read_source);
+    EXPECT_FALSE(read_source->is_mapped());
+    EXPECT_EQ(read_source->view(), large);
+
+    const auto empty = MappedSource::open(dir / "empty.py", 0);
+    ASSERT_TRUE(empty);
+    EXPECT_TRUE(empty->empty());
+    EXPECT_FALSE(MappedSource::open(dir / "missing.py"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(SimilarityDetectorTest, EachSourceFileIsReadOnce) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    const auto root = std::filesystem::temp_directory_path() / "aegis_read_once_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    size_t total_bytes = 0;
+    for (const auto* name : {"clone_type1_a.py", "clone_type1_b.py", "clone_type2_a.py",
+                             "clone_type2_b.py", "no_clones.py"}) {
+        std::filesystem::copy_file(fixtures_dir / name, root / name);
+        total_bytes += std::filesystem::file_size(root / name);
+    }
+    {
+        // Big enough to be mapped
+        std::ofstream large(root / "large.py");
+        for (int i = 0; i < 2000; ++i) {
+            large << "def helper_" << i << "(value):\n    return value + " << i << "\n";
+        }
+    }
+    const auto large_bytes = std::filesystem::file_size(root / "large.py");
+    total_bytes += large_bytes;
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 10;
+    for (const size_t threads : {size_t{1}, size_t{4}}) {
+        SCOPED_TRACE("threads=" + std::to_string(threads));
+        config.num_threads = threads;
+        const auto report = SimilarityDetector(config).analyze(root);
+        EXPECT_EQ(report.performance.files_read, 6);
+        EXPECT_EQ(report.performance.bytes_read + report.performance.bytes_mapped, total_bytes);
+        EXPECT_EQ(report.performance.bytes_mapped, large_bytes);
+    }
+
+    // Incremental runs only read files whose mtime or size moved
+    SimilarityDetector incremental(config);
+    EXPECT_EQ(incremental.analyze_incremental(root).performance.bytes_read, total_bytes);
+    {
+        std::ofstream(root / "no_clones.py", std::ios::app) << "\nextra = 1\n";
+    }
+    const auto updated = incremental.analyze_incremental(root);
+    EXPECT_EQ(updated.performance.files_read, 1);
+    EXPECT_EQ(updated.performance.bytes_read, std::filesystem::file_size(root / "no_clones.py"));
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_F(SimilarityDetectorTest, ReportsArenaUsage) {
+    if (!has_fixtures()) {
+        GTEST_SKIP() << "Fixtures directory not found";
+    }
+
+    DetectorConfig config;
+    config.window_size = 5;
+    config.min_clone_tokens = 10;
+    for (const size_t threads : {size_t{1}, size_t{4}}) {
+        SCOPED_TRACE("threads=" + std::to_string(threads));
+        config.num_threads = threads;
+        const auto report = SimilarityDetector(config).analyze(fixtures_dir);
+
+        // Token columns of every file come from the arena, in a few heap blocks
+        const auto& performance = report.performance;
+        EXPECT_GE(performance.arena_allocations, report.summary.files_analyzed);
+        EXPECT_GT(performance.arena_heap_allocations, 0);
+        EXPECT_LT(performance.arena_heap_allocations, performance.arena_allocations);
+        EXPECT_GT(performance.arena_high_water_bytes, 0);
+        EXPECT_TRUE(report.to_json()["performance"].contains("arena_high_water_bytes"));
+    }
+}
+
+TEST(MappedSourceTest, DISABLED_BenchmarkSourceLoading) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*BenchmarkSourceLoading*"
+    // AEGIS_BENCH_MB sets the tree size (default 256 MB)
+
+    const char* size_env = std::getenv("AEGIS_BENCH_MB");
+    const size_t tree_bytes = (size_env ? std::stoul(size_env) : 256) << 20;
+    const size_t file_bytes = 256 << 10;
+
+    const auto dir = std::filesystem::temp_directory_path() / "aegis_source_bench";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::string contents;
+    while (contents.size() < file_bytes) {
+        contents += "def f_" + std::to_string(contents.size()) + "(a, b):\n    return a + b\n";
+    }
+    std::vector<std::filesystem::path> files;
+    for (size_t written = 0; written < tree_bytes; written += contents.size()) {
+        files.push_back(dir / ("file" + std::to_string(files.size()) + ".py"));
+        std::ofstream(files.back(), std::ios::binary) << contents;
+    }
+
+    // Anonymous resident memory in bytes (Linux). Mapped pages are page
+    // cache the kernel can reclaim, so they are not counted.
+    const auto resident_bytes = [] {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.starts_with("RssAnon:")) {
+                return std::stoul(line.substr(8)) << 10;
+            }
+        }
+        return size_t{0};
+    };
+
+    // Load every file, keep them all (like AnalysisState::sources) and
+    // touch every byte (like the tokenizer)
+    const auto measure = [&](const char* name, const auto& load) {
+        const size_t rss_before = resident_bytes();
+        const auto start = std::chrono::high_resolution_clock::now();
+        std::vector<decltype(load(files[0]))> kept;
+        uint64_t checksum = 0;
+        for (const auto& file : files) {
+            kept.push_back(load(file));
+            checksum += FileUtils::content_hash(std::string_view(kept.back()));
+        }
+        const auto seconds = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        const size_t rss_growth = resident_bytes() - std::min(rss_before, resident_bytes());
+        std::cout << name << ": " << static_cast<double>(tree_bytes >> 20) / seconds << " MB/s, "
+                  << "anonymous RSS +" << (rss_growth >> 20) << " MB (checksum " << checksum << ")\n";
+    };
+
+    std::cout << "\n=== Source loading: " << files.size() << " files, "
+              << (tree_bytes >> 20) << " MB ===\n";
+    measure("ifstream + ostringstream", [](const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    });
+    measure("FileUtils::read_file", [](const std::filesystem::path& path) {
+        return *FileUtils::read_file(path);
+    });
+    std::vector<MappedSource> mapped;
+    measure("MappedSource::open", [&mapped](const std::filesystem::path& path) {
+        mapped.push_back(*MappedSource::open(path));
+        return mapped.back().view();
+    });
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(SimilarityDetectorTest, DISABLED_BenchmarkTokenizeManySmallFiles) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*BenchmarkTokenizeManySmallFiles*"
+    // AEGIS_BENCH_FILES sets the number of files (default 20000)
+
+    const char* count_env = std::getenv("AEGIS_BENCH_FILES");
+    const size_t file_count = count_env ? std::stoul(count_env) : 20000;
+
+    const auto dir = std::filesystem::temp_directory_path() / "aegis_small_files_bench";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    for (size_t i = 0; i < file_count; ++i) {
+        std::ofstream(dir / ("file" + std::to_string(i) + ".py"))
+            << "def f_" << i << "(a, b):\n    return a + b * " << i << "\n";
+    }
+
+    // Normalizer lookups happen once per file on every worker
+    DetectorConfig config;
+    config.num_threads = 64;
+    SimilarityDetector detector(config);
+
+    std::cout << "\n=== Tokenizing " << file_count << " small files on "
+              << config.num_threads << " threads ===\n";
+    for (int run = 0; run < 3; ++run) {
+        const auto report = detector.analyze(dir);
+        EXPECT_EQ(report.summary.files_analyzed, file_count);
+        std::cout << "run " << run << ": tokenize " << report.timing.tokenize_ms << " ms, total "
+                  << report.timing.total_ms << " ms\n";
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -1,7 +1,16 @@
 #include <gtest/gtest.h>
 #include "core/hash_index.hpp"
+#include "core/bloom_filter.hpp"
+#include "core/clone_extender.hpp"
+#include "core/count_min_sketch.hpp"
+#include "core/minhash.hpp"
 #include "core/rolling_hash.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
 #include <iomanip>
 #include <iostream>
 
@@ -49,44 +58,44 @@ TEST_F(HashIndexTest, GetFilePath) {
 // =============================================================================
 
 TEST_F(HashIndexTest, AddAndRetrieveHash) {
-    HashLocation loc{0, 10, 15, 0, 50, 0, 10};
+    HashLocation loc{0, 0, 10};
     index.add_hash(12345, loc);
 
-    auto* locations = index.get_locations(12345);
-    ASSERT_NE(locations, nullptr);
-    ASSERT_EQ(locations->size(), 1);
-    EXPECT_EQ((*locations)[0].file_id, 0);
-    EXPECT_EQ((*locations)[0].start_line, 10);
+    auto locations = index.get_locations(12345);
+    ASSERT_FALSE(locations.empty());
+    ASSERT_EQ(locations.size(), 1);
+    EXPECT_EQ(locations[0].file_id, 0);
+    EXPECT_EQ(locations[0].token_count, 10);
 }
 
 TEST_F(HashIndexTest, MultipleLocationsPerHash) {
-    HashLocation loc1{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2{1, 20, 25, 0, 50, 100, 10};
-    HashLocation loc3{2, 30, 35, 0, 50, 200, 10};
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{1, 100, 10};
+    HashLocation loc3{2, 200, 10};
 
     index.add_hash(12345, loc1);
     index.add_hash(12345, loc2);
     index.add_hash(12345, loc3);
 
-    auto* locations = index.get_locations(12345);
-    ASSERT_NE(locations, nullptr);
-    EXPECT_EQ(locations->size(), 3);
+    auto locations = index.get_locations(12345);
+    ASSERT_FALSE(locations.empty());
+    EXPECT_EQ(locations.size(), 3);
 }
 
 TEST_F(HashIndexTest, NonexistentHashReturnsNull) {
-    EXPECT_EQ(index.get_locations(99999), nullptr);
+    EXPECT_TRUE(index.get_locations(99999).empty());
 }
 
 TEST_F(HashIndexTest, ClearRemovesAllData) {
     index.register_file("file.py");
-    HashLocation loc{0, 10, 15, 0, 50, 0, 10};
+    HashLocation loc{0, 0, 10};
     index.add_hash(12345, loc);
 
     index.clear();
 
     EXPECT_EQ(index.file_count(), 0);
     EXPECT_EQ(index.hash_count(), 0);
-    EXPECT_EQ(index.get_locations(12345), nullptr);
+    EXPECT_TRUE(index.get_locations(12345).empty());
 }
 
 // =============================================================================
@@ -99,7 +108,7 @@ TEST_F(HashIndexTest, FindClonePairsEmpty) {
 }
 
 TEST_F(HashIndexTest, FindClonePairsSingleLocation) {
-    HashLocation loc{0, 10, 15, 0, 50, 0, 10};
+    HashLocation loc{0, 0, 10};
     index.add_hash(12345, loc);
 
     auto pairs = index.find_clone_pairs();
@@ -110,8 +119,8 @@ TEST_F(HashIndexTest, FindClonePairsTwoLocations) {
     index.register_file("file1.py");
     index.register_file("file2.py");
 
-    HashLocation loc1{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2{1, 20, 25, 0, 50, 0, 10};
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{1, 0, 10};
 
     index.add_hash(12345, loc1);
     index.add_hash(12345, loc2);
@@ -127,8 +136,8 @@ TEST_F(HashIndexTest, FindClonePairsSkipsOverlapping) {
     index.register_file("file.py");
 
     // Two overlapping locations in same file
-    HashLocation loc1{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2{0, 12, 17, 0, 50, 5, 10};  // Overlaps with loc1
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{0, 5, 10};  // Overlaps with loc1
 
     index.add_hash(12345, loc1);
     index.add_hash(12345, loc2);
@@ -141,8 +150,8 @@ TEST_F(HashIndexTest, FindClonePairsNonOverlappingSameFile) {
     index.register_file("file.py");
 
     // Two non-overlapping locations in same file
-    HashLocation loc1{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2{0, 100, 105, 0, 50, 500, 10};  // Far apart
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{0, 500, 10};  // Far apart
 
     index.add_hash(12345, loc1);
     index.add_hash(12345, loc2);
@@ -156,14 +165,14 @@ TEST_F(HashIndexTest, FindClonePairsMultipleHashes) {
     index.register_file("file2.py");
 
     // Hash A appears in both files
-    HashLocation loc1a{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2a{1, 20, 25, 0, 50, 0, 10};
+    HashLocation loc1a{0, 0, 10};
+    HashLocation loc2a{1, 0, 10};
     index.add_hash(111, loc1a);
     index.add_hash(111, loc2a);
 
     // Hash B also appears in both files
-    HashLocation loc1b{0, 50, 55, 0, 50, 100, 10};
-    HashLocation loc2b{1, 60, 65, 0, 50, 100, 10};
+    HashLocation loc1b{0, 100, 10};
+    HashLocation loc2b{1, 100, 10};
     index.add_hash(222, loc1b);
     index.add_hash(222, loc2b);
 
@@ -171,6 +180,37 @@ TEST_F(HashIndexTest, FindClonePairsMultipleHashes) {
     EXPECT_EQ(pairs.size(), 2);  // One pair per hash
 }
 
+TEST_F(HashIndexTest, VisitClonePairsStreamsBoundedBatches) {
+    // 20 files share 10 hashes: 10 * 190 pairs
+    for (uint64_t hash = 1; hash <= 10; ++hash) {
+        for (uint32_t file_id = 0; file_id < 20; ++file_id) {
+            HashLocation loc{file_id, static_cast<uint32_t>(hash * 100), 10};
+            index.add_hash(hash, loc);
+        }
+    }
+
+    size_t visited = 0;
+    size_t batches = 0;
+    auto stats = index.visit_clone_pairs([&](std::span<const ClonePair> batch) {
+        EXPECT_LE(batch.size(), 64);
+        // Each batch is grouped by file pair
+        for (size_t i = 1; i < batch.size(); ++i) {
+            const auto key = [](const ClonePair& pair) {
+                return std::minmax(pair.location_a.file_id, pair.location_b.file_id);
+            };
+            EXPECT_LE(key(batch[i - 1]), key(batch[i]));
+        }
+        visited += batch.size();
+        ++batches;
+    }, 64);
+
+    EXPECT_EQ(visited, 1900);
+    EXPECT_EQ(stats.pairs, 1900);
+    EXPECT_EQ(stats.peak_buffered, 64);
+    EXPECT_EQ(batches, (1900 + 63) / 64);
+    EXPECT_EQ(index.find_clone_pairs().size(), 1900);
+}
+
 // =============================================================================
 // Merge Adjacent Clones Tests
 // =============================================================================
@@ -183,8 +223,8 @@ TEST_F(HashIndexTest, MergeAdjacentClonesEmpty) {
 
 TEST_F(HashIndexTest, MergeAdjacentClonesSinglePair) {
     ClonePair pair;
-    pair.location_a = {0, 10, 15, 0, 50, 0, 10};
-    pair.location_b = {1, 20, 25, 0, 50, 0, 10};
+    pair.location_a = {0, 0, 10};
+    pair.location_b = {1, 0, 10};
 
     std::vector<ClonePair> pairs = {pair};
     auto merged = HashIndex::merge_adjacent_clones(pairs);
@@ -194,12 +234,12 @@ TEST_F(HashIndexTest, MergeAdjacentClonesSinglePair) {
 
 TEST_F(HashIndexTest, MergeAdjacentClonesAdjacentPairs) {
     ClonePair pair1;
-    pair1.location_a = {0, 10, 12, 0, 50, 0, 5};
-    pair1.location_b = {1, 20, 22, 0, 50, 0, 5};
+    pair1.location_a = {0, 0, 5};
+    pair1.location_b = {1, 0, 5};
 
     ClonePair pair2;
-    pair2.location_a = {0, 13, 15, 0, 50, 5, 5};  // Adjacent in file 0
-    pair2.location_b = {1, 23, 25, 0, 50, 5, 5};  // Adjacent in file 1
+    pair2.location_a = {0, 5, 5};  // Adjacent in file 0
+    pair2.location_b = {1, 5, 5};  // Adjacent in file 1
 
     std::vector<ClonePair> pairs = {pair1, pair2};
     auto merged = HashIndex::merge_adjacent_clones(pairs);
@@ -210,12 +250,12 @@ TEST_F(HashIndexTest, MergeAdjacentClonesAdjacentPairs) {
 
 TEST_F(HashIndexTest, MergeAdjacentClonesNonAdjacent) {
     ClonePair pair1;
-    pair1.location_a = {0, 10, 15, 0, 50, 0, 10};
-    pair1.location_b = {1, 20, 25, 0, 50, 0, 10};
+    pair1.location_a = {0, 0, 10};
+    pair1.location_b = {1, 0, 10};
 
     ClonePair pair2;
-    pair2.location_a = {0, 100, 105, 0, 50, 500, 10};  // Far from pair1
-    pair2.location_b = {1, 200, 205, 0, 50, 500, 10};
+    pair2.location_a = {0, 500, 10};  // Far from pair1
+    pair2.location_b = {1, 500, 10};
 
     std::vector<ClonePair> pairs = {pair1, pair2};
     auto merged = HashIndex::merge_adjacent_clones(pairs);
@@ -225,12 +265,12 @@ TEST_F(HashIndexTest, MergeAdjacentClonesNonAdjacent) {
 
 TEST_F(HashIndexTest, MergeAdjacentClonesDifferentFiles) {
     ClonePair pair1;
-    pair1.location_a = {0, 10, 15, 0, 50, 0, 10};
-    pair1.location_b = {1, 20, 25, 0, 50, 0, 10};
+    pair1.location_a = {0, 0, 10};
+    pair1.location_b = {1, 0, 10};
 
     ClonePair pair2;
-    pair2.location_a = {0, 16, 20, 0, 50, 10, 10};  // Adjacent to pair1
-    pair2.location_b = {2, 30, 35, 0, 50, 0, 10};   // Different file!
+    pair2.location_a = {0, 10, 10};  // Adjacent to pair1
+    pair2.location_b = {2, 0, 10};   // Different file!
 
     std::vector<ClonePair> pairs = {pair1, pair2};
     auto merged = HashIndex::merge_adjacent_clones(pairs);
@@ -244,12 +284,12 @@ TEST_F(HashIndexTest, MergeAdjacentClonesDifferentFiles) {
 
 TEST_F(HashIndexTest, FilterBySizeRemovesSmall) {
     ClonePair small;
-    small.location_a = {0, 10, 12, 0, 50, 0, 5};
-    small.location_b = {1, 20, 22, 0, 50, 0, 5};
+    small.location_a = {0, 0, 5};
+    small.location_b = {1, 0, 5};
 
     ClonePair large;
-    large.location_a = {0, 100, 120, 0, 50, 500, 50};
-    large.location_b = {1, 200, 220, 0, 50, 500, 50};
+    large.location_a = {0, 500, 50};
+    large.location_b = {1, 500, 50};
 
     std::vector<ClonePair> pairs = {small, large};
     auto filtered = HashIndex::filter_by_size(pairs, 30);
@@ -260,8 +300,8 @@ TEST_F(HashIndexTest, FilterBySizeRemovesSmall) {
 
 TEST_F(HashIndexTest, FilterBySizeKeepsAll) {
     ClonePair pair;
-    pair.location_a = {0, 10, 20, 0, 50, 0, 50};
-    pair.location_b = {1, 20, 30, 0, 50, 0, 50};
+    pair.location_a = {0, 0, 50};
+    pair.location_b = {1, 0, 50};
 
     std::vector<ClonePair> pairs = {pair};
     auto filtered = HashIndex::filter_by_size(pairs, 10);
@@ -287,13 +327,13 @@ TEST_F(HashIndexTest, GetStatsWithData) {
     index.register_file("file2.py");
 
     // Hash with multiple locations (duplicate)
-    HashLocation loc1{0, 10, 15, 0, 50, 0, 10};
-    HashLocation loc2{1, 20, 25, 0, 50, 0, 10};
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{1, 0, 10};
     index.add_hash(111, loc1);
     index.add_hash(111, loc2);
 
     // Hash with single location
-    HashLocation loc3{0, 50, 55, 0, 50, 100, 10};
+    HashLocation loc3{0, 100, 10};
     index.add_hash(222, loc3);
 
     auto stats = index.get_stats();
@@ -305,6 +345,70 @@ TEST_F(HashIndexTest, GetStatsWithData) {
     EXPECT_EQ(stats.max_locations_per_hash, 2);
 }
 
+// =============================================================================
+// Frozen (CSR) Layout Tests
+// =============================================================================
+
+TEST_F(HashIndexTest, FreezeKeepsLocationsInInsertionOrder) {
+    index.register_file("file1.py");
+    index.register_file("file2.py");
+
+    std::vector<HashRecord> records;
+    for (uint32_t i = 0; i < 4; ++i) {
+        HashLocation loc{i % 2, 100 * i, 10};
+        records.push_back({0xABCD0000ULL + (i % 2), loc});
+    }
+    index.freeze(std::move(records));
+
+    EXPECT_TRUE(index.is_frozen());
+    EXPECT_EQ(index.hash_count(), 2);
+    EXPECT_EQ(index.location_count(), 4);
+
+    auto locations = index.get_locations(0xABCD0000ULL);
+    ASSERT_EQ(locations.size(), 2);
+    EXPECT_EQ(locations[0].token_start, 0);
+    EXPECT_EQ(locations[1].token_start, 200);
+    EXPECT_TRUE(index.get_locations(42).empty());
+}
+
+TEST_F(HashIndexTest, FreezeMergesMutableEntries) {
+    HashLocation loc1{0, 0, 10};
+    HashLocation loc2{1, 0, 10};
+    index.add_hash(777, loc1);
+    index.freeze({{777, loc2}, {1ULL << 63, loc2}});
+
+    EXPECT_EQ(index.get_locations(777).size(), 2);
+    EXPECT_EQ(index.get_locations(1ULL << 63).size(), 1);
+
+    // Adding to a frozen index converts it back to the mutable layout
+    index.add_hash(777, loc1);
+    EXPECT_FALSE(index.is_frozen());
+    EXPECT_EQ(index.get_locations(777).size(), 3);
+}
+
+TEST_F(HashIndexTest, FrozenClonePairsMatchMutable) {
+    HashIndex mutable_index;
+    std::vector<HashRecord> records;
+    for (uint64_t hash = 0; hash < 50; ++hash) {
+        for (uint32_t file_id = 0; file_id < 3; ++file_id) {
+            HashLocation loc{file_id, static_cast<uint32_t>(hash * 10), 10};
+            mutable_index.add_hash(hash * 0x9E3779B97F4A7C15ULL, loc);
+            records.push_back({hash * 0x9E3779B97F4A7C15ULL, loc});
+        }
+    }
+    index.freeze(std::move(records));
+
+    auto frozen_stats = index.get_stats();
+    auto mutable_stats = mutable_index.get_stats();
+    EXPECT_TRUE(frozen_stats.frozen);
+    EXPECT_EQ(frozen_stats.total_hashes, mutable_stats.total_hashes);
+    EXPECT_EQ(frozen_stats.total_locations, mutable_stats.total_locations);
+    EXPECT_EQ(frozen_stats.duplicate_hashes, mutable_stats.duplicate_hashes);
+    EXPECT_LT(frozen_stats.memory_bytes, mutable_stats.memory_bytes);
+
+    EXPECT_EQ(index.find_clone_pairs().size(), mutable_index.find_clone_pairs().size());
+}
+
 // =============================================================================
 // HashIndexBuilder Tests
 // =============================================================================
@@ -364,6 +468,91 @@ TEST(HashIndexBuilderTest, SkipsStructuralTokens) {
     EXPECT_GT(builder.index().hash_count(), 0);
 }
 
+TEST(HashIndexBuilderTest, FreezeModeMatchesMutableBuild) {
+    TokenizedFile file;
+    file.path = "test.py";
+    for (int i = 0; i < 40; ++i) {
+        NormalizedToken tok{};
+        tok.type = TokenType::IDENTIFIER;
+        tok.original_hash = static_cast<uint32_t>(i % 7);
+        tok.normalized_hash = static_cast<uint32_t>(i % 7);
+        tok.line = static_cast<uint32_t>(i + 1);
+        tok.column = 1;
+        tok.length = 3;
+        file.tokens.push_back(tok);
+    }
+
+    HashIndex mutable_index;
+    HashIndexBuilder mutable_builder(mutable_index, 5);
+    mutable_builder.add_file(file, true);
+
+    HashIndex frozen_index;
+    HashIndexBuilder::Config config;
+    config.window_size = 5;
+    config.freeze = true;
+    HashIndexBuilder frozen_builder(frozen_index, config);
+    frozen_builder.add_file(file, true);
+    EXPECT_EQ(frozen_index.hash_count(), 0);  // Nothing indexed until finalize
+    frozen_builder.finalize();
+
+    EXPECT_TRUE(frozen_index.is_frozen());
+    EXPECT_EQ(frozen_index.hash_count(), mutable_index.hash_count());
+    EXPECT_EQ(frozen_index.location_count(), mutable_index.location_count());
+    EXPECT_EQ(frozen_index.find_clone_pairs().size(), mutable_index.find_clone_pairs().size());
+}
+
+TEST(HashIndexBuilderTest, ParallelShardedBuildMatchesSequential) {
+    // Enough records to take the sharded path (10 groups of 4 identical files)
+    std::vector<TokenizedFile> files(40);
+    for (size_t f = 0; f < files.size(); ++f) {
+        files[f].path = "file" + std::to_string(f) + ".py";
+        for (uint32_t i = 0; i < 2000; ++i) {
+            NormalizedToken tok{};
+            tok.type = TokenType::IDENTIFIER;
+            tok.normalized_hash = (i * 2654435761u) ^ static_cast<uint32_t>((f % 10) << 20);
+            tok.original_hash = tok.normalized_hash;
+            tok.line = i / 10 + 1;
+            tok.column = 1;
+            tok.length = 3;
+            files[f].tokens.push_back(tok);
+        }
+    }
+
+    HashIndex sequential_index;
+    HashIndexBuilder::Config config;
+    config.window_size = 10;
+    config.freeze = true;
+    HashIndexBuilder sequential_builder(sequential_index, config);
+    for (const auto& file : files) {
+        sequential_builder.add_file(file, true);
+    }
+    sequential_builder.finalize();
+
+    ThreadPool pool(4);
+    HashIndex parallel_index;
+    HashIndexBuilder parallel_builder(parallel_index, config);
+    parallel_builder.add_files(files, pool, true);
+    parallel_builder.finalize(&pool);
+
+    ASSERT_TRUE(parallel_index.is_frozen());
+    ASSERT_EQ(parallel_index.file_count(), files.size());
+    EXPECT_EQ(parallel_index.get_file_path(7), "file7.py");
+    EXPECT_EQ(parallel_index.hash_count(), sequential_index.hash_count());
+    EXPECT_EQ(parallel_index.location_count(), sequential_index.location_count());
+
+    // Bucket order and location order within buckets must be identical
+    auto sequential_pairs = sequential_index.find_clone_pairs();
+    auto parallel_pairs = parallel_index.find_clone_pairs();
+    ASSERT_EQ(parallel_pairs.size(), sequential_pairs.size());
+    ASSERT_FALSE(parallel_pairs.empty());
+    for (size_t i = 0; i < parallel_pairs.size(); ++i) {
+        EXPECT_EQ(parallel_pairs[i].shared_hash, sequential_pairs[i].shared_hash);
+        EXPECT_EQ(parallel_pairs[i].location_a.file_id, sequential_pairs[i].location_a.file_id);
+        EXPECT_EQ(parallel_pairs[i].location_b.file_id, sequential_pairs[i].location_b.file_id);
+        EXPECT_EQ(parallel_pairs[i].location_a.token_start, sequential_pairs[i].location_a.token_start);
+    }
+}
+
 TEST(HashIndexBuilderTest, SmallFilesIgnored) {
     TokenizedFile file;
     file.path = "tiny.py";
@@ -404,8 +593,6 @@ TEST(HashIndexParallelTest, ParallelFindClonePairsMatchesSequential) {
             loc.file_id = file_id;
             loc.token_start = static_cast<uint32_t>((hash - 1000) * 10);
             loc.token_count = 10;
-            loc.start_line = static_cast<uint32_t>(hash - 1000 + 1);
-            loc.end_line = loc.start_line + 5;
             index.add_hash(hash, loc);
         }
     }
@@ -423,6 +610,30 @@ TEST(HashIndexParallelTest, ParallelFindClonePairsMatchesSequential) {
     EXPECT_EQ(sequential_pairs.size(), 300);
 }
 
+TEST(HashIndexParallelTest, ParallelVisitorBoundsEachProducer) {
+    HashIndex index;
+    for (uint64_t hash = 1; hash <= 300; ++hash) {
+        for (uint32_t file_id = 0; file_id < 4; ++file_id) {
+            HashLocation loc{};
+            loc.file_id = file_id;
+            loc.token_start = static_cast<uint32_t>(hash * 10);
+            loc.token_count = 10;
+            index.add_hash(hash, loc);
+        }
+    }
+
+    ThreadPool pool(4);
+    size_t visited = 0;
+    auto stats = index.visit_clone_pairs_parallel(pool, [&](std::span<const ClonePair> batch) {
+        EXPECT_LE(batch.size(), 100);
+        visited += batch.size();  // The visitor is never called concurrently
+    }, 100);
+
+    EXPECT_EQ(visited, 300 * 6);
+    EXPECT_EQ(stats.pairs, 300 * 6);
+    EXPECT_LE(stats.peak_buffered, pool.size() * 100);
+}
+
 TEST(HashIndexParallelTest, ParallelWithSmallWorkloadFallsBackToSequential) {
     // With fewer than 100 work items, parallel should use sequential
     HashIndex index;
@@ -436,8 +647,6 @@ TEST(HashIndexParallelTest, ParallelWithSmallWorkloadFallsBackToSequential) {
             loc.file_id = file_id;
             loc.token_start = static_cast<uint32_t>((hash - 1000) * 10);
             loc.token_count = 10;
-            loc.start_line = 1;
-            loc.end_line = 5;
             index.add_hash(hash, loc);
         }
     }
@@ -465,8 +674,6 @@ TEST(HashIndexParallelTest, ParallelWithSingleThreadFallsBackToSequential) {
             loc.file_id = file_id;
             loc.token_start = static_cast<uint32_t>((hash - 1000) * 10);
             loc.token_count = 10;
-            loc.start_line = 1;
-            loc.end_line = 5;
             index.add_hash(hash, loc);
         }
     }
@@ -496,8 +703,6 @@ TEST(HashIndexParallelTest, ParallelHandlesLargeWorkload) {
             loc.file_id = files[i * 2];
             loc.token_start = static_cast<uint32_t>((hash - 1000) * 10 + i);
             loc.token_count = 10;
-            loc.start_line = static_cast<uint32_t>(i + 1);
-            loc.end_line = loc.start_line + 5;
             index.add_hash(hash, loc);
         }
     }
@@ -524,15 +729,11 @@ TEST(HashIndexParallelTest, ParallelPreservesClonePairFields) {
     loc1.file_id = file1;
     loc1.token_start = 100;
     loc1.token_count = 50;
-    loc1.start_line = 10;
-    loc1.end_line = 20;
 
     HashLocation loc2;
     loc2.file_id = file2;
     loc2.token_start = 200;
     loc2.token_count = 50;
-    loc2.start_line = 30;
-    loc2.end_line = 40;
 
     // Add to 200+ hashes to trigger parallel mode
     for (uint64_t hash = 1000; hash < 1200; ++hash) {
@@ -563,23 +764,17 @@ TEST(HashIndexParallelTest, ParallelExcludesOverlappingSameFile) {
     loc1.file_id = file1;
     loc1.token_start = 0;
     loc1.token_count = 20;
-    loc1.start_line = 1;
-    loc1.end_line = 10;
 
     HashLocation loc2;
     loc2.file_id = file1;
     loc2.token_start = 10;  // Overlaps with loc1
     loc2.token_count = 20;
-    loc2.start_line = 5;
-    loc2.end_line = 15;
 
     // Add non-overlapping location
     HashLocation loc3;
     loc3.file_id = file1;
     loc3.token_start = 100;  // No overlap
     loc3.token_count = 20;
-    loc3.start_line = 50;
-    loc3.end_line = 60;
 
     // Add to 200+ hashes to trigger parallel mode
     for (uint64_t hash = 1000; hash < 1200; ++hash) {
@@ -597,6 +792,725 @@ TEST(HashIndexParallelTest, ParallelExcludesOverlappingSameFile) {
     EXPECT_EQ(parallel_pairs.size(), 400);
 }
 
+// =============================================================================
+// Stop Hash Tests
+// =============================================================================
+
+namespace {
+
+// 600 files sharing one window hash (above the default 500 threshold)
+HashIndex make_stop_hash_index(const StopHashMode mode) {
+    HashIndex index;
+    StopHashPolicy policy;
+    policy.mode = mode;
+    index.set_stop_hash_policy(policy);
+    for (uint32_t file_id = 0; file_id < 600; ++file_id) {
+        index.add_hash(42, HashLocation{file_id, 0, 10});
+    }
+    index.add_hash(7, HashLocation{0, 20, 10});
+    index.add_hash(7, HashLocation{1, 20, 10});
+    return index;
+}
+
+// Files with a shared run of identical tokens followed by unique tokens
+std::vector<TokenizedFile> make_repetitive_files(const uint32_t count) {
+    std::vector<TokenizedFile> files(count);
+    for (uint32_t f = 0; f < count; ++f) {
+        files[f].path = "file" + std::to_string(f) + ".py";
+        for (uint32_t i = 0; i < 40; ++i) {
+            NormalizedToken tok{};
+            tok.type = TokenType::IDENTIFIER;
+            tok.original_hash = i < 20 ? 1 : 1000 + f * 100 + i;
+            tok.normalized_hash = tok.original_hash;
+            tok.line = i + 1;
+            tok.column = 1;
+            tok.length = 1;
+            files[f].tokens.push_back(tok);
+        }
+    }
+    return files;
+}
+
+}  // anonymous namespace
+
+TEST(CountMinSketchTest, NeverUndercountsAndMerges) {
+    CountMinSketch sketch(256);
+    CountMinSketch other(256);
+    for (uint64_t key = 0; key < 2000; ++key) {
+        for (uint64_t n = 0; n <= key % 5; ++n) {
+            (key % 2 ? sketch : other).add(key);
+        }
+    }
+    sketch.merge(other);
+
+    EXPECT_EQ(sketch.width(), 256);
+    EXPECT_EQ(sketch.total(), 6000);
+    for (uint64_t key = 0; key < 2000; ++key) {
+        EXPECT_GE(sketch.estimate(key), key % 5 + 1);
+    }
+    EXPECT_THROW(sketch.merge(CountMinSketch(512)), std::invalid_argument);
+}
+
+TEST(StopHashTest, ThresholdScalesWithCorpusSize) {
+    StopHashPolicy policy;
+    EXPECT_EQ(policy.threshold(1000), 500);
+    EXPECT_EQ(policy.threshold(10'000'000), 10'000);
+}
+
+TEST(StopHashTest, CloneClassModeReplacesPairs) {
+    auto index = make_stop_hash_index(StopHashMode::CLONE_CLASS);
+
+    auto pairs = index.find_clone_pairs();
+    ASSERT_EQ(pairs.size(), 1);  // Only the ordinary hash
+    EXPECT_EQ(pairs[0].shared_hash, 7);
+
+    auto classes = index.find_clone_classes();
+    ASSERT_EQ(classes.size(), 1);
+    EXPECT_EQ(classes[0].shared_hash, 42);
+    EXPECT_EQ(classes[0].locations.size(), 600);  // Not dropped at 500
+    EXPECT_EQ(classes[0].locations.back().file_id, 599);
+
+    auto stats = index.get_stats();
+    EXPECT_EQ(stats.stop_hash_threshold, 500);
+    EXPECT_EQ(stats.stop_hashes, 1);
+    EXPECT_EQ(stats.stop_hash_locations, 600);
+}
+
+TEST(StopHashTest, SampleModeBoundsPairs) {
+    auto index = make_stop_hash_index(StopHashMode::SAMPLE);
+
+    ThreadPool pool(2);
+    const size_t sampled = 64 * 63 / 2;
+    EXPECT_EQ(index.find_clone_pairs().size(), sampled + 1);
+    EXPECT_EQ(index.find_clone_pairs_parallel(pool).size(), sampled + 1);
+    EXPECT_TRUE(index.find_clone_classes().empty());
+}
+
+TEST(StopHashTest, DropModeSkipsStopHashes) {
+    auto index = make_stop_hash_index(StopHashMode::DROP);
+    EXPECT_EQ(index.find_clone_pairs().size(), 1);
+    EXPECT_TRUE(index.find_clone_classes().empty());
+}
+
+TEST(StopHashTest, BuilderThinsStopHashesBeforeFreeze) {
+    const auto files = make_repetitive_files(200);  // 200 * 16 windows of one hash
+
+    for (const auto mode : {StopHashMode::DROP, StopHashMode::SAMPLE}) {
+        HashIndex index;
+        HashIndexBuilder::Config config;
+        config.window_size = 5;
+        config.freeze = true;
+        config.stop_hashes.mode = mode;
+        config.stop_hashes.min_locations = 50;
+        HashIndexBuilder builder(index, config);
+        ThreadPool pool(2);
+        builder.add_files(files, pool);
+        builder.finalize(&pool);
+
+        const auto stats = index.get_stats();
+        EXPECT_GE(stats.stop_hashes, 1);
+        EXPECT_GE(stats.thinned_locations, 200 * 16 - 200);
+
+        // Windows inside the shared run all have the same hash
+        std::vector<uint64_t> run(5, 1);
+        const uint64_t run_hash = HashSequence::compute_all(run, 5, HashFunction::MERSENNE_61)[0];
+        const auto kept = index.get_locations(run_hash).size();
+        if (mode == StopHashMode::DROP) {
+            EXPECT_EQ(kept, 0);
+        } else {
+            EXPECT_GT(kept, 0);
+            EXPECT_LT(kept, 200);
+        }
+    }
+}
+
+TEST(StopHashTest, BuilderKeepsHashesTheSketchOvercounts) {
+    // 4000 distinct filler windows and one hash seen exactly at the
+    // threshold: the builder's sketch is 1024 wide (4e * 4050 / 50 < 1024)
+    constexpr size_t threshold = 50;
+    constexpr uint32_t fillers = 4000;
+    const auto window_hash = [](const uint64_t token) {
+        std::vector<uint64_t> window(1, token);
+        return HashSequence::compute_all(window, 1, HashFunction::MERSENNE_61)[0];
+    };
+    CountMinSketch filler_sketch(1024);
+    for (uint32_t i = 0; i < fillers; ++i) {
+        filler_sketch.add(window_hash(1'000'000 + i));
+    }
+
+    // A token whose window collides with fillers in every row
+    uint64_t colliding = 1;
+    while (filler_sketch.estimate(window_hash(colliding)) == 0) {
+        ++colliding;
+    }
+
+    std::vector<TokenizedFile> files(2);
+    const auto add_token = [](TokenizedFile& file, const uint32_t hash, const uint32_t line) {
+        NormalizedToken tok{};
+        tok.type = TokenType::IDENTIFIER;
+        tok.original_hash = hash;
+        tok.normalized_hash = hash;
+        tok.line = line;
+        tok.column = 1;
+        tok.length = 1;
+        file.tokens.push_back(tok);
+    };
+    files[0].path = "fillers.py";
+    for (uint32_t i = 0; i < fillers; ++i) {
+        add_token(files[0], 1'000'000 + i, i + 1);
+    }
+    files[1].path = "repeated.py";
+    for (uint32_t i = 0; i < threshold; ++i) {
+        add_token(files[1], static_cast<uint32_t>(colliding), i + 1);
+    }
+
+    for (const auto mode : {StopHashMode::DROP, StopHashMode::SAMPLE}) {
+        HashIndex index;
+        HashIndexBuilder::Config config;
+        config.window_size = 1;
+        config.freeze = true;
+        config.stop_hashes.mode = mode;
+        config.stop_hashes.min_locations = threshold;
+        HashIndexBuilder builder(index, config);
+        for (const auto& file : files) {
+            builder.add_file(file, false);
+        }
+        builder.finalize();
+
+        // Estimated above the threshold, but not a stop hash
+        EXPECT_EQ(index.get_locations(window_hash(colliding)).size(), threshold);
+        EXPECT_EQ(index.get_stats().thinned_locations, 0);
+    }
+}
+
+// =============================================================================
+// Singleton Elimination Tests
+// =============================================================================
+
+TEST(BlockedBloomFilterTest, NoFalseNegativesAndLowFalsePositiveRate) {
+    BlockedBloomFilter filter(10000);
+    size_t seen_before = 0;  // Only possible through false positives
+    for (uint64_t key = 0; key < 10000; ++key) {
+        seen_before += filter.insert(key * 7919) ? 1 : 0;
+    }
+    EXPECT_LT(seen_before, 100);
+    for (uint64_t key = 0; key < 10000; ++key) {
+        EXPECT_TRUE(filter.contains(key * 7919));
+        EXPECT_TRUE(filter.insert(key * 7919));
+    }
+
+    size_t false_positives = 0;
+    for (uint64_t key = 1'000'000; key < 1'010'000; ++key) {
+        false_positives += filter.contains(key * 7919) ? 1 : 0;
+    }
+    EXPECT_LT(false_positives, 200);  // Well under 2%
+}
+
+TEST(BlockedBloomFilterTest, ConcurrentInsertReportsNewExactlyOnce) {
+    BlockedBloomFilter filter(1000);
+    ThreadPool pool(4);
+    std::atomic<size_t> new_inserts{0};
+
+    pool.parallel_for(0, 4000, [&](const size_t i) {
+        if (!filter.insert(i % 1000)) {
+            new_inserts++;
+        }
+    });
+
+    // Each key is new once; a false positive can only lower the count
+    EXPECT_LE(new_inserts.load(), 1000);
+    EXPECT_GT(new_inserts.load(), 950);
+}
+
+TEST(HashIndexBuilderTest, DropSingletonsKeepsAllPairs) {
+    // Unique files plus pairs of identical files
+    std::vector<TokenizedFile> files(60);
+    for (uint32_t f = 0; f < files.size(); ++f) {
+        files[f].path = "file" + std::to_string(f) + ".py";
+        const uint32_t content = f < 20 ? f / 2 : f;  // Files 0-19 come in pairs
+        for (uint32_t i = 0; i < 200; ++i) {
+            NormalizedToken tok{};
+            tok.type = TokenType::IDENTIFIER;
+            tok.normalized_hash = (i * 2654435761u) ^ (content << 20);
+            tok.original_hash = tok.normalized_hash;
+            tok.line = i + 1;
+            tok.column = 1;
+            tok.length = 1;
+            files[f].tokens.push_back(tok);
+        }
+    }
+
+    HashIndexBuilder::Config config;
+    config.window_size = 10;
+    config.freeze = true;
+
+    HashIndex full_index;
+    HashIndexBuilder full_builder(full_index, config);
+    for (const auto& file : files) {
+        full_builder.add_file(file, true);
+    }
+    full_builder.finalize();
+
+    config.drop_singletons = true;
+    HashIndex filtered_index;
+    HashIndexBuilder filtered_builder(filtered_index, config);
+    ThreadPool pool(2);
+    filtered_builder.add_files(files, pool, true);
+    filtered_builder.finalize(&pool);
+
+    EXPECT_EQ(filtered_index.find_clone_pairs().size(), full_index.find_clone_pairs().size());
+    EXPECT_LT(filtered_index.memory_bytes() * 2, full_index.memory_bytes());
+
+    const auto stats = filtered_index.get_stats();
+    EXPECT_GE(stats.singletons_dropped, 40 * 191);  // Windows of the unique files
+    EXPECT_LT(stats.singleton_false_positive_rate, 0.05);
+    EXPECT_EQ(stats.singleton_bytes_saved,
+              stats.singletons_dropped * (sizeof(HashLocation) + sizeof(uint64_t) + sizeof(uint32_t)));
+    EXPECT_EQ(full_index.get_stats().singletons_dropped, 0);
+}
+
+TEST_F(HashIndexTest, RemoveFileLocationsAndVisitPairsOfMarkedFiles) {
+    const auto a = index.register_file("a.py");
+    const auto b = index.register_file("b.py");
+    const auto c = index.register_file("c.py");
+    for (const auto file : {a, b, c}) {
+        index.add_hash(7, {file, 0, 10});
+    }
+    index.add_hash(8, {a, 20, 10});
+    index.add_hash(8, {b, 20, 10});
+    index.freeze();
+
+    // Only pairs touching c: (a, c) and (b, c)
+    std::vector<bool> marked = {false, false, true};
+    const std::vector<uint64_t> hashes = {7, 8};
+    std::vector<ClonePair> pairs;
+    index.visit_clone_pairs_of(hashes, marked, [&pairs](std::span<const ClonePair> batch) {
+        pairs.insert(pairs.end(), batch.begin(), batch.end());
+    });
+    ASSERT_EQ(pairs.size(), 2);
+    for (const auto& pair : pairs) {
+        EXPECT_TRUE(pair.location_a.file_id == c || pair.location_b.file_id == c);
+    }
+
+    // Removal thaws the index; emptied buckets disappear
+    EXPECT_EQ(index.remove_file_locations(b, std::vector<uint64_t>{7, 8}), 2);
+    EXPECT_FALSE(index.is_frozen());
+    EXPECT_EQ(index.location_count(), 3);
+    EXPECT_EQ(index.get_locations(7).size(), 2);
+    EXPECT_EQ(index.get_locations(8).size(), 1);
+    EXPECT_EQ(index.remove_file_locations(a, std::vector<uint64_t>{8}), 1);
+    EXPECT_TRUE(index.get_locations(8).empty());
+    EXPECT_EQ(index.hash_count(), 1);
+}
+
+TEST_F(HashIndexTest, RemoveFileTombstonesUntilCompaction) {
+    const uint32_t a = index.register_file("a.cpp");
+    const uint32_t b = index.register_file("b.cpp");
+    const uint32_t c = index.register_file("c.cpp");
+    index.add_hash(7, {a, 0, 10});
+    index.add_hash(7, {b, 0, 10});
+    index.add_hash(7, {c, 0, 10});
+    index.add_hash(8, {a, 20, 10});
+    index.add_hash(8, {b, 20, 10});
+    index.freeze();
+    index.set_compaction_threshold(1.0);
+
+    index.remove_file(b);
+    EXPECT_TRUE(index.is_removed(b));
+    EXPECT_TRUE(index.is_frozen());
+    EXPECT_TRUE(index.get_file_path(b).empty());
+    EXPECT_EQ(index.tombstoned_locations(), 2);
+    EXPECT_DOUBLE_EQ(index.tombstone_ratio(), 0.4);
+    EXPECT_EQ(index.location_count(), 3);
+    EXPECT_EQ(index.get_locations(7).size(), 2);
+    EXPECT_EQ(index.get_locations(8).size(), 1);
+    EXPECT_EQ(index.live_location_count(7), 2);
+    EXPECT_EQ(index.live_location_count(8), 1);
+    EXPECT_EQ(index.live_location_count(9), 0);
+    std::vector<uint32_t> live_files;
+    index.for_each_live_location(7, [&](const HashLocation& location) {
+        live_files.push_back(location.file_id);
+    });
+    EXPECT_EQ(live_files, (std::vector<uint32_t>{a, c}));
+
+    // Only (a, c) on hash 7 is left; hash 8 has a single live location
+    const auto pairs = index.find_clone_pairs();
+    ASSERT_EQ(pairs.size(), 1);
+    EXPECT_EQ(pairs[0].location_a.file_id, a);
+    EXPECT_EQ(pairs[0].location_b.file_id, c);
+
+    // The tombstoned ID is not handed out while its locations are stored
+    const uint32_t d = index.register_file("d.cpp");
+    EXPECT_EQ(d, 3);
+
+    index.compact();
+    EXPECT_EQ(index.tombstoned_locations(), 0);
+    EXPECT_EQ(index.location_count(), 3);
+    EXPECT_EQ(index.hash_count(), 2);
+    EXPECT_EQ(index.register_file("e.cpp"), b);
+    EXPECT_FALSE(index.is_removed(b));
+    EXPECT_EQ(index.get_file_path(b), "e.cpp");
+    EXPECT_EQ(index.get_locations(7).size(), 2);
+
+    // Mutable layout: compaction erases tombstoned locations in place
+    index.add_hash(8, {b, 5, 10});
+    index.remove_file(a);
+    EXPECT_FALSE(index.is_frozen());
+    EXPECT_EQ(index.get_locations(8).size(), 1);
+    index.compact();
+    EXPECT_EQ(index.location_count(), 2);
+    EXPECT_EQ(index.hash_count(), 2);
+}
+
+TEST(HashIndexCompactionTest, BackgroundCompactionMatchesSynchronous) {
+    // 20 files sharing 150 hashes: enough buckets for the parallel visitor
+    HashIndex index;
+    std::vector<HashRecord> records;
+    for (uint32_t f = 0; f < 20; ++f) {
+        index.register_file("file" + std::to_string(f) + ".cpp");
+        for (uint32_t h = 0; h < 150; ++h) {
+            records.push_back({1000 + h, {f, h, 10}});
+        }
+    }
+    index.freeze(std::move(records));
+    index.set_compaction_threshold(1.0);
+
+    for (const uint32_t f : {2u, 5u, 11u}) {
+        index.remove_file(f);
+    }
+    HashIndex sync_index = index;
+    sync_index.compact();
+
+    ThreadPool pool(2);
+    index.compact_async(pool);
+    ASSERT_TRUE(index.compaction_pending());
+
+    // Reads keep working against the snapshot while compaction runs
+    EXPECT_EQ(index.get_locations(1000).size(), 17);
+    EXPECT_EQ(index.find_clone_pairs_parallel(pool).size(), index.find_clone_pairs().size());
+
+    // Removed after the snapshot: still tombstoned once the result is installed
+    index.remove_file(7);
+    index.finish_compaction();
+    EXPECT_FALSE(index.compaction_pending());
+    EXPECT_EQ(index.tombstoned_locations(), 150);
+    EXPECT_EQ(index.location_count(), 16 * 150);
+    EXPECT_EQ(index.find_clone_pairs().size(), 150u * (16 * 15 / 2));
+
+    sync_index.remove_file(7);
+    sync_index.compact();
+    index.compact();
+    EXPECT_EQ(index.tombstoned_locations(), 0);
+    EXPECT_EQ(index.memory_bytes(), sync_index.memory_bytes());
+    for (uint64_t hash = 1000; hash < 1150; ++hash) {
+        const auto expected = sync_index.get_locations(hash);
+        const auto actual = index.get_locations(hash);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            EXPECT_EQ(actual[i].file_id, expected[i].file_id);
+            EXPECT_EQ(actual[i].token_start, expected[i].token_start);
+        }
+    }
+}
+
+TEST(HashIndexCompactionTest, RemoveFileCompactsAtThreshold) {
+    HashIndex index;
+    std::vector<HashRecord> records;
+    for (uint32_t f = 0; f < 8; ++f) {
+        index.register_file("file" + std::to_string(f) + ".cpp");
+        records.push_back({42, {f, 0, 10}});
+    }
+    index.freeze(std::move(records));
+
+    ThreadPool pool(2);
+    index.remove_file(0, &pool);
+    EXPECT_EQ(index.tombstoned_locations(), 1);
+    EXPECT_FALSE(index.compaction_pending());
+
+    // 2 of 8 locations tombstoned reaches the default 0.25 ratio
+    index.remove_file(1, &pool);
+    EXPECT_TRUE(index.compaction_pending());
+    index.finish_compaction();
+    EXPECT_EQ(index.tombstoned_locations(), 0);
+    EXPECT_EQ(index.location_count(), 6);
+
+    // Without a pool the compaction runs immediately
+    index.set_compaction_threshold(0.1);
+    index.remove_file(2);
+    EXPECT_FALSE(index.compaction_pending());
+    EXPECT_EQ(index.tombstoned_locations(), 0);
+    EXPECT_EQ(index.get_locations(42).size(), 5);
+    EXPECT_EQ(index.register_file("new.cpp"), 2);
+}
+
+// =============================================================================
+// MinHash LSH Tests
+// =============================================================================
+
+namespace {
+
+std::vector<uint64_t> shingle_range(const uint64_t begin, const uint64_t end) {
+    std::vector<uint64_t> shingles;
+    for (uint64_t value = begin; value < end; ++value) {
+        shingles.push_back(value * 0x9E3779B97F4A7C15ULL);
+    }
+    return shingles;
+}
+
+}  // anonymous namespace
+
+TEST(MinHashLSHTest, SignatureAgreementTracksJaccardSimilarity) {
+    MinHashLSH::Config config;
+    config.signature_size = 512;
+    MinHashLSH lsh(config);
+
+    const auto a = lsh.signature(shingle_range(0, 1000));
+    ASSERT_EQ(a.size(), 512);
+    EXPECT_DOUBLE_EQ(MinHashLSH::estimate_similarity(a, lsh.signature(shingle_range(0, 1000))), 1.0);
+
+    // Jaccard 500 / 1500
+    const auto b = lsh.signature(shingle_range(500, 1500));
+    EXPECT_NEAR(MinHashLSH::estimate_similarity(a, b), 1.0 / 3.0, 0.08);
+
+    const auto c = lsh.signature(shingle_range(5000, 6000));
+    EXPECT_LT(MinHashLSH::estimate_similarity(a, c), 0.05);
+
+    // Fewer shingles than bins: densification still fills every bin
+    const auto small = lsh.signature(shingle_range(0, 20));
+    ASSERT_EQ(small.size(), 512);
+    EXPECT_DOUBLE_EQ(MinHashLSH::estimate_similarity(small, lsh.signature(shingle_range(0, 20))), 1.0);
+
+    EXPECT_TRUE(lsh.signature(std::span<const uint64_t>{}).empty());
+    EXPECT_EQ(MinHashLSH::estimate_similarity(a, {}), 0.0);
+}
+
+TEST(MinHashLSHTest, CandidatePairsKeepOnlyNearDuplicates) {
+    MinHashLSH lsh;
+    std::vector<std::vector<uint64_t>> signatures = {
+        lsh.signature(shingle_range(0, 1000)),
+        lsh.signature(shingle_range(10'000, 11'000)),
+        lsh.signature(shingle_range(50, 1050)),       // ~90% like file 0
+        {},                                           // Too short to sign
+        lsh.signature(shingle_range(10'100, 11'100)), // ~82% like file 1
+        lsh.signature(shingle_range(90'000, 91'000)),
+    };
+
+    const auto pairs = lsh.candidate_pairs(signatures);
+    ASSERT_EQ(pairs.size(), 2);
+    EXPECT_EQ(pairs[0].file_a, 0);
+    EXPECT_EQ(pairs[0].file_b, 2);
+    EXPECT_GT(pairs[0].similarity, 0.7);
+    EXPECT_EQ(pairs[1].file_a, 1);
+    EXPECT_EQ(pairs[1].file_b, 4);
+    EXPECT_GT(pairs[1].similarity, 0.6);
+
+    ThreadPool pool(4);
+    const auto parallel = lsh.candidate_pairs(signatures, &pool);
+    ASSERT_EQ(parallel.size(), pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        EXPECT_EQ(parallel[i].file_a, pairs[i].file_a);
+        EXPECT_EQ(parallel[i].file_b, pairs[i].file_b);
+        EXPECT_DOUBLE_EQ(parallel[i].similarity, pairs[i].similarity);
+    }
+}
+
+// =============================================================================
+// External Index Tests
+// =============================================================================
+
+TEST(ExternalHashIndexTest, SpilledRunsMatchFrozenIndex) {
+    // 20 files of 200 windows: many shared hashes plus one stop hash
+    std::vector<HashRecord> records;
+    for (uint32_t file = 0; file < 20; ++file) {
+        for (uint32_t pos = 0; pos < 200; ++pos) {
+            const uint64_t hash = pos % 50 == 0 ? 7777 : (file * 31 + pos) % 1000;
+            records.push_back({hash, HashLocation{file, pos, 5}});
+        }
+    }
+
+    StopHashPolicy policy;
+    policy.min_locations = 50;
+
+    HashIndex index;
+    index.set_stop_hash_policy(policy);
+    index.freeze(records);
+
+    const auto spill_dir = std::filesystem::temp_directory_path() / "aegis_spill_test";
+    std::filesystem::remove_all(spill_dir);
+    std::filesystem::create_directories(spill_dir);
+    {
+        ExternalHashIndex::Config config;
+        config.memory_budget_bytes = 100 * sizeof(HashRecord);
+        config.spill_dir = spill_dir;
+        config.merge_fan_in = 3;
+        ExternalHashIndex external(config);
+        external.set_stop_hash_policy(policy);
+        for (size_t begin = 0; begin < records.size(); begin += 64) {
+            const size_t count = std::min<size_t>(64, records.size() - begin);
+            external.add_records(std::span(records).subspan(begin, count));
+        }
+        EXPECT_EQ(external.location_count(), records.size());
+        EXPECT_EQ(external.stop_hash_threshold(), index.stop_hash_threshold());
+
+        // Same buckets, same location order
+        const auto key = [](const HashLocation& loc) {
+            return std::tuple(loc.file_id, loc.token_start, loc.token_count);
+        };
+        std::vector<std::pair<uint64_t, std::vector<HashLocation>>> expected;
+        index.for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+            expected.emplace_back(hash, std::vector<HashLocation>(locations.begin(), locations.end()));
+        });
+        size_t bucket = 0;
+        external.for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+            ASSERT_LT(bucket, expected.size());
+            EXPECT_EQ(hash, expected[bucket].first);
+            ASSERT_EQ(locations.size(), expected[bucket].second.size());
+            for (size_t i = 0; i < locations.size(); ++i) {
+                EXPECT_EQ(key(locations[i]), key(expected[bucket].second[i]));
+            }
+            ++bucket;
+        });
+        EXPECT_EQ(bucket, expected.size());
+
+        const auto& spilled = external.spill_stats();
+        EXPECT_GT(spilled.runs, 40);
+        EXPECT_GT(spilled.merge_passes, 0);
+        EXPECT_GE(spilled.bytes, records.size() * sizeof(HashRecord));
+
+        // Same pairs and stop hash classes in one merge
+        const auto pair_key = [&](const ClonePair& pair) {
+            return std::tuple(key(pair.location_a), key(pair.location_b), pair.shared_hash);
+        };
+        std::vector<ClonePair> frozen_pairs;
+        index.visit_clone_pairs([&](std::span<const ClonePair> batch) {
+            frozen_pairs.insert(frozen_pairs.end(), batch.begin(), batch.end());
+        }, 500);
+        std::vector<ClonePair> external_pairs;
+        std::vector<CloneClass> classes;
+        const auto stats = external.visit_clone_pairs([&](std::span<const ClonePair> batch) {
+            external_pairs.insert(external_pairs.end(), batch.begin(), batch.end());
+        }, &classes, 500);
+        EXPECT_EQ(stats.pairs, frozen_pairs.size());
+        ASSERT_EQ(external_pairs.size(), frozen_pairs.size());
+        for (size_t i = 0; i < frozen_pairs.size(); ++i) {
+            EXPECT_EQ(pair_key(external_pairs[i]), pair_key(frozen_pairs[i]));
+        }
+
+        const auto frozen_classes = index.find_clone_classes();
+        ASSERT_EQ(classes.size(), 1);
+        ASSERT_EQ(frozen_classes.size(), 1);
+        EXPECT_EQ(classes[0].shared_hash, 7777);
+        EXPECT_EQ(classes[0].locations.size(), frozen_classes[0].locations.size());
+    }
+
+    // Run files go away with the index
+    EXPECT_TRUE(std::filesystem::is_empty(spill_dir));
+    std::filesystem::remove_all(spill_dir);
+}
+
+TEST(ExternalHashIndexTest, SmallInputStaysInMemory) {
+    ExternalHashIndex external;
+    const std::vector<HashRecord> records = {
+        {5, HashLocation{1, 0, 5}},
+        {3, HashLocation{0, 0, 5}},
+        {5, HashLocation{0, 8, 5}},
+    };
+    external.add_records(records);
+
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> files_of_5;
+    external.for_each_bucket([&](const uint64_t hash, std::span<const HashLocation> locations) {
+        hashes.push_back(hash);
+        if (hash == 5) {
+            for (const auto& loc : locations) {
+                files_of_5.push_back(loc.file_id);
+            }
+        }
+    });
+    EXPECT_EQ(hashes, (std::vector<uint64_t>{3, 5}));
+    EXPECT_EQ(files_of_5, (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(external.spill_stats().runs, 0);
+    EXPECT_EQ(external.spill_stats().bytes, 0);
+}
+
+// =============================================================================
+// Index File Tests
+// =============================================================================
+
+TEST(IndexFileTest, SaveAndOpenRoundTrip) {
+    HashIndex index;
+    const auto a = index.register_file("a.py");
+    const auto b = index.register_file("b.py");
+    for (uint32_t i = 0; i < 50; ++i) {
+        index.add_hash(1000 + i, {a, i, 10});
+        index.add_hash(1000 + i, {b, i + 4, 10});
+        index.add_hash(5000 + i, {a, i + 60, 10});
+    }
+
+    IndexFileInfo info;
+    info.config_fingerprint = 0xfeedULL;
+    info.files = {{"a.py", 11, 100, 1234}, {"b.py", 22, 200, 5678}};
+
+    const auto path = std::filesystem::temp_directory_path() / "aegis_index_roundtrip.aidx";
+    index.save(path, info);  // Mutable index: saved through a frozen copy
+    EXPECT_FALSE(index.is_frozen());
+
+    IndexFileInfo loaded_info;
+    const auto loaded = HashIndex::open(path, &loaded_info);
+    EXPECT_TRUE(loaded.is_frozen());
+    EXPECT_TRUE(loaded.is_mapped());
+    EXPECT_EQ(loaded_info.config_fingerprint, 0xfeedULL);
+    ASSERT_EQ(loaded_info.files.size(), 2);
+    EXPECT_EQ(loaded_info.files[1].path, "b.py");
+    EXPECT_EQ(loaded_info.files[1].content_hash, 22);
+    EXPECT_EQ(loaded_info.files[1].mtime, 200);
+    EXPECT_EQ(loaded_info.files[1].size, 5678);
+    EXPECT_EQ(loaded.file_count(), 2);
+    EXPECT_EQ(loaded.get_file_path(b), "b.py");
+
+    EXPECT_EQ(loaded.hash_count(), index.hash_count());
+    EXPECT_EQ(loaded.location_count(), index.location_count());
+    const auto locations = loaded.get_locations(1010);
+    ASSERT_EQ(locations.size(), 2);
+    EXPECT_EQ(locations[1].file_id, b);
+    EXPECT_EQ(locations[1].token_start, 14);
+    EXPECT_TRUE(loaded.get_locations(4242).empty());
+    EXPECT_EQ(loaded.find_clone_pairs().size(), index.find_clone_pairs().size());
+
+    // Writing to a mapped index copies it out of the mapping first
+    auto mutable_copy = HashIndex::open(path);
+    mutable_copy.add_hash(1010, {a, 99, 10});
+    EXPECT_FALSE(mutable_copy.is_mapped());
+    EXPECT_EQ(mutable_copy.get_locations(1010).size(), 3);
+
+    std::filesystem::remove(path);
+}
+
+TEST(IndexFileTest, OpenRejectsInvalidFiles) {
+    const auto path = std::filesystem::temp_directory_path() / "aegis_index_invalid.aidx";
+
+    EXPECT_THROW(HashIndex::open(path.string() + ".missing"), std::runtime_error);
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << std::string(256, 'x');
+    }
+    EXPECT_THROW(HashIndex::open(path), std::runtime_error);
+
+    // A valid file cut short must be rejected, not read out of bounds
+    HashIndex index;
+    index.register_file("a.py");
+    for (uint32_t i = 0; i < 100; ++i) {
+        index.add_hash(i, {0, i, 10});
+        index.add_hash(i, {0, i + 200, 10});
+    }
+    index.save(path, {0, {{"a.py", 1, 0, 10}}});
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+    EXPECT_THROW(HashIndex::open(path), std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
 // =============================================================================
 // Performance Benchmark Tests
 // =============================================================================
@@ -624,8 +1538,6 @@ TEST(HashIndexBenchmarkTest, DISABLED_BenchmarkSequentialVsParallel) {
             loc.file_id = files[i];
             loc.token_start = static_cast<uint32_t>((hash - 1000) * 20);
             loc.token_count = 15;
-            loc.start_line = static_cast<uint32_t>(hash - 1000 + 1);
-            loc.end_line = loc.start_line + 10;
             index.add_hash(hash, loc);
         }
     }
@@ -666,3 +1578,134 @@ TEST(HashIndexBenchmarkTest, DISABLED_BenchmarkSequentialVsParallel) {
         std::cout << "Clone pairs found: " << parallel_pairs.size() << "\n";
     }
 }
+
+TEST(HashIndexBenchmarkTest, DISABLED_BenchmarkIndexBuild) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*Benchmark*"
+
+    std::vector<TokenizedFile> files(400);
+    for (size_t f = 0; f < files.size(); ++f) {
+        files[f].path = "file" + std::to_string(f) + ".py";
+        for (uint32_t i = 0; i < 5000; ++i) {
+            NormalizedToken tok{};
+            tok.type = TokenType::IDENTIFIER;
+            tok.normalized_hash = (i * 2654435761u) ^ static_cast<uint32_t>(f << 16);
+            tok.original_hash = tok.normalized_hash;
+            tok.line = i / 10 + 1;
+            tok.column = 1;
+            tok.length = 3;
+            files[f].tokens.push_back(tok);
+        }
+    }
+
+    HashIndexBuilder::Config config;
+    config.window_size = 10;
+    config.freeze = true;
+
+    HashIndex sequential_index;
+    auto seq_start = std::chrono::high_resolution_clock::now();
+    HashIndexBuilder sequential_builder(sequential_index, config);
+    for (const auto& file : files) {
+        sequential_builder.add_file(file, true);
+    }
+    sequential_builder.finalize();
+    auto seq_end = std::chrono::high_resolution_clock::now();
+    auto seq_ms = std::chrono::duration_cast<std::chrono::milliseconds>(seq_end - seq_start).count();
+
+    std::cout << "\n=== Index build (" << sequential_index.location_count() << " locations) ===\n";
+    std::cout << "Sequential: " << seq_ms << " ms\n";
+
+    for (size_t threads : {2, 4, 8}) {
+        ThreadPool pool(threads);
+        HashIndex parallel_index;
+
+        auto par_start = std::chrono::high_resolution_clock::now();
+        HashIndexBuilder parallel_builder(parallel_index, config);
+        parallel_builder.add_files(files, pool, true);
+        parallel_builder.finalize(&pool);
+        auto par_end = std::chrono::high_resolution_clock::now();
+        auto par_ms = std::chrono::duration_cast<std::chrono::milliseconds>(par_end - par_start).count();
+
+        EXPECT_EQ(parallel_index.location_count(), sequential_index.location_count());
+        std::cout << threads << " threads: " << par_ms << " ms\n";
+    }
+
+    // Two-pass build that drops singleton windows first
+    config.drop_singletons = true;
+    HashIndex filtered_index;
+    const auto filter_start = std::chrono::high_resolution_clock::now();
+    HashIndexBuilder filtered_builder(filtered_index, config);
+    for (const auto& file : files) {
+        filtered_builder.add_file(file, true);
+    }
+    filtered_builder.finalize();
+    const auto filter_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - filter_start).count();
+
+    const auto stats = filtered_index.get_stats();
+    std::cout << "Drop singletons: " << filter_ms << " ms, "
+              << filtered_index.memory_bytes() << " bytes vs "
+              << sequential_index.memory_bytes() << " bytes ("
+              << stats.singletons_dropped << " dropped, false-positive rate "
+              << stats.singleton_false_positive_rate << ")\n";
+}
+
+TEST(HashIndexBenchmarkTest, DISABLED_BenchmarkHashingAndExtension) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*HashingAndExtension*"
+
+    // Python-like streams: a NEWLINE after every 8 tokens, INDENT/DEDENT now and then
+    std::vector<TokenizedFile> files(200);
+    for (size_t f = 0; f < files.size(); ++f) {
+        files[f].path = "file" + std::to_string(f) + ".py";
+        for (uint32_t i = 0; i < 20000; ++i) {
+            NormalizedToken tok{};
+            tok.type = i % 9 == 8 ? TokenType::NEWLINE
+                     : i % 97 == 40 ? TokenType::INDENT
+                     : i % 97 == 80 ? TokenType::DEDENT : TokenType::IDENTIFIER;
+            // Files share a common body so extension has runs to follow
+            tok.original_hash = ((i % 4096) * 2654435761u) ^ (i % 61 == 0 ? static_cast<uint32_t>(f) : 0u);
+            tok.normalized_hash = tok.original_hash % 509;
+            tok.line = i / 9 + 1;
+            tok.column = static_cast<uint16_t>(i % 9 * 4);
+            tok.length = 3;
+            files[f].tokens.push_back(tok);
+        }
+    }
+
+    HashIndex index;
+    HashIndexBuilder::Config config;
+    config.window_size = 10;
+    const HashIndexBuilder builder(index, config);
+
+    const auto hash_start = std::chrono::high_resolution_clock::now();
+    size_t records = 0;
+    for (int round = 0; round < 5; ++round) {
+        for (size_t f = 0; f < files.size(); ++f) {
+            records += builder.collect_records(files[f], static_cast<uint32_t>(f), round % 2 == 0).size();
+        }
+    }
+    const auto hash_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - hash_start).count();
+
+    CloneExtender::Config extender_config;
+    extender_config.min_similarity = 0.5f;
+    const CloneExtender extender(extender_config);
+
+    const auto extend_start = std::chrono::high_resolution_clock::now();
+    size_t extended_tokens = 0;
+    for (size_t f = 1; f < files.size(); ++f) {
+        for (uint32_t start = 0; start + 500 < 20000; start += 500) {
+            ClonePair seed;
+            seed.location_a = {0, start, 10};
+            seed.location_b = {static_cast<uint32_t>(f), start, 10};
+            extended_tokens += extender.extend(seed, files[0], files[f]).token_count();
+        }
+    }
+    const auto extend_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - extend_start).count();
+
+    std::cout << "\n=== Hashing and extension (" << files.size() << " files x 20000 tokens) ===\n";
+    std::cout << "collect_records x5: " << hash_ms << " ms (" << records << " records)\n";
+    std::cout << "extend:             " << extend_ms << " ms (" << extended_tokens << " tokens)\n";
+}
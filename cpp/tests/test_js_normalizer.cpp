@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "tokenizers/js_normalizer.hpp"
+#include "utils/thread_pool.hpp"
+#include <algorithm>
 
 using namespace aegis::similarity;
 
@@ -334,3 +336,55 @@ TEST_F(JavaScriptNormalizerTest, SupportedExtensions) {
     EXPECT_TRUE(normalizer.supports_extension(".mjs"));
     EXPECT_FALSE(normalizer.supports_extension(".py"));
 }
+
+// =============================================================================
+// Split Tokenization
+// =============================================================================
+
+TEST_F(JavaScriptNormalizerTest, LargeSourceSplitMatchesSequential) {
+    const std::string code =
+        "export function scale(values, limit) {\n"
+        "    // Sum the values up to limit\n"
+        "    let total = 0x1F; /* start */ const name = 'sum\\n';\n"
+        "    const pattern = /[a-z]+\\/x/g;\n"
+        "    for (let i = 0; i < limit; i++) total += values[i] / 2.5e3;\n"
+        "    return total;\n"
+        "}\n\n";
+    const auto append_code = [&](std::string& source, const size_t bytes) {
+        while (source.size() < bytes) {
+            source += code;
+        }
+    };
+
+    // Five pieces cut near 1.2, 2.4, 3.6 and 4.8 MB: the first two cuts
+    // fall inside a comment, the third inside a template literal
+    std::string source;
+    append_code(source, 1 << 20);
+    source += "/*\n";
+    while (source.size() < (13 << 20) / 5) {
+        source += " * let notCode = 1;\n";
+    }
+    source += " */\n";
+    append_code(source, (17 << 20) / 5);
+    source += "const text = `\n";
+    while (source.size() < 4 << 20) {
+        source += "${ { notCode: '1' } } / 2\n";
+    }
+    source += "`;\n";
+    append_code(source, 6 << 20);
+
+    ThreadPool pool(4);
+    const auto sequential = normalizer.normalize(source);
+    const auto split = normalizer.normalize(source, std::pmr::get_default_resource(), pool);
+
+    EXPECT_TRUE(std::ranges::equal(split.tokens.types(), sequential.tokens.types()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.original_hashes(), sequential.tokens.original_hashes()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.normalized_hashes(), sequential.tokens.normalized_hashes()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.lines(), sequential.tokens.lines()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.columns(), sequential.tokens.columns()));
+    EXPECT_TRUE(std::ranges::equal(split.tokens.lengths(), sequential.tokens.lengths()));
+    EXPECT_EQ(split.total_lines, sequential.total_lines);
+    EXPECT_EQ(split.code_lines, sequential.code_lines);
+    EXPECT_EQ(split.comment_lines, sequential.comment_lines);
+    EXPECT_EQ(split.blank_lines, sequential.blank_lines);
+}
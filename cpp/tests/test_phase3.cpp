@@ -1,11 +1,22 @@
 #include <gtest/gtest.h>
 #include "core/clone_extender.hpp"
+#include "core/rolling_hash.hpp"
 #include "utils/thread_pool.hpp"
 #include "utils/lru_cache.hpp"
+#include "utils/analysis_arena.hpp"
+#include "tokenizers/python_normalizer.hpp"
+#include "tokenizers/byte_scan.hpp"
+#include "tokenizers/chunked_scan.hpp"
+#include "tokenizers/keyword_table.hpp"
+#include "tokenizers/token_normalizer.hpp"
+#include <algorithm>
 #include <vector>
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <random>
+#include <cstdlib>
+#include <iostream>
 
 using namespace aegis::similarity;
 
@@ -218,6 +229,50 @@ TEST_F(ThreadPoolTest, SingleElementParallelFor) {
     EXPECT_EQ(called, 1);
 }
 
+// =============================================================================
+// Analysis Arena Tests
+// =============================================================================
+
+TEST(AnalysisArenaTest, ThreadsAllocateFromOwnSubArenas) {
+    PythonNormalizer normalizer;
+    const std::string source =
+        "def total(values):\n"
+        "    result = 0\n"
+        "    for value in values:\n"
+        "        result += value\n"
+        "    return result\n";
+    const auto expected = normalizer.normalize(source);
+
+    TokenizedFile copy;
+    {
+        AnalysisArena arena;
+        ThreadPool pool(4);
+        // Constructed in place, so the tokens stay in the arena
+        std::vector<std::optional<TokenizedFile>> files(64);
+        pool.parallel_for(0, files.size(), [&](size_t i) {
+            files[i].emplace(normalizer.normalize(source, arena.resource()));
+        });
+
+        for (const auto& file : files) {
+            ASSERT_EQ(file->tokens.size(), expected.tokens.size());
+            EXPECT_TRUE(std::ranges::equal(file->tokens, expected.tokens));
+            EXPECT_TRUE(std::ranges::equal(file->tokens.significant_hashes(true),
+                                           expected.tokens.significant_hashes(true)));
+        }
+
+        const auto stats = arena.stats();
+        EXPECT_GE(stats.sub_arenas, 1);
+        EXPECT_LE(stats.sub_arenas, 4);
+        EXPECT_GE(stats.allocations, files.size());
+        EXPECT_LT(stats.heap_allocations, stats.allocations);
+        EXPECT_GT(stats.high_water_bytes, 0);
+
+        // Copies leave the arena
+        copy = *files.front();
+    }
+    EXPECT_TRUE(std::ranges::equal(copy.tokens, expected.tokens));
+}
+
 // =============================================================================
 // Clone Extender Tests
 // =============================================================================
@@ -331,13 +386,9 @@ TEST_F(CloneExtenderTest, ExtendBasic) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 2;
     seed.location_a.token_count = 3;
-    seed.location_a.start_line = 3;
-    seed.location_a.end_line = 5;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 2;
     seed.location_b.token_count = 3;
-    seed.location_b.start_line = 3;
-    seed.location_b.end_line = 5;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -382,13 +433,9 @@ TEST_F(CloneExtenderTest, ExtendForwardAtEndOfFile) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 3;  // Tokens 4,5
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 4;
-    seed.location_a.end_line = 5;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 3;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 4;
-    seed.location_b.end_line = 5;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -416,13 +463,9 @@ TEST_F(CloneExtenderTest, ExtendBackwardAtStartOfFile) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 0;  // Tokens 1,2
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 1;
-    seed.location_a.end_line = 2;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 0;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 1;
-    seed.location_b.end_line = 2;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -453,13 +496,9 @@ TEST_F(CloneExtenderTest, ExtendWithMaxGapReached) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 0;
     seed.location_a.token_count = 2;  // Match on 1,2
-    seed.location_a.start_line = 1;
-    seed.location_a.end_line = 2;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 0;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 1;
-    seed.location_b.end_line = 2;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -489,13 +528,9 @@ TEST_F(CloneExtenderTest, ExtendWithSmallGap) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 0;
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 1;
-    seed.location_a.end_line = 2;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 0;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 1;
-    seed.location_b.end_line = 2;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -523,13 +558,9 @@ TEST_F(CloneExtenderTest, ExtendNoMatchingTokens) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 2;  // The two 5's
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 3;
-    seed.location_a.end_line = 4;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 2;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 3;
-    seed.location_b.end_line = 4;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -557,13 +588,9 @@ TEST_F(CloneExtenderTest, ExtendSingleTokenClone) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 2;  // Just token 3
     seed.location_a.token_count = 1;
-    seed.location_a.start_line = 3;
-    seed.location_a.end_line = 3;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 2;
     seed.location_b.token_count = 1;
-    seed.location_b.start_line = 3;
-    seed.location_b.end_line = 3;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -621,13 +648,9 @@ TEST_F(CloneExtenderTest, ExtendAllSinglePair) {
     pair.location_a.file_id = 0;
     pair.location_a.token_start = 1;
     pair.location_a.token_count = 3;
-    pair.location_a.start_line = 2;
-    pair.location_a.end_line = 4;
     pair.location_b.file_id = 1;
     pair.location_b.token_start = 1;
     pair.location_b.token_count = 3;
-    pair.location_b.start_line = 2;
-    pair.location_b.end_line = 4;
     pair.similarity = 1.0f;
     pair.clone_type = CloneType::TYPE_1;
 
@@ -668,26 +691,18 @@ TEST_F(CloneExtenderTest, ExtendAllMultiplePairs) {
     pair1.location_a.file_id = 0;
     pair1.location_a.token_start = 0;
     pair1.location_a.token_count = 3;
-    pair1.location_a.start_line = 1;
-    pair1.location_a.end_line = 3;
     pair1.location_b.file_id = 1;
     pair1.location_b.token_start = 0;
     pair1.location_b.token_count = 3;
-    pair1.location_b.start_line = 1;
-    pair1.location_b.end_line = 3;
     pair1.similarity = 1.0f;
 
     ClonePair pair2;
     pair2.location_a.file_id = 0;
     pair2.location_a.token_start = 0;
     pair2.location_a.token_count = 3;
-    pair2.location_a.start_line = 1;
-    pair2.location_a.end_line = 3;
     pair2.location_b.file_id = 2;
     pair2.location_b.token_start = 0;
     pair2.location_b.token_count = 3;
-    pair2.location_b.start_line = 1;
-    pair2.location_b.end_line = 3;
     pair2.similarity = 1.0f;
 
     std::vector<ClonePair> pairs = {pair1, pair2};
@@ -722,13 +737,9 @@ TEST_F(CloneExtenderTest, ExtendAllFiltersSmallClones) {
     pair.location_a.file_id = 0;
     pair.location_a.token_start = 0;
     pair.location_a.token_count = 3;
-    pair.location_a.start_line = 1;
-    pair.location_a.end_line = 3;
     pair.location_b.file_id = 1;
     pair.location_b.token_start = 0;
     pair.location_b.token_count = 3;
-    pair.location_b.start_line = 1;
-    pair.location_b.end_line = 3;
     pair.similarity = 1.0f;
 
     std::vector<ClonePair> pairs = {pair};
@@ -761,13 +772,9 @@ TEST_F(CloneExtenderTest, ExtendAllMissingFile) {
     pair.location_a.file_id = 0;  // file_a - exists
     pair.location_a.token_start = 0;
     pair.location_a.token_count = 3;
-    pair.location_a.start_line = 1;
-    pair.location_a.end_line = 3;
     pair.location_b.file_id = 1;  // file_b - NOT in files vector
     pair.location_b.token_start = 0;
     pair.location_b.token_count = 3;
-    pair.location_b.start_line = 1;
-    pair.location_b.end_line = 3;
     pair.similarity = 1.0f;
 
     std::vector<ClonePair> pairs = {pair};
@@ -867,28 +874,30 @@ TEST_F(CloneExtenderTest, ExtendUpdatesLineNumbers) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 4;  // Token 5
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 5;
-    seed.location_a.end_line = 6;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 4;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 5;
-    seed.location_b.end_line = 6;
     seed.similarity = 1.0f;
 
     auto extended = extender.extend(seed, file_a, file_b);
 
+    // Line numbers come from the token store
+    const auto seed_span = file_a.tokens.source_span(seed.location_a);
+    const auto extended_span = file_a.tokens.source_span(extended.location_a);
+    EXPECT_EQ(seed_span.start_line, 5);
+    EXPECT_EQ(seed_span.end_line, 6);
+
     // Line numbers should be updated if extended
     if (extended.location_a.token_count > seed.location_a.token_count) {
         // If extended backward, start_line should decrease
         if (extended.location_a.token_start < seed.location_a.token_start) {
-            EXPECT_LT(extended.location_a.start_line, seed.location_a.start_line);
+            EXPECT_LT(extended_span.start_line, seed_span.start_line);
         }
         // If extended forward, end_line should increase
         uint32_t seed_end = seed.location_a.token_start + seed.location_a.token_count;
         uint32_t ext_end = extended.location_a.token_start + extended.location_a.token_count;
         if (ext_end > seed_end) {
-            EXPECT_GT(extended.location_a.end_line, seed.location_a.end_line);
+            EXPECT_GT(extended_span.end_line, seed_span.end_line);
         }
     }
 }
@@ -910,13 +919,9 @@ TEST_F(CloneExtenderTest, ExtendDeterminesCloneType) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 0;
     seed.location_a.token_count = 2;
-    seed.location_a.start_line = 1;
-    seed.location_a.end_line = 2;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 0;
     seed.location_b.token_count = 2;
-    seed.location_b.start_line = 1;
-    seed.location_b.end_line = 2;
     seed.similarity = 1.0f;
     seed.clone_type = CloneType::TYPE_1;
 
@@ -946,13 +951,9 @@ TEST_F(CloneExtenderTest, ExtendRejectsLowSimilarity) {
     seed.location_a.file_id = 0;
     seed.location_a.token_start = 0;
     seed.location_a.token_count = 3;  // Matches 1,2,3
-    seed.location_a.start_line = 1;
-    seed.location_a.end_line = 3;
     seed.location_b.file_id = 1;
     seed.location_b.token_start = 0;
     seed.location_b.token_count = 3;
-    seed.location_b.start_line = 1;
-    seed.location_b.end_line = 3;
     seed.similarity = 1.0f;
 
     auto extended = extender.extend(seed, file_a, file_b);
@@ -983,3 +984,302 @@ TEST_F(ThreadPoolTest, ThreadSafeLRUCache) {
     // Should have many successful operations
     EXPECT_GT(success_count.load(), 500);
 }
+
+// =============================================================================
+// Keyword Table Tests
+// =============================================================================
+
+TEST(KeywordTableTest, ClassifiesListedWordsOnly) {
+    constexpr auto keywords = std::to_array<std::string_view>({
+        "if", "else", "for", "while", "return", "class", "def", "lambda"});
+    constexpr auto types = std::to_array<std::string_view>({
+        "int", "str", "dict", "else"});
+    constexpr KeywordTable table{
+        TaggedWords{TokenType::KEYWORD, keywords},
+        TaggedWords{TokenType::TYPE, types},
+    };
+
+    // Built at compile time
+    static_assert(table.classify("while") == TokenType::KEYWORD);
+    static_assert(table.classify("whilst") == TokenType::IDENTIFIER);
+
+    for (const auto word : keywords) {
+        EXPECT_EQ(table.classify(word), TokenType::KEYWORD) << word;
+    }
+    EXPECT_EQ(table.classify("int"), TokenType::TYPE);
+    EXPECT_EQ(table.classify("dict"), TokenType::TYPE);
+
+    // A word in two lists keeps the type of the first
+    EXPECT_EQ(table.classify("else"), TokenType::KEYWORD);
+
+    // Prefixes, extensions, case variants and other lengths are identifiers
+    for (const std::string_view word : {"", "i", "f", "iff", "Int", "For", "retur",
+                                        "returns", "class_", "lambda_expression"}) {
+        EXPECT_EQ(table.classify(word), TokenType::IDENTIFIER) << word;
+    }
+
+    // Views into a larger buffer compare by contents
+    const std::string source = "x = lambda y: y";
+    EXPECT_EQ(table.classify(std::string_view(source).substr(4, 6)), TokenType::KEYWORD);
+    EXPECT_EQ(table.classify(std::string_view(source).substr(4, 7)), TokenType::IDENTIFIER);
+}
+
+// =============================================================================
+// Byte Scan Tests
+// =============================================================================
+
+TEST(ByteScanTest, KernelsMatchStandardSearch) {
+    // Sparse stop bytes between runs of plain text and blanks, so matches
+    // fall in vector bodies, across block boundaries and in scalar tails
+    std::mt19937 rng(42);
+    const std::string_view alphabet = "aaaaaaaaaaaaaaaaaaaa      \t\t\n\"'\\*";
+    std::string text(1000, ' ');
+    for (auto& c : text) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+
+    const std::string_view sets[] = {"\n", "\"\\\n", "`${}\\", " \t\r", "*", "abcdefgh"};
+    const ScanKernel kernels[] = {ScanKernel::SCALAR, ScanKernel::SSE2, ScanKernel::AVX2, ScanKernel::AUTO};
+
+    for (const auto kernel : kernels) {
+        for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000}) {
+            const std::string_view view(text.data(), length);
+            for (size_t pos = 0; pos <= length; pos += 7) {
+                for (const auto set : sets) {
+                    const auto any = view.find_first_of(set, pos);
+                    EXPECT_EQ(ByteScan::find_any_of(view, pos, set, kernel),
+                              any == std::string_view::npos ? length : any);
+                    const auto other = view.find_first_not_of(set, pos);
+                    EXPECT_EQ(ByteScan::skip_all_of(view, pos, set, kernel),
+                              other == std::string_view::npos ? length : other);
+                }
+
+                const auto newlines = ByteScan::count_newlines(view, pos, length, kernel);
+                EXPECT_EQ(newlines.count,
+                          static_cast<size_t>(std::count(view.begin() + pos, view.end(), '\n')));
+                if (newlines.count > 0) {
+                    EXPECT_EQ(newlines.last, view.rfind('\n'));
+                }
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Chunked Scan Tests
+// =============================================================================
+
+TEST(ChunkedScanTest, SplitsAtLineStarts) {
+    EXPECT_EQ(ChunkedScan::split("int x;\n", 8).size(), 1);
+
+    std::string source;
+    while (source.size() < ChunkedScan::MIN_SOURCE_BYTES * 2) {
+        source += "int value = compute(" + std::to_string(source.size() % 997) + ");\n";
+    }
+
+    const auto pieces = ChunkedScan::split(source, 5);
+    ASSERT_EQ(pieces.size(), 5);
+    EXPECT_EQ(pieces.front().begin, 0);
+    EXPECT_EQ(pieces.back().end, source.size());
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        EXPECT_EQ(pieces[i].begin, pieces[i - 1].end);
+        EXPECT_EQ(source[pieces[i].begin - 1], '\n');
+        EXPECT_EQ(pieces[i].line, 1 + std::count(source.begin(), source.begin() + pieces[i].begin, '\n'));
+    }
+}
+
+// =============================================================================
+// Token Store Tests
+// =============================================================================
+
+TEST(TokenStoreTest, ColumnsAndSignificantSequence) {
+    const auto make = [](TokenType type, uint32_t hash, uint32_t line) {
+        return NormalizedToken{type, hash, hash % 7, line, static_cast<uint16_t>(hash % 80), 3};
+    };
+
+    // No structural tokens: the significant sequence is the full one
+    TokenStore flat;
+    for (uint32_t i = 0; i < 40; ++i) {
+        flat.push_back(make(TokenType::IDENTIFIER, 1000 + i, i / 4));
+    }
+    EXPECT_EQ(flat.significant_size(), flat.size());
+    EXPECT_EQ(flat.significant_hashes(false).data(), flat.original_hashes().data());
+    EXPECT_EQ(flat.token_index(17), 17);
+
+    // Structural tokens after the first significant ones are filtered out
+    TokenStore store;
+    std::vector<NormalizedToken> pushed;
+    std::vector<uint64_t> significant;
+    std::vector<size_t> positions;
+    for (uint32_t i = 0; i < 200; ++i) {
+        const TokenType type = i % 9 == 5 ? TokenType::NEWLINE
+                             : i % 23 == 11 ? TokenType::INDENT
+                             : i % 3 == 0 ? TokenType::KEYWORD : TokenType::OPERATOR;
+        pushed.push_back(make(type, 5000 + i * 13, i / 5));
+        store.push_back(pushed.back());
+        if (!TokenStore::is_structural(type)) {
+            significant.push_back(pushed.back().original_hash);
+            positions.push_back(i);
+        }
+    }
+
+    ASSERT_EQ(store.size(), pushed.size());
+    size_t i = 0;
+    for (const auto tok : store) {
+        EXPECT_EQ(tok, pushed[i]);
+        EXPECT_EQ(tok.line, pushed[i].line);
+        EXPECT_EQ(tok.column, pushed[i].column);
+        EXPECT_EQ(tok.length, pushed[i].length);
+        ++i;
+    }
+    EXPECT_EQ(store.back(), pushed.back());
+    EXPECT_EQ(store.lines()[42], pushed[42].line);
+
+    ASSERT_EQ(store.significant_size(), significant.size());
+    const auto hashes = store.significant_hashes(false);
+    const auto normalized = store.significant_hashes(true);
+    for (size_t pos = 0; pos < significant.size(); ++pos) {
+        EXPECT_EQ(hashes[pos], significant[pos]);
+        EXPECT_EQ(normalized[pos], significant[pos] % 7);
+        EXPECT_EQ(store.token_index(pos), positions[pos]);
+    }
+
+    // 32-bit columns hash like their widened copies
+    EXPECT_EQ(HashSequence::compute_all(hashes, 10, HashFunction::MERSENNE_61),
+              HashSequence::compute_all(significant, 10, HashFunction::MERSENNE_61));
+
+    // Appending a store matches pushing its tokens one by one
+    TokenStore appended = flat;
+    TokenStore one_by_one = flat;
+    appended.append(store);
+    for (const auto tok : store) {
+        one_by_one.push_back(tok);
+    }
+    EXPECT_TRUE(std::ranges::equal(appended.lines(), one_by_one.lines()));
+    EXPECT_TRUE(std::ranges::equal(appended.significant_hashes(true), one_by_one.significant_hashes(true)));
+    ASSERT_EQ(appended.significant_size(), one_by_one.significant_size());
+    for (size_t pos = 0; pos < appended.significant_size(); ++pos) {
+        EXPECT_EQ(appended.token_index(pos), one_by_one.token_index(pos));
+    }
+
+    store.clear();
+    EXPECT_TRUE(store.empty());
+    EXPECT_EQ(store.significant_size(), 0);
+}
+
+// =============================================================================
+// Tokenizer Benchmark
+// =============================================================================
+
+TEST(TokenizerBenchmarkTest, DISABLED_BenchmarkTokenizerThroughput) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*BenchmarkTokenizerThroughput*"
+    // AEGIS_BENCH_MB sets the source size per language (default 32 MB)
+
+    const char* size_env = std::getenv("AEGIS_BENCH_MB");
+    const size_t source_bytes = (size_env ? std::stoul(size_env) : 32) << 20;
+
+    struct Sample {
+        const char* name;
+        Language language;
+        std::string code;
+    };
+
+    // Identifier-heavy code (keywords, builtin types and plain names), then
+    // code dominated by comments, docstrings and string literals
+    const Sample samples[] = {
+        {"Python", Language::PYTHON,
+         "def process_items(items, limit):\n"
+         "    result = list()\n"
+         "    for index, item in enumerate(items):\n"
+         "        if item is not None and isinstance(item, dict):\n"
+         "            result.append(str(item.get('name', index)))\n"
+         "        elif index > limit:\n"
+         "            break\n"
+         "    return tuple(result)\n\n"},
+        {"JavaScript", Language::JAVASCRIPT,
+         "export async function processItems(items, limit) {\n"
+         "    const result = new Array();\n"
+         "    for (let index = 0; index < items.length; index++) {\n"
+         "        if (items[index] !== null && typeof items[index] === 'object') {\n"
+         "            result.push(String(items[index].name));\n"
+         "        } else if (index > limit) {\n"
+         "            break;\n"
+         "        }\n"
+         "    }\n"
+         "    return await Promise.resolve(result);\n"
+         "}\n\n"},
+        {"C++", Language::CPP,
+         "static std::vector<std::string> process_items(const std::vector<Item>& items, size_t limit) {\n"
+         "    std::vector<std::string> result;\n"
+         "    for (size_t index = 0; index < items.size(); ++index) {\n"
+         "        if (items[index].valid && !items[index].name.empty()) {\n"
+         "            result.push_back(static_cast<std::string>(items[index].name));\n"
+         "        } else if (index > limit) {\n"
+         "            break;\n"
+         "        }\n"
+         "    }\n"
+         "    return result;\n"
+         "}\n\n"},
+        {"Python (docstrings, comments)", Language::PYTHON,
+         "def load_settings(path):\n"
+         "    \"\"\"Load the settings file at path and return them as a dictionary.\n"
+         "\n"
+         "    Missing keys fall back to the defaults documented in the README; keys\n"
+         "    that are not recognized are kept so newer files still load.\n"
+         "    \"\"\"\n"
+         "    # Read the whole file up front: settings files are small and the parser\n"
+         "    # needs random access for error messages with line numbers.\n"
+         "    message = 'settings file could not be read, falling back to the defaults'\n"
+         "    return parse(path, message)\n\n"},
+        {"JavaScript (comments)", Language::JAVASCRIPT,
+         "/**\n"
+         " * Load the settings file at path and return them as an object.\n"
+         " * Missing keys fall back to the defaults documented in the README.\n"
+         " */\n"
+         "function loadSettings(path) {\n"
+         "    // Settings files are small, so read the whole file up front\n"
+         "    const message = 'settings file could not be read, using the defaults';\n"
+         "    return parse(path, message);\n"
+         "}\n\n"},
+        {"C++ (comments)", Language::CPP,
+         "/**\n"
+         " * Load the settings file at path and return them as a map.\n"
+         " * Missing keys fall back to the defaults documented in the README.\n"
+         " */\n"
+         "Settings load_settings(const std::string& path) {\n"
+         "    // Settings files are small, so read the whole file up front\n"
+         "    const char* message = \"settings file could not be read, using the defaults\";\n"
+         "    return parse(path, message);\n"
+         "}\n\n"},
+    };
+
+    ThreadPool pool;
+    std::cout << "\n=== Tokenizer throughput: " << (source_bytes >> 20) << " MB per language, "
+              << pool.size() << " threads for split sources ===\n";
+    for (const auto& sample : samples) {
+        std::string source;
+        source.reserve(source_bytes + sample.code.size());
+        while (source.size() < source_bytes) {
+            source += sample.code;
+        }
+
+        auto normalizer = create_normalizer(sample.language);
+        const auto start = std::chrono::high_resolution_clock::now();
+        const auto tokenized = normalizer->normalize(source);
+        const auto seconds = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        // Same source split over the pool (C++ and JavaScript only)
+        const auto split_start = std::chrono::high_resolution_clock::now();
+        const auto split = normalizer->normalize(source, std::pmr::get_default_resource(), pool);
+        const auto split_seconds = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - split_start).count();
+        EXPECT_EQ(split.tokens.size(), tokenized.tokens.size());
+
+        std::cout << sample.name << ": "
+                  << static_cast<double>(source.size()) / (1 << 20) / seconds << " MB/s, "
+                  << static_cast<double>(source.size()) / (1 << 20) / split_seconds << " MB/s split, "
+                  << tokenized.tokens.size() << " tokens\n";
+    }
+}
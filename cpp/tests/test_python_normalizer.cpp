@@ -60,8 +60,8 @@ TEST_F(PythonNormalizerTest, KeywordsPreserveOriginalHash) {
     ASSERT_FALSE(result1.tokens.empty());
     ASSERT_FALSE(result2.tokens.empty());
 
-    auto& tok1 = result1.tokens[0];
-    auto& tok2 = result2.tokens[0];
+    const auto tok1 = result1.tokens[0];
+    const auto tok2 = result2.tokens[0];
 
     EXPECT_EQ(tok1.original_hash, tok2.original_hash);
     EXPECT_EQ(tok1.normalized_hash, tok2.normalized_hash);
@@ -397,6 +397,45 @@ TEST_F(PythonNormalizerTest, CountsLinesCorrectly) {
     EXPECT_EQ(result.comment_lines, 1);
 }
 
+TEST_F(PythonNormalizerTest, LongCommentsDocstringsAndStringsKeepPositions) {
+    const std::string padding(80, 'x');
+    auto result = normalizer.normalize(
+        "def f():\n"
+        "    \"\"\"Docstring " + padding + "\n"
+        "    with an escaped \\\"\"\" quote and a second line.\n"
+        "    \"\"\"\n"
+        "    # Comment " + padding + "\n"
+        "\tvalue = 'text " + padding + " \\' end'  # trailing\n"
+        "    return value\n"
+    );
+
+    std::vector<NormalizedToken> identifiers;
+    std::optional<NormalizedToken> string_token;
+    for (const auto& tok : result.tokens) {
+        if (tok.type == TokenType::IDENTIFIER) {
+            identifiers.push_back(tok);
+        } else if (tok.type == TokenType::STRING_LITERAL) {
+            string_token = tok;
+        }
+    }
+
+    // f, value, value
+    ASSERT_EQ(identifiers.size(), 3);
+    EXPECT_EQ(identifiers[1].line, 6);
+    EXPECT_EQ(identifiers[1].column, 2);
+    EXPECT_EQ(identifiers[2].line, 7);
+    EXPECT_EQ(identifiers[2].column, 12);
+
+    // The docstring is skipped; the string's escape sequence is not part of its hash
+    ASSERT_TRUE(string_token.has_value());
+    EXPECT_EQ(string_token->line, 6);
+    EXPECT_EQ(string_token->column, 10);
+    const auto unescaped = normalizer.normalize("'text " + padding + "  end'");
+    ASSERT_EQ(unescaped.tokens.size(), 1);
+    EXPECT_EQ(string_token->original_hash, unescaped.tokens[0].original_hash);
+    EXPECT_EQ(result.total_lines, 7);
+}
+
 // =============================================================================
 // Full Function Tests
 // =============================================================================
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include "core/rolling_hash.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <vector>
 
 using namespace aegis::similarity;
@@ -159,17 +162,11 @@ TEST_F(RollingHashTest, HashSequenceComputesAllWindows) {
     // Window size 3 over 6 tokens = 4 windows
     ASSERT_EQ(results.size(), 4);
 
-    // Verify positions
-    EXPECT_EQ(results[0].first, 0);  // Window [1,2,3]
-    EXPECT_EQ(results[1].first, 1);  // Window [2,3,4]
-    EXPECT_EQ(results[2].first, 2);  // Window [3,4,5]
-    EXPECT_EQ(results[3].first, 3);  // Window [4,5,6]
-
-    // Verify hashes
-    EXPECT_EQ(results[0].second, RollingHash::compute_hash({1, 2, 3}));
-    EXPECT_EQ(results[1].second, RollingHash::compute_hash({2, 3, 4}));
-    EXPECT_EQ(results[2].second, RollingHash::compute_hash({3, 4, 5}));
-    EXPECT_EQ(results[3].second, RollingHash::compute_hash({4, 5, 6}));
+    // Verify hashes (indexed by window start position)
+    EXPECT_EQ(results[0], RollingHash::compute_hash({1, 2, 3}));
+    EXPECT_EQ(results[1], RollingHash::compute_hash({2, 3, 4}));
+    EXPECT_EQ(results[2], RollingHash::compute_hash({3, 4, 5}));
+    EXPECT_EQ(results[3], RollingHash::compute_hash({4, 5, 6}));
 }
 
 TEST_F(RollingHashTest, HashSequenceEmptyForSmallInput) {
@@ -184,8 +181,54 @@ TEST_F(RollingHashTest, HashSequenceHandlesSingleWindow) {
     auto results = HashSequence::compute_all(tokens, 3);
 
     ASSERT_EQ(results.size(), 1);
-    EXPECT_EQ(results[0].first, 0);
-    EXPECT_EQ(results[0].second, RollingHash::compute_hash({1, 2, 3}));
+    EXPECT_EQ(results[0], RollingHash::compute_hash({1, 2, 3}));
+}
+
+TEST_F(RollingHashTest, WinnowSelectsRightmostMinimum) {
+    std::vector<uint64_t> windows = {77, 74, 42, 17, 98, 50, 17, 98, 8, 88};
+    auto fingerprints = HashSequence::winnow(windows, 4);
+
+    // Runs: [77,74,42,17] -> 3, [74,42,17,98] -> 3, [42,17,98,50] -> 3,
+    // [17,98,50,17] -> 6 (rightmost tie), [98,50,17,98] -> 6, [50,17,98,8] -> 8, ...
+    ASSERT_EQ(fingerprints.size(), 3);
+    EXPECT_EQ(fingerprints[0].first, 3);
+    EXPECT_EQ(fingerprints[1].first, 6);
+    EXPECT_EQ(fingerprints[2].first, 8);
+}
+
+TEST_F(RollingHashTest, WinnowCoversEveryRun) {
+    std::vector<uint64_t> tokens;
+    for (uint64_t i = 0; i < 2000; ++i) {
+        tokens.push_back((i * 2654435761ULL) % 97);
+    }
+    const auto windows = HashSequence::compute_all(tokens, 5);
+
+    for (const size_t w : {2, 8, 26}) {
+        auto fingerprints = HashSequence::winnow(windows, w);
+
+        // Every run of w consecutive windows must contain a fingerprint
+        std::vector<bool> selected(windows.size(), false);
+        for (const auto& [pos, hash] : fingerprints) {
+            selected[pos] = true;
+        }
+        size_t since_last = 0;
+        for (size_t i = 0; i < windows.size(); ++i) {
+            since_last = selected[i] ? 0 : since_last + 1;
+            ASSERT_LT(since_last, w) << "window " << i << ", w=" << w;
+        }
+
+        // Density is roughly 2 / (w + 1)
+        EXPECT_LT(fingerprints.size(), windows.size() * 3 / (w + 1) + 1);
+    }
+}
+
+TEST_F(RollingHashTest, WinnowShortInputKeepsMinimum) {
+    std::vector<uint64_t> windows = {9, 3, 5};
+    auto fingerprints = HashSequence::winnow(windows, 10);
+
+    ASSERT_EQ(fingerprints.size(), 1);
+    EXPECT_EQ(fingerprints[0].first, 1);
+    EXPECT_EQ(HashSequence::winnow(windows, 1).size(), windows.size());
 }
 
 // =============================================================================
@@ -256,7 +299,7 @@ TEST_F(RollingHashTest, LowCollisionRateForSequentialValues) {
 
     // Check for unique hashes (should be very high uniqueness)
     std::set<uint64_t> unique_hashes;
-    for (const auto& [pos, hash] : results) {
+    for (const uint64_t hash : results) {
         unique_hashes.insert(hash);
     }
 
@@ -265,6 +308,106 @@ TEST_F(RollingHashTest, LowCollisionRateForSequentialValues) {
     EXPECT_GT(uniqueness, 0.99);
 }
 
+// =============================================================================
+// Mersenne-61 Policy Tests
+// =============================================================================
+
+TEST_F(RollingHashTest, Mersenne61MulMatchesWideModulo) {
+    __extension__ using uint128 = unsigned __int128;
+    const uint64_t values[] = {0, 1, 2, Mersenne61HashPolicy::MOD - 1,
+                               Mersenne61HashPolicy::BASE, 0x123456789ABCDEFULL & Mersenne61HashPolicy::MOD};
+    for (const uint64_t a : values) {
+        for (const uint64_t b : values) {
+            const auto expected = static_cast<uint64_t>(
+                static_cast<uint128>(a) * b % Mersenne61HashPolicy::MOD);
+            EXPECT_EQ(Mersenne61HashPolicy::mul(a, b), expected) << a << " * " << b;
+        }
+    }
+    EXPECT_EQ(Mersenne61HashPolicy::reduce(~0ULL), (~0ULL) % Mersenne61HashPolicy::MOD);
+}
+
+TEST_F(RollingHashTest, Mersenne61RollingMatchesComputeHash) {
+    // Window size 7 exercises a non-power-of-two window in an 8-slot ring
+    std::vector<uint64_t> tokens;
+    for (uint64_t i = 0; i < 100; ++i) {
+        tokens.push_back(i * 0x9E3779B97F4A7C15ULL);
+    }
+
+    RollingHash61 hasher(7);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto hash = hasher.push(tokens[i]);
+        if (i + 1 < 7) {
+            EXPECT_FALSE(hash.has_value());
+            continue;
+        }
+        ASSERT_TRUE(hash.has_value());
+        std::vector<uint64_t> window(tokens.begin() + static_cast<std::ptrdiff_t>(i - 6),
+                                     tokens.begin() + static_cast<std::ptrdiff_t>(i + 1));
+        EXPECT_EQ(*hash, RollingHash61::compute_hash(window));
+        EXPECT_LT(*hash, RollingHash61::MOD);
+    }
+    EXPECT_EQ(hasher.current_size(), 7);
+}
+
+TEST_F(RollingHashTest, ComputeAllDispatchesHashFunction) {
+    std::vector<uint64_t> tokens = {5, 4, 3, 2, 1, 0, 9, 8};
+
+    auto legacy = HashSequence::compute_all(tokens, 4, HashFunction::MOD_1E9_9);
+    auto wide = HashSequence::compute_all(tokens, 4, HashFunction::MERSENNE_61);
+
+    EXPECT_EQ(legacy, HashSequence::compute_all(tokens, 4));
+    EXPECT_EQ(wide, HashSequence::compute_all<Mersenne61HashPolicy>(tokens, 4));
+    ASSERT_EQ(wide.size(), 5);
+    EXPECT_EQ(wide[2], RollingHash61::compute_hash({3, 2, 1, 0}));
+}
+
+TEST_F(RollingHashTest, Mersenne61NoCollisionsOnLargeInput) {
+    std::vector<uint64_t> tokens;
+    for (uint64_t i = 0; i < 200000; ++i) {
+        tokens.push_back((i * 2654435761ULL) & 0xFFFFFFFF);
+    }
+    auto results = HashSequence::compute_all<Mersenne61HashPolicy>(tokens, 10);
+
+    std::vector<uint64_t> hashes = results;
+    std::sort(hashes.begin(), hashes.end());
+    EXPECT_EQ(std::adjacent_find(hashes.begin(), hashes.end()), hashes.end());
+}
+
+TEST_F(RollingHashTest, AllKernelsProduceIdenticalHashes) {
+    std::vector<uint64_t> tokens;
+    uint64_t x = 12345;
+    for (size_t i = 0; i < 1234; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        tokens.push_back(i % 7 == 0 ? ~0ULL - i : x >> 11);  // Include unreduced values
+    }
+
+    // The legacy policy is only exact for 32-bit token hashes
+    std::vector<uint64_t> narrow_tokens;
+    for (const uint64_t token : tokens) {
+        narrow_tokens.push_back(token & 0xFFFFFFFF);
+    }
+
+    for (const size_t window : {1, 5, 16}) {
+        for (const auto function : {HashFunction::MOD_1E9_9, HashFunction::MERSENNE_61}) {
+            const auto& input = function == HashFunction::MOD_1E9_9 ? narrow_tokens : tokens;
+            const auto scalar = HashSequence::compute_all(input, window, function, HashKernel::SCALAR);
+            ASSERT_EQ(scalar.size(), input.size() - window + 1);
+            EXPECT_EQ(HashSequence::compute_all(input, window, function, HashKernel::MULTI_LANE), scalar);
+            EXPECT_EQ(HashSequence::compute_all(input, window, function, HashKernel::AVX2), scalar);
+            EXPECT_EQ(HashSequence::compute_all(input, window, function), scalar);
+        }
+    }
+
+    // Rolling push() agrees with the batch kernels
+    const auto batch = HashSequence::compute_all(tokens, 16, HashFunction::MERSENNE_61);
+    RollingHash61 hasher(16);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (auto hash = hasher.push(tokens[i])) {
+            ASSERT_EQ(*hash, batch[i + 1 - 16]) << "position " << i;
+        }
+    }
+}
+
 // =============================================================================
 // Real-World Simulation
 // =============================================================================
@@ -287,8 +430,8 @@ TEST_F(RollingHashTest, DetectDuplicateSequences) {
     // Count occurrences
     int occurrences = 0;
     std::vector<size_t> positions;
-    for (const auto& [pos, hash] : results) {
-        if (hash == pattern_hash) {
+    for (size_t pos = 0; pos < results.size(); ++pos) {
+        if (results[pos] == pattern_hash) {
             occurrences++;
             positions.push_back(pos);
         }
@@ -298,3 +441,47 @@ TEST_F(RollingHashTest, DetectDuplicateSequences) {
     EXPECT_EQ(positions[0], 5);   // First at index 5
     EXPECT_EQ(positions[1], 13);  // Second at index 13
 }
+
+// =============================================================================
+// Performance Benchmark Tests
+// =============================================================================
+
+TEST_F(RollingHashTest, DISABLED_BenchmarkHashPolicies) {
+    // Disabled by default - enable manually for benchmarking
+    // Use: ./similarity_tests --gtest_also_run_disabled_tests --gtest_filter="*Benchmark*"
+
+    std::vector<uint64_t> tokens;
+    for (uint64_t i = 0; i < 5'000'000; ++i) {
+        uint64_t x = (i + 1) * 0x9E3779B97F4A7C15ULL;  // splitmix64 finalizer
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        tokens.push_back((x ^ (x >> 31)) & 0xFFFF);  // 16-bit token alphabet
+    }
+
+    const auto run = [&tokens](const char* name, const HashFunction function, const HashKernel kernel) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto results = HashSequence::compute_all(tokens, 10, function, kernel);
+        const auto end = std::chrono::high_resolution_clock::now();
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        std::vector<uint64_t> hashes = results;
+        std::sort(hashes.begin(), hashes.end());
+        const auto unique = static_cast<size_t>(
+            std::unique(hashes.begin(), hashes.end()) - hashes.begin());
+
+        std::cout << name << ": " << us / 1000.0 << " ms, "
+                  << static_cast<double>(tokens.size()) / static_cast<double>(us) << " Mtokens/s, "
+                  << results.size() - unique << " colliding windows\n";
+        return results;
+    };
+
+    std::cout << "\n=== Rolling hash policies (" << tokens.size() << " tokens, window 10) ===\n";
+    std::cout << "AVX2 available: " << (HashSequence::avx2_supported() ? "yes" : "no") << "\n";
+    run("Mod 1e9+9   scalar     ", HashFunction::MOD_1E9_9, HashKernel::SCALAR);
+    run("Mod 1e9+9   multi-lane ", HashFunction::MOD_1E9_9, HashKernel::MULTI_LANE);
+    const auto scalar = run("Mersenne 61 scalar     ", HashFunction::MERSENNE_61, HashKernel::SCALAR);
+    const auto lanes = run("Mersenne 61 multi-lane ", HashFunction::MERSENNE_61, HashKernel::MULTI_LANE);
+    const auto avx2 = run("Mersenne 61 AVX2       ", HashFunction::MERSENNE_61, HashKernel::AVX2);
+    EXPECT_EQ(lanes, scalar);
+    EXPECT_EQ(avx2, scalar);
+}
@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+#include "core/seed_chainer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace aegis::similarity;
+
+namespace {
+
+// One window seed
+ClonePair make_seed(uint32_t file_a, uint32_t start_a, uint32_t file_b, uint32_t start_b,
+                    uint32_t window = 10) {
+    ClonePair pair{};
+    pair.location_a = {file_a, start_a, window};
+    pair.location_b = {file_b, start_b, window};
+    pair.clone_type = CloneType::TYPE_1;
+    pair.similarity = 1.0f;
+    return pair;
+}
+
+// Every window of an exact clone of the given length
+std::vector<ClonePair> clone_seeds(uint32_t file_a, uint32_t start_a, uint32_t file_b,
+                                   uint32_t start_b, uint32_t length, uint32_t window = 10) {
+    std::vector<ClonePair> seeds;
+    for (uint32_t i = 0; i + window <= length; ++i) {
+        seeds.push_back(make_seed(file_a, start_a + i, file_b, start_b + i, window));
+    }
+    return seeds;
+}
+
+}  // anonymous namespace
+
+// =============================================================================
+// Diagonal Chaining Tests
+// =============================================================================
+
+TEST(SeedChainerTest, ChainsAllWindowsOfOneClone) {
+    auto seeds = clone_seeds(0, 100, 1, 40, 200);
+    std::shuffle(seeds.begin(), seeds.end(), std::mt19937(7));
+
+    auto chained = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(chained.size(), 1);
+    EXPECT_EQ(chained[0].location_a.token_start, 100);
+    EXPECT_EQ(chained[0].location_a.token_count, 200);
+    EXPECT_EQ(chained[0].location_b.token_start, 40);
+    EXPECT_EQ(chained[0].location_b.token_count, 200);
+}
+
+TEST(SeedChainerTest, OrientsSwappedSeeds) {
+    auto seeds = clone_seeds(0, 0, 1, 50, 40);
+    for (size_t i = 0; i < seeds.size(); i += 2) {
+        std::swap(seeds[i].location_a, seeds[i].location_b);
+    }
+
+    auto chained = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(chained.size(), 1);
+    EXPECT_EQ(chained[0].location_a.file_id, 0);
+    EXPECT_EQ(chained[0].location_b.file_id, 1);
+    EXPECT_EQ(chained[0].token_count(), 40);
+}
+
+TEST(SeedChainerTest, BridgesGapsUpToMaxGap) {
+    // Windows at 0 and 15 with window 10 leave a 5-token gap
+    std::vector<ClonePair> seeds = {make_seed(0, 0, 1, 0), make_seed(0, 15, 1, 15)};
+
+    SeedChainer::Config config;
+    config.max_gap = 5;
+    EXPECT_EQ(SeedChainer(config).chain(seeds).size(), 1);
+
+    config.max_gap = 4;
+    EXPECT_EQ(SeedChainer(config).chain(seeds).size(), 2);
+}
+
+TEST(SeedChainerTest, JoinsRunsAcrossSmallDiagonalShift) {
+    // Two tokens inserted in file 1 after the first 50 tokens
+    auto seeds = clone_seeds(0, 0, 1, 0, 50);
+    auto tail = clone_seeds(0, 50, 1, 52, 50);
+    seeds.insert(seeds.end(), tail.begin(), tail.end());
+
+    auto chained = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(chained.size(), 1);
+    EXPECT_EQ(chained[0].location_a.token_count, 100);
+    EXPECT_EQ(chained[0].location_b.token_count, 102);
+}
+
+TEST(SeedChainerTest, KeepsSeparateClonesAndFilePairsApart) {
+    auto seeds = clone_seeds(0, 0, 1, 0, 30);
+    auto far = clone_seeds(0, 500, 1, 900, 30);
+    auto other_file = clone_seeds(0, 0, 2, 0, 30);
+    auto same_file = clone_seeds(3, 0, 3, 100, 30);
+    seeds.insert(seeds.end(), far.begin(), far.end());
+    seeds.insert(seeds.end(), other_file.begin(), other_file.end());
+    seeds.insert(seeds.end(), same_file.begin(), same_file.end());
+
+    auto chained = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(chained.size(), 4);
+    for (const auto& pair : chained) {
+        EXPECT_EQ(pair.token_count(), 30);
+    }
+    // Grouped by file pair in ascending order
+    EXPECT_EQ(chained[0].location_b.file_id, 1);
+    EXPECT_EQ(chained[1].location_b.file_id, 1);
+    EXPECT_EQ(chained[2].location_b.file_id, 2);
+    EXPECT_EQ(chained[3].location_a.file_id, 3);
+}
+
+TEST(SeedChainerTest, SparseDiagonalUsesSameResult) {
+    // Seeds far apart on one diagonal take the comparison-sort path
+    std::vector<ClonePair> seeds = {
+        make_seed(0, 90000, 1, 90000), make_seed(0, 5, 1, 5), make_seed(0, 40000, 1, 40000)
+    };
+
+    auto chained = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(chained.size(), 3);
+    EXPECT_EQ(chained[0].location_a.token_start, 5);
+    EXPECT_EQ(chained[1].location_a.token_start, 40000);
+    EXPECT_EQ(chained[2].location_a.token_start, 90000);
+}
+
+TEST(SeedChainerTest, ParallelMatchesSequential) {
+    std::mt19937 rng(11);
+    std::vector<ClonePair> seeds;
+    for (uint32_t f = 0; f < 40; ++f) {
+        for (int c = 0; c < 5; ++c) {
+            auto clone = clone_seeds(f, rng() % 5000, f + 1 + rng() % 3, rng() % 5000, 20 + rng() % 200);
+            seeds.insert(seeds.end(), clone.begin(), clone.end());
+        }
+    }
+    std::shuffle(seeds.begin(), seeds.end(), rng);
+
+    ThreadPool pool(4);
+    const SeedChainer chainer;
+    auto sequential = chainer.chain(seeds);
+    auto parallel = chainer.chain(seeds, pool);
+
+    ASSERT_EQ(sequential.size(), parallel.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+        EXPECT_EQ(sequential[i].location_a.file_id, parallel[i].location_a.file_id);
+        EXPECT_EQ(sequential[i].location_a.token_start, parallel[i].location_a.token_start);
+        EXPECT_EQ(sequential[i].location_b.token_start, parallel[i].location_b.token_start);
+        EXPECT_EQ(sequential[i].token_count(), parallel[i].token_count());
+    }
+}
+
+// =============================================================================
+// Clone Class Tests
+// =============================================================================
+
+TEST(SeedChainerTest, ChainsShiftedCloneClasses) {
+    // A 40-token block at offset 7 in each of 3 files, one class per window
+    std::vector<CloneClass> classes;
+    for (uint32_t w = 0; w + 10 <= 40; ++w) {
+        CloneClass clone_class{};
+        for (uint32_t f = 0; f < 3; ++f) {
+            clone_class.locations.push_back({f, 7 + w, 10});
+        }
+        clone_class.shared_hash = w;
+        classes.push_back(clone_class);
+    }
+    // A class with a different shape stays separate
+    CloneClass other{};
+    other.locations = {{0, 100, 10}, {2, 300, 10}};
+    classes.push_back(other);
+    std::shuffle(classes.begin(), classes.end(), std::mt19937(1));
+
+    auto chained = SeedChainer().chain_classes(classes);
+
+    ASSERT_EQ(chained.size(), 2);
+    EXPECT_EQ(chained[0].locations.size(), 3);
+    EXPECT_EQ(chained[0].token_count(), 40);
+    EXPECT_EQ(chained[0].shared_hash, 0);
+    for (const auto& loc : chained[0].locations) {
+        EXPECT_EQ(loc.token_start, 7);
+        EXPECT_EQ(loc.token_end(), 47);
+    }
+    EXPECT_EQ(chained[1].token_count(), 10);
+}
+
+// =============================================================================
+// Streaming Tests
+// =============================================================================
+
+TEST(SeedChainerTest, StreamWithCompactionMatchesOneShot) {
+    std::mt19937 rng(5);
+    std::vector<ClonePair> seeds;
+    for (uint32_t f = 0; f < 10; ++f) {
+        for (int c = 0; c < 8; ++c) {
+            auto clone = clone_seeds(f, rng() % 3000, f + 1, rng() % 3000, 20 + rng() % 150);
+            seeds.insert(seeds.end(), clone.begin(), clone.end());
+        }
+    }
+    std::shuffle(seeds.begin(), seeds.end(), rng);
+
+    SeedChainer::Config config;
+    config.compact_threshold = 100;
+    const SeedChainer chainer(config);
+
+    auto stream = chainer.stream();
+    for (size_t i = 0; i < seeds.size(); i += 37) {
+        const size_t n = std::min<size_t>(37, seeds.size() - i);
+        stream.add(std::span<const ClonePair>(seeds).subspan(i, n));
+    }
+    // Compaction keeps far fewer entries alive than the raw seeds
+    EXPECT_LT(stream.peak_size(), seeds.size() / 4);
+
+    auto streamed = stream.finish();
+    auto one_shot = SeedChainer().chain(seeds);
+
+    ASSERT_EQ(streamed.size(), one_shot.size());
+    for (size_t i = 0; i < streamed.size(); ++i) {
+        EXPECT_EQ(streamed[i].location_a.file_id, one_shot[i].location_a.file_id);
+        EXPECT_EQ(streamed[i].location_a.token_start, one_shot[i].location_a.token_start);
+        EXPECT_EQ(streamed[i].location_a.token_count, one_shot[i].location_a.token_count);
+        EXPECT_EQ(streamed[i].location_b.token_start, one_shot[i].location_b.token_start);
+        EXPECT_EQ(streamed[i].location_b.token_count, one_shot[i].location_b.token_count);
+    }
+}
+
+// =============================================================================
+// Benchmark (run with --gtest_also_run_disabled_tests)
+// =============================================================================
+
+TEST(SeedChainerTest, DISABLED_BenchmarkChaining) {
+    std::mt19937 rng(3);
+    std::vector<ClonePair> seeds;
+    for (uint32_t f = 0; f < 2000; ++f) {
+        for (int c = 0; c < 10; ++c) {
+            auto clone = clone_seeds(f, rng() % 20000, rng() % 2000, rng() % 20000, 30 + rng() % 300);
+            seeds.insert(seeds.end(), clone.begin(), clone.end());
+        }
+    }
+    std::shuffle(seeds.begin(), seeds.end(), rng);
+
+    ThreadPool pool;
+    const SeedChainer chainer;
+
+    auto start = std::chrono::steady_clock::now();
+    const auto sequential = chainer.chain(seeds);
+    const auto sequential_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    const auto parallel = chainer.chain(seeds, pool);
+    const auto parallel_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << seeds.size() << " seeds -> " << sequential.size() << " regions\n"
+              << "  sequential: " << sequential_ms << " ms\n"
+              << "  parallel (" << pool.size() << " threads): " << parallel_ms << " ms\n";
+    EXPECT_EQ(sequential.size(), parallel.size());
+}
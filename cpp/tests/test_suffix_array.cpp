@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "core/suffix_array.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace aegis::similarity;
+
+namespace {
+
+std::vector<uint32_t> naive_suffix_array(const std::vector<uint32_t>& text) {
+    std::vector<uint32_t> sa(text.size());
+    std::iota(sa.begin(), sa.end(), 0);
+    std::sort(sa.begin(), sa.end(), [&text](uint32_t a, uint32_t b) {
+        return std::lexicographical_compare(text.begin() + a, text.end(),
+                                            text.begin() + b, text.end());
+    });
+    return sa;
+}
+
+TokenizedFile make_file(const std::string& path, const std::vector<uint32_t>& hashes) {
+    TokenizedFile file;
+    file.path = path;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        NormalizedToken tok{};
+        tok.type = TokenType::IDENTIFIER;
+        tok.original_hash = hashes[i];
+        tok.normalized_hash = hashes[i];
+        tok.line = static_cast<uint32_t>(i + 1);
+        tok.column = 1;
+        tok.length = 1;
+        file.tokens.push_back(tok);
+    }
+    return file;
+}
+
+}  // anonymous namespace
+
+// =============================================================================
+// Suffix Array / LCP Tests
+// =============================================================================
+
+TEST(SuffixArrayTest, MatchesNaiveSortOnBanana) {
+    // "banana" + sentinel with a=1, b=2, n=3
+    std::vector<uint32_t> text = {2, 1, 3, 1, 3, 1, 0};
+    auto sa = build_suffix_array(text, 4);
+
+    EXPECT_EQ(sa, naive_suffix_array(text));
+    EXPECT_EQ(sa, (std::vector<uint32_t>{6, 5, 3, 1, 0, 4, 2}));
+
+    auto lcp = build_lcp_array(text, sa);
+    EXPECT_EQ(lcp, (std::vector<uint32_t>{0, 0, 1, 3, 0, 0, 2}));
+}
+
+TEST(SuffixArrayTest, MatchesNaiveSortOnRandomTexts) {
+    std::mt19937 rng(42);
+    for (const uint32_t alphabet : {2u, 3u, 20u}) {
+        for (int round = 0; round < 20; ++round) {
+            std::vector<uint32_t> text(1 + rng() % 300);
+            for (auto& symbol : text) {
+                symbol = 1 + rng() % (alphabet - 1);
+            }
+            text.push_back(0);
+
+            auto sa = build_suffix_array(text, alphabet);
+            ASSERT_EQ(sa, naive_suffix_array(text)) << "alphabet " << alphabet;
+
+            auto lcp = build_lcp_array(text, sa);
+            for (size_t i = 1; i < sa.size(); ++i) {
+                size_t h = 0;
+                while (sa[i - 1] + h < text.size() && sa[i] + h < text.size() &&
+                       text[sa[i - 1] + h] == text[sa[i] + h]) {
+                    ++h;
+                }
+                ASSERT_EQ(lcp[i], h);
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Clone Finder Tests
+// =============================================================================
+
+TEST(SuffixArrayCloneFinderTest, FindsMaximalRepeatAcrossFiles) {
+    std::vector<uint32_t> shared;
+    for (uint32_t i = 0; i < 40; ++i) {
+        shared.push_back(100 + i);
+    }
+
+    std::vector<uint32_t> a = {1, 2, 3};
+    a.insert(a.end(), shared.begin(), shared.end());
+    a.push_back(4);
+    std::vector<uint32_t> b = {7};
+    b.insert(b.end(), shared.begin(), shared.end());
+    b.insert(b.end(), {8, 9});
+
+    SuffixArrayCloneFinder::Config config;
+    config.min_tokens = 20;
+    SuffixArrayCloneFinder finder(config);
+    const std::vector<TokenizedFile> files = {make_file("a.py", a), make_file("b.py", b)};
+    auto pairs = finder.find_clone_pairs(files);
+
+    ASSERT_EQ(pairs.size(), 1);
+    EXPECT_EQ(pairs[0].location_a.file_id, 0);
+    EXPECT_EQ(pairs[0].location_a.token_start, 3);
+    EXPECT_EQ(pairs[0].location_b.file_id, 1);
+    EXPECT_EQ(pairs[0].location_b.token_start, 1);
+    EXPECT_EQ(pairs[0].token_count(), 40);
+    const auto span = files[0].tokens.source_span(pairs[0].location_a);
+    EXPECT_EQ(span.start_line, 4);
+    EXPECT_EQ(span.end_line, 43);
+}
+
+TEST(SuffixArrayCloneFinderTest, RepeatsDoNotCrossFileBoundaries) {
+    // File a ends with the same tokens file b starts with, but together
+    // they would only form a long repeat across the boundary
+    std::vector<uint32_t> a, b, c;
+    for (uint32_t i = 0; i < 15; ++i) {
+        a.push_back(200 + i);
+        b.push_back(300 + i);
+    }
+    c = a;
+    c.insert(c.end(), b.begin(), b.end());
+
+    SuffixArrayCloneFinder::Config config;
+    config.min_tokens = 20;
+    SuffixArrayCloneFinder finder(config);
+    auto pairs = finder.find_clone_pairs({make_file("a.py", a), make_file("b.py", b), make_file("c.py", c)});
+
+    EXPECT_TRUE(pairs.empty());
+}
+
+TEST(SuffixArrayCloneFinderTest, RepetitiveCodeYieldsLinearPairs) {
+    // 600 copies of the same block: the hash index would skip these hashes
+    // (over 500 locations) or emit ~180k pairs
+    std::vector<TokenizedFile> files;
+    std::vector<uint32_t> block;
+    for (uint32_t i = 0; i < 30; ++i) {
+        block.push_back(500 + i);
+    }
+    for (uint32_t f = 0; f < 600; ++f) {
+        std::vector<uint32_t> tokens = {f + 1};  // Unique prefix per file
+        tokens.insert(tokens.end(), block.begin(), block.end());
+        tokens.push_back(f + 10000);             // Unique suffix per file
+        std::string path = "f";
+        path += std::to_string(f);
+        path += ".py";
+        files.push_back(make_file(path, tokens));
+    }
+
+    SuffixArrayCloneFinder::Config config;
+    config.min_tokens = 30;
+    auto pairs = SuffixArrayCloneFinder(config).find_clone_pairs(files);
+
+    EXPECT_EQ(pairs.size(), files.size() - 1);
+    for (const auto& pair : pairs) {
+        EXPECT_EQ(pair.token_count(), 30);
+        EXPECT_EQ(pair.location_a.token_start, 1);
+    }
+}
+
+TEST(SuffixArrayCloneFinderTest, PeriodicRegionInOneFileIsTrimmed) {
+    // Period-10 sequence of 60 tokens: occurrences overlap with themselves
+    std::vector<uint32_t> tokens;
+    for (uint32_t i = 0; i < 60; ++i) {
+        tokens.push_back(1 + i % 10);
+    }
+
+    SuffixArrayCloneFinder::Config config;
+    config.min_tokens = 20;
+    auto pairs = SuffixArrayCloneFinder(config).find_clone_pairs({make_file("p.py", tokens)});
+
+    // Split into two disjoint copies of three periods each
+    ASSERT_EQ(pairs.size(), 1);
+    EXPECT_EQ(pairs[0].location_a.token_start, 0);
+    EXPECT_EQ(pairs[0].location_b.token_start, 30);
+    EXPECT_EQ(pairs[0].token_count(), 30);
+}